@@ -0,0 +1,258 @@
+#ifndef BATCH_HASH_H
+#define BATCH_HASH_H
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define BATCH_HASH_X86 1
+#include <immintrin.h>
+#endif
+
+/*
+* Hash functions that can hash a whole array of keys in one call, for building and probing
+* maps from columnar data.
+*
+* Each hasher is an ordinary hash function object, usable as the H of a HashMap, that also
+* has a static hash_batch(keys, count, out) writing the same values operator() would.
+* HashMap detects hash_batch and uses it in its bulk insert and batched lookup paths.
+*
+* hash_batch picks a kernel at run time from what the CPU reports through CPUID, so the
+* same binary runs everywhere and needs no -mavx2:
+*      - MixHash (multiply-xorshift) hashes four 64-bit lanes at a time with AVX2.
+*      - Crc32cHash and FixedBytesHash use the SSE4.2 crc32 instruction.
+* Every kernel has a portable scalar fallback that produces identical values.
+*
+* Usage:
+*      HashMap<uint64_t, Row, MixHash<uint64_t>> index(keys_and_rows.begin(), keys_and_rows.end());
+*      std::vector<size_t> hashes(keys.size());
+*      hash_batch(MixHash<uint64_t>(), keys.data(), keys.size(), hashes.data());
+*/
+
+// kernels in increasing order of what they need from the CPU
+enum class HashKernel { Scalar, Sse42, Avx2 };
+
+/*
+* Returns the best kernel the running CPU supports; CPUID is queried once.
+*/
+inline HashKernel detected_hash_kernel() {
+#if BATCH_HASH_X86
+    static const HashKernel kernel = [] {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) return HashKernel::Avx2;
+        if (__builtin_cpu_supports("sse4.2")) return HashKernel::Sse42;
+        return HashKernel::Scalar;
+    }();
+    return kernel;
+#else
+    return HashKernel::Scalar;
+#endif
+}
+
+inline const char* hash_kernel_name(HashKernel kernel) {
+    switch (kernel) {
+        case HashKernel::Avx2: return "avx2";
+        case HashKernel::Sse42: return "sse4.2";
+        default: return "scalar";
+    }
+}
+
+/*
+* Multiply-xorshift mixer for 32- and 64-bit integer keys. Unlike std::hash, which is the
+* identity for integers, every input bit affects every output bit, so keys with regular
+* strides spread over all buckets.
+*/
+template<typename K>
+struct MixHash {
+    static_assert(std::is_integral_v<K> && (sizeof(K) == 4 || sizeof(K) == 8),
+                  "MixHash: keys must be 32- or 64-bit integers");
+
+    size_t operator()(K key) const {
+        return static_cast<size_t>(mix(widen(key)));
+    }
+
+    static void hash_batch(const K* keys, size_t count, size_t* out,
+                           HashKernel kernel = detected_hash_kernel()) {
+        size_t done = 0;
+#if BATCH_HASH_X86
+        if (std::min(kernel, detected_hash_kernel()) == HashKernel::Avx2) done = hash_batch_avx2(keys, count, out);
+#endif
+        for (size_t i = done; i < count; i++) out[i] = static_cast<size_t>(mix(widen(keys[i])));
+    }
+
+private:
+    static constexpr uint64_t kMultiplier = 0xd6e8feb86659fd93ULL;
+
+    // 32-bit keys are zero-extended, as the AVX2 kernel does
+    static uint64_t widen(K key) {
+        return static_cast<uint64_t>(static_cast<std::make_unsigned_t<K>>(key));
+    }
+
+    static uint64_t mix(uint64_t x) {
+        x ^= x >> 32;
+        x *= kMultiplier;
+        x ^= x >> 32;
+        x *= kMultiplier;
+        x ^= x >> 32;
+        return x;
+    }
+
+#if BATCH_HASH_X86
+    // AVX2 has no 64-bit multiply, so it is put together from three 32x32 multiplies
+    __attribute__((target("avx2")))
+    static __m256i multiply(__m256i x) {
+        const __m256i low = _mm256_set1_epi64x(static_cast<long long>(kMultiplier & 0xffffffffULL));
+        const __m256i high = _mm256_set1_epi64x(static_cast<long long>(kMultiplier >> 32));
+        __m256i cross = _mm256_add_epi64(_mm256_mul_epu32(_mm256_srli_epi64(x, 32), low),
+                                         _mm256_mul_epu32(x, high));
+        return _mm256_add_epi64(_mm256_mul_epu32(x, low), _mm256_slli_epi64(cross, 32));
+    }
+
+    // hashes keys four at a time and returns how many it did
+    __attribute__((target("avx2")))
+    static size_t hash_batch_avx2(const K* keys, size_t count, size_t* out) {
+        static_assert(sizeof(size_t) == 8, "MixHash: the AVX2 kernel writes 64-bit hashes");
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4) {
+            __m256i x;
+            if constexpr (sizeof(K) == 8) {
+                x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys + i));
+            } else {
+                x = _mm256_cvtepu32_epi64(_mm_loadu_si128(reinterpret_cast<const __m128i*>(keys + i)));
+            }
+            x = _mm256_xor_si256(x, _mm256_srli_epi64(x, 32));
+            x = multiply(x);
+            x = _mm256_xor_si256(x, _mm256_srli_epi64(x, 32));
+            x = multiply(x);
+            x = _mm256_xor_si256(x, _mm256_srli_epi64(x, 32));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), x);
+        }
+        return i;
+    }
+#endif
+};
+
+// table for the reflected CRC32C polynomial 0x82f63b78, one entry per byte value
+constexpr std::array<uint32_t, 256> make_crc32c_table() {
+    std::array<uint32_t, 256> table{};
+    for (uint32_t byte = 0; byte < 256; byte++) {
+        uint32_t crc = byte;
+        for (int bit = 0; bit < 8; bit++) crc = (crc >> 1) ^ (0x82f63b78U & (0U - (crc & 1)));
+        table[byte] = crc;
+    }
+    return table;
+}
+
+inline constexpr std::array<uint32_t, 256> kCrc32cTable = make_crc32c_table();
+
+/*
+* CRC32C (Castagnoli) of a byte range, the polynomial the SSE4.2 crc32 instruction
+* implements. The portable version goes one byte at a time through a 256-entry table.
+*/
+class Crc32c {
+public:
+    static constexpr uint32_t kSeed = 0xffffffffU;
+
+    static uint32_t scalar(uint32_t crc, const unsigned char* bytes, size_t size) {
+        for (size_t i = 0; i < size; i++) crc = kCrc32cTable[(crc ^ bytes[i]) & 0xff] ^ (crc >> 8);
+        return crc;
+    }
+
+#if BATCH_HASH_X86
+    __attribute__((target("sse4.2")))
+    static uint32_t sse42(uint32_t crc, const unsigned char* bytes, size_t size) {
+        size_t i = 0;
+#if defined(__x86_64__)
+        for (; i + 8 <= size; i += 8) {
+            uint64_t word;
+            std::memcpy(&word, bytes + i, 8);
+            crc = static_cast<uint32_t>(_mm_crc32_u64(crc, word));
+        }
+#endif
+        for (; i + 4 <= size; i += 4) {
+            uint32_t word;
+            std::memcpy(&word, bytes + i, 4);
+            crc = _mm_crc32_u32(crc, word);
+        }
+        for (; i < size; i++) crc = _mm_crc32_u8(crc, bytes[i]);
+        return crc;
+    }
+#endif
+
+};
+
+/*
+* CRC32C of the object representation of each key, for integer keys (Crc32cHash) and for
+* fixed-length byte keys such as std::array<unsigned char, 16> (FixedBytesHash<16>).
+* The hash is 32 bits wide, which is plenty for bucket indices; the batch kernel runs the
+* crc32 chains of consecutive keys back to back so their latencies overlap.
+*/
+template<typename K>
+struct Crc32cHash {
+    static_assert(std::has_unique_object_representations_v<K>,
+                  "Crc32cHash: keys must not contain padding bits");
+
+    size_t operator()(const K& key) const {
+        size_t hash;
+        hash_batch(&key, 1, &hash);
+        return hash;
+    }
+
+    static void hash_batch(const K* keys, size_t count, size_t* out,
+                           HashKernel kernel = detected_hash_kernel()) {
+        const auto* bytes = reinterpret_cast<const unsigned char*>(keys);
+#if BATCH_HASH_X86
+        if (std::min(kernel, detected_hash_kernel()) >= HashKernel::Sse42) {
+            hash_batch_sse42(bytes, count, out);
+            return;
+        }
+#endif
+        for (size_t i = 0; i < count; i++) {
+            out[i] = ~Crc32c::scalar(Crc32c::kSeed, bytes + i * sizeof(K), sizeof(K));
+        }
+    }
+
+private:
+#if BATCH_HASH_X86
+    // compiled for SSE4.2 as a whole so Crc32c::sse42 inlines into the loop
+    __attribute__((target("sse4.2")))
+    static void hash_batch_sse42(const unsigned char* bytes, size_t count, size_t* out) {
+        for (size_t i = 0; i < count; i++) {
+            out[i] = ~Crc32c::sse42(Crc32c::kSeed, bytes + i * sizeof(K), sizeof(K));
+        }
+    }
+#endif
+};
+
+template<size_t N>
+using FixedBytesHash = Crc32cHash<std::array<unsigned char, N>>;
+
+/*
+* True if H has a hash_batch that takes an array of K.
+*/
+template<typename H, typename K, typename = void>
+struct HasBatchHash : std::false_type {};
+
+template<typename H, typename K>
+struct HasBatchHash<H, K, std::void_t<decltype(std::declval<const H&>().hash_batch(
+    std::declval<const K*>(), size_t(), std::declval<size_t*>()))>> : std::true_type {};
+
+/*
+* Writes hash(keys[i]) to out[i] for i in [0, count), through H::hash_batch when there
+* is one and one call to hash at a time otherwise.
+*/
+template<typename H, typename K>
+void hash_batch(const H& hash, const K* keys, size_t count, size_t* out) {
+    if constexpr (HasBatchHash<H, K>::value) {
+        hash.hash_batch(keys, count, out);
+    } else {
+        for (size_t i = 0; i < count; i++) out[i] = hash(keys[i]);
+    }
+}
+
+#endif
@@ -0,0 +1,172 @@
+#ifndef BLOOM_FILTER_H
+#define BLOOM_FILTER_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+#include "batch_hash.h"
+
+/*
+* Blocked Bloom filter over precomputed hash values.
+*
+* The bits are split into 64-byte blocks, one cache line each. A hash selects one block
+* and sets or tests one bit in each of the block's eight 64-bit words, so a lookup costs
+* a single cache miss no matter how many bits it checks. On a CPU with AVX2 (detected at
+* run time with detected_hash_kernel(), see batch_hash.h, so no -mavx2 is needed) the eight
+* bits are tested with two 256-bit instructions; otherwise a branch-free scalar loop does
+* the same work, with the same answers.
+*
+* The filter never reports a false negative: may_contain(hash) is true for every hash
+* that was added since the last clear() or reset(). With the default 12 bits per key
+* about 0.5% of absent hashes are reported as present.
+*
+* Usage:
+*      BlockedBloomFilter filter(1000);
+*      filter.add(std::hash<int>()(42));
+*      if (filter.may_contain(std::hash<int>()(7))) { ... }  // almost surely skipped
+*
+* Exceptions: std::out_of_range if bits_per_key is 0.
+*
+* Notes: bits cannot be removed, so erased keys keep answering "maybe" until the filter
+* is rebuilt. stale() counts those erasures for the owner to decide when to rebuild.
+*/
+class BlockedBloomFilter {
+public:
+    static constexpr size_t kDefaultBitsPerKey = 12;
+
+    explicit BlockedBloomFilter(size_t expected_keys = 0, size_t bits_per_key = kDefaultBitsPerKey) :
+        _bits_per_key(bits_per_key) {
+        if (bits_per_key == 0) {
+            throw std::out_of_range("BlockedBloomFilter: bits_per_key cannot be 0");
+        }
+        reset(expected_keys);
+    }
+
+    /*
+    * Clears the filter and resizes it for expected_keys keys.
+    *
+    * Complexity: O(expected_keys)
+    */
+    void reset(size_t expected_keys) {
+        _capacity = std::max<size_t>(expected_keys, 1);
+        size_t blocks = (_capacity * _bits_per_key + kBlockBits - 1) / kBlockBits;
+        _blocks.assign(blocks, Block{});
+        _keys = 0;
+        _stale = 0;
+    }
+
+    /*
+    * Clears the filter, keeping its size.
+    */
+    void clear() {
+        reset(_capacity);
+    }
+
+    void add(size_t hash) {
+        uint64_t mixed = mix(hash);
+        Block& block = _blocks[block_index(mixed)];
+        uint32_t low = static_cast<uint32_t>(mixed);
+        for (size_t i = 0; i < kWordsPerBlock; ++i) {
+            block.words[i] |= uint64_t(1) << bit_index(low, i);
+        }
+        _keys++;
+    }
+
+    bool may_contain(size_t hash) const {
+        return may_contain(hash, _kernel);
+    }
+
+    /*
+    * may_contain with the given kernel, or the best one the CPU supports if that is lower;
+    * for tests and benchmarks of the kernels.
+    */
+    bool may_contain(size_t hash, HashKernel kernel) const {
+        uint64_t mixed = mix(hash);
+        const Block& block = _blocks[block_index(mixed)];
+        uint32_t low = static_cast<uint32_t>(mixed);
+#if BATCH_HASH_X86
+        if (std::min(kernel, detected_hash_kernel()) == HashKernel::Avx2) return may_contain_avx2(block, low);
+#endif
+        uint64_t missing = 0;
+        for (size_t i = 0; i < kWordsPerBlock; ++i) {
+            missing |= ~block.words[i] & (uint64_t(1) << bit_index(low, i));
+        }
+        return missing == 0;
+    }
+
+    /*
+    * Records that one of the added keys has been erased.
+    */
+    void mark_stale() { _stale++; }
+
+    size_t bits_per_key() const { return _bits_per_key; }
+    size_t capacity() const { return _capacity; }
+    size_t keys() const { return _keys; }
+    size_t stale() const { return _stale; }
+
+    size_t memory_usage() const {
+        return sizeof(*this) + _blocks.capacity() * sizeof(Block);
+    }
+
+private:
+    static constexpr size_t kWordsPerBlock = 8;
+    static constexpr size_t kBlockBits = kWordsPerBlock * 64;
+
+    // odd multipliers, one per word, that spread the low 32 bits of the hash
+    static constexpr uint32_t kSalts[kWordsPerBlock] = {
+        0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
+        0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U
+    };
+
+    struct alignas(64) Block {
+        uint64_t words[kWordsPerBlock];
+    };
+
+    // std::hash of an integer is the identity, so the bits are mixed before use
+    static uint64_t mix(uint64_t hash) {
+        hash ^= hash >> 33;
+        hash *= 0xff51afd7ed558ccdULL;
+        hash ^= hash >> 33;
+        hash *= 0xc4ceb9fe1a85ec53ULL;
+        hash ^= hash >> 33;
+        return hash;
+    }
+
+    // maps the high 32 bits onto [0, blocks) without a division
+    size_t block_index(uint64_t mixed) const {
+        return static_cast<size_t>(((mixed >> 32) * _blocks.size()) >> 32);
+    }
+
+    static uint32_t bit_index(uint32_t low, size_t word) {
+        return (low * kSalts[word]) >> 26;
+    }
+
+#if BATCH_HASH_X86
+    __attribute__((target("avx2")))
+    static bool may_contain_avx2(const Block& block, uint32_t low) {
+        const __m256i salts = _mm256_setr_epi32(
+            int(kSalts[0]), int(kSalts[1]), int(kSalts[2]), int(kSalts[3]),
+            int(kSalts[4]), int(kSalts[5]), int(kSalts[6]), int(kSalts[7]));
+        __m256i shifts = _mm256_srli_epi32(_mm256_mullo_epi32(_mm256_set1_epi32(int(low)), salts), 26);
+        const __m256i one = _mm256_set1_epi64x(1);
+        __m256i low_mask = _mm256_sllv_epi64(one, _mm256_cvtepu32_epi64(_mm256_castsi256_si128(shifts)));
+        __m256i high_mask = _mm256_sllv_epi64(one, _mm256_cvtepu32_epi64(_mm256_extracti128_si256(shifts, 1)));
+        const __m256i* words = reinterpret_cast<const __m256i*>(block.words);
+        // testc is 1 when every bit of the mask is also set in the block
+        return _mm256_testc_si256(_mm256_load_si256(words), low_mask)
+             & _mm256_testc_si256(_mm256_load_si256(words + 1), high_mask);
+    }
+#endif
+
+    size_t _bits_per_key;
+    size_t _capacity = 0;
+    size_t _keys = 0;
+    size_t _stale = 0;
+    std::vector<Block> _blocks;
+    HashKernel _kernel = detected_hash_kernel();
+};
+
+#endif
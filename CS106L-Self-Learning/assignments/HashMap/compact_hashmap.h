@@ -0,0 +1,585 @@
+#ifndef COMPACT_HASHMAP_H
+#define COMPACT_HASHMAP_H
+
+#include <algorithm>
+#include <cstdint>
+#include <initializer_list>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+/*
+* Template class for a forward iterator over a CompactHashMap.
+*
+* The iterator is an index into the node pool of the map instead of a node pointer, so it
+* survives the pool growing. Iteration walks the pool in order, which is contiguous memory,
+* instead of walking the chains bucket by bucket.
+*
+* Map = the CompactHashMap the iterator is for
+* IsConst = whether the iterator is a const_iterator
+*/
+template <typename Map, bool IsConst = true>
+class CompactHashMapIterator {
+public:
+    using value_type = std::conditional_t<IsConst, const typename Map::value_type, typename Map::value_type>;
+    using iterator_category = std::forward_iterator_tag;
+    using difference_type = std::ptrdiff_t;
+    using pointer = value_type*;
+    using reference = value_type&;
+
+    friend Map;
+    friend class CompactHashMapIterator<Map, !IsConst>;
+
+    CompactHashMapIterator() : _map(nullptr), _index(0) {}
+
+    /*
+    * Conversion from iterator to const_iterator.
+    */
+    template <bool IsConst_ = IsConst, typename = std::enable_if_t<!IsConst_>>
+    operator CompactHashMapIterator<Map, true>() const {
+        return CompactHashMapIterator<Map, true>(_map, _index);
+    }
+
+    reference operator*() const { return _map->_nodes[_index].value(); }
+    pointer operator->() const { return &_map->_nodes[_index].value(); }
+
+    CompactHashMapIterator& operator++() {
+        ++_index;
+        return *this;
+    }
+
+    CompactHashMapIterator operator++(int) {
+        auto copy = *this;
+        ++_index;
+        return copy;
+    }
+
+    friend bool operator==(const CompactHashMapIterator& lhs, const CompactHashMapIterator& rhs) {
+        return lhs._map == rhs._map && lhs._index == rhs._index;
+    }
+
+    friend bool operator!=(const CompactHashMapIterator& lhs, const CompactHashMapIterator& rhs) {
+        return !(lhs == rhs);
+    }
+
+private:
+    using map_pointer = std::conditional_t<IsConst, const Map*, Map*>;
+
+    CompactHashMapIterator(map_pointer map, size_t index) : _map(map), _index(index) {}
+
+    map_pointer _map;
+    size_t _index;
+};
+
+/*
+* Template class for a memory-compact HashMap
+*
+* K = key type
+* M = mapped type
+* H = hash function type used to hash a key; if not provided, defaults to std::hash<K>
+*
+* CompactHashMap has the interface and the separate-chaining semantics of HashMap, but no
+* node is allocated on its own. All nodes live in one contiguous pool and are linked by
+* 32-bit indices, and the buckets hold 32-bit indices as well:
+*
+*      HashMap<uint32_t, uint32_t>         node = 8 (pair) + 8 (next) + malloc overhead (8-24)
+*                                          bucket = 8
+*      CompactHashMap<uint32_t, uint32_t>  node = 8 (pair) + 4 (next), bucket = 4
+*
+* The pool is kept dense: erasing an element moves the last element of the pool into the
+* hole, so iteration is a linear scan and no free list is needed.
+*
+* Like HashMap, the map never rehashes on its own; the pool grows geometrically.
+*
+* Usage:
+*      CompactHashMap<uint32_t, uint32_t> map(1 << 20);
+*      map.insert({3, 4});
+*      std::cout << map.memory_usage() << " bytes";
+*
+* Notes: unlike HashMap, erase invalidates references and iterators to the last element of
+* the pool (it is moved), and insert invalidates all references (the pool may be reallocated).
+* Iterators other than the ones to erased or moved elements stay valid, since they are indices.
+*
+* Concept requirements:
+*      - H is function type that with function prototype size_t hash(const K& key).
+*      - K and M must be regular (copyable, default constructible, and equality comparable),
+*        and should be nothrow move constructible, as erase and pool growth move elements.
+*      - at most 2^32 - 2 elements.
+*/
+template<typename K, typename M, typename H = std::hash<K>>
+class CompactHashMap {
+public:
+    using value_type = std::pair<const K, M>;
+    using index_type = uint32_t;
+    using iterator = CompactHashMapIterator<CompactHashMap, false>;
+    using const_iterator = CompactHashMapIterator<CompactHashMap, true>;
+
+    friend class CompactHashMapIterator<CompactHashMap, false>;
+    friend class CompactHashMapIterator<CompactHashMap, true>;
+
+    /*
+    * Constructors, with the same meaning as the ones of HashMap.
+    *
+    * Usage:
+    *      CompactHashMap<int, int> map;
+    *      CompactHashMap<int, int> map(100, my_hash);
+    *      CompactHashMap<char, int> map{vec.begin(), vec.end()};
+    *      CompactHashMap<char, int> map{{'a', 1}, {'b', 2}};
+    */
+    CompactHashMap();
+    explicit CompactHashMap(size_t bucket_count, const H& hash = H());
+    template<typename InputIter>
+    CompactHashMap(InputIter begin, InputIter end, size_t bucket_count = kDefaultBuckets, const H& hash = H());
+    CompactHashMap(std::initializer_list<value_type> init, size_t bucket_count = kDefaultBuckets, const H& hash = H());
+
+    /*
+    * Copying copies the pool and the buckets as they are: links are indices, so they stay
+    * valid in the copy and no element is hashed again.
+    * The move operations steal the pool and the buckets; the moved-from map is empty with
+    * bucket_count() == 0 and gets kDefaultBuckets buckets again on its first insert.
+    */
+    CompactHashMap(const CompactHashMap& map);
+    CompactHashMap(CompactHashMap&& map) noexcept;
+    CompactHashMap& operator=(const CompactHashMap& map);
+    CompactHashMap& operator=(CompactHashMap&& map) noexcept;
+    ~CompactHashMap();
+
+    inline size_t size() const;
+    inline bool empty() const;
+    inline float load_factor() const;
+    inline size_t bucket_count() const;
+
+    /*
+    * Returns the number of elements the pool can hold before it is reallocated.
+    */
+    inline size_t capacity() const;
+
+    /*
+    * Returns the exact number of bytes held by the map: the object itself, the node pool
+    * and the bucket array. Both are single allocations, so there is no per-node
+    * allocator overhead to account for.
+    *
+    * Complexity: O(1)
+    */
+    size_t memory_usage() const;
+
+    bool contains(const K& key) const;
+
+    /*
+    * Exceptions: std::out_of_range if key is not in the map.
+    */
+    M& at(const K& key);
+    const M& at(const K& key) const;
+
+    M& operator[](const K& key);
+
+    /*
+    * Inserts the K/M pair if the key does not exist yet, see HashMap::insert.
+    *
+    * Exceptions: std::length_error if the map already holds the maximum number of elements.
+    *
+    * Complexity: O(1) amortized average case
+    */
+    std::pair<iterator, bool> insert(const value_type& value);
+
+    /*
+    * Erases the element with key (returns whether it was present), or the element pos points
+    * to. The last element of the pool is moved into the freed slot, so erase(pos) returns an
+    * iterator to that moved element, which has not been visited yet by a loop like
+    *      for (auto it = map.begin(); it != map.end(); ) it = map.erase(it);
+    *
+    * Complexity: O(1) amortized average case, O(N) worst case, N = number of elements
+    */
+    bool erase(const K& key);
+    iterator erase(const_iterator pos);
+
+    /*
+    * Removes all elements, keeping the number of buckets and the pool capacity.
+    */
+    void clear();
+
+    /*
+    * Relinks all elements into new_buckets buckets; the pool is not touched.
+    *
+    * Exceptions: std::out_of_range if new_buckets = 0.
+    *
+    * Complexity: O(N + B)
+    */
+    void rehash(size_t new_buckets);
+
+    iterator find(const K& key);
+    const_iterator find(const K& key) const;
+
+    iterator begin();
+    const_iterator begin() const;
+    iterator end();
+    const_iterator end() const;
+
+private:
+    /*
+    * A pool slot: storage for one value_type plus the index of the next node in its chain.
+    * The value is constructed and destroyed by hand, so that slots past _size hold nothing.
+    */
+    struct Node {
+        alignas(value_type) unsigned char storage[sizeof(value_type)];
+        index_type next;
+
+        value_type& value() { return *std::launder(reinterpret_cast<value_type*>(storage)); }
+        const value_type& value() const { return *std::launder(reinterpret_cast<const value_type*>(storage)); }
+    };
+
+    using index_pair = std::pair<index_type, index_type>;
+
+    static constexpr index_type kNil = std::numeric_limits<index_type>::max();
+    static constexpr size_t kMaxSize = kNil - 1;
+    static constexpr size_t kDefaultBuckets = 10;
+    static constexpr size_t kInitialCapacity = 8;
+
+    /*
+    * Returns {previous node, node with key}, as indices; like chain_find, if key is not
+    * found returns {last node of the chain (kNil if empty), kNil}.
+    */
+    index_pair find_index(const K& key) const;
+    size_t bucket_of(const K& key) const;
+
+    /*
+    * Reallocates the pool with room for new_capacity nodes, moving the live elements.
+    */
+    void reallocate(size_t new_capacity);
+
+    /*
+    * Moves the last node of the pool into slot index (which must hold no value) and fixes
+    * the link that pointed to the last node.
+    */
+    void fill_hole(index_type index);
+
+    void destroy_all();
+
+    Node* _nodes;
+    size_t _size;
+    size_t _capacity;
+    H _hash_function;
+    std::vector<index_type> _buckets_array;
+};
+
+template<typename K, typename M, typename H>
+CompactHashMap<K, M, H>::CompactHashMap() : CompactHashMap(kDefaultBuckets) {}
+
+template<typename K, typename M, typename H>
+CompactHashMap<K, M, H>::CompactHashMap(size_t bucket_count, const H& hash) :
+    _nodes(nullptr),
+    _size(0),
+    _capacity(0),
+    _hash_function(hash),
+    _buckets_array(bucket_count, kNil) {}
+
+template<typename K, typename M, typename H>
+template<typename InputIter>
+CompactHashMap<K, M, H>::CompactHashMap(InputIter begin, InputIter end, size_t bucket_count, const H& hash) :
+    CompactHashMap(bucket_count, hash)
+{
+    for (InputIter it = begin; it != end; ++it) {
+        insert(*it);
+    }
+}
+
+template<typename K, typename M, typename H>
+CompactHashMap<K, M, H>::CompactHashMap(std::initializer_list<value_type> init, size_t bucket_count, const H& hash) :
+    CompactHashMap(init.begin(), init.end(), bucket_count, hash) {}
+
+template<typename K, typename M, typename H>
+CompactHashMap<K, M, H>::CompactHashMap(const CompactHashMap& map) :
+    _nodes(nullptr),
+    _size(0),
+    _capacity(0),
+    _hash_function(map._hash_function),
+    _buckets_array(map._buckets_array)
+{
+    if (map._size == 0) return;
+    reallocate(map._size);
+    // indices are relative to the pool, so the links can be copied verbatim
+    for (; _size < map._size; _size++) {
+        new (_nodes[_size].storage) value_type(map._nodes[_size].value());
+        _nodes[_size].next = map._nodes[_size].next;
+    }
+}
+
+template<typename K, typename M, typename H>
+CompactHashMap<K, M, H>::CompactHashMap(CompactHashMap&& map) noexcept :
+    _nodes(map._nodes),
+    _size(map._size),
+    _capacity(map._capacity),
+    _hash_function(std::move(map._hash_function)),
+    _buckets_array(std::move(map._buckets_array))
+{
+    map._nodes = nullptr;
+    map._size = 0;
+    map._capacity = 0;
+    map._buckets_array.clear();
+}
+
+template<typename K, typename M, typename H>
+CompactHashMap<K, M, H>& CompactHashMap<K, M, H>::operator=(const CompactHashMap& map) {
+    if (this == &map) return *this;
+    CompactHashMap copy(map);
+    return *this = std::move(copy);
+}
+
+template<typename K, typename M, typename H>
+CompactHashMap<K, M, H>& CompactHashMap<K, M, H>::operator=(CompactHashMap&& map) noexcept {
+    if (this == &map) return *this;
+    destroy_all();
+    std::allocator<Node>().deallocate(_nodes, _capacity);
+
+    _nodes = map._nodes;
+    _size = map._size;
+    _capacity = map._capacity;
+    _hash_function = std::move(map._hash_function);
+    _buckets_array = std::move(map._buckets_array);
+
+    map._nodes = nullptr;
+    map._size = 0;
+    map._capacity = 0;
+    map._buckets_array.clear();
+    return *this;
+}
+
+template<typename K, typename M, typename H>
+CompactHashMap<K, M, H>::~CompactHashMap() {
+    destroy_all();
+    std::allocator<Node>().deallocate(_nodes, _capacity);
+}
+
+template<typename K, typename M, typename H>
+inline size_t CompactHashMap<K, M, H>::size() const {
+    return _size;
+}
+
+template<typename K, typename M, typename H>
+inline bool CompactHashMap<K, M, H>::empty() const {
+    return _size == 0;
+}
+
+template<typename K, typename M, typename H>
+inline float CompactHashMap<K, M, H>::load_factor() const {
+    if (_buckets_array.empty()) return 0;
+    return ((float) _size) / _buckets_array.size();
+}
+
+template<typename K, typename M, typename H>
+inline size_t CompactHashMap<K, M, H>::bucket_count() const {
+    return _buckets_array.size();
+}
+
+template<typename K, typename M, typename H>
+inline size_t CompactHashMap<K, M, H>::capacity() const {
+    return _capacity;
+}
+
+template<typename K, typename M, typename H>
+size_t CompactHashMap<K, M, H>::memory_usage() const {
+    return sizeof(*this) + _capacity * sizeof(Node) + _buckets_array.capacity() * sizeof(index_type);
+}
+
+template<typename K, typename M, typename H>
+bool CompactHashMap<K, M, H>::contains(const K& key) const {
+    return find_index(key).second != kNil;
+}
+
+template<typename K, typename M, typename H>
+M& CompactHashMap<K, M, H>::at(const K& key) {
+    index_type index = find_index(key).second;
+    if (index == kNil) {
+        throw std::out_of_range("CompactHashMap<K, M, H>::at: key not found");
+    }
+    return _nodes[index].value().second;
+}
+
+template<typename K, typename M, typename H>
+const M& CompactHashMap<K, M, H>::at(const K& key) const {
+    return const_cast<CompactHashMap*>(this)->at(key);
+}
+
+template<typename K, typename M, typename H>
+M& CompactHashMap<K, M, H>::operator[](const K& key) {
+    return insert({key, {}}).first->second;
+}
+
+template<typename K, typename M, typename H>
+std::pair<typename CompactHashMap<K, M, H>::iterator, bool>
+CompactHashMap<K, M, H>::insert(const value_type& value) {
+    if (_buckets_array.empty()) _buckets_array.assign(kDefaultBuckets, kNil);
+    auto [prev, curr] = find_index(value.first);
+    if (curr != kNil) return {iterator(this, curr), false};
+
+    if (_size == kMaxSize) {
+        throw std::length_error("CompactHashMap<K, M, H>::insert: too many elements");
+    }
+    if (_size == _capacity) {
+        reallocate(std::min(kMaxSize, std::max(kInitialCapacity, 2 * _capacity)));
+    }
+
+    index_type index = static_cast<index_type>(_size);
+    new (_nodes[index].storage) value_type(value);
+    _nodes[index].next = kNil;
+    if (prev != kNil) {
+        _nodes[prev].next = index;
+    } else {
+        _buckets_array[bucket_of(value.first)] = index;
+    }
+    _size++;
+    return {iterator(this, index), true};
+}
+
+template<typename K, typename M, typename H>
+bool CompactHashMap<K, M, H>::erase(const K& key) {
+    auto [prev, curr] = find_index(key);
+    if (curr == kNil) return false;
+
+    if (prev != kNil) {
+        _nodes[prev].next = _nodes[curr].next;
+    } else {
+        _buckets_array[bucket_of(key)] = _nodes[curr].next;
+    }
+    _nodes[curr].value().~value_type();
+    fill_hole(curr);
+    return true;
+}
+
+template<typename K, typename M, typename H>
+typename CompactHashMap<K, M, H>::iterator CompactHashMap<K, M, H>::erase(const_iterator pos) {
+    size_t index = pos._index;
+    if (index < _size) erase(_nodes[index].value().first);
+    // the slot now holds the former last element, or index == _size which is end()
+    return iterator(this, index);
+}
+
+template<typename K, typename M, typename H>
+void CompactHashMap<K, M, H>::clear() {
+    destroy_all();
+    std::fill(_buckets_array.begin(), _buckets_array.end(), kNil);
+}
+
+template<typename K, typename M, typename H>
+void CompactHashMap<K, M, H>::rehash(size_t new_buckets) {
+    if (new_buckets == 0) {
+        throw std::out_of_range("CompactHashMap<K, M, H>::rehash: new_buckets cannot be 0");
+    }
+    _buckets_array.assign(new_buckets, kNil);
+    // push to the head in reverse pool order, so every chain ends up in pool order
+    for (size_t i = _size; i-- > 0;) {
+        size_t bucket = bucket_of(_nodes[i].value().first);
+        _nodes[i].next = _buckets_array[bucket];
+        _buckets_array[bucket] = static_cast<index_type>(i);
+    }
+}
+
+template<typename K, typename M, typename H>
+typename CompactHashMap<K, M, H>::iterator CompactHashMap<K, M, H>::find(const K& key) {
+    index_type index = find_index(key).second;
+    return index == kNil ? end() : iterator(this, index);
+}
+
+template<typename K, typename M, typename H>
+typename CompactHashMap<K, M, H>::const_iterator CompactHashMap<K, M, H>::find(const K& key) const {
+    return const_cast<CompactHashMap*>(this)->find(key);
+}
+
+template<typename K, typename M, typename H>
+typename CompactHashMap<K, M, H>::iterator CompactHashMap<K, M, H>::begin() {
+    return iterator(this, 0);
+}
+
+template<typename K, typename M, typename H>
+typename CompactHashMap<K, M, H>::const_iterator CompactHashMap<K, M, H>::begin() const {
+    return const_iterator(this, 0);
+}
+
+template<typename K, typename M, typename H>
+typename CompactHashMap<K, M, H>::iterator CompactHashMap<K, M, H>::end() {
+    return iterator(this, _size);
+}
+
+template<typename K, typename M, typename H>
+typename CompactHashMap<K, M, H>::const_iterator CompactHashMap<K, M, H>::end() const {
+    return const_iterator(this, _size);
+}
+
+template<typename K, typename M, typename H>
+typename CompactHashMap<K, M, H>::index_pair CompactHashMap<K, M, H>::find_index(const K& key) const {
+    if (_buckets_array.empty()) return {kNil, kNil};
+    index_type prev = kNil;
+    index_type curr = _buckets_array[bucket_of(key)];
+    while (curr != kNil) {
+        if (_nodes[curr].value().first == key) return {prev, curr};
+        prev = curr;
+        curr = _nodes[curr].next;
+    }
+    return {prev, kNil};
+}
+
+template<typename K, typename M, typename H>
+size_t CompactHashMap<K, M, H>::bucket_of(const K& key) const {
+    return _hash_function(key) % _buckets_array.size();
+}
+
+template<typename K, typename M, typename H>
+void CompactHashMap<K, M, H>::reallocate(size_t new_capacity) {
+    std::allocator<Node> allocator;
+    Node* new_nodes = allocator.allocate(new_capacity);
+    for (size_t i = 0; i < _size; i++) {
+        new (new_nodes[i].storage) value_type(std::move(_nodes[i].value()));
+        new_nodes[i].next = _nodes[i].next;
+        _nodes[i].value().~value_type();
+    }
+    allocator.deallocate(_nodes, _capacity);
+    _nodes = new_nodes;
+    _capacity = new_capacity;
+}
+
+template<typename K, typename M, typename H>
+void CompactHashMap<K, M, H>::fill_hole(index_type index) {
+    index_type last = static_cast<index_type>(--_size);
+    if (index == last) return;
+
+    // find whatever points to the last node: a bucket head or its predecessor in the chain
+    size_t bucket = bucket_of(_nodes[last].value().first);
+    if (_buckets_array[bucket] == last) {
+        _buckets_array[bucket] = index;
+    } else {
+        index_type prev = _buckets_array[bucket];
+        while (_nodes[prev].next != last) prev = _nodes[prev].next;
+        _nodes[prev].next = index;
+    }
+
+    new (_nodes[index].storage) value_type(std::move(_nodes[last].value()));
+    _nodes[index].next = _nodes[last].next;
+    _nodes[last].value().~value_type();
+}
+
+template<typename K, typename M, typename H>
+void CompactHashMap<K, M, H>::destroy_all() {
+    for (size_t i = 0; i < _size; i++) {
+        _nodes[i].value().~value_type();
+    }
+    _size = 0;
+}
+
+template<typename K, typename M, typename H>
+std::ostream& operator<<(std::ostream& output_stream, const CompactHashMap<K, M, H>& map) {
+    output_stream << "{";
+    bool first = true;
+    for (const auto& [key, mapped] : map) {
+        if (!first) output_stream << ", ";
+        output_stream << key << ":" << mapped;
+        first = false;
+    }
+    return output_stream << "}";
+}
+
+#endif
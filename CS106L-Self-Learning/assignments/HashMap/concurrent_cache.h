@@ -0,0 +1,319 @@
+#ifndef CONCURRENT_CACHE_H
+#define CONCURRENT_CACHE_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <stdexcept>
+#include <vector>
+
+#include "hashmap.h"
+
+/*
+* Hit/miss/eviction counters of a ConcurrentCache (or of one of its shards).
+*/
+struct CacheStats {
+    size_t hits = 0;
+    size_t misses = 0;
+    size_t evictions = 0;
+};
+
+/*
+* Template class for a thread-safe, fixed-capacity cache
+*
+* K = key type
+* V = cached value type
+* H = hash function type used to hash a key; if not provided, defaults to DefaultHash<K>
+*
+* The cache is split into shards selected by the (mixed) hash of the key. Every shard owns a
+* HashMap from key to slot index, an array of slots and a reader/writer lock, so threads that
+* touch different shards never contend with each other.
+*
+* Eviction uses the CLOCK policy: each slot carries a reference bit, and a hit only sets that
+* bit (an atomic store under the shared lock) instead of relinking the entry at the head of an
+* LRU list. When a full shard needs room, its clock hand sweeps the slots, clearing reference
+* bits until it finds an unreferenced slot, which becomes the victim.
+*
+* Usage:
+*      ConcurrentCache<int, std::string> cache(1024);
+*      cache.put(3, "Avery");
+*      if (auto hit = cache.get(3)) { std::cout << *hit; }
+*
+* Concept requirements:
+*      - K and V must be default constructible and copyable.
+*      - H must be safe to call concurrently from several threads.
+*/
+template<typename K, typename V, typename H = DefaultHash<K>>
+class ConcurrentCache {
+public:
+    /*
+    * Constructor with capacity, number of shards and hash function as parameters.
+    * The capacity is split evenly between the shards (rounding up), and shard_count is
+    * rounded up to a power of two.
+    *
+    * Usage:
+    *      ConcurrentCache<int, int> cache(1 << 20);       // default shard count
+    *      ConcurrentCache<int, int> cache(1 << 20, 64);   // 64 shards
+    *
+    * Exceptions: std::out_of_range if capacity or shard_count is 0.
+    *
+    * Complexity: O(C), C = capacity
+    */
+    explicit ConcurrentCache(size_t capacity, size_t shard_count = kDefaultShards, const H& hash = H());
+
+    /*
+    * Returns a copy of the value cached for key, or std::nullopt on a miss.
+    * A hit sets the reference bit of the entry so the next clock sweep spares it.
+    *
+    * Usage:
+    *      auto hit = cache.get(3);
+    *
+    * Complexity: O(1) average case, takes a shared lock on one shard.
+    */
+    std::optional<V> get(const K& key);
+
+    /*
+    * Returns whether key is cached. Unlike get, this does not touch the reference bit
+    * or the statistics.
+    */
+    bool contains(const K& key) const;
+
+    /*
+    * Inserts or overwrites the value cached for key. If the shard is full, one entry of
+    * that shard is evicted first.
+    *
+    * Usage:
+    *      cache.put(3, "Anna");
+    *
+    * Complexity: O(1) amortized, takes an exclusive lock on one shard.
+    */
+    void put(const K& key, const V& value);
+
+    /*
+    * Removes key from the cache. Returns true if the key was cached.
+    */
+    bool erase(const K& key);
+
+    /*
+    * Removes every entry. Statistics are kept.
+    */
+    void clear();
+
+    size_t size() const;
+    size_t capacity() const;
+    size_t shard_count() const;
+
+    /*
+    * Returns the statistics of one shard, or the sum over all shards.
+    *
+    * Exceptions: std::out_of_range if shard >= shard_count().
+    */
+    CacheStats shard_stats(size_t shard) const;
+    CacheStats stats() const;
+
+private:
+    static const size_t kDefaultShards = 16;
+
+    /*
+    * One cache entry. The reference bit is atomic because readers set it while only
+    * holding the shared lock of the shard.
+    */
+    struct Slot {
+        K key;
+        V value;
+        std::atomic<bool> referenced{false};
+    };
+
+    struct Shard {
+        Shard(size_t capacity, const H& hash) : index(capacity, hash), slots(capacity) {}
+
+        mutable std::shared_mutex mutex;
+        HashMap<K, size_t, H> index;
+        std::vector<Slot> slots;
+        std::vector<size_t> free_slots;
+        size_t used = 0;
+        size_t hand = 0;
+
+        std::atomic<size_t> hits{0};
+        std::atomic<size_t> misses{0};
+        std::atomic<size_t> evictions{0};
+    };
+
+    Shard& shard_for(const K& key) const;
+    static size_t evict(Shard& shard);
+
+    H _hash_function;
+    size_t _capacity;
+    size_t _shard_bits;
+    std::vector<std::unique_ptr<Shard>> _shards;
+};
+
+template<typename K, typename V, typename H>
+ConcurrentCache<K, V, H>::ConcurrentCache(size_t capacity, size_t shard_count, const H& hash) :
+    _hash_function(hash),
+    _capacity(0),
+    _shard_bits(0)
+{
+    if (capacity == 0 || shard_count == 0) {
+        throw std::out_of_range("ConcurrentCache: capacity and shard_count must be positive");
+    }
+    while ((size_t(1) << _shard_bits) < shard_count) _shard_bits++;
+    size_t shards = size_t(1) << _shard_bits;
+    size_t per_shard = (capacity + shards - 1) / shards;
+    for (size_t i = 0; i < shards; i++) {
+        _shards.push_back(std::make_unique<Shard>(per_shard, hash));
+    }
+    _capacity = per_shard * shards;
+}
+
+template<typename K, typename V, typename H>
+std::optional<V> ConcurrentCache<K, V, H>::get(const K& key) {
+    Shard& shard = shard_for(key);
+    std::shared_lock lock(shard.mutex);
+    // only const members of the index are used under the shared lock
+    const auto& index = shard.index;
+    auto iter = index.find(key);
+    if (iter == index.end()) {
+        shard.misses.fetch_add(1, std::memory_order_relaxed);
+        return std::nullopt;
+    }
+    Slot& slot = shard.slots[iter->second];
+    // a hit is only a relaxed store, no list relinking under an exclusive lock
+    if (!slot.referenced.load(std::memory_order_relaxed)) {
+        slot.referenced.store(true, std::memory_order_relaxed);
+    }
+    shard.hits.fetch_add(1, std::memory_order_relaxed);
+    return slot.value;
+}
+
+template<typename K, typename V, typename H>
+bool ConcurrentCache<K, V, H>::contains(const K& key) const {
+    Shard& shard = shard_for(key);
+    std::shared_lock lock(shard.mutex);
+    return shard.index.contains(key);
+}
+
+template<typename K, typename V, typename H>
+void ConcurrentCache<K, V, H>::put(const K& key, const V& value) {
+    Shard& shard = shard_for(key);
+    std::unique_lock lock(shard.mutex);
+    auto iter = shard.index.find(key);
+    if (iter != shard.index.end()) {
+        Slot& slot = shard.slots[iter->second];
+        slot.value = value;
+        slot.referenced.store(true, std::memory_order_relaxed);
+        return;
+    }
+
+    size_t slot_index;
+    if (!shard.free_slots.empty()) {
+        slot_index = shard.free_slots.back();
+        shard.free_slots.pop_back();
+    } else if (shard.used < shard.slots.size()) {
+        slot_index = shard.used++;
+    } else {
+        slot_index = evict(shard);
+        shard.evictions.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    Slot& slot = shard.slots[slot_index];
+    slot.key = key;
+    slot.value = value;
+    // new entries start unreferenced, so a one-hit wonder is the first to go
+    slot.referenced.store(false, std::memory_order_relaxed);
+    shard.index.insert({key, slot_index});
+}
+
+template<typename K, typename V, typename H>
+bool ConcurrentCache<K, V, H>::erase(const K& key) {
+    Shard& shard = shard_for(key);
+    std::unique_lock lock(shard.mutex);
+    auto iter = shard.index.find(key);
+    if (iter == shard.index.end()) return false;
+    size_t slot_index = iter->second;
+    shard.index.erase(iter);
+    shard.free_slots.push_back(slot_index);
+    return true;
+}
+
+template<typename K, typename V, typename H>
+void ConcurrentCache<K, V, H>::clear() {
+    for (auto& shard : _shards) {
+        std::unique_lock lock(shard->mutex);
+        shard->index.clear();
+        shard->free_slots.clear();
+        shard->used = 0;
+        shard->hand = 0;
+    }
+}
+
+template<typename K, typename V, typename H>
+size_t ConcurrentCache<K, V, H>::size() const {
+    size_t total = 0;
+    for (const auto& shard : _shards) {
+        std::shared_lock lock(shard->mutex);
+        total += shard->index.size();
+    }
+    return total;
+}
+
+template<typename K, typename V, typename H>
+size_t ConcurrentCache<K, V, H>::capacity() const {
+    return _capacity;
+}
+
+template<typename K, typename V, typename H>
+size_t ConcurrentCache<K, V, H>::shard_count() const {
+    return _shards.size();
+}
+
+template<typename K, typename V, typename H>
+CacheStats ConcurrentCache<K, V, H>::shard_stats(size_t shard) const {
+    if (shard >= _shards.size()) {
+        throw std::out_of_range("ConcurrentCache::shard_stats: shard index out of range");
+    }
+    const Shard& s = *_shards[shard];
+    return {s.hits.load(std::memory_order_relaxed),
+            s.misses.load(std::memory_order_relaxed),
+            s.evictions.load(std::memory_order_relaxed)};
+}
+
+template<typename K, typename V, typename H>
+CacheStats ConcurrentCache<K, V, H>::stats() const {
+    CacheStats total;
+    for (size_t i = 0; i < _shards.size(); i++) {
+        CacheStats s = shard_stats(i);
+        total.hits += s.hits;
+        total.misses += s.misses;
+        total.evictions += s.evictions;
+    }
+    return total;
+}
+
+template<typename K, typename V, typename H>
+typename ConcurrentCache<K, V, H>::Shard& ConcurrentCache<K, V, H>::shard_for(const K& key) const {
+    // mix the hash before taking the top bits, otherwise an identity std::hash would put
+    // keys that collide in the shard's own HashMap into the same shard as well
+    size_t mixed = static_cast<size_t>(static_cast<uint64_t>(_hash_function(key)) * 0x9E3779B97F4A7C15ull);
+    size_t shard = _shard_bits == 0 ? 0 : mixed >> (sizeof(size_t) * 8 - _shard_bits);
+    return *_shards[shard];
+}
+
+template<typename K, typename V, typename H>
+size_t ConcurrentCache<K, V, H>::evict(Shard& shard) {
+    // CLOCK sweep: give every referenced slot a second chance. Terminates within two
+    // rounds because the sweep clears each bit it passes (we hold the exclusive lock).
+    while (shard.slots[shard.hand].referenced.load(std::memory_order_relaxed)) {
+        shard.slots[shard.hand].referenced.store(false, std::memory_order_relaxed);
+        shard.hand = (shard.hand + 1) % shard.slots.size();
+    }
+    size_t victim = shard.hand;
+    shard.hand = (shard.hand + 1) % shard.slots.size();
+    shard.index.erase(shard.slots[victim].key);
+    return victim;
+}
+
+#endif
@@ -0,0 +1,605 @@
+#ifndef DISK_HASHMAP_H
+#define DISK_HASHMAP_H
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "hashmap.h"
+
+/*
+* Layout and cache settings of a DiskHashMap. page_size and bucket_count only apply when
+* the file is created; an existing file keeps the ones it was created with.
+*
+* page_size    - bytes per page, the unit of I/O and of caching (a multiple of 512 keeps
+*                pages aligned with disk sectors).
+* bucket_count - number of primary bucket pages. Keys hash to a primary page and spill
+*                into a chain of overflow pages, so bucket_count * records_per_page()
+*                should be about the number of keys expected.
+* cache_pages  - number of pages kept in memory (at least 2): the memory bound of the map.
+*/
+struct DiskOptions {
+    size_t page_size = 4096;
+    size_t bucket_count = 1024;
+    size_t cache_pages = 256;
+};
+
+/*
+* I/O counters of a DiskHashMap: page reads and writes hit the file, cache hits did not.
+*/
+struct DiskStats {
+    size_t page_reads = 0;
+    size_t page_writes = 0;
+    size_t cache_hits = 0;
+};
+
+/*
+* Template class for a hash map that lives in a file, for key spaces larger than memory
+*
+* K = key type
+* M = mapped type
+* H = hash function type used to hash a key; if not provided, defaults to std::hash<K>
+*
+* The file is an array of fixed-size pages:
+*      page 0               - header: layout, number of elements, free page list
+*      pages 1 ... B        - primary bucket pages, bucket = hash(key) % B
+*      pages B + 1 ...      - overflow pages, chained from a bucket page when it is full
+* Each page holds a count, the number of its next overflow page (0 for none) and packed
+* K/M records. An erase moves the last record of the page into the hole, and an overflow
+* page left empty is unlinked and put on the free list for the next overflow.
+*
+* Pages are read and written with pread/pwrite through a page cache of options.cache_pages
+* frames, evicted with the CLOCK policy (as in ConcurrentCache); dirty pages are written
+* back on eviction and by flush(). Memory use is therefore bounded by the cache, whatever
+* the size of the file. A lookup costs one read per page of the chain not in the cache.
+* find_many sorts a batch of lookups by bucket page, so each page is read once per batch
+* and the reads sweep the file in offset order instead of seeking at random.
+*
+* Usage:
+*      DiskOptions options;
+*      options.bucket_count = 1 << 20;
+*      options.cache_pages = 1 << 16;          // 256 MB of 4 KB pages
+*      DiskHashMap<uint64_t, Record> table("/data/records.bin", options);
+*      table.insert_or_assign(id, record);
+*      if (auto found = table.find(id)) use(*found);
+*
+* Exceptions: std::runtime_error if the file cannot be opened, read or written, or is not
+* a DiskHashMap file of the same record size; std::out_of_range for unusable options.
+*
+* Notes: values are returned by copy, since the page holding them may be evicted by the
+* next call. The file is only consistent after flush() or destruction: use DurableHashMap
+* when updates must survive a crash. Not thread-safe, like HashMap.
+*
+* Concept requirements:
+*      - K and M must be trivially copyable (they are stored as raw bytes), K equality comparable.
+*/
+template<typename K, typename M, typename H = std::hash<K>>
+class DiskHashMap {
+    static_assert(std::is_trivially_copyable_v<K> && std::is_trivially_copyable_v<M>,
+                  "DiskHashMap: K and M must be trivially copyable");
+
+public:
+    using value_type = std::pair<K, M>;
+
+    /*
+    * Opens file, creating it with the layout of options if it does not exist.
+    */
+    explicit DiskHashMap(const std::string& file, const DiskOptions& options = DiskOptions(), const H& hash = H());
+
+    DiskHashMap(const DiskHashMap&) = delete;
+    DiskHashMap& operator=(const DiskHashMap&) = delete;
+
+    /*
+    * Flushes and closes the file. Errors are ignored here, call flush() to observe them.
+    */
+    ~DiskHashMap();
+
+    /*
+    * Updates, with the semantics of HashMap.
+    *
+    * Complexity: O(L) page accesses, L = pages in the chain of the key
+    */
+    bool insert(const value_type& value);
+    void insert_or_assign(const K& key, const M& mapped);
+    bool erase(const K& key);
+
+    /*
+    * Lookups. at throws std::out_of_range if key is not found.
+    *
+    * Complexity: O(L) page accesses, L = pages in the chain of the key
+    */
+    std::optional<M> find(const K& key);
+    bool contains(const K& key);
+    M at(const K& key);
+
+    /*
+    * Looks up every key of keys, out[i] being the result for keys[i], visiting the bucket
+    * pages in file order.
+    *
+    * Complexity: O(N log N) plus at most one access per distinct page of the chains involved
+    */
+    void find_many(const std::vector<K>& keys, std::vector<std::optional<M>>& out);
+
+    /*
+    * Calls f(key, mapped) for every element, page by page.
+    *
+    * Complexity: O(P) page accesses, P = number of pages
+    */
+    template<typename F>
+    void for_each(F f);
+
+    size_t size() const;
+    bool empty() const;
+    size_t bucket_count() const;
+    size_t page_count() const;
+    size_t records_per_page() const;
+
+    /*
+    * Writes every dirty page and the header, then fsyncs the file.
+    */
+    void flush();
+
+    const DiskStats& stats() const;
+    void reset_stats();
+
+private:
+    static constexpr char kMagic[8] = {'H', 'M', 'D', 'I', 'S', 'K', '0', '1'};
+    static constexpr size_t kRecordSize = sizeof(K) + sizeof(M);
+    // page layout: uint64 next overflow page, uint32 record count, uint32 unused, records
+    static constexpr size_t kPageHeader = 16;
+
+    struct FileHeader {
+        char magic[8];
+        uint64_t page_size;
+        uint64_t bucket_count;
+        uint64_t record_size;
+        uint64_t size;
+        uint64_t page_count;
+        uint64_t free_head;
+    };
+
+    struct Frame {
+        uint64_t page = 0;          // 0: the frame holds no page
+        uint32_t pins = 0;
+        bool dirty = false;
+        bool referenced = false;
+    };
+
+    /*
+    * A page pinned in the cache for as long as the PageRef lives.
+    */
+    class PageRef {
+    public:
+        PageRef(DiskHashMap* map, size_t frame) : _map(map), _frame(frame) {}
+        PageRef(PageRef&& other) noexcept : _map(other._map), _frame(other._frame) { other._map = nullptr; }
+        PageRef(const PageRef&) = delete;
+        PageRef& operator=(const PageRef&) = delete;
+        PageRef& operator=(PageRef&& other) noexcept {
+            if (this != &other) {
+                release();
+                _map = std::exchange(other._map, nullptr);
+                _frame = other._frame;
+            }
+            return *this;
+        }
+        ~PageRef() { release(); }
+
+        uint64_t id() const { return _map->_frames[_frame].page; }
+        char* data() const { return _map->_memory.data() + _frame * _map->_header.page_size; }
+        void mark_dirty() const { _map->_frames[_frame].dirty = true; }
+
+        uint64_t next() const { return load<uint64_t>(0); }
+        uint32_t count() const { return load<uint32_t>(8); }
+        void set_next(uint64_t next) const { store(0, next); }
+        void set_count(uint32_t count) const { store(8, count); }
+
+        K key(size_t index) const { return load<K>(offset(index)); }
+        M mapped(size_t index) const { return load<M>(offset(index) + sizeof(K)); }
+        void set(size_t index, const K& key, const M& mapped) const {
+            store(offset(index), key);
+            store(offset(index) + sizeof(K), mapped);
+        }
+
+    private:
+        static size_t offset(size_t index) { return kPageHeader + index * kRecordSize; }
+
+        void release() {
+            if (_map != nullptr) _map->_frames[_frame].pins--;
+            _map = nullptr;
+        }
+
+        template<typename T>
+        T load(size_t offset) const {
+            T value;
+            std::memcpy(&value, data() + offset, sizeof(T));
+            return value;
+        }
+
+        template<typename T>
+        void store(size_t offset, const T& value) const {
+            std::memcpy(data() + offset, &value, sizeof(T));
+            mark_dirty();
+        }
+
+        DiskHashMap* _map;
+        size_t _frame;
+    };
+
+    // {page holding key, index in it}, or an empty page reference if key is absent
+    struct Location {
+        std::optional<PageRef> page;
+        size_t index = 0;
+    };
+
+    size_t bucket_of(const K& key) const;
+    Location locate(const K& key, size_t bucket);
+    bool write(const K& key, const M& mapped, bool overwrite);
+
+    PageRef pin(uint64_t page, bool fresh = false);
+    size_t victim();
+    uint64_t allocate_page();
+    void free_page(uint64_t page);
+
+    void read_page(uint64_t page, char* data);
+    void write_page(uint64_t page, const char* data);
+    void write_header();
+    [[noreturn]] void fail(const std::string& what) const;
+
+    std::string _file;
+    int _fd;
+    H _hash_function;
+    FileHeader _header;
+    std::vector<Frame> _frames;
+    std::vector<char> _memory;
+    HashMap<uint64_t, size_t> _page_table;
+    size_t _hand;
+    DiskStats _stats;
+};
+
+template<typename K, typename M, typename H>
+DiskHashMap<K, M, H>::DiskHashMap(const std::string& file, const DiskOptions& options, const H& hash) :
+    _file(file), _fd(-1), _hash_function(hash), _header(), _page_table(2 * options.cache_pages), _hand(0) {
+    if (options.cache_pages < 2 || options.bucket_count == 0 ||
+        options.page_size < kPageHeader + kRecordSize || options.page_size < sizeof(FileHeader)) {
+        throw std::out_of_range("DiskHashMap: needs 2 cache pages, 1 bucket and pages of at least one record");
+    }
+    _fd = ::open(file.c_str(), O_RDWR | O_CREAT, 0644);
+    if (_fd < 0) fail("cannot open");
+
+    struct stat status;
+    if (::fstat(_fd, &status) != 0) fail("cannot stat");
+    try {
+        if (status.st_size == 0) {
+            std::memcpy(_header.magic, kMagic, sizeof(kMagic));
+            _header.page_size = options.page_size;
+            _header.bucket_count = options.bucket_count;
+            _header.record_size = kRecordSize;
+            _header.page_count = 1 + options.bucket_count;
+            // the bucket pages start empty: a sparse file reads back as zeros
+            if (::ftruncate(_fd, _header.page_count * _header.page_size) != 0) fail("cannot extend");
+            write_header();
+        } else {
+            ssize_t count = ::pread(_fd, &_header, sizeof(_header), 0);
+            if (count != static_cast<ssize_t>(sizeof(_header)) || std::memcmp(_header.magic, kMagic, sizeof(kMagic)) != 0) {
+                throw std::runtime_error("DiskHashMap: not a DiskHashMap file " + file);
+            }
+            if (_header.record_size != kRecordSize) {
+                throw std::runtime_error("DiskHashMap: record size mismatch in " + file);
+            }
+        }
+    } catch (...) {
+        ::close(_fd);
+        throw;
+    }
+    _frames.resize(options.cache_pages);
+    _memory.resize(options.cache_pages * _header.page_size);
+}
+
+template<typename K, typename M, typename H>
+DiskHashMap<K, M, H>::~DiskHashMap() {
+    try {
+        flush();
+    } catch (const std::exception&) {
+    }
+    ::close(_fd);
+}
+
+template<typename K, typename M, typename H>
+bool DiskHashMap<K, M, H>::insert(const value_type& value) {
+    return write(value.first, value.second, false);
+}
+
+template<typename K, typename M, typename H>
+void DiskHashMap<K, M, H>::insert_or_assign(const K& key, const M& mapped) {
+    write(key, mapped, true);
+}
+
+template<typename K, typename M, typename H>
+bool DiskHashMap<K, M, H>::erase(const K& key) {
+    size_t bucket = bucket_of(key);
+    std::optional<PageRef> prev;
+    PageRef page = pin(1 + bucket);
+    while (true) {
+        uint32_t count = page.count();
+        for (uint32_t index = 0; index < count; index++) {
+            if (!(page.key(index) == key)) continue;
+            if (index + 1 != count) page.set(index, page.key(count - 1), page.mapped(count - 1));
+            page.set_count(count - 1);
+            _header.size--;
+            if (count == 1 && prev) {
+                // an empty overflow page goes back to the free list
+                prev->set_next(page.next());
+                uint64_t id = page.id();
+                page = std::move(*prev);
+                free_page(id);
+            }
+            return true;
+        }
+        uint64_t next = page.next();
+        if (next == 0) return false;
+        // unpin the previous page before pinning the next, so two cache pages are enough
+        prev.reset();
+        prev.emplace(std::move(page));
+        page = pin(next);
+    }
+}
+
+template<typename K, typename M, typename H>
+std::optional<M> DiskHashMap<K, M, H>::find(const K& key) {
+    Location location = locate(key, bucket_of(key));
+    if (!location.page) return std::nullopt;
+    return location.page->mapped(location.index);
+}
+
+template<typename K, typename M, typename H>
+bool DiskHashMap<K, M, H>::contains(const K& key) {
+    return locate(key, bucket_of(key)).page.has_value();
+}
+
+template<typename K, typename M, typename H>
+M DiskHashMap<K, M, H>::at(const K& key) {
+    auto found = find(key);
+    if (!found) throw std::out_of_range("DiskHashMap<K, M, H>::at: key not found");
+    return *found;
+}
+
+template<typename K, typename M, typename H>
+void DiskHashMap<K, M, H>::find_many(const std::vector<K>& keys, std::vector<std::optional<M>>& out) {
+    out.assign(keys.size(), std::nullopt);
+    // {bucket, index in keys}: sorted, the bucket pages are visited in file order and
+    // lookups of the same bucket follow each other, so its chain is still cached
+    std::vector<std::pair<size_t, size_t>> order;
+    order.reserve(keys.size());
+    for (size_t index = 0; index < keys.size(); index++) order.push_back({bucket_of(keys[index]), index});
+    std::sort(order.begin(), order.end());
+    for (const auto& [bucket, index] : order) {
+        Location location = locate(keys[index], bucket);
+        if (location.page) out[index] = location.page->mapped(location.index);
+    }
+}
+
+template<typename K, typename M, typename H>
+template<typename F>
+void DiskHashMap<K, M, H>::for_each(F f) {
+    for (uint64_t bucket = 0; bucket < _header.bucket_count; bucket++) {
+        for (uint64_t id = 1 + bucket; id != 0;) {
+            PageRef page = pin(id);
+            for (uint32_t index = 0; index < page.count(); index++) f(page.key(index), page.mapped(index));
+            id = page.next();
+        }
+    }
+}
+
+template<typename K, typename M, typename H>
+size_t DiskHashMap<K, M, H>::size() const {
+    return _header.size;
+}
+
+template<typename K, typename M, typename H>
+bool DiskHashMap<K, M, H>::empty() const {
+    return size() == 0;
+}
+
+template<typename K, typename M, typename H>
+size_t DiskHashMap<K, M, H>::bucket_count() const {
+    return _header.bucket_count;
+}
+
+template<typename K, typename M, typename H>
+size_t DiskHashMap<K, M, H>::page_count() const {
+    return _header.page_count;
+}
+
+template<typename K, typename M, typename H>
+size_t DiskHashMap<K, M, H>::records_per_page() const {
+    return (_header.page_size - kPageHeader) / kRecordSize;
+}
+
+template<typename K, typename M, typename H>
+void DiskHashMap<K, M, H>::flush() {
+    for (size_t frame = 0; frame < _frames.size(); frame++) {
+        if (_frames[frame].page != 0 && _frames[frame].dirty) {
+            write_page(_frames[frame].page, _memory.data() + frame * _header.page_size);
+            _frames[frame].dirty = false;
+        }
+    }
+    write_header();
+    if (::fsync(_fd) != 0) fail("cannot fsync");
+}
+
+template<typename K, typename M, typename H>
+const DiskStats& DiskHashMap<K, M, H>::stats() const {
+    return _stats;
+}
+
+template<typename K, typename M, typename H>
+void DiskHashMap<K, M, H>::reset_stats() {
+    _stats = DiskStats();
+}
+
+template<typename K, typename M, typename H>
+size_t DiskHashMap<K, M, H>::bucket_of(const K& key) const {
+    return _hash_function(key) % _header.bucket_count;
+}
+
+template<typename K, typename M, typename H>
+typename DiskHashMap<K, M, H>::Location DiskHashMap<K, M, H>::locate(const K& key, size_t bucket) {
+    for (uint64_t id = 1 + bucket; id != 0;) {
+        PageRef page = pin(id);
+        for (uint32_t index = 0; index < page.count(); index++) {
+            if (page.key(index) == key) return {std::move(page), index};
+        }
+        id = page.next();
+    }
+    return {};
+}
+
+template<typename K, typename M, typename H>
+bool DiskHashMap<K, M, H>::write(const K& key, const M& mapped, bool overwrite) {
+    // walk the whole chain (the key may be in any page), remembering the first free slot
+    uint64_t free_slot_page = 0;
+    PageRef page = pin(1 + bucket_of(key));
+    while (true) {
+        uint32_t count = page.count();
+        for (uint32_t index = 0; index < count; index++) {
+            if (page.key(index) == key) {
+                if (overwrite) page.set(index, key, mapped);
+                return false;
+            }
+        }
+        if (free_slot_page == 0 && count < records_per_page()) free_slot_page = page.id();
+        if (page.next() == 0) break;
+        page = pin(page.next());
+    }
+
+    if (free_slot_page == 0) {
+        // every page of the chain is full: link a new overflow page at the tail
+        PageRef overflow = pin(allocate_page(), true);
+        page.set_next(overflow.id());
+        page = std::move(overflow);
+    } else if (free_slot_page != page.id()) {
+        page = pin(free_slot_page);
+    }
+    page.set(page.count(), key, mapped);
+    page.set_count(page.count() + 1);
+    _header.size++;
+    return true;
+}
+
+template<typename K, typename M, typename H>
+typename DiskHashMap<K, M, H>::PageRef DiskHashMap<K, M, H>::pin(uint64_t page, bool fresh) {
+    auto cached = _page_table.find(page);
+    if (cached != _page_table.end()) {
+        size_t frame = cached->second;
+        _frames[frame].referenced = true;
+        _frames[frame].pins++;
+        _stats.cache_hits++;
+        if (fresh) {
+            // a page reused from the free list
+            std::memset(_memory.data() + frame * _header.page_size, 0, _header.page_size);
+            _frames[frame].dirty = true;
+        }
+        return PageRef(this, frame);
+    }
+
+    size_t frame = victim();
+    char* data = _memory.data() + frame * _header.page_size;
+    if (_frames[frame].page != 0) {
+        if (_frames[frame].dirty) write_page(_frames[frame].page, data);
+        _page_table.erase(_frames[frame].page);
+    }
+    if (fresh) {
+        std::memset(data, 0, _header.page_size);
+    } else {
+        read_page(page, data);
+    }
+    // a fresh page must reach the file even if it is never written again
+    _frames[frame] = Frame{page, 1, fresh, true};
+    _page_table.insert({page, frame});
+    return PageRef(this, frame);
+}
+
+template<typename K, typename M, typename H>
+size_t DiskHashMap<K, M, H>::victim() {
+    // CLOCK: spare referenced frames once, clearing their bit; never evict a pinned frame
+    for (size_t step = 0; step < 2 * _frames.size() + 1; step++) {
+        size_t frame = _hand;
+        _hand = (_hand + 1) % _frames.size();
+        if (_frames[frame].pins > 0) continue;
+        if (_frames[frame].referenced && _frames[frame].page != 0) {
+            _frames[frame].referenced = false;
+            continue;
+        }
+        return frame;
+    }
+    throw std::runtime_error("DiskHashMap: every cache page is pinned");
+}
+
+template<typename K, typename M, typename H>
+uint64_t DiskHashMap<K, M, H>::allocate_page() {
+    if (_header.free_head == 0) return _header.page_count++;
+    uint64_t page = _header.free_head;
+    _header.free_head = pin(page).next();
+    return page;
+}
+
+template<typename K, typename M, typename H>
+void DiskHashMap<K, M, H>::free_page(uint64_t page) {
+    PageRef freed = pin(page);
+    freed.set_count(0);
+    freed.set_next(_header.free_head);
+    _header.free_head = page;
+}
+
+template<typename K, typename M, typename H>
+void DiskHashMap<K, M, H>::read_page(uint64_t page, char* data) {
+    size_t done = 0;
+    while (done < _header.page_size) {
+        ssize_t count = ::pread(_fd, data + done, _header.page_size - done, page * _header.page_size + done);
+        if (count < 0 && errno == EINTR) continue;
+        if (count < 0) fail("cannot read");
+        if (count == 0) break;
+        done += count;
+    }
+    // past the end of the file: a page allocated but never written yet
+    std::memset(data + done, 0, _header.page_size - done);
+    _stats.page_reads++;
+}
+
+template<typename K, typename M, typename H>
+void DiskHashMap<K, M, H>::write_page(uint64_t page, const char* data) {
+    size_t done = 0;
+    while (done < _header.page_size) {
+        ssize_t count = ::pwrite(_fd, data + done, _header.page_size - done, page * _header.page_size + done);
+        if (count < 0 && errno == EINTR) continue;
+        if (count < 0) fail("cannot write");
+        done += count;
+    }
+    _stats.page_writes++;
+}
+
+template<typename K, typename M, typename H>
+void DiskHashMap<K, M, H>::write_header() {
+    std::vector<char> page(_header.page_size, '\0');
+    std::memcpy(page.data(), &_header, sizeof(_header));
+    write_page(0, page.data());
+}
+
+template<typename K, typename M, typename H>
+void DiskHashMap<K, M, H>::fail(const std::string& what) const {
+    throw std::runtime_error("DiskHashMap: " + what + " " + _file + ": " + std::strerror(errno));
+}
+
+#endif
@@ -0,0 +1,554 @@
+#ifndef DURABLE_HASHMAP_H
+#define DURABLE_HASHMAP_H
+
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "hashmap.h"
+
+/*
+* Binary encoding of keys and mapped values in the log and in snapshots.
+* Trivially copyable types are stored as raw bytes and std::string as a length and its
+* characters; specialize DurableCodec for any other K or M.
+*
+* write appends the encoding of value to out. read decodes a value from [in, end),
+* advances in past it and returns false if the input is too short.
+*/
+template<typename T, typename Enable = void>
+struct DurableCodec {
+    static_assert(std::is_trivially_copyable_v<T>, "DurableCodec: specialize DurableCodec for this type");
+
+    static void write(std::string& out, const T& value) {
+        out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    static bool read(const char*& in, const char* end, T& value) {
+        if (static_cast<size_t>(end - in) < sizeof(T)) return false;
+        std::memcpy(&value, in, sizeof(T));
+        in += sizeof(T);
+        return true;
+    }
+};
+
+template<>
+struct DurableCodec<std::string> {
+    static void write(std::string& out, const std::string& value) {
+        DurableCodec<uint64_t>::write(out, value.size());
+        out.append(value);
+    }
+
+    static bool read(const char*& in, const char* end, std::string& value) {
+        uint64_t length;
+        if (!DurableCodec<uint64_t>::read(in, end, length)) return false;
+        if (static_cast<uint64_t>(end - in) < length) return false;
+        value.assign(in, length);
+        in += length;
+        return true;
+    }
+};
+
+/*
+* Durability settings of a DurableHashMap.
+*
+* sync_every       - group commit: fsync the log once every sync_every records.
+*                    1 makes every write durable before it returns; 0 leaves fsync to
+*                    sync(), checkpoint() and the destructor.
+* sync_interval    - also fsync at the first write after this much time since the last fsync
+*                    (0 = disabled), which bounds the loss window of a slow writer.
+* checkpoint_every - write a snapshot and truncate the log once the log holds this many
+*                    records (0 = only on checkpoint()).
+*/
+struct DurableOptions {
+    size_t sync_every = 1;
+    std::chrono::milliseconds sync_interval{0};
+    size_t checkpoint_every = 0;
+};
+
+/*
+* Template class for a crash-safe HashMap
+*
+* K = key type
+* M = mapped type
+* H = hash function type used to hash a key; if not provided, defaults to DefaultHash<K>
+*
+* DurableHashMap keeps a HashMap in memory and makes every update durable in a directory:
+*      wal.log       - append-only write-ahead log of put/erase/clear records
+*      snapshot.bin  - binary image of the whole map at the last checkpoint
+*
+* An update is applied to the map and written to the log (one write system call) before
+* it returns, so it survives a crash of the process. fsync is batched (group commit, see
+* DurableOptions): updates since the last fsync may be lost if the machine goes down.
+* Every log record carries its length and a CRC-32, so a record torn by a crash is
+* detected and cut off at recovery.
+*
+* A checkpoint writes snapshot.tmp, fsyncs it, renames it over snapshot.bin and then
+* truncates the log. Replaying the log on top of the snapshot is idempotent, so a crash at
+* any point of a checkpoint recovers to the same map. The constructor recovers: it loads
+* snapshot.bin, if any, and replays wal.log.
+*
+* Usage:
+*      DurableOptions options;
+*      options.sync_every = 64;
+*      DurableHashMap<std::string, int> map("/var/lib/app/scores", options);
+*      map.insert_or_assign("Avery", 3);
+*      int score = map.at("Avery");
+*
+* Exceptions: std::runtime_error if a file cannot be opened, written or synced, or if the
+* snapshot is corrupt. A failed write leaves the in-memory map updated but the update is
+* not durable.
+*
+* Concept requirements:
+*      - K and M must be regular, and DurableCodec<K> and DurableCodec<M> must exist.
+*      - not thread-safe, like HashMap.
+*/
+template<typename K, typename M, typename H = DefaultHash<K>>
+class DurableHashMap {
+public:
+    using map_type = HashMap<K, M, H>;
+    using value_type = typename map_type::value_type;
+
+    /*
+    * Opens (creating it if needed) the directory and recovers the map from it.
+    */
+    explicit DurableHashMap(const std::string& directory, const DurableOptions& options = DurableOptions(),
+                            size_t bucket_count = kDefaultBuckets, const H& hash = H());
+
+    DurableHashMap(const DurableHashMap&) = delete;
+    DurableHashMap& operator=(const DurableHashMap&) = delete;
+
+    /*
+    * Syncs the log and closes it. Errors are ignored here, call sync() to observe them.
+    */
+    ~DurableHashMap();
+
+    /*
+    * Updates, with the semantics of HashMap. Only updates that change the map are logged:
+    * inserting a key that is present, assigning the value a key already maps to, erasing
+    * a missing key and clearing an empty map write no record.
+    */
+    bool insert(const value_type& value);
+    void insert_or_assign(const K& key, const M& mapped);
+    bool erase(const K& key);
+    void clear();
+
+    /*
+    * Read access. The mapped values can only be changed through the updates above,
+    * so that each change goes through the log.
+    */
+    size_t size() const;
+    bool empty() const;
+    bool contains(const K& key) const;
+    const M& at(const K& key) const;
+    const map_type& map() const;
+
+    /*
+    * fsyncs all records written so far.
+    */
+    void sync();
+
+    /*
+    * Writes a snapshot of the map and empties the log.
+    *
+    * Complexity: O(N), N = number of elements
+    */
+    void checkpoint();
+
+    /*
+    * Number of records in the log since the last checkpoint, and number of fsyncs of the
+    * log so far (to observe group commit).
+    */
+    size_t log_records() const;
+    size_t sync_count() const;
+
+private:
+    enum RecordType : uint8_t { kPut = 1, kErase = 2, kClear = 3 };
+
+    static const size_t kDefaultBuckets = 10;
+    static constexpr char kSnapshotMagic[8] = {'H', 'M', 'S', 'N', 'A', 'P', '0', '1'};
+
+    std::string path(const char* name) const;
+    void recover();
+    void load_snapshot();
+    void replay_log();
+    bool apply(const char*& in, const char* end);
+    // inserts or assigns without default constructing an M; false if key already maps to mapped
+    bool put(const K& key, const M& mapped);
+
+    void append(RecordType type, const K* key, const M* mapped);
+    void after_append();
+
+    static uint32_t crc32(const char* data, size_t size);
+    static std::string read_file(const std::string& file);
+    static void write_all(int fd, const std::string& data, const std::string& file);
+    static void fsync_or_throw(int fd, const std::string& file);
+    [[noreturn]] static void fail(const std::string& what, const std::string& file);
+    [[noreturn]] static void corrupt(const std::string& what, const std::string& file);
+
+    std::string _directory;
+    DurableOptions _options;
+    map_type _map;
+    int _log_fd;
+    size_t _log_bytes;
+    size_t _log_records;
+    size_t _unsynced;
+    size_t _sync_count;
+    std::chrono::steady_clock::time_point _last_sync;
+    std::string _record;
+};
+
+template<typename K, typename M, typename H>
+DurableHashMap<K, M, H>::DurableHashMap(const std::string& directory, const DurableOptions& options,
+                                        size_t bucket_count, const H& hash) :
+    _directory(directory),
+    _options(options),
+    _map(bucket_count, hash),
+    _log_fd(-1),
+    _log_bytes(0),
+    _log_records(0),
+    _unsynced(0),
+    _sync_count(0),
+    _last_sync(std::chrono::steady_clock::now())
+{
+    if (mkdir(directory.c_str(), 0755) != 0 && errno != EEXIST) {
+        fail("cannot create directory", directory);
+    }
+    try {
+        recover();
+    } catch (...) {
+        if (_log_fd >= 0) ::close(_log_fd);
+        throw;
+    }
+}
+
+template<typename K, typename M, typename H>
+DurableHashMap<K, M, H>::~DurableHashMap() {
+    if (_log_fd < 0) return;
+    if (_unsynced > 0) ::fsync(_log_fd);
+    ::close(_log_fd);
+}
+
+template<typename K, typename M, typename H>
+bool DurableHashMap<K, M, H>::insert(const value_type& value) {
+    if (!_map.insert(value).second) return false;
+    append(kPut, &value.first, &value.second);
+    return true;
+}
+
+template<typename K, typename M, typename H>
+void DurableHashMap<K, M, H>::insert_or_assign(const K& key, const M& mapped) {
+    if (!put(key, mapped)) return;
+    append(kPut, &key, &mapped);
+}
+
+template<typename K, typename M, typename H>
+bool DurableHashMap<K, M, H>::erase(const K& key) {
+    if (!_map.erase(key)) return false;
+    append(kErase, &key, nullptr);
+    return true;
+}
+
+template<typename K, typename M, typename H>
+void DurableHashMap<K, M, H>::clear() {
+    if (_map.empty()) return;
+    _map.clear();
+    append(kClear, nullptr, nullptr);
+}
+
+template<typename K, typename M, typename H>
+size_t DurableHashMap<K, M, H>::size() const {
+    return _map.size();
+}
+
+template<typename K, typename M, typename H>
+bool DurableHashMap<K, M, H>::empty() const {
+    return _map.empty();
+}
+
+template<typename K, typename M, typename H>
+bool DurableHashMap<K, M, H>::contains(const K& key) const {
+    return _map.contains(key);
+}
+
+template<typename K, typename M, typename H>
+const M& DurableHashMap<K, M, H>::at(const K& key) const {
+    return _map.at(key);
+}
+
+template<typename K, typename M, typename H>
+const typename DurableHashMap<K, M, H>::map_type& DurableHashMap<K, M, H>::map() const {
+    return _map;
+}
+
+template<typename K, typename M, typename H>
+void DurableHashMap<K, M, H>::sync() {
+    if (_unsynced == 0) return;
+    fsync_or_throw(_log_fd, path("wal.log"));
+    _unsynced = 0;
+    _sync_count++;
+    _last_sync = std::chrono::steady_clock::now();
+}
+
+template<typename K, typename M, typename H>
+void DurableHashMap<K, M, H>::checkpoint() {
+    std::string snapshot(kSnapshotMagic, sizeof(kSnapshotMagic));
+    DurableCodec<uint64_t>::write(snapshot, _map.size());
+    for (const auto& [key, mapped] : _map) {
+        DurableCodec<K>::write(snapshot, key);
+        DurableCodec<M>::write(snapshot, mapped);
+    }
+    DurableCodec<uint32_t>::write(snapshot, crc32(snapshot.data(), snapshot.size()));
+
+    std::string tmp = path("snapshot.tmp");
+    int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) fail("cannot create snapshot", tmp);
+    try {
+        write_all(fd, snapshot, tmp);
+        fsync_or_throw(fd, tmp);
+    } catch (...) {
+        ::close(fd);
+        throw;
+    }
+    ::close(fd);
+    if (std::rename(tmp.c_str(), path("snapshot.bin").c_str()) != 0) fail("cannot rename snapshot", tmp);
+    int dir_fd = ::open(_directory.c_str(), O_RDONLY);
+    if (dir_fd >= 0) {
+        // makes the rename itself durable
+        ::fsync(dir_fd);
+        ::close(dir_fd);
+    }
+
+    // the snapshot now holds everything, the log can start over
+    if (::ftruncate(_log_fd, 0) != 0) fail("cannot truncate log", path("wal.log"));
+    fsync_or_throw(_log_fd, path("wal.log"));
+    _log_bytes = 0;
+    _log_records = 0;
+    _unsynced = 0;
+}
+
+template<typename K, typename M, typename H>
+size_t DurableHashMap<K, M, H>::log_records() const {
+    return _log_records;
+}
+
+template<typename K, typename M, typename H>
+size_t DurableHashMap<K, M, H>::sync_count() const {
+    return _sync_count;
+}
+
+template<typename K, typename M, typename H>
+std::string DurableHashMap<K, M, H>::path(const char* name) const {
+    return _directory + "/" + name;
+}
+
+template<typename K, typename M, typename H>
+void DurableHashMap<K, M, H>::recover() {
+    load_snapshot();
+    replay_log();
+}
+
+template<typename K, typename M, typename H>
+void DurableHashMap<K, M, H>::load_snapshot() {
+    std::string file = path("snapshot.bin");
+    if (::access(file.c_str(), F_OK) != 0) return;
+    std::string data = read_file(file);
+
+    const size_t header = sizeof(kSnapshotMagic) + sizeof(uint64_t);
+    if (data.size() < header + sizeof(uint32_t) ||
+        std::memcmp(data.data(), kSnapshotMagic, sizeof(kSnapshotMagic)) != 0) {
+        corrupt("corrupt snapshot", file);
+    }
+    const char* end = data.data() + data.size() - sizeof(uint32_t);
+    uint32_t crc;
+    std::memcpy(&crc, end, sizeof(crc));
+    if (crc != crc32(data.data(), end - data.data())) corrupt("corrupt snapshot", file);
+
+    const char* in = data.data() + sizeof(kSnapshotMagic);
+    uint64_t count;
+    DurableCodec<uint64_t>::read(in, end, count);
+    if (_map.bucket_count() < count) _map.rehash(count);
+    for (uint64_t i = 0; i < count; i++) {
+        K key;
+        M mapped;
+        if (!DurableCodec<K>::read(in, end, key) || !DurableCodec<M>::read(in, end, mapped)) {
+            corrupt("corrupt snapshot", file);
+        }
+        _map.insert({key, mapped});
+    }
+}
+
+template<typename K, typename M, typename H>
+void DurableHashMap<K, M, H>::replay_log() {
+    std::string file = path("wal.log");
+    _log_fd = ::open(file.c_str(), O_RDWR | O_CREAT | O_APPEND, 0644);
+    if (_log_fd < 0) fail("cannot open log", file);
+    std::string data = read_file(file);
+
+    // record: uint32 payload length, uint32 CRC-32 of the payload, payload
+    const char* in = data.data();
+    const char* end = data.data() + data.size();
+    while (in != end) {
+        const char* record = in;
+        uint32_t length, crc;
+        if (!DurableCodec<uint32_t>::read(in, end, length) || !DurableCodec<uint32_t>::read(in, end, crc) ||
+            static_cast<size_t>(end - in) < length || crc32(in, length) != crc) {
+            // torn tail from a crash in the middle of a write: drop it
+            if (::ftruncate(_log_fd, record - data.data()) != 0) fail("cannot truncate log", file);
+            break;
+        }
+        const char* payload = in;
+        if (!apply(payload, in + length)) corrupt("corrupt log record", file);
+        in += length;
+        _log_bytes = in - data.data();
+        _log_records++;
+    }
+}
+
+template<typename K, typename M, typename H>
+bool DurableHashMap<K, M, H>::put(const K& key, const M& mapped) {
+    auto found = _map.find(key);
+    if (found == _map.end()) {
+        _map.insert({key, mapped});
+        return true;
+    }
+    if (found->second == mapped) return false;
+    found->second = mapped;
+    return true;
+}
+
+template<typename K, typename M, typename H>
+bool DurableHashMap<K, M, H>::apply(const char*& in, const char* end) {
+    uint8_t type;
+    if (!DurableCodec<uint8_t>::read(in, end, type)) return false;
+    K key;
+    M mapped;
+    switch (type) {
+    case kPut:
+        if (!DurableCodec<K>::read(in, end, key) || !DurableCodec<M>::read(in, end, mapped)) return false;
+        put(key, mapped);
+        return true;
+    case kErase:
+        if (!DurableCodec<K>::read(in, end, key)) return false;
+        _map.erase(key);
+        return true;
+    case kClear:
+        _map.clear();
+        return true;
+    default:
+        return false;
+    }
+}
+
+template<typename K, typename M, typename H>
+void DurableHashMap<K, M, H>::append(RecordType type, const K* key, const M* mapped) {
+    // reserve the header, encode the payload behind it, then fill in length and CRC
+    _record.assign(2 * sizeof(uint32_t), '\0');
+    DurableCodec<uint8_t>::write(_record, type);
+    if (key != nullptr) DurableCodec<K>::write(_record, *key);
+    if (mapped != nullptr) DurableCodec<M>::write(_record, *mapped);
+    uint32_t length = static_cast<uint32_t>(_record.size() - 2 * sizeof(uint32_t));
+    uint32_t crc = crc32(_record.data() + 2 * sizeof(uint32_t), length);
+    std::memcpy(&_record[0], &length, sizeof(length));
+    std::memcpy(&_record[sizeof(length)], &crc, sizeof(crc));
+
+    try {
+        write_all(_log_fd, _record, path("wal.log"));
+    } catch (...) {
+        // cut a partially written record, or every later record would be lost at recovery
+        if (::ftruncate(_log_fd, _log_bytes) != 0) {}
+        throw;
+    }
+    _log_bytes += _record.size();
+    _log_records++;
+    _unsynced++;
+    after_append();
+}
+
+template<typename K, typename M, typename H>
+void DurableHashMap<K, M, H>::after_append() {
+    if (_options.checkpoint_every != 0 && _log_records >= _options.checkpoint_every) {
+        checkpoint();
+        return;
+    }
+    bool batch_full = _options.sync_every != 0 && _unsynced >= _options.sync_every;
+    bool interval_over = _options.sync_interval.count() != 0 &&
+                         std::chrono::steady_clock::now() - _last_sync >= _options.sync_interval;
+    if (batch_full || interval_over) sync();
+}
+
+template<typename K, typename M, typename H>
+uint32_t DurableHashMap<K, M, H>::crc32(const char* data, size_t size) {
+    // CRC-32 (IEEE 802.3), table built on first use
+    static const auto table = [] {
+        std::array<uint32_t, 256> result{};
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int bit = 0; bit < 8; bit++) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            result[i] = c;
+        }
+        return result;
+    }();
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < size; i++) {
+        crc = table[(crc ^ static_cast<uint8_t>(data[i])) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+template<typename K, typename M, typename H>
+std::string DurableHashMap<K, M, H>::read_file(const std::string& file) {
+    int fd = ::open(file.c_str(), O_RDONLY);
+    if (fd < 0) fail("cannot open", file);
+    std::string data;
+    char buffer[1 << 16];
+    while (true) {
+        ssize_t count = ::read(fd, buffer, sizeof(buffer));
+        if (count < 0 && errno == EINTR) continue;
+        if (count < 0) {
+            ::close(fd);
+            fail("cannot read", file);
+        }
+        if (count == 0) break;
+        data.append(buffer, count);
+    }
+    ::close(fd);
+    return data;
+}
+
+template<typename K, typename M, typename H>
+void DurableHashMap<K, M, H>::write_all(int fd, const std::string& data, const std::string& file) {
+    size_t written = 0;
+    while (written < data.size()) {
+        ssize_t count = ::write(fd, data.data() + written, data.size() - written);
+        if (count < 0 && errno == EINTR) continue;
+        if (count < 0) fail("cannot write", file);
+        written += count;
+    }
+}
+
+template<typename K, typename M, typename H>
+void DurableHashMap<K, M, H>::fsync_or_throw(int fd, const std::string& file) {
+    if (::fsync(fd) != 0) fail("cannot fsync", file);
+}
+
+template<typename K, typename M, typename H>
+void DurableHashMap<K, M, H>::fail(const std::string& what, const std::string& file) {
+    throw std::runtime_error("DurableHashMap: " + what + " " + file + ": " + std::strerror(errno));
+}
+
+template<typename K, typename M, typename H>
+void DurableHashMap<K, M, H>::corrupt(const std::string& what, const std::string& file) {
+    throw std::runtime_error("DurableHashMap: " + what + " " + file);
+}
+
+#endif
@@ -0,0 +1,567 @@
+#ifndef EXTENDIBLE_HASHMAP_H
+#define EXTENDIBLE_HASHMAP_H
+
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "hash_chain.h"
+#include "hashers.h"
+
+/*
+* Template class for a forward iterator over an ExtendibleHashMap: walks the segments in
+* creation order, and the chains of each segment bucket by bucket.
+*
+* Map = the ExtendibleHashMap the iterator is for
+* IsConst = whether the iterator is a const_iterator
+*/
+template <typename Map, bool IsConst = true>
+class ExtendibleHashMapIterator {
+public:
+    using value_type = std::conditional_t<IsConst, const typename Map::value_type, typename Map::value_type>;
+    using iterator_category = std::forward_iterator_tag;
+    using difference_type = std::ptrdiff_t;
+    using pointer = value_type*;
+    using reference = value_type&;
+
+    friend Map;
+    friend class ExtendibleHashMapIterator<Map, !IsConst>;
+
+    ExtendibleHashMapIterator() : _map(nullptr), _segment(0), _bucket(0), _node(nullptr) {}
+
+    /*
+    * Conversion from iterator to const_iterator.
+    */
+    template <bool IsConst_ = IsConst, typename = std::enable_if_t<!IsConst_>>
+    operator ExtendibleHashMapIterator<Map, true>() const {
+        return ExtendibleHashMapIterator<Map, true>(_map, _segment, _bucket, _node);
+    }
+
+    reference operator*() const { return _node->value; }
+    pointer operator->() const { return &_node->value; }
+
+    ExtendibleHashMapIterator& operator++() {
+        _node = _node->next;
+        if (_node == nullptr) {
+            _bucket++;
+            skip_empty();
+        }
+        return *this;
+    }
+
+    ExtendibleHashMapIterator operator++(int) {
+        auto copy = *this;
+        ++*this;
+        return copy;
+    }
+
+    friend bool operator==(const ExtendibleHashMapIterator& lhs, const ExtendibleHashMapIterator& rhs) {
+        return lhs._node == rhs._node;
+    }
+
+    friend bool operator!=(const ExtendibleHashMapIterator& lhs, const ExtendibleHashMapIterator& rhs) {
+        return !(lhs == rhs);
+    }
+
+private:
+    using map_pointer = std::conditional_t<IsConst, const Map*, Map*>;
+    using node_pointer = typename Map::Node*;
+
+    ExtendibleHashMapIterator(map_pointer map, size_t segment, size_t bucket, node_pointer node) :
+        _map(map), _segment(segment), _bucket(bucket), _node(node) {}
+
+    // moves to the first node at or after (_segment, _bucket), or to end() (_node == nullptr)
+    void skip_empty() {
+        for (; _segment < _map->_segments.size(); _segment++, _bucket = 0) {
+            for (; _bucket < Map::kSegmentBuckets; _bucket++) {
+                _node = _map->_segments[_segment]->buckets[_bucket];
+                if (_node != nullptr) return;
+            }
+        }
+        _node = nullptr;
+    }
+
+    map_pointer _map;
+    size_t _segment;
+    size_t _bucket;
+    node_pointer _node;
+};
+
+/*
+* Template class for a HashMap that grows by extendible hashing
+*
+* K = key type
+* M = mapped type
+* H = hash function type used to hash a key; if not provided, defaults to std::hash<K>
+*
+* The chains live in segments of kSegmentBuckets buckets each. A directory of 2^G segment
+* pointers (G = global_depth()) is indexed by the top G bits of the hash, and a segment of
+* local depth L is shared by the 2^(G - L) directory entries whose top L bits it owns.
+* When an insert leaves a segment with more than kSegmentBuckets elements, that segment
+* alone is split on its next hash bit: the nodes with the bit set are relinked into a new
+* segment, and half of its directory entries are pointed at it. The directory only doubles
+* (copying pointers, not nodes) when the segment split already had L == G.
+*
+* Growth is therefore proportional: an insert moves at most one segment's nodes, about
+* kSegmentBuckets of them, where HashMap::rehash moves all N at once. Like HashMap, nodes
+* keep their hash, so a split never calls the hash function. A split only touches one
+* segment and its directory entries, which is what makes per-segment locking a natural
+* extension.
+*
+* The hash of H is mixed with mix64 before use, since the directory uses the top bits
+* and std::hash of an integer is the integer itself.
+*
+* Usage:
+*      ExtendibleHashMap<uint64_t, Order> orders;
+*      orders.insert({7, order});
+*      orders[8] = other;
+*      for (const auto& [id, order] : orders) ...
+*
+* Notes: elements stay at the same address for their whole life, but iterators are
+* invalidated by inserts (a split can move their element to another segment). erase does
+* not merge segments.
+*
+* Concept requirements:
+*      - H is function type that with function prototype size_t hash(const K& key).
+*      - K and M must be copyable, K equality comparable, M default constructible for operator[].
+*/
+template<typename K, typename M, typename H = std::hash<K>>
+class ExtendibleHashMap {
+public:
+    using value_type = std::pair<const K, M>;
+    using iterator = ExtendibleHashMapIterator<ExtendibleHashMap, false>;
+    using const_iterator = ExtendibleHashMapIterator<ExtendibleHashMap, true>;
+
+    friend class ExtendibleHashMapIterator<ExtendibleHashMap, false>;
+    friend class ExtendibleHashMapIterator<ExtendibleHashMap, true>;
+
+    static constexpr size_t kSegmentBuckets = 256;
+
+    /*
+    * Constructors. The map starts with one segment and grows one split at a time.
+    *
+    * Usage:
+    *      ExtendibleHashMap<int, int> map;
+    *      ExtendibleHashMap<char, int> map{vec.begin(), vec.end()};
+    *      ExtendibleHashMap<char, int> map{{'a', 1}, {'b', 2}};
+    */
+    explicit ExtendibleHashMap(const H& hash = H());
+    template<typename InputIter>
+    ExtendibleHashMap(InputIter begin, InputIter end, const H& hash = H());
+    ExtendibleHashMap(std::initializer_list<value_type> init, const H& hash = H());
+
+    /*
+    * Copying keeps the segment layout of map, relinking nothing and hashing nothing.
+    * A moved-from map is empty, with a single segment.
+    */
+    ExtendibleHashMap(const ExtendibleHashMap& map);
+    ExtendibleHashMap(ExtendibleHashMap&& map);
+    ExtendibleHashMap& operator=(const ExtendibleHashMap& map);
+    ExtendibleHashMap& operator=(ExtendibleHashMap&& map);
+    ~ExtendibleHashMap();
+
+    size_t size() const;
+    bool empty() const;
+    float load_factor() const;
+
+    /*
+    * Total number of buckets, kSegmentBuckets per segment.
+    */
+    size_t bucket_count() const;
+
+    /*
+    * Layout: G, number of segments, and the number of nodes relinked by splits since
+    * construction or clear() (about N for N inserts, spread over the inserts).
+    */
+    size_t global_depth() const;
+    size_t segment_count() const;
+    size_t relinked_nodes() const;
+
+    bool contains(const K& key) const;
+
+    /*
+    * Exceptions: std::out_of_range if key is not in the map.
+    */
+    M& at(const K& key);
+    const M& at(const K& key) const;
+
+    M& operator[](const K& key);
+
+    /*
+    * Inserts the K/M pair if the key does not exist yet, see HashMap::insert.
+    *
+    * Complexity: O(1) average case, plus O(kSegmentBuckets) when the insert splits a
+    * segment, plus O(2^G) when it also doubles the directory
+    */
+    std::pair<iterator, bool> insert(const value_type& value);
+
+    /*
+    * Erases the element with key (returns whether it was present), or the element pos
+    * points to (returns an iterator to the next element).
+    *
+    * Complexity: O(1) average case
+    */
+    bool erase(const K& key);
+    iterator erase(const_iterator pos);
+
+    /*
+    * Removes all elements and goes back to a single segment.
+    */
+    void clear();
+
+    iterator find(const K& key);
+    const_iterator find(const K& key) const;
+
+    iterator begin();
+    const_iterator begin() const;
+    iterator end();
+    const_iterator end() const;
+
+private:
+    using Node = HashedNode<value_type>;
+
+    struct Segment {
+        size_t index;           // position in _segments, for iterators
+        size_t local_depth;
+        size_t size;
+        std::vector<Node*> buckets;
+
+        Segment(size_t index, size_t local_depth) :
+            index(index), local_depth(local_depth), size(0), buckets(kSegmentBuckets, nullptr) {}
+    };
+
+    // splitting stops at this depth (a directory of 2^24 entries, some 2^32 elements)
+    static constexpr size_t kMaxDepth = 24;
+
+    size_t hash_of(const K& key) const;
+    Segment* segment_of(size_t hash) const;
+    static size_t bucket_of(size_t hash);
+    std::pair<Node*, Node*> find_node(const K& key, size_t hash) const;
+
+    /*
+    * Splits segment on hash bit 63 - local_depth, doubling the directory first if needed.
+    * Does nothing if no node of the segment would move to the new segment or the other
+    * way (all hashes equal, or local_depth at kMaxDepth).
+    */
+    void split(Segment* segment);
+
+    iterator make_iterator(Node* node, size_t hash);
+    void reset();
+    void delete_all();
+
+    H _hash_function;
+    std::vector<std::unique_ptr<Segment>> _segments;
+    std::vector<Segment*> _directory;
+    size_t _global_depth;
+    size_t _size;
+    size_t _relinked;
+};
+
+template<typename K, typename M, typename H>
+ExtendibleHashMap<K, M, H>::ExtendibleHashMap(const H& hash) :
+    _hash_function(hash), _global_depth(0), _size(0), _relinked(0) {
+    reset();
+}
+
+template<typename K, typename M, typename H>
+template<typename InputIter>
+ExtendibleHashMap<K, M, H>::ExtendibleHashMap(InputIter begin, InputIter end, const H& hash) :
+    ExtendibleHashMap(hash) {
+    for (auto iter = begin; iter != end; ++iter) insert(*iter);
+}
+
+template<typename K, typename M, typename H>
+ExtendibleHashMap<K, M, H>::ExtendibleHashMap(std::initializer_list<value_type> init, const H& hash) :
+    ExtendibleHashMap(init.begin(), init.end(), hash) {}
+
+template<typename K, typename M, typename H>
+ExtendibleHashMap<K, M, H>::ExtendibleHashMap(const ExtendibleHashMap& map) :
+    _hash_function(map._hash_function), _global_depth(map._global_depth), _size(map._size), _relinked(0) {
+    for (const auto& segment : map._segments) {
+        auto copy = std::make_unique<Segment>(segment->index, segment->local_depth);
+        copy->size = segment->size;
+        for (size_t bucket = 0; bucket < kSegmentBuckets; bucket++) {
+            // copy the chain in order
+            Node** tail = &copy->buckets[bucket];
+            for (const Node* node = segment->buckets[bucket]; node != nullptr; node = node->next) {
+                *tail = new Node(node->value, node->hash, nullptr);
+                tail = &(*tail)->next;
+            }
+        }
+        _segments.push_back(std::move(copy));
+    }
+    _directory.reserve(map._directory.size());
+    for (const Segment* segment : map._directory) _directory.push_back(_segments[segment->index].get());
+}
+
+template<typename K, typename M, typename H>
+ExtendibleHashMap<K, M, H>::ExtendibleHashMap(ExtendibleHashMap&& map) : ExtendibleHashMap(map._hash_function) {
+    *this = std::move(map);
+}
+
+template<typename K, typename M, typename H>
+ExtendibleHashMap<K, M, H>& ExtendibleHashMap<K, M, H>::operator=(const ExtendibleHashMap& map) {
+    if (this != &map) *this = ExtendibleHashMap(map);
+    return *this;
+}
+
+template<typename K, typename M, typename H>
+ExtendibleHashMap<K, M, H>& ExtendibleHashMap<K, M, H>::operator=(ExtendibleHashMap&& map) {
+    if (this != &map) {
+        std::swap(_hash_function, map._hash_function);
+        _segments.swap(map._segments);
+        _directory.swap(map._directory);
+        std::swap(_global_depth, map._global_depth);
+        std::swap(_size, map._size);
+        std::swap(_relinked, map._relinked);
+        map.clear();
+    }
+    return *this;
+}
+
+template<typename K, typename M, typename H>
+ExtendibleHashMap<K, M, H>::~ExtendibleHashMap() {
+    delete_all();
+}
+
+template<typename K, typename M, typename H>
+size_t ExtendibleHashMap<K, M, H>::size() const {
+    return _size;
+}
+
+template<typename K, typename M, typename H>
+bool ExtendibleHashMap<K, M, H>::empty() const {
+    return _size == 0;
+}
+
+template<typename K, typename M, typename H>
+float ExtendibleHashMap<K, M, H>::load_factor() const {
+    return static_cast<float>(_size) / bucket_count();
+}
+
+template<typename K, typename M, typename H>
+size_t ExtendibleHashMap<K, M, H>::bucket_count() const {
+    return _segments.size() * kSegmentBuckets;
+}
+
+template<typename K, typename M, typename H>
+size_t ExtendibleHashMap<K, M, H>::global_depth() const {
+    return _global_depth;
+}
+
+template<typename K, typename M, typename H>
+size_t ExtendibleHashMap<K, M, H>::segment_count() const {
+    return _segments.size();
+}
+
+template<typename K, typename M, typename H>
+size_t ExtendibleHashMap<K, M, H>::relinked_nodes() const {
+    return _relinked;
+}
+
+template<typename K, typename M, typename H>
+bool ExtendibleHashMap<K, M, H>::contains(const K& key) const {
+    return find_node(key, hash_of(key)).second != nullptr;
+}
+
+template<typename K, typename M, typename H>
+M& ExtendibleHashMap<K, M, H>::at(const K& key) {
+    return const_cast<M&>(static_cast<const ExtendibleHashMap*>(this)->at(key));
+}
+
+template<typename K, typename M, typename H>
+const M& ExtendibleHashMap<K, M, H>::at(const K& key) const {
+    Node* node = find_node(key, hash_of(key)).second;
+    if (node == nullptr) {
+        throw std::out_of_range("ExtendibleHashMap<K, M, H>::at: key not found");
+    }
+    return node->value.second;
+}
+
+template<typename K, typename M, typename H>
+M& ExtendibleHashMap<K, M, H>::operator[](const K& key) {
+    return insert({key, M()}).first->second;
+}
+
+template<typename K, typename M, typename H>
+std::pair<typename ExtendibleHashMap<K, M, H>::iterator, bool> ExtendibleHashMap<K, M, H>::insert(const value_type& value) {
+    size_t hash = hash_of(value.first);
+    Node* found = find_node(value.first, hash).second;
+    if (found != nullptr) return {make_iterator(found, hash), false};
+
+    Segment* segment = segment_of(hash);
+    Node*& head = segment->buckets[bucket_of(hash)];
+    Node* node = new Node(value, hash, head);
+    head = node;
+    segment->size++;
+    _size++;
+    if (segment->size > kSegmentBuckets) split(segment);
+    return {make_iterator(node, hash), true};
+}
+
+template<typename K, typename M, typename H>
+bool ExtendibleHashMap<K, M, H>::erase(const K& key) {
+    size_t hash = hash_of(key);
+    auto [prev, node] = find_node(key, hash);
+    if (node == nullptr) return false;
+    Segment* segment = segment_of(hash);
+    (prev == nullptr ? segment->buckets[bucket_of(hash)] : prev->next) = node->next;
+    delete node;
+    segment->size--;
+    _size--;
+    return true;
+}
+
+template<typename K, typename M, typename H>
+typename ExtendibleHashMap<K, M, H>::iterator ExtendibleHashMap<K, M, H>::erase(const_iterator pos) {
+    iterator next(this, pos._segment, pos._bucket, const_cast<Node*>(pos._node));
+    ++next;
+    erase(pos->first);
+    return next;
+}
+
+template<typename K, typename M, typename H>
+void ExtendibleHashMap<K, M, H>::clear() {
+    delete_all();
+    reset();
+}
+
+template<typename K, typename M, typename H>
+typename ExtendibleHashMap<K, M, H>::iterator ExtendibleHashMap<K, M, H>::find(const K& key) {
+    size_t hash = hash_of(key);
+    Node* node = find_node(key, hash).second;
+    return node == nullptr ? end() : make_iterator(node, hash);
+}
+
+template<typename K, typename M, typename H>
+typename ExtendibleHashMap<K, M, H>::const_iterator ExtendibleHashMap<K, M, H>::find(const K& key) const {
+    return const_cast<ExtendibleHashMap*>(this)->find(key);
+}
+
+template<typename K, typename M, typename H>
+typename ExtendibleHashMap<K, M, H>::iterator ExtendibleHashMap<K, M, H>::begin() {
+    iterator iter(this, 0, 0, nullptr);
+    iter.skip_empty();
+    return iter;
+}
+
+template<typename K, typename M, typename H>
+typename ExtendibleHashMap<K, M, H>::const_iterator ExtendibleHashMap<K, M, H>::begin() const {
+    return const_cast<ExtendibleHashMap*>(this)->begin();
+}
+
+template<typename K, typename M, typename H>
+typename ExtendibleHashMap<K, M, H>::iterator ExtendibleHashMap<K, M, H>::end() {
+    return iterator(this, _segments.size(), 0, nullptr);
+}
+
+template<typename K, typename M, typename H>
+typename ExtendibleHashMap<K, M, H>::const_iterator ExtendibleHashMap<K, M, H>::end() const {
+    return const_cast<ExtendibleHashMap*>(this)->end();
+}
+
+template<typename K, typename M, typename H>
+size_t ExtendibleHashMap<K, M, H>::hash_of(const K& key) const {
+    return static_cast<size_t>(mix64(_hash_function(key)));
+}
+
+template<typename K, typename M, typename H>
+typename ExtendibleHashMap<K, M, H>::Segment* ExtendibleHashMap<K, M, H>::segment_of(size_t hash) const {
+    return _directory[_global_depth == 0 ? 0 : static_cast<uint64_t>(hash) >> (64 - _global_depth)];
+}
+
+template<typename K, typename M, typename H>
+size_t ExtendibleHashMap<K, M, H>::bucket_of(size_t hash) {
+    // low bits: the directory uses the high ones
+    return hash & (kSegmentBuckets - 1);
+}
+
+template<typename K, typename M, typename H>
+std::pair<typename ExtendibleHashMap<K, M, H>::Node*, typename ExtendibleHashMap<K, M, H>::Node*>
+ExtendibleHashMap<K, M, H>::find_node(const K& key, size_t hash) const {
+    return chain_find_hashed(segment_of(hash)->buckets[bucket_of(hash)], key, hash, PairFirstKey(), false);
+}
+
+template<typename K, typename M, typename H>
+void ExtendibleHashMap<K, M, H>::split(Segment* segment) {
+    size_t depth = segment->local_depth;
+    if (depth == kMaxDepth) return;
+    uint64_t bit = uint64_t(1) << (63 - depth);
+    // a split that would leave one side empty only deepens the directory: wait for a key
+    // that differs in this bit (never, if all hashes are equal)
+    size_t moving = 0;
+    uint64_t sample = 0;
+    for (Node* head : segment->buckets) {
+        for (Node* node = head; node != nullptr; node = node->next) {
+            moving += (node->hash & bit) != 0;
+            sample = node->hash;
+        }
+    }
+    if (moving == 0 || moving == segment->size) return;
+
+    if (depth == _global_depth) {
+        // each entry becomes two adjacent entries for the same segment
+        std::vector<Segment*> directory;
+        directory.reserve(2 * _directory.size());
+        for (Segment* entry : _directory) {
+            directory.push_back(entry);
+            directory.push_back(entry);
+        }
+        _directory.swap(directory);
+        _global_depth++;
+    }
+
+    _segments.push_back(std::make_unique<Segment>(_segments.size(), depth + 1));
+    Segment* upper = _segments.back().get();
+    segment->local_depth = depth + 1;
+    for (size_t bucket = 0; bucket < kSegmentBuckets; bucket++) {
+        Node** link = &segment->buckets[bucket];
+        while (*link != nullptr) {
+            Node* node = *link;
+            if (node->hash & bit) {
+                *link = node->next;
+                node->next = upper->buckets[bucket];
+                upper->buckets[bucket] = node;
+            } else {
+                link = &node->next;
+            }
+        }
+    }
+    upper->size = moving;
+    segment->size -= moving;
+    _relinked += moving;
+
+    // the segment owned the 2^(G - depth) consecutive entries starting with the top depth
+    // bits of any of its hashes: the upper half goes to the new segment
+    size_t span = size_t(1) << (_global_depth - depth);
+    size_t first = depth == 0 ? 0 : static_cast<size_t>(sample >> (64 - depth)) << (_global_depth - depth);
+    for (size_t entry = first + span / 2; entry < first + span; entry++) _directory[entry] = upper;
+}
+
+template<typename K, typename M, typename H>
+typename ExtendibleHashMap<K, M, H>::iterator ExtendibleHashMap<K, M, H>::make_iterator(Node* node, size_t hash) {
+    return iterator(this, segment_of(hash)->index, bucket_of(hash), node);
+}
+
+template<typename K, typename M, typename H>
+void ExtendibleHashMap<K, M, H>::reset() {
+    _segments.clear();
+    _segments.push_back(std::make_unique<Segment>(0, 0));
+    _directory.assign(1, _segments.front().get());
+    _global_depth = 0;
+    _size = 0;
+    _relinked = 0;
+}
+
+template<typename K, typename M, typename H>
+void ExtendibleHashMap<K, M, H>::delete_all() {
+    for (auto& segment : _segments) chain_delete_all(segment->buckets);
+}
+
+#endif
@@ -0,0 +1,296 @@
+#ifndef HASH_AGGREGATOR_H
+#define HASH_AGGREGATOR_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "hashmap.h"
+
+/*
+* Template class for a parallel hash aggregation (group-by) engine
+*
+* K = group key type
+* Acc = accumulator type
+* H = hash function type used to hash a key; if not provided, defaults to DefaultHash<K>
+* Combine = binary function Acc(const Acc&, const Acc&) that folds a value into an accumulator;
+*           defaults to std::plus<Acc>, i.e. the familiar map[key] += value
+*
+* Replaces the single-threaded `map[key] += value` loop. Input rows are split into batches
+* that worker threads pull from a shared counter. Every worker pre-aggregates into its own
+* thread-local HashMaps, so the hot loop needs no synchronization at all. The thread-local
+* tables are radix-partitioned by hash: a row goes to partition p of its worker, chosen by the
+* top bits of the mixed hash. All the rows with a given key therefore meet in the same
+* partition index on every worker, and finish() merges each partition index independently
+* and in parallel.
+*
+* High-cardinality inputs scale with the number of workers since both phases are
+* embarrassingly parallel. Low-cardinality (skewed) inputs keep every thread-local table
+* tiny and cache resident, and the merge only has a handful of groups to combine.
+*
+* Usage:
+*      HashAggregator<std::string, long> agg(8);
+*      agg.consume(rows.begin(), rows.end());          // rows: std::vector<std::pair<std::string, long>>
+*      agg.finish();
+*      long total = agg.at("Avery");
+*
+* Concept requirements:
+*      - K and Acc must be copyable and default constructible, K equality comparable.
+*      - H and Combine must be safe to call concurrently from several threads.
+*/
+template<typename K, typename Acc, typename H = DefaultHash<K>, typename Combine = std::plus<Acc>>
+class HashAggregator {
+public:
+    using map_type = HashMap<K, Acc, H>;
+
+    /*
+    * Constructor with number of worker threads, batch size, hash and combine functions.
+    * num_threads = 0 uses std::thread::hardware_concurrency().
+    *
+    * Exceptions: std::out_of_range if batch_size is 0.
+    */
+    explicit HashAggregator(size_t num_threads = 0, size_t batch_size = kDefaultBatchSize,
+                            const H& hash = H(), const Combine& combine = Combine());
+
+    /*
+    * Aggregates the rows in [first, last) into the thread-local tables.
+    * Elements must be pairs whose first member converts to K and second to Acc.
+    * May be called several times before finish().
+    *
+    * Complexity: O(N / T) wall time for N rows and T threads
+    */
+    template<typename RandomIt>
+    void consume(RandomIt first, RandomIt last);
+
+    /*
+    * Merges all thread-local tables into the result partitions, in parallel over partitions.
+    * Further consume() calls start new thread-local tables that the next finish() merges
+    * into the same result.
+    */
+    void finish();
+
+    /*
+    * Accessors for the merged result.
+    *
+    * Exceptions: at throws std::out_of_range if key has no group.
+    */
+    size_t size() const;
+    bool contains(const K& key) const;
+    const Acc& at(const K& key) const;
+    size_t partition_count() const;
+    const map_type& partition(size_t index) const;
+
+    /*
+    * Calls fn(key, accumulator) for every group of the merged result.
+    */
+    template<typename Fn>
+    void for_each(Fn fn) const;
+
+    /*
+    * Collects the merged result into one HashMap (a serial pass over all groups).
+    */
+    map_type to_hashmap() const;
+
+    size_t thread_count() const;
+
+private:
+    static constexpr size_t kDefaultBatchSize = 4096;
+    static constexpr size_t kInitialBuckets = 64;
+    static constexpr size_t kMaxLoadFactor = 2;
+
+    using partitions_type = std::vector<map_type>;
+
+    size_t partition_of(const K& key) const;
+    void accumulate(map_type& map, const K& key, const Acc& value);
+    void grow_if_needed(map_type& map);
+
+    /*
+    * Runs fn(worker_index) on every worker, using the calling thread as worker 0.
+    */
+    template<typename Fn>
+    void run_workers(Fn fn);
+
+    partitions_type make_partitions() const;
+
+    size_t _num_threads;
+    size_t _batch_size;
+    size_t _partition_bits;
+    H _hash_function;
+    Combine _combine;
+
+    std::vector<partitions_type> _local;
+    partitions_type _merged;
+};
+
+template<typename K, typename Acc, typename H, typename Combine>
+HashAggregator<K, Acc, H, Combine>::HashAggregator(size_t num_threads, size_t batch_size,
+                                                   const H& hash, const Combine& combine) :
+    _num_threads(num_threads == 0 ? std::max(1u, std::thread::hardware_concurrency()) : num_threads),
+    _batch_size(batch_size),
+    _partition_bits(4),
+    _hash_function(hash),
+    _combine(combine)
+{
+    if (batch_size == 0) {
+        throw std::out_of_range("HashAggregator: batch_size cannot be 0");
+    }
+    // a few partitions per worker so the merge phase balances even with uneven partitions
+    while ((size_t(1) << _partition_bits) < 4 * _num_threads) _partition_bits++;
+    for (size_t i = 0; i < _num_threads; i++) {
+        _local.push_back(make_partitions());
+    }
+    _merged = make_partitions();
+}
+
+template<typename K, typename Acc, typename H, typename Combine>
+template<typename RandomIt>
+void HashAggregator<K, Acc, H, Combine>::consume(RandomIt first, RandomIt last) {
+    size_t rows = static_cast<size_t>(last - first);
+    size_t batches = (rows + _batch_size - 1) / _batch_size;
+    std::atomic<size_t> next_batch{0};
+
+    run_workers([&](size_t worker) {
+        partitions_type& local = _local[worker];
+        for (size_t batch = next_batch.fetch_add(1); batch < batches; batch = next_batch.fetch_add(1)) {
+            RandomIt begin = first + batch * _batch_size;
+            RandomIt end = first + std::min(rows, (batch + 1) * _batch_size);
+            for (RandomIt it = begin; it != end; ++it) {
+                const K& key = it->first;
+                accumulate(local[partition_of(key)], key, it->second);
+            }
+        }
+    });
+}
+
+template<typename K, typename Acc, typename H, typename Combine>
+void HashAggregator<K, Acc, H, Combine>::finish() {
+    std::atomic<size_t> next_partition{0};
+    size_t partitions = _merged.size();
+
+    run_workers([&](size_t) {
+        for (size_t p = next_partition.fetch_add(1); p < partitions; p = next_partition.fetch_add(1)) {
+            map_type& target = _merged[p];
+            for (auto& local : _local) {
+                map_type& source = local[p];
+                if (source.empty()) continue;
+                // take over the first non-empty table instead of re-inserting its groups
+                if (target.empty()) {
+                    std::swap(target, source);
+                    continue;
+                }
+                for (const auto& [key, value] : source) {
+                    accumulate(target, key, value);
+                }
+                source.clear();
+            }
+        }
+    });
+}
+
+template<typename K, typename Acc, typename H, typename Combine>
+size_t HashAggregator<K, Acc, H, Combine>::size() const {
+    size_t total = 0;
+    for (const auto& map : _merged) total += map.size();
+    return total;
+}
+
+template<typename K, typename Acc, typename H, typename Combine>
+bool HashAggregator<K, Acc, H, Combine>::contains(const K& key) const {
+    return _merged[partition_of(key)].contains(key);
+}
+
+template<typename K, typename Acc, typename H, typename Combine>
+const Acc& HashAggregator<K, Acc, H, Combine>::at(const K& key) const {
+    return _merged[partition_of(key)].at(key);
+}
+
+template<typename K, typename Acc, typename H, typename Combine>
+size_t HashAggregator<K, Acc, H, Combine>::partition_count() const {
+    return _merged.size();
+}
+
+template<typename K, typename Acc, typename H, typename Combine>
+const typename HashAggregator<K, Acc, H, Combine>::map_type&
+HashAggregator<K, Acc, H, Combine>::partition(size_t index) const {
+    if (index >= _merged.size()) {
+        throw std::out_of_range("HashAggregator::partition: index out of range");
+    }
+    return _merged[index];
+}
+
+template<typename K, typename Acc, typename H, typename Combine>
+template<typename Fn>
+void HashAggregator<K, Acc, H, Combine>::for_each(Fn fn) const {
+    for (const auto& map : _merged) {
+        for (const auto& [key, value] : map) fn(key, value);
+    }
+}
+
+template<typename K, typename Acc, typename H, typename Combine>
+typename HashAggregator<K, Acc, H, Combine>::map_type HashAggregator<K, Acc, H, Combine>::to_hashmap() const {
+    map_type result(std::max<size_t>(size(), 1), _hash_function);
+    for_each([&result](const K& key, const Acc& value) {
+        result.insert({key, value});
+    });
+    return result;
+}
+
+template<typename K, typename Acc, typename H, typename Combine>
+size_t HashAggregator<K, Acc, H, Combine>::thread_count() const {
+    return _num_threads;
+}
+
+template<typename K, typename Acc, typename H, typename Combine>
+size_t HashAggregator<K, Acc, H, Combine>::partition_of(const K& key) const {
+    // the top bits of a multiplicative mix; the tables themselves use hash % buckets,
+    // so partitioning does not reduce the entropy left for the buckets
+    uint64_t mixed = static_cast<uint64_t>(_hash_function(key)) * 0x9E3779B97F4A7C15ull;
+    return static_cast<size_t>(mixed >> (64 - _partition_bits));
+}
+
+template<typename K, typename Acc, typename H, typename Combine>
+void HashAggregator<K, Acc, H, Combine>::accumulate(map_type& map, const K& key, const Acc& value) {
+    auto iter = map.find(key);
+    if (iter != map.end()) {
+        iter->second = _combine(iter->second, value);
+        return;
+    }
+    map.insert({key, value});
+    grow_if_needed(map);
+}
+
+template<typename K, typename Acc, typename H, typename Combine>
+void HashAggregator<K, Acc, H, Combine>::grow_if_needed(map_type& map) {
+    // HashMap never rehashes on its own, so keep the chains of the local tables short
+    if (map.size() > kMaxLoadFactor * map.bucket_count()) {
+        map.rehash(4 * map.bucket_count());
+    }
+}
+
+template<typename K, typename Acc, typename H, typename Combine>
+template<typename Fn>
+void HashAggregator<K, Acc, H, Combine>::run_workers(Fn fn) {
+    std::vector<std::thread> workers;
+    for (size_t worker = 1; worker < _num_threads; worker++) {
+        workers.emplace_back(fn, worker);
+    }
+    fn(0);
+    for (auto& worker : workers) worker.join();
+}
+
+template<typename K, typename Acc, typename H, typename Combine>
+typename HashAggregator<K, Acc, H, Combine>::partitions_type
+HashAggregator<K, Acc, H, Combine>::make_partitions() const {
+    partitions_type partitions;
+    partitions.reserve(size_t(1) << _partition_bits);
+    for (size_t p = 0; p < (size_t(1) << _partition_bits); p++) {
+        partitions.emplace_back(kInitialBuckets, _hash_function);
+    }
+    return partitions;
+}
+
+#endif
@@ -0,0 +1,128 @@
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "batch_hash.h"
+#include "hash_quality.h"
+#include "hashers.h"
+
+/*
+* Reports how a hash function spreads a sample of keys over a HashMap.
+*
+* Usage:
+*      hash_analyzer <key file> [--type int|string] [--hasher std|default|mix|crc32c] [--buckets N]
+*
+* The key file holds one key per line. Integer keys are parsed as signed 64-bit numbers.
+* --buckets defaults to the number of distinct keys, i.e. a map at max_load_factor().
+* The hashers are std::hash, DefaultHash and, for integers, MixHash and Crc32cHash.
+*/
+
+struct Options {
+    std::string path;
+    std::string type = "int";
+    std::string hasher = "default";
+    size_t buckets = 0;
+};
+
+[[noreturn]] static void usage(const std::string& error) {
+    std::cerr << "hash_analyzer: " << error << '\n'
+              << "usage: hash_analyzer <key file> [--type int|string] [--hasher std|default|mix|crc32c] [--buckets N]\n";
+    std::exit(2);
+}
+
+static Options parse_options(int argc, char* argv[]) {
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg.rfind("--", 0) == 0) {
+            if (i + 1 == argc) usage("missing value for " + arg);
+            std::string value = argv[++i];
+            if (arg == "--type") {
+                options.type = value;
+            } else if (arg == "--hasher") {
+                options.hasher = value;
+            } else if (arg == "--buckets") {
+                options.buckets = std::stoull(value);
+            } else {
+                usage("unknown option " + arg);
+            }
+        } else if (options.path.empty()) {
+            options.path = arg;
+        } else {
+            usage("more than one key file");
+        }
+    }
+    if (options.path.empty()) usage("no key file");
+    return options;
+}
+
+template<typename K>
+static std::vector<K> read_keys(const std::string& path) {
+    std::ifstream in(path);
+    if (!in) throw std::runtime_error("cannot open " + path);
+    std::vector<K> keys;
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty()) continue;
+        if constexpr (std::is_integral_v<K>) {
+            keys.push_back(static_cast<K>(std::stoll(line)));
+        } else {
+            keys.push_back(line);
+        }
+    }
+    return keys;
+}
+
+template<typename K, typename H>
+static void report(const std::vector<K>& keys, const H& hash, const Options& options) {
+    size_t buckets = options.buckets;
+    if (buckets == 0) {
+        std::vector<K> distinct(keys);
+        std::sort(distinct.begin(), distinct.end());
+        buckets = std::max<size_t>(1, std::unique(distinct.begin(), distinct.end()) - distinct.begin());
+    }
+    std::cout << "hasher:                " << options.hasher << " on " << options.type << " keys\n"
+              << analyze_hash_quality(keys, hash, buckets);
+}
+
+int main(int argc, char* argv[]) {
+    try {
+        Options options = parse_options(argc, argv);
+        if (options.type == "int") {
+            auto keys = read_keys<long long>(options.path);
+            if (keys.empty()) usage(options.path + " holds no keys");
+            if (options.hasher == "std") {
+                report(keys, std::hash<long long>(), options);
+            } else if (options.hasher == "default") {
+                report(keys, DefaultHash<long long>(), options);
+            } else if (options.hasher == "mix") {
+                report(keys, MixHash<long long>(), options);
+            } else if (options.hasher == "crc32c") {
+                report(keys, Crc32cHash<long long>(), options);
+            } else {
+                usage("unknown hasher " + options.hasher + " for int keys");
+            }
+        } else if (options.type == "string") {
+            auto keys = read_keys<std::string>(options.path);
+            if (keys.empty()) usage(options.path + " holds no keys");
+            if (options.hasher == "std") {
+                report(keys, std::hash<std::string>(), options);
+            } else if (options.hasher == "default") {
+                report(keys, DefaultHash<std::string>(), options);
+            } else {
+                usage("unknown hasher " + options.hasher + " for string keys");
+            }
+        } else {
+            usage("unknown key type " + options.type);
+        }
+    } catch (const std::exception& error) {
+        std::cerr << "hash_analyzer: " << error.what() << '\n';
+        return 1;
+    }
+    return 0;
+}
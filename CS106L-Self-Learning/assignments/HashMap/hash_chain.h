@@ -0,0 +1,210 @@
+#ifndef HASH_CHAIN_H
+#define HASH_CHAIN_H
+
+#include <algorithm>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/*
+* Shared separate-chaining engine of HashMap, HashSet and HashMultiMap.
+*
+* All three containers store their elements in singly linked chains hanging off a
+* std::vector<Node*> of buckets, and all of them iterate with HashMapIterator. They only
+* differ in what a node stores (a K/M pair or just a key) and in how duplicate keys are
+* handled, so the node type and the chain algorithms below are written once, parametrized
+* on the stored value type and on a KeyOf function object that extracts the key from it.
+*/
+
+/*
+* node structure represented a node in a linked list.
+* Each node consists of a value (K/M pair for maps, K for sets) and a next pointer.
+*
+* Usage;
+*      HashNode<std::pair<const int, int>> n;
+*      n.value = {3, 4};
+*      n.next = nullptr;
+*/
+template<typename Value>
+struct HashNode
+{
+    Value value;
+    HashNode* next;
+    /*
+    * Default constructor, so even if you forget to set next to nullptr it'll be fine.
+    */
+    HashNode() : value(Value()), next(nullptr) {};
+    HashNode(const Value& value, HashNode* next) : value(value), next(next) {};
+};
+
+/*
+* Node that also keeps the hash of its key, as HashMap's nodes do. Rehashing then never calls
+* the hash function, and a chain walk compares the stored hash before the key, which lets
+* a chain kept sorted by hash stop at the first larger hash.
+*/
+template<typename Value>
+struct HashedNode
+{
+    Value value;
+    size_t hash;
+    HashedNode* next;
+
+    HashedNode() : value(Value()), hash(0), next(nullptr) {};
+    HashedNode(const Value& value, size_t hash, HashedNode* next) : value(value), hash(hash), next(next) {};
+};
+
+/*
+* Hash of the key of node: stored in a HashedNode, computed with hash_of for a HashNode.
+*/
+template<typename Value, typename HashOf>
+size_t chain_node_hash(const HashNode<Value>* node, HashOf& hash_of) {
+    return hash_of(node->value);
+}
+
+template<typename Value, typename HashOf>
+size_t chain_node_hash(const HashedNode<Value>* node, HashOf&) {
+    return node->hash;
+}
+
+/*
+* KeyOf function objects: the key of a set element is the element itself,
+* the key of a map element is its first member.
+*/
+struct IdentityKey {
+    template<typename T>
+    const T& operator()(const T& value) const { return value; }
+};
+
+struct PairFirstKey {
+    template<typename P>
+    const typename P::first_type& operator()(const P& value) const { return value.first; }
+};
+
+/*
+* Walks the chain starting at head looking for key.
+* Returns {previous node, node with key}; if key is not found, returns
+* {last node in the chain (nullptr if empty), nullptr}, so the result can be used
+* to append a new node at the tail.
+*
+* Complexity: O(L), L = length of the chain
+*/
+template<typename Node, typename K, typename KeyOf>
+std::pair<Node*, Node*> chain_find(Node* head, const K& key, KeyOf key_of) {
+    Node* prev = nullptr;
+    Node* curr = head;
+    while (curr != nullptr) {
+        if (key_of(curr->value) == key) return {prev, curr};
+        prev = curr;
+        curr = curr->next;
+    }
+    return {prev, curr};
+}
+
+/*
+* chain_find for HashedNode chains with the hash of key already known: keys are only
+* compared on nodes with the same hash. If sorted is true the chain must be ordered by
+* hash, and the walk stops at the first larger hash; when key is not found, the previous
+* node returned is then the one after which key belongs (nullptr for the head).
+*
+* Complexity: O(L), L = length of the chain; O(position of key) if sorted
+*/
+template<typename Node, typename K, typename KeyOf>
+std::pair<Node*, Node*> chain_find_hashed(Node* head, const K& key, size_t hash, KeyOf key_of, bool sorted) {
+    Node* prev = nullptr;
+    Node* curr = head;
+    while (curr != nullptr) {
+        if (curr->hash == hash && key_of(curr->value) == key) return {prev, curr};
+        if (sorted && curr->hash > hash) return {prev, nullptr};
+        prev = curr;
+        curr = curr->next;
+    }
+    return {prev, curr};
+}
+
+/*
+* Stably sorts every chain of HashedNodes by hash, relinking the nodes in place.
+*
+* Complexity: O(N log L + B), L = length of the longest chain
+*/
+template<typename BucketArray>
+void chain_sort_by_hash(BucketArray& buckets) {
+    using Node = std::remove_pointer_t<typename BucketArray::value_type>;
+    std::vector<Node*> chain;
+    for (auto& head : buckets) {
+        if (head == nullptr || head->next == nullptr) continue;
+        chain.clear();
+        for (Node* node = head; node != nullptr; node = node->next) chain.push_back(node);
+        std::stable_sort(chain.begin(), chain.end(), [](const Node* lhs, const Node* rhs) {
+            return lhs->hash < rhs->hash;
+        });
+        for (size_t i = 0; i + 1 < chain.size(); i++) chain[i]->next = chain[i + 1];
+        chain.back()->next = nullptr;
+        head = chain.front();
+    }
+}
+
+/*
+* Returns the index of the first non-empty bucket, or the last index if all buckets are empty
+* (whose head is then nullptr, which is exactly what end() points to).
+*/
+template<typename BucketArray>
+size_t chain_first_not_empty(const BucketArray& buckets) {
+    for (size_t i = 0; i < buckets.size(); i++) {
+        if (buckets[i] != nullptr) return i;
+    }
+    return buckets.size() - 1;
+}
+
+/*
+* Frees every node of every chain with delete_node(node) and resets all bucket heads to
+* nullptr. The number of buckets stays the same. Without delete_node, nodes are deleted.
+*
+* Complexity: O(N + B)
+*/
+template<typename BucketArray, typename DeleteNode>
+void chain_delete_all(BucketArray& buckets, DeleteNode delete_node) {
+    for (auto& bucket : buckets) {
+        // bucket is the head of linkedlist, traverse linkedlist and delete each node
+        while (bucket != nullptr) {
+            auto next = bucket->next;
+            delete_node(bucket);
+            bucket = next;
+        }
+    }
+}
+
+template<typename BucketArray>
+void chain_delete_all(BucketArray& buckets) {
+    chain_delete_all(buckets, [](auto node) { delete node; });
+}
+
+/*
+* Resizes buckets to new_count heads and relinks every node into bucket
+* hash_of(node) % new_count (the stored hash for a HashedNode). No node is allocated,
+* copied or freed.
+*
+* Nodes are pushed to the head of their new chain while the old chains are walked in order,
+* so runs of adjacent nodes that land in the same bucket stay adjacent (in reverse order);
+* HashMultiMap relies on this to keep equal keys together.
+*
+* Complexity: O(N + B)
+*/
+template<typename BucketArray, typename HashOf>
+void chain_redistribute(BucketArray& buckets, size_t new_count, HashOf hash_of) {
+    // swap in an empty array of new_count heads, keeping the old heads in old_buckets
+    BucketArray old_buckets(new_count, nullptr, buckets.get_allocator());
+    old_buckets.swap(buckets);
+
+    for (auto old_head : old_buckets) {
+        while (old_head != nullptr) {
+            auto curr = old_head;
+            old_head = old_head->next;
+            size_t index = chain_node_hash(curr, hash_of) % new_count;
+            curr->next = buckets[index];
+            buckets[index] = curr;
+        }
+    }
+}
+
+#endif
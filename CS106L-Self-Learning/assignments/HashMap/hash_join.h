@@ -0,0 +1,466 @@
+#ifndef HASH_JOIN_H
+#define HASH_JOIN_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include "hash_multimap.h"
+#include "hashers.h"
+
+/*
+* Join modes supported by HashJoinTable:
+*      Inner    - emit(probe_row, build_row) for every matching pair
+*      LeftSemi - emit(probe_row) once for every probe row with at least one match
+*      LeftAnti - emit(probe_row) for every probe row without any match
+*/
+enum class JoinMode { Inner, LeftSemi, LeftAnti };
+
+/*
+* Template class for the build side of a hash join
+*
+* K = join key type
+* BuildRow = type of the build-side rows
+* H = hash function type used to hash a key; if not provided, defaults to std::hash<K>
+*
+* The build side is loaded into a HashMultiMap from key to row (duplicate keys allowed).
+* Probing then works on batches of probe rows: the keys of a whole batch are hashed and their
+* bucket slots prefetched, then the chain heads are prefetched, and only then is each row
+* looked up. The cache misses of one batch overlap instead of being paid one row at a time
+* as with a plain HashMap::find per row. The table is immutable after construction, so it can
+* be probed by several streams, also concurrently.
+*
+* Usage:
+*      HashJoinTable<int, Customer> customers(rows.begin(), rows.end(),
+*                                             [](const Customer& c) { return c.id; });
+*      customers.probe<JoinMode::Inner>(orders.begin(), orders.end(),
+*                                       [](const Order& o) { return o.customer_id; },
+*                                       [](const Order& o, const Customer& c) {...});
+*/
+template<typename K, typename BuildRow, typename H = std::hash<K>>
+class HashJoinTable {
+public:
+    /*
+    * Builds the table from the rows in [first, last); key_of(row) returns the join key.
+    * For forward iterators the bucket count is sized to the number of rows up front. An
+    * input range cannot be counted, so the table doubles its buckets whenever the rows
+    * reach the bucket count.
+    *
+    * Complexity: O(N) (amortized for input iterators), N = number of build rows
+    */
+    template<typename InputIt, typename KeyOf>
+    HashJoinTable(InputIt first, InputIt last, KeyOf key_of, const H& hash = H());
+
+    /*
+    * Probes the rows in [first, last) and calls emit as described for JoinMode.
+    * The emit callback may be a function object or an output adapter from join_output().
+    *
+    * Complexity: O(P + M), P = number of probe rows, M = number of emitted rows
+    */
+    template<JoinMode Mode, typename ForwardIt, typename KeyOf, typename Emit>
+    void probe(ForwardIt first, ForwardIt last, KeyOf key_of, Emit&& emit,
+               size_t batch_size = kDefaultBatchSize) const;
+
+    size_t size() const;
+    size_t bucket_count() const;
+
+private:
+    static constexpr size_t kDefaultBatchSize = 16;
+
+    HashMultiMap<K, BuildRow, H> _table;
+};
+
+/*
+* Output adapter for HashJoinTable::probe: writes std::pair(probe_row, build_row) for
+* inner joins, or the probe row for semi/anti joins, through an output iterator.
+*
+* Usage:
+*      std::vector<std::pair<Order, Customer>> joined;
+*      customers.probe<JoinMode::Inner>(..., join_output(std::back_inserter(joined)));
+*/
+template<typename OutputIt>
+class JoinOutput {
+public:
+    explicit JoinOutput(OutputIt out) : _out(out) {}
+
+    template<typename ProbeRow, typename BuildRow>
+    void operator()(const ProbeRow& probe_row, const BuildRow& build_row) {
+        *_out++ = std::make_pair(probe_row, build_row);
+    }
+
+    template<typename ProbeRow>
+    void operator()(const ProbeRow& probe_row) {
+        *_out++ = probe_row;
+    }
+
+private:
+    OutputIt _out;
+};
+
+template<typename OutputIt>
+JoinOutput<OutputIt> join_output(OutputIt out) {
+    return JoinOutput<OutputIt>(out);
+}
+
+/*
+* Joins a build range against a probe range within a memory budget.
+*
+* If the build side fits into memory_budget bytes (estimated from the row count and the
+* node size), this is a single HashJoinTable build and probe. Otherwise it runs a Grace hash
+* join: both sides are radix-partitioned by hash into local temporary files (std::tmpfile),
+* aiming for each build partition to fit the budget, and every partition pair is then
+* joined in memory on its own. Matching rows always share a partition, so the result is the
+* same as the in-memory join (only the emit order differs).
+*
+* A pass writes at most 2^kMaxGracePartitionBits partitions, two open files each. A build
+* partition that still exceeds the budget (a very large input, or skew) is partitioned again
+* on the next hash bits; one whose rows all have the same hash cannot be split, and is
+* joined in budget-sized chunks of its build side, each probed with the whole partition.
+* Each partition pair is closed once it is joined. A nested pass also gets a smaller fan-out
+* while the partitions above it still hold descriptors. So at most about
+* kMaxOpenSpillFiles temporary files are open at once, however deep the partitioning goes.
+*
+* Requirements: when spilling, both row types must be trivially copyable, since they are
+* written to the temporary files as raw bytes.
+*
+* Exceptions: std::out_of_range if memory_budget is 0; std::length_error if the build side
+* exceeds the budget but the rows are not trivially copyable; std::runtime_error if a
+* temporary file cannot be created or written.
+*/
+template<JoinMode Mode, typename K, typename H = std::hash<K>,
+         typename BuildIt, typename ProbeIt, typename BuildKeyOf, typename ProbeKeyOf, typename Emit>
+void grace_hash_join(BuildIt build_first, BuildIt build_last, BuildKeyOf build_key,
+                     ProbeIt probe_first, ProbeIt probe_last, ProbeKeyOf probe_key,
+                     Emit emit, size_t memory_budget, const H& hash = H());
+
+template<typename K, typename BuildRow, typename H>
+template<typename InputIt, typename KeyOf>
+HashJoinTable<K, BuildRow, H>::HashJoinTable(InputIt first, InputIt last, KeyOf key_of, const H& hash) :
+    _table(1, hash)
+{
+    using category = typename std::iterator_traits<InputIt>::iterator_category;
+    constexpr bool kSized = std::is_base_of_v<std::forward_iterator_tag, category>;
+    if constexpr (kSized) {
+        _table.rehash(std::max<size_t>(1, std::distance(first, last)));
+    }
+    for (InputIt it = first; it != last; ++it) {
+        if constexpr (!kSized) {
+            // keep about one row per bucket, as for a counted range
+            if (_table.size() >= _table.bucket_count()) _table.rehash(2 * _table.size());
+        }
+        _table.insert({key_of(*it), *it});
+    }
+}
+
+template<typename K, typename BuildRow, typename H>
+template<JoinMode Mode, typename ForwardIt, typename KeyOf, typename Emit>
+void HashJoinTable<K, BuildRow, H>::probe(ForwardIt first, ForwardIt last, KeyOf key_of, Emit&& emit,
+                                          size_t batch_size) const {
+    if (batch_size == 0) batch_size = 1;
+    std::vector<ForwardIt> rows(batch_size);
+    std::vector<K> keys(batch_size);
+    std::vector<size_t> hashes(batch_size);
+
+    while (first != last) {
+        // stage 1: hash the batch and prefetch the bucket slots
+        size_t count = 0;
+        for (; count < batch_size && first != last; ++count, ++first) {
+            rows[count] = first;
+            keys[count] = key_of(*first);
+            hashes[count] = _table.hash_of(keys[count]);
+            _table.prefetch_bucket(hashes[count]);
+        }
+        // stage 2: the slots are in cache now, prefetch the chain heads
+        for (size_t i = 0; i < count; i++) {
+            _table.prefetch_head(hashes[i]);
+        }
+        // stage 3: walk the chains
+        for (size_t i = 0; i < count; i++) {
+            auto [match, match_end] = _table.equal_range(keys[i], hashes[i]);
+            if constexpr (Mode == JoinMode::Inner) {
+                for (; match != match_end; ++match) emit(*rows[i], match->second);
+            } else if constexpr (Mode == JoinMode::LeftSemi) {
+                if (match != match_end) emit(*rows[i]);
+            } else {
+                if (match == match_end) emit(*rows[i]);
+            }
+        }
+    }
+}
+
+template<typename K, typename BuildRow, typename H>
+size_t HashJoinTable<K, BuildRow, H>::size() const {
+    return _table.size();
+}
+
+template<typename K, typename BuildRow, typename H>
+size_t HashJoinTable<K, BuildRow, H>::bucket_count() const {
+    return _table.bucket_count();
+}
+
+/*
+* A temporary spill file holding rows of one partition as raw bytes. It also remembers
+* whether all of its rows have the same hash, in which case no further partitioning can
+* split it.
+*/
+template<typename Row>
+class SpillFile {
+public:
+    SpillFile() : _file(std::tmpfile(), &std::fclose), _count(0), _hash(0), _one_hash(true) {
+        if (_file == nullptr) throw std::runtime_error("grace_hash_join: cannot create temporary file");
+    }
+
+    void write(const Row& row, uint64_t hash) {
+        if (std::fwrite(&row, sizeof(Row), 1, _file.get()) != 1) {
+            throw std::runtime_error("grace_hash_join: cannot write temporary file");
+        }
+        if (_count == 0) _hash = hash;
+        _one_hash = _one_hash && hash == _hash;
+        _count++;
+    }
+
+    /*
+    * Reads all rows back, in chunks of chunk_size rows, and calls fn(begin, end) per chunk.
+    */
+    template<typename Fn>
+    void read_chunks(size_t chunk_size, Fn fn) {
+        std::rewind(_file.get());
+        std::vector<Row> chunk(chunk_size);
+        size_t remaining = _count;
+        while (remaining > 0) {
+            size_t count = std::fread(chunk.data(), sizeof(Row), std::min(chunk_size, remaining), _file.get());
+            if (count == 0) throw std::runtime_error("grace_hash_join: cannot read temporary file");
+            fn(chunk.begin(), chunk.begin() + count);
+            remaining -= count;
+        }
+    }
+
+    std::vector<Row> read_all() {
+        std::vector<Row> rows;
+        read_chunks(std::max<size_t>(_count, 1), [&rows](auto begin, auto end) {
+            rows.assign(begin, end);
+        });
+        return rows;
+    }
+
+    /*
+    * Closes the file and frees its descriptor; the rows cannot be read any more.
+    */
+    void close() { _file.reset(); }
+
+    bool is_open() const { return _file != nullptr; }
+    size_t size() const { return _count; }
+    bool one_hash() const { return _one_hash; }
+
+private:
+    std::unique_ptr<std::FILE, int (*)(std::FILE*)> _file;
+    size_t _count;
+    uint64_t _hash;
+    bool _one_hash;
+};
+
+// fan-out of one partitioning pass: two temporary files per partition stay open at once
+constexpr size_t kMaxGracePartitionBits = 8;
+// temporary files open at once across all levels, well under the usual limit of 1024
+constexpr size_t kMaxOpenSpillFiles = size_t(2) << kMaxGracePartitionBits;
+
+/*
+* Shared state of a spilling grace_hash_join: the key functions, the budget, and the
+* recursive partitioning. Level by level, partitions use the next bits of
+* mix64(hash(key)), starting from the top ones.
+*/
+template<JoinMode Mode, typename K, typename H, typename BuildRow, typename ProbeRow,
+         typename BuildKeyOf, typename ProbeKeyOf, typename Emit>
+class GraceJoin {
+public:
+    // a build row costs a multimap node (key, row and next pointer) plus a bucket slot
+    static constexpr size_t kRowBytes = sizeof(K) + sizeof(BuildRow) + 2 * sizeof(void*);
+
+    GraceJoin(const BuildKeyOf& build_key, const ProbeKeyOf& probe_key, Emit& emit,
+              size_t memory_budget, const H& hash) :
+        _build_key(build_key), _probe_key(probe_key), _emit(emit), _memory_budget(memory_budget), _hash(hash),
+        _probe_chunk(std::max<size_t>(1024, memory_budget / 4 / sizeof(ProbeRow))) {}
+
+    uint64_t hash_of(const K& key) const {
+        return mix64(static_cast<uint64_t>(_hash(key)));
+    }
+
+    /*
+    * Partition bits for rows of the given size: twice the minimum number of partitions,
+    * so that moderate skew still fits the budget, but at most 2^kMaxGracePartitionBits and
+    * no more than the hash bits left after used_bits. A nested pass also keeps the open
+    * files within kMaxOpenSpillFiles, down to a single bit; deeper passes split the rest.
+    */
+    size_t partition_bits(size_t build_rows, size_t used_bits) const {
+        size_t min_partitions = (build_rows * kRowBytes + _memory_budget - 1) / _memory_budget;
+        size_t bits = 1;
+        while (bits < kMaxGracePartitionBits && (size_t(1) << bits) < 2 * min_partitions) bits++;
+        while (bits > 1 && _open_files + (size_t(2) << bits) > kMaxOpenSpillFiles) bits--;
+        return std::min(bits, 64 - used_bits);
+    }
+
+    template<typename Row>
+    std::vector<SpillFile<Row>> open_partitions(size_t bits) {
+        std::vector<SpillFile<Row>> files(size_t(1) << bits);
+        _open_files += files.size();
+        return files;
+    }
+
+    /*
+    * Joins the partition pairs one after the other, closing each pair right after its join
+    * so that only the pairs still waiting keep their descriptors.
+    */
+    void join_partitions(std::vector<SpillFile<BuildRow>>& build_files,
+                         std::vector<SpillFile<ProbeRow>>& probe_files, size_t used_bits) {
+        for (size_t p = 0; p < build_files.size(); p++) {
+            join(build_files[p], probe_files[p], used_bits);
+            close(build_files[p]);
+            close(probe_files[p]);
+        }
+    }
+
+    static size_t partition_of(uint64_t hash, size_t used_bits, size_t bits) {
+        return static_cast<size_t>((hash << used_bits) >> (64 - bits));
+    }
+
+    /*
+    * Joins one spilled partition pair whose rows agree on the top used_bits hash bits.
+    * A build side over the budget is partitioned again on the next hash bits; one that
+    * cannot be split (all rows have the same hash) is joined in budget-sized chunks.
+    */
+    void join(SpillFile<BuildRow>& build, SpillFile<ProbeRow>& probe, size_t used_bits) {
+        if (probe.size() == 0) return;
+        if (build.size() == 0 && Mode != JoinMode::LeftAnti) return;
+
+        if (build.size() * kRowBytes <= _memory_budget) {
+            std::vector<BuildRow> rows = build.read_all();
+            HashJoinTable<K, BuildRow, H> table(rows.begin(), rows.end(), _build_key, _hash);
+            probe.read_chunks(_probe_chunk, [&](auto begin, auto end) {
+                table.template probe<Mode>(begin, end, _probe_key, _emit);
+            });
+            return;
+        }
+        if (build.one_hash() || used_bits == 64) {
+            join_chunked(build, probe);
+            return;
+        }
+
+        size_t bits = partition_bits(build.size(), used_bits);
+        auto build_files = open_partitions<BuildRow>(bits);
+        auto probe_files = open_partitions<ProbeRow>(bits);
+        build.read_chunks(_probe_chunk, [&](auto begin, auto end) {
+            for (auto it = begin; it != end; ++it) {
+                uint64_t hash = hash_of(_build_key(*it));
+                build_files[partition_of(hash, used_bits, bits)].write(*it, hash);
+            }
+        });
+        probe.read_chunks(_probe_chunk, [&](auto begin, auto end) {
+            for (auto it = begin; it != end; ++it) {
+                uint64_t hash = hash_of(_probe_key(*it));
+                probe_files[partition_of(hash, used_bits, bits)].write(*it, hash);
+            }
+        });
+        // every row is in a child partition now: the parent pair is not needed any more
+        close(build);
+        close(probe);
+        join_partitions(build_files, probe_files, used_bits + bits);
+    }
+
+private:
+    template<typename Row>
+    void close(SpillFile<Row>& file) {
+        if (!file.is_open()) return;
+        file.close();
+        _open_files--;
+    }
+
+    /*
+    * Block nested loop over budget-sized chunks of the build side: every chunk is built
+    * into a table and probed with the whole probe side. Semi and anti joins keep one bit
+    * per probe row, set when any chunk matched it, and emit at the end.
+    */
+    void join_chunked(SpillFile<BuildRow>& build, SpillFile<ProbeRow>& probe) {
+        const size_t build_chunk = std::max<size_t>(1, _memory_budget / kRowBytes);
+        if constexpr (Mode == JoinMode::Inner) {
+            build.read_chunks(build_chunk, [&](auto build_begin, auto build_end) {
+                HashJoinTable<K, BuildRow, H> table(build_begin, build_end, _build_key, _hash);
+                probe.read_chunks(_probe_chunk, [&](auto begin, auto end) {
+                    table.template probe<Mode>(begin, end, _probe_key, _emit);
+                });
+            });
+        } else {
+            std::vector<bool> matched(probe.size());
+            build.read_chunks(build_chunk, [&](auto build_begin, auto build_end) {
+                HashJoinTable<K, BuildRow, H> table(build_begin, build_end, _build_key, _hash);
+                size_t first = 0;
+                probe.read_chunks(_probe_chunk, [&](auto begin, auto end) {
+                    table.template probe<JoinMode::LeftSemi>(begin, end, _probe_key, [&](const ProbeRow& row) {
+                        matched[first + (&row - &*begin)] = true;
+                    });
+                    first += end - begin;
+                });
+            });
+            size_t first = 0;
+            probe.read_chunks(_probe_chunk, [&](auto begin, auto end) {
+                for (auto it = begin; it != end; ++it) {
+                    if (matched[first + (it - begin)] == (Mode == JoinMode::LeftSemi)) _emit(*it);
+                }
+                first += end - begin;
+            });
+        }
+    }
+
+    const BuildKeyOf& _build_key;
+    const ProbeKeyOf& _probe_key;
+    Emit& _emit;
+    size_t _memory_budget;
+    const H& _hash;
+    size_t _probe_chunk;
+    // spill files currently open, at every level of the partitioning
+    size_t _open_files = 0;
+};
+
+template<JoinMode Mode, typename K, typename H,
+         typename BuildIt, typename ProbeIt, typename BuildKeyOf, typename ProbeKeyOf, typename Emit>
+void grace_hash_join(BuildIt build_first, BuildIt build_last, BuildKeyOf build_key,
+                     ProbeIt probe_first, ProbeIt probe_last, ProbeKeyOf probe_key,
+                     Emit emit, size_t memory_budget, const H& hash) {
+    using BuildRow = typename std::iterator_traits<BuildIt>::value_type;
+    using ProbeRow = typename std::iterator_traits<ProbeIt>::value_type;
+    using Join = GraceJoin<Mode, K, H, BuildRow, ProbeRow, BuildKeyOf, ProbeKeyOf, Emit>;
+    if (memory_budget == 0) {
+        throw std::out_of_range("grace_hash_join: memory_budget cannot be 0");
+    }
+    const size_t build_rows = std::distance(build_first, build_last);
+
+    if (build_rows * Join::kRowBytes <= memory_budget) {
+        HashJoinTable<K, BuildRow, H> table(build_first, build_last, build_key, hash);
+        table.template probe<Mode>(probe_first, probe_last, probe_key, emit);
+        return;
+    }
+
+    if constexpr (!std::is_trivially_copyable_v<BuildRow> || !std::is_trivially_copyable_v<ProbeRow>) {
+        throw std::length_error("grace_hash_join: build side exceeds the budget and rows cannot be spilled");
+    } else {
+        Join join(build_key, probe_key, emit, memory_budget, hash);
+        size_t bits = join.partition_bits(build_rows, 0);
+        auto build_files = join.template open_partitions<BuildRow>(bits);
+        auto probe_files = join.template open_partitions<ProbeRow>(bits);
+        for (BuildIt it = build_first; it != build_last; ++it) {
+            uint64_t key_hash = join.hash_of(build_key(*it));
+            build_files[Join::partition_of(key_hash, 0, bits)].write(*it, key_hash);
+        }
+        for (ProbeIt it = probe_first; it != probe_last; ++it) {
+            uint64_t key_hash = join.hash_of(probe_key(*it));
+            probe_files[Join::partition_of(key_hash, 0, bits)].write(*it, key_hash);
+        }
+        join.join_partitions(build_files, probe_files, bits);
+    }
+}
+
+#endif
@@ -0,0 +1,454 @@
+#ifndef HASH_MULTIMAP_H
+#define HASH_MULTIMAP_H
+
+#include <iostream>
+#include <initializer_list>
+#include <stdexcept>
+#include <vector>
+
+#include "hash_chain.h"
+#include "hashmap_iterator.h"
+
+/*
+* Template class for a HashMultiMap
+*
+* K = key type
+* V = mapped type
+* H = hash function type used to hash a key; if not provided, defaults to std::hash<K>
+*
+* HashMultiMap is built on the same chains and iterator as HashMap but allows several
+* elements with equal keys. Instead of emulating it with HashMap<K, std::vector<V>> (one
+* extra allocation per key), every element is its own node and elements with equal keys are
+* kept adjacent within their chain, so equal_range is a single walk.
+*
+* Usage:
+*      HashMultiMap<std::string, int> map;
+*      map.insert({"Avery", 2020});
+*      map.insert({"Avery", 2021});
+*      auto [first, last] = map.equal_range("Avery");   // two elements
+*
+* Concept requirements:
+*      - H is function type that with function prototype size_t hash(const K& key).
+*      - K and V must be regular (copyable, default constructible, and equality comparable).
+*/
+template<typename K, typename V, typename H = std::hash<K>>
+class HashMultiMap {
+public:
+    using key_type = K;
+    using mapped_type = V;
+    using value_type = std::pair<const K, V>;
+    using iterator = HashMapIterator<HashMultiMap, false>;
+    using const_iterator = HashMapIterator<HashMultiMap, true>;
+
+    friend class HashMapIterator<HashMultiMap, false>;
+    friend class HashMapIterator<HashMultiMap, true>;
+
+    /*
+    * Constructors, with the same meaning as the ones of HashMap, except that duplicate
+    * keys in the range or initializer_list are all kept.
+    */
+    HashMultiMap();
+    explicit HashMultiMap(size_t bucket_count, const H& hash = H());
+    template<typename InputIter>
+    HashMultiMap(InputIter begin, InputIter end, size_t bucket_count = kDefaultBuckets, const H& hash = H());
+    HashMultiMap(std::initializer_list<value_type> init, size_t bucket_count = kDefaultBuckets, const H& hash = H());
+
+    HashMultiMap(const HashMultiMap& map);
+    HashMultiMap(HashMultiMap&& map);
+    HashMultiMap& operator=(const HashMultiMap& map);
+    HashMultiMap& operator=(HashMultiMap&& map);
+    ~HashMultiMap();
+
+    inline size_t size() const;
+    inline bool empty() const;
+    inline float load_factor() const;
+    inline size_t bucket_count() const;
+
+    bool contains(const K& key) const;
+
+    /*
+    * Returns the number of elements with the given key.
+    *
+    * Complexity: O(1 + C) average case, C = count(key)
+    */
+    size_t count(const K& key) const;
+
+    /*
+    * Inserts the K/V pair, even if elements with that key already exist.
+    * The new element is placed right after the last element with an equal key.
+    *
+    * Return value: iterator to the new element.
+    *
+    * Complexity: O(1 + C) average case, C = count(key)
+    */
+    iterator insert(const value_type& value);
+
+    /*
+    * Returns the range [first, last) of all elements with the given key,
+    * or {end(), end()} if there is none.
+    *
+    * Usage:
+    *      auto [first, last] = map.equal_range(3);
+    *      for (auto iter = first; iter != last; ++iter) {...}
+    *
+    * Complexity: O(1 + C) average case, C = count(key)
+    */
+    std::pair<iterator, iterator> equal_range(const K& key);
+    std::pair<const_iterator, const_iterator> equal_range(const K& key) const;
+
+    /*
+    * Precomputed-hash lookups for batched probing (see HashJoinTable): hash_of returns the
+    * hash of key, the prefetch functions warm the bucket slot, then the head node of the
+    * chain for that hash, and equal_range(key, hash) skips hashing key again.
+    * Behavior is undefined if hash != hash_of(key).
+    *
+    * Usage:
+    *      size_t hash = map.hash_of(key);
+    *      map.prefetch_bucket(hash);
+    *      ... // other work
+    *      map.prefetch_head(hash);
+    *      ... // other work
+    *      auto [first, last] = map.equal_range(key, hash);
+    */
+    size_t hash_of(const K& key) const;
+    void prefetch_bucket(size_t hash) const;
+    void prefetch_head(size_t hash) const;
+    std::pair<const_iterator, const_iterator> equal_range(const K& key, size_t hash) const;
+
+    /*
+    * Returns an iterator to the first element with the given key, or end().
+    */
+    iterator find(const K& key);
+    const_iterator find(const K& key) const;
+
+    /*
+    * Erases all elements with the given key (returns how many were erased), or the single
+    * element pos points to (returns the iterator following pos).
+    */
+    size_t erase(const K& key);
+    iterator erase(const_iterator pos);
+
+    void clear();
+
+    /*
+    * Relinks all elements into new_buckets buckets; equal keys stay adjacent.
+    *
+    * Exceptions: std::out_of_range if new_buckets = 0.
+    */
+    void rehash(size_t new_buckets);
+
+    iterator begin();
+    const_iterator begin() const;
+    iterator end();
+    const_iterator end() const;
+
+private:
+    using Node = HashNode<value_type>;
+    using node_pair = std::pair<Node*, Node*>;
+
+    node_pair find_node(const K& key) const;
+    node_pair find_node(const K& key, size_t hash) const;
+    std::pair<iterator, iterator> equal_range_of(const K& key, size_t hash);
+    iterator make_iterator(Node* curr);
+
+    /* Private member variables */
+    size_t _size;
+    H _hash_function;
+    std::vector<Node*> _buckets_array;
+
+    static const size_t kDefaultBuckets = 10;
+    using bucket_array_type = decltype(_buckets_array);
+};
+
+template<typename K, typename V, typename H>
+HashMultiMap<K, V, H>::HashMultiMap() : HashMultiMap(kDefaultBuckets) {}
+
+template<typename K, typename V, typename H>
+HashMultiMap<K, V, H>::HashMultiMap(size_t bucket_count, const H& hash) :
+    _size(0),
+    _hash_function(hash),
+    _buckets_array(bucket_count, nullptr) {}
+
+template<typename K, typename V, typename H>
+template<typename InputIter>
+HashMultiMap<K, V, H>::HashMultiMap(InputIter begin, InputIter end, size_t bucket_count, const H& hash) :
+    HashMultiMap(bucket_count, hash)
+{
+    for (InputIter it = begin; it != end; it++) {
+        insert(*it);
+    }
+}
+
+template<typename K, typename V, typename H>
+HashMultiMap<K, V, H>::HashMultiMap(std::initializer_list<value_type> init, size_t bucket_count, const H& hash) :
+    HashMultiMap(init.begin(), init.end(), bucket_count, hash) {}
+
+template<typename K, typename V, typename H>
+HashMultiMap<K, V, H>::HashMultiMap(const HashMultiMap& map) :
+    HashMultiMap(map._buckets_array.size(), map._hash_function)
+{
+    // insert places each element after its equal keys, so the relative order is kept
+    for (const auto& kv_pair : map) {
+        insert(kv_pair);
+    }
+}
+
+template<typename K, typename V, typename H>
+HashMultiMap<K, V, H>::HashMultiMap(HashMultiMap&& map) :
+    _size(map._size),
+    _hash_function(std::move(map._hash_function)),
+    _buckets_array(std::move(map._buckets_array))
+{
+    map._buckets_array.resize(_buckets_array.size(), nullptr);
+    map._size = 0;
+}
+
+template<typename K, typename V, typename H>
+HashMultiMap<K, V, H>& HashMultiMap<K, V, H>::operator=(const HashMultiMap& map) {
+    if (this == &map) return *this;
+    clear();
+    _hash_function = map._hash_function;
+    for (const auto& kv_pair : map) {
+        insert(kv_pair);
+    }
+    return *this;
+}
+
+template<typename K, typename V, typename H>
+HashMultiMap<K, V, H>& HashMultiMap<K, V, H>::operator=(HashMultiMap&& map) {
+    if (this == &map) return *this;
+    clear();
+    _size = map._size;
+    _hash_function = std::move(map._hash_function);
+    _buckets_array = std::move(map._buckets_array);
+    map._size = 0;
+    map._buckets_array.resize(_buckets_array.size(), nullptr);
+    return *this;
+}
+
+template<typename K, typename V, typename H>
+HashMultiMap<K, V, H>::~HashMultiMap() {
+    clear();
+}
+
+template<typename K, typename V, typename H>
+inline size_t HashMultiMap<K, V, H>::size() const {
+    return _size;
+}
+
+template<typename K, typename V, typename H>
+inline bool HashMultiMap<K, V, H>::empty() const {
+    return _size == 0;
+}
+
+template<typename K, typename V, typename H>
+inline float HashMultiMap<K, V, H>::load_factor() const {
+    return ((float) _size) / _buckets_array.size();
+}
+
+template<typename K, typename V, typename H>
+inline size_t HashMultiMap<K, V, H>::bucket_count() const {
+    return _buckets_array.size();
+}
+
+template<typename K, typename V, typename H>
+bool HashMultiMap<K, V, H>::contains(const K& key) const {
+    return find_node(key).second != nullptr;
+}
+
+template<typename K, typename V, typename H>
+size_t HashMultiMap<K, V, H>::count(const K& key) const {
+    size_t result = 0;
+    for (Node* curr = find_node(key).second; curr != nullptr && curr->value.first == key; curr = curr->next) {
+        result++;
+    }
+    return result;
+}
+
+template<typename K, typename V, typename H>
+typename HashMultiMap<K, V, H>::iterator HashMultiMap<K, V, H>::insert(const value_type& value) {
+    auto [prev, curr] = find_node(value.first);
+    // append after the run of equal keys, or at the tail of the chain if there is none
+    while (curr != nullptr && curr->value.first == value.first) {
+        prev = curr;
+        curr = curr->next;
+    }
+    Node* new_node = new Node(value, curr);
+    if (prev != nullptr) {
+        prev->next = new_node;
+    } else {
+        _buckets_array[_hash_function(value.first) % _buckets_array.size()] = new_node;
+    }
+    _size++;
+    return make_iterator(new_node);
+}
+
+template<typename K, typename V, typename H>
+std::pair<typename HashMultiMap<K, V, H>::iterator, typename HashMultiMap<K, V, H>::iterator>
+HashMultiMap<K, V, H>::equal_range(const K& key) {
+    return equal_range_of(key, _hash_function(key));
+}
+
+template<typename K, typename V, typename H>
+std::pair<typename HashMultiMap<K, V, H>::const_iterator, typename HashMultiMap<K, V, H>::const_iterator>
+HashMultiMap<K, V, H>::equal_range(const K& key) const {
+    return const_cast<HashMultiMap<K, V, H> *>(this)->equal_range_of(key, _hash_function(key));
+}
+
+template<typename K, typename V, typename H>
+std::pair<typename HashMultiMap<K, V, H>::const_iterator, typename HashMultiMap<K, V, H>::const_iterator>
+HashMultiMap<K, V, H>::equal_range(const K& key, size_t hash) const {
+    return const_cast<HashMultiMap<K, V, H> *>(this)->equal_range_of(key, hash);
+}
+
+template<typename K, typename V, typename H>
+size_t HashMultiMap<K, V, H>::hash_of(const K& key) const {
+    return _hash_function(key);
+}
+
+template<typename K, typename V, typename H>
+void HashMultiMap<K, V, H>::prefetch_bucket(size_t hash) const {
+    __builtin_prefetch(&_buckets_array[hash % _buckets_array.size()]);
+}
+
+template<typename K, typename V, typename H>
+void HashMultiMap<K, V, H>::prefetch_head(size_t hash) const {
+    Node* head = _buckets_array[hash % _buckets_array.size()];
+    if (head != nullptr) __builtin_prefetch(head);
+}
+
+template<typename K, typename V, typename H>
+typename HashMultiMap<K, V, H>::iterator HashMultiMap<K, V, H>::find(const K& key) {
+    return make_iterator(find_node(key).second);
+}
+
+template<typename K, typename V, typename H>
+typename HashMultiMap<K, V, H>::const_iterator HashMultiMap<K, V, H>::find(const K& key) const {
+    return const_cast<HashMultiMap<K, V, H> *>(this)->find(key);
+}
+
+template<typename K, typename V, typename H>
+size_t HashMultiMap<K, V, H>::erase(const K& key) {
+    size_t index = _hash_function(key) % _buckets_array.size();
+    auto [prev, curr] = chain_find(_buckets_array[index], key, PairFirstKey());
+
+    size_t erased = 0;
+    while (curr != nullptr && curr->value.first == key) {
+        Node* next = curr->next;
+        delete curr;
+        curr = next;
+        erased++;
+    }
+    if (prev == nullptr) {
+        _buckets_array[index] = curr;
+    } else {
+        prev->next = curr;
+    }
+    _size -= erased;
+    return erased;
+}
+
+template<typename K, typename V, typename H>
+typename HashMultiMap<K, V, H>::iterator HashMultiMap<K, V, H>::erase(const_iterator pos) {
+    Node* target = pos._node;
+    iterator next = make_iterator(target);
+    ++next;
+    if (target == nullptr) return next;
+
+    size_t index = _hash_function(target->value.first) % _buckets_array.size();
+    // pos may be any of several equal keys, so unlink by address rather than by key
+    Node* prev = nullptr;
+    for (Node* curr = _buckets_array[index]; curr != target; curr = curr->next) {
+        prev = curr;
+    }
+    if (prev == nullptr) {
+        _buckets_array[index] = target->next;
+    } else {
+        prev->next = target->next;
+    }
+    delete target;
+    _size--;
+    return next;
+}
+
+template<typename K, typename V, typename H>
+void HashMultiMap<K, V, H>::clear() {
+    chain_delete_all(_buckets_array);
+    _size = 0;
+}
+
+template<typename K, typename V, typename H>
+void HashMultiMap<K, V, H>::rehash(size_t new_buckets) {
+    if (new_buckets == 0) {
+        throw std::out_of_range("HashMultiMap<K, V, H>::rehash: new_buckets cannot be 0");
+    }
+    chain_redistribute(_buckets_array, new_buckets, [this](const value_type& kv_pair) {
+        return _hash_function(kv_pair.first);
+    });
+}
+
+template<typename K, typename V, typename H>
+typename HashMultiMap<K, V, H>::iterator HashMultiMap<K, V, H>::begin() {
+    return make_iterator(_buckets_array[chain_first_not_empty(_buckets_array)]);
+}
+
+template<typename K, typename V, typename H>
+typename HashMultiMap<K, V, H>::const_iterator HashMultiMap<K, V, H>::begin() const {
+    return const_cast<HashMultiMap<K, V, H> *>(this)->begin();
+}
+
+template<typename K, typename V, typename H>
+typename HashMultiMap<K, V, H>::iterator HashMultiMap<K, V, H>::end() {
+    return make_iterator(nullptr);
+}
+
+template<typename K, typename V, typename H>
+typename HashMultiMap<K, V, H>::const_iterator HashMultiMap<K, V, H>::end() const {
+    return const_cast<HashMultiMap<K, V, H> *>(this)->end();
+}
+
+template<typename K, typename V, typename H>
+typename HashMultiMap<K, V, H>::node_pair HashMultiMap<K, V, H>::find_node(const K& key) const {
+    return find_node(key, _hash_function(key));
+}
+
+template<typename K, typename V, typename H>
+typename HashMultiMap<K, V, H>::node_pair HashMultiMap<K, V, H>::find_node(const K& key, size_t hash) const {
+    return chain_find(_buckets_array[hash % _buckets_array.size()], key, PairFirstKey());
+}
+
+template<typename K, typename V, typename H>
+std::pair<typename HashMultiMap<K, V, H>::iterator, typename HashMultiMap<K, V, H>::iterator>
+HashMultiMap<K, V, H>::equal_range_of(const K& key, size_t hash) {
+    Node* first = find_node(key, hash).second;
+    if (first == nullptr) return {end(), end()};
+
+    // equal keys are adjacent, so the range ends at the first element with another key
+    iterator first_iter(&_buckets_array, first, hash % _buckets_array.size());
+    iterator last_iter = first_iter;
+    while (last_iter != end() && last_iter->first == key) ++last_iter;
+    return {first_iter, last_iter};
+}
+
+template<typename K, typename V, typename H>
+typename HashMultiMap<K, V, H>::iterator HashMultiMap<K, V, H>::make_iterator(Node* curr) {
+    size_t index = _buckets_array.size();
+    if (curr != nullptr) {
+        index = _hash_function(curr->value.first) % _buckets_array.size();
+    }
+    return iterator(&_buckets_array, curr, index);
+}
+
+template<typename K, typename V, typename H>
+std::ostream& operator<<(std::ostream& output_stream, const HashMultiMap<K, V, H>& map) {
+    output_stream << "{";
+    bool first = true;
+    for (const auto& [key, value] : map) {
+        if (!first) output_stream << ", ";
+        output_stream << key << ":" << value;
+        first = false;
+    }
+    return output_stream << "}";
+}
+
+#endif
@@ -0,0 +1,191 @@
+#ifndef HASH_QUALITY_H
+#define HASH_QUALITY_H
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+/*
+* How well a hash function spreads a sample of keys over a HashMap with a given number of
+* buckets, measured the way HashMap uses the hash (bucket = hash % buckets), next to what
+* an ideal random hash would give for the same load.
+*
+* Bucket distribution:
+*      chi_square is the usual statistic of the bucket counts against a uniform spread, and
+*      chi_square_z its distance from the mean of a random hash in standard deviations:
+*      |z| below 3 is indistinguishable from random, large positive z means clustering.
+* Projected chains:
+*      chain_lengths[l] is the number of buckets holding l keys (the last entry counts all
+*      longer chains), expected_chain_lengths the Poisson expectation. mean_probe_length is
+*      the number of nodes a successful find compares, on average.
+* Avalanche:
+*      for each sampled key and each input bit, the bit is flipped and the output bits that
+*      change are counted. avalanche is the mean fraction of output bits flipped (ideal 0.5)
+*      and worst_avalanche_bias the largest |P(output bit j flips | input bit i) - 0.5|
+*      over all input/output bit pairs (ideal close to 0; 0.5 means bit j ignores bit i).
+*/
+struct HashQualityReport {
+    static constexpr size_t kMaxChainLength = 8;
+
+    size_t keys = 0;
+    size_t distinct_hashes = 0;
+    size_t buckets = 0;
+    double chi_square = 0;
+    double chi_square_z = 0;
+    std::vector<size_t> chain_lengths;
+    std::vector<double> expected_chain_lengths;
+    size_t longest_chain = 0;
+    double mean_probe_length = 0;
+    double expected_probe_length = 0;
+    double avalanche = 0;
+    double worst_avalanche_bias = 0;
+};
+
+/*
+* Input bits the avalanche test flips: all bits of an integer key, the bits of the first
+* kMaxStringBytes bytes of a string key.
+*/
+constexpr size_t kMaxStringBytes = 32;
+
+template<typename K>
+size_t avalanche_bits(const K& key) {
+    if constexpr (std::is_integral_v<K>) {
+        return 8 * sizeof(K);
+    } else {
+        static_assert(std::is_same_v<K, std::string>, "analyze_hash_quality: keys must be integers or strings");
+        return 8 * std::min(key.size(), kMaxStringBytes);
+    }
+}
+
+template<typename K>
+K flip_bit(K key, size_t bit) {
+    if constexpr (std::is_integral_v<K>) {
+        using Unsigned = std::make_unsigned_t<K>;
+        return static_cast<K>(static_cast<Unsigned>(key) ^ (Unsigned(1) << bit));
+    } else {
+        key[bit / 8] = static_cast<char>(key[bit / 8] ^ (1 << (bit % 8)));
+        return key;
+    }
+}
+
+/*
+* Analyzes hash on the distinct keys of sample, for a map with the given number of buckets.
+* The avalanche test uses up to avalanche_samples of those keys, spread over the sample.
+*
+* Usage:
+*      auto report = analyze_hash_quality(keys, DefaultHash<uint64_t>(), 1 << 20);
+*      std::cout << report;
+*
+* Exceptions: std::out_of_range if sample is empty or buckets is 0.
+*
+* Complexity: O(N log N + S * b), N = sample size, S = avalanche_samples, b = key bits
+*/
+template<typename K, typename H>
+HashQualityReport analyze_hash_quality(std::vector<K> sample, const H& hash, size_t buckets,
+                                       size_t avalanche_samples = 2000) {
+    if (sample.empty() || buckets == 0) {
+        throw std::out_of_range("analyze_hash_quality: needs at least one key and one bucket");
+    }
+    // a map holds every key once
+    std::sort(sample.begin(), sample.end());
+    sample.erase(std::unique(sample.begin(), sample.end()), sample.end());
+
+    HashQualityReport report;
+    report.keys = sample.size();
+    report.buckets = buckets;
+
+    std::vector<size_t> hashes;
+    hashes.reserve(sample.size());
+    std::vector<size_t> bucket_sizes(buckets, 0);
+    for (const K& key : sample) {
+        hashes.push_back(static_cast<size_t>(hash(key)));
+        bucket_sizes[hashes.back() % buckets]++;
+    }
+    std::sort(hashes.begin(), hashes.end());
+    report.distinct_hashes = std::unique(hashes.begin(), hashes.end()) - hashes.begin();
+
+    double load = double(report.keys) / buckets;
+    report.chain_lengths.assign(HashQualityReport::kMaxChainLength + 1, 0);
+    double probes = 0;
+    for (size_t size : bucket_sizes) {
+        report.chi_square += (size - load) * (size - load) / load;
+        report.chain_lengths[std::min(size, HashQualityReport::kMaxChainLength)]++;
+        report.longest_chain = std::max(report.longest_chain, size);
+        // finding the i-th key of a chain compares i nodes
+        probes += size * (size + 1) / 2.0;
+    }
+    double freedom = std::max<double>(buckets - 1, 1);
+    report.chi_square_z = (report.chi_square - freedom) / std::sqrt(2 * freedom);
+    report.mean_probe_length = probes / report.keys;
+    report.expected_probe_length = 1 + (report.keys - 1) / (2.0 * buckets);
+
+    // Poisson(load) buckets per chain length, the tail folded into the last entry
+    double probability = std::exp(-load), remaining = 1;
+    for (size_t length = 0; length < HashQualityReport::kMaxChainLength; length++) {
+        report.expected_chain_lengths.push_back(probability * buckets);
+        remaining -= probability;
+        probability *= load / (length + 1);
+    }
+    report.expected_chain_lengths.push_back(std::max(remaining, 0.0) * buckets);
+
+    constexpr size_t kOutputBits = 8 * sizeof(size_t);
+    size_t input_bits = 0;
+    for (const K& key : sample) input_bits = std::max(input_bits, avalanche_bits(key));
+    std::vector<size_t> flips(input_bits * kOutputBits, 0);
+    std::vector<size_t> trials(input_bits, 0);
+    size_t total_flips = 0, total_trials = 0;
+    size_t stride = std::max<size_t>(1, sample.size() / std::max<size_t>(avalanche_samples, 1));
+    for (size_t index = 0; index < sample.size() && avalanche_samples > 0; index += stride) {
+        const K& key = sample[index];
+        size_t base = static_cast<size_t>(hash(key));
+        for (size_t bit = 0; bit < avalanche_bits(key); bit++) {
+            size_t changed = base ^ static_cast<size_t>(hash(flip_bit(key, bit)));
+            trials[bit]++;
+            total_trials++;
+            for (size_t out = 0; out < kOutputBits; out++) {
+                flips[bit * kOutputBits + out] += (changed >> out) & 1;
+            }
+            total_flips += __builtin_popcountll(changed);
+        }
+    }
+    if (total_trials > 0) {
+        report.avalanche = double(total_flips) / (double(total_trials) * kOutputBits);
+        for (size_t bit = 0; bit < input_bits; bit++) {
+            if (trials[bit] == 0) continue;
+            for (size_t out = 0; out < kOutputBits; out++) {
+                double bias = std::abs(double(flips[bit * kOutputBits + out]) / trials[bit] - 0.5);
+                report.worst_avalanche_bias = std::max(report.worst_avalanche_bias, bias);
+            }
+        }
+    }
+    return report;
+}
+
+inline std::ostream& operator<<(std::ostream& os, const HashQualityReport& report) {
+    os << std::fixed << std::setprecision(3);
+    os << "keys:                  " << report.keys << " (" << report.distinct_hashes << " distinct hashes)\n";
+    os << "buckets:               " << report.buckets << " (load factor "
+       << double(report.keys) / report.buckets << ")\n";
+    os << "chi-square:            " << report.chi_square << " (z = " << report.chi_square_z
+       << ", |z| < 3 looks random)\n";
+    os << "mean probe length:     " << report.mean_probe_length << " (random hash: "
+       << report.expected_probe_length << ")\n";
+    os << "longest chain:         " << report.longest_chain << '\n';
+    os << "chain length  buckets    random hash\n";
+    for (size_t length = 0; length < report.chain_lengths.size(); length++) {
+        std::string label = std::to_string(length) + (length + 1 == report.chain_lengths.size() ? "+" : "");
+        os << std::setw(12) << label << std::setw(9) << report.chain_lengths[length]
+           << std::setw(15) << report.expected_chain_lengths[length] << '\n';
+    }
+    os << "avalanche:             " << report.avalanche << " (ideal 0.5)\n";
+    os << "worst avalanche bias:  " << report.worst_avalanche_bias << " (ideal close to 0)\n";
+    os << std::defaultfloat;
+    return os;
+}
+
+#endif
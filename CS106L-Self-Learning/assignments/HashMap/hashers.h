@@ -0,0 +1,167 @@
+#ifndef HASHERS_H
+#define HASHERS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+/*
+* Well-mixed hash functions to use as the H of a HashMap.
+*
+* std::hash is the identity for integers in libstdc++, so with it a bucket index is just
+* key % bucket_count: sequential ids are fine, but keys with a stride sharing a factor with
+* the bucket count (multiples of 8, of 1024, ...) pile into a few buckets. Every hasher
+* here mixes all input bits into all output bits instead, and DefaultHash<K> is the
+* default H of HashMap and of the containers built on it:
+*      - DefaultHash<T> picks one for T: integers, enums, pointers and floating point numbers
+*        go through mix64, strings through StringHash, std::pair and std::tuple are combined
+*        member by member, and anything else is std::hash<T> followed by mix64.
+*      - StringHash hashes 8 bytes per step with a 64x64 -> 128-bit multiply, and accepts
+*        std::string, std::string_view and C strings alike.
+*      - hash_combine and hash_fields build hashes for structs.
+*
+* Usage:
+*      HashMap<uint64_t, Order> orders;                     // DefaultHash<uint64_t>
+*      HashMap<std::pair<int, int>, double> grid;            // combined member by member
+*      HashMap<uint64_t, Order, MixHash<uint64_t>> batched;  // vectorized hash_batch
+*
+*      struct PointHash {
+*          size_t operator()(const Point& p) const { return hash_fields(p.x, p.y, p.z); }
+*      };
+*
+* Run hash_analyzer on a sample of real keys to check how a hasher spreads them.
+*/
+
+/*
+* Finalizer of SplitMix64 / Stafford's variant 13: a bijection on 64-bit values in which
+* every input bit flips every output bit with probability close to 1/2.
+*/
+constexpr uint64_t mix64(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+/*
+* Folds hash into seed. The result depends on the order of the calls, so (a, b) and
+* (b, a) hash differently.
+*/
+constexpr size_t hash_combine(size_t seed, size_t hash) {
+    return static_cast<size_t>(mix64(seed + 0x9e3779b97f4a7c15ULL + hash * 0xd6e8feb86659fd93ULL));
+}
+
+class StringHash {
+public:
+    size_t operator()(std::string_view text) const {
+        return static_cast<size_t>(hash(text.data(), text.size()));
+    }
+
+    static uint64_t hash(const char* data, size_t size) {
+        uint64_t state = kSeed ^ (size * kPrimes[0]);
+        size_t i = 0;
+        for (; i + 16 <= size; i += 16) {
+            state = fold(load(data + i) ^ kPrimes[1], load(data + i + 8) ^ state);
+        }
+        for (; i + 8 <= size; i += 8) {
+            state = fold(load(data + i) ^ kPrimes[1], state ^ kPrimes[2]);
+        }
+        // the last 1 to 7 bytes, zero padded
+        uint64_t tail = 0;
+        if (size > i) std::memcpy(&tail, data + i, size - i);
+        return fold(tail ^ kPrimes[2], state ^ kPrimes[3]) ^ state;
+    }
+
+private:
+    static constexpr uint64_t kSeed = 0x2d358dccaa6c78a5ULL;
+    static constexpr uint64_t kPrimes[4] = {
+        0xa0761d6478bd642fULL, 0xe7037ed1a0b428dbULL, 0x8ebc6af09c88c6e3ULL, 0x589965cc75374cc3ULL
+    };
+
+    static uint64_t load(const char* bytes) {
+        uint64_t word;
+        std::memcpy(&word, bytes, sizeof(word));
+        return word;
+    }
+
+    // full 128-bit product, high and low halves folded together
+    static uint64_t fold(uint64_t a, uint64_t b) {
+        __uint128_t product = static_cast<__uint128_t>(a) * b;
+        return static_cast<uint64_t>(product) ^ static_cast<uint64_t>(product >> 64);
+    }
+};
+
+template<typename... Types>
+size_t hash_fields(const Types&... fields);
+
+template<typename T, typename Enable = void>
+struct DefaultHash {
+    size_t operator()(const T& value) const {
+        return static_cast<size_t>(mix64(std::hash<T>()(value)));
+    }
+};
+
+template<typename T>
+struct DefaultHash<T, std::enable_if_t<std::is_integral_v<T> || std::is_enum_v<T> || std::is_pointer_v<T>>> {
+    size_t operator()(const T& value) const {
+        if constexpr (std::is_pointer_v<T>) {
+            return static_cast<size_t>(mix64(reinterpret_cast<uintptr_t>(value)));
+        } else {
+            return static_cast<size_t>(mix64(static_cast<uint64_t>(value)));
+        }
+    }
+};
+
+template<typename T>
+struct DefaultHash<T, std::enable_if_t<std::is_floating_point_v<T>>> {
+    size_t operator()(const T& value) const {
+        // 0.0 == -0.0 must hash alike; long double has padding bytes, so all go through double
+        double widened = value == T(0) ? 0.0 : static_cast<double>(value);
+        uint64_t bits;
+        std::memcpy(&bits, &widened, sizeof(bits));
+        return static_cast<size_t>(mix64(bits));
+    }
+};
+
+template<>
+struct DefaultHash<std::string> : StringHash {};
+
+template<>
+struct DefaultHash<std::string_view> : StringHash {};
+
+template<typename First, typename Second>
+struct DefaultHash<std::pair<First, Second>> {
+    size_t operator()(const std::pair<First, Second>& value) const {
+        return hash_combine(DefaultHash<First>()(value.first), DefaultHash<Second>()(value.second));
+    }
+};
+
+template<typename... Types>
+struct DefaultHash<std::tuple<Types...>> {
+    size_t operator()(const std::tuple<Types...>& value) const {
+        return std::apply([](const auto&... members) { return hash_fields(members...); }, value);
+    }
+};
+
+/*
+* Combined DefaultHash of every argument, in order.
+*
+* Usage:
+*      size_t operator()(const Point& p) const { return hash_fields(p.x, p.y, p.z); }
+*/
+template<typename... Types>
+size_t hash_fields(const Types&... fields) {
+    size_t seed = sizeof...(Types);
+    ((seed = hash_combine(seed, DefaultHash<std::decay_t<Types>>()(fields))), ...);
+    return seed;
+}
+
+#endif
@@ -9,8 +9,39 @@ HashMap<K, M, H>::HashMap(size_t bucket_count, const H& hash):
     _hash_function(hash), 
     _buckets_array(bucket_count, nullptr) {};
 
+template<typename K, typename M, typename H>
+HashMap<K, M, H>::HashMap(size_t bucket_count, const H& hash, const PagePolicy& policy):
+    _size(0),
+    _hash_function(hash),
+    _buckets_array(bucket_count, nullptr, PageAllocator<Node*>(policy)) {};
+
+template<typename K, typename M, typename H>
+PagePolicy HashMap<K, M, H>::page_policy() const {
+    return _buckets_array.get_allocator().policy();
+}
+
+template<typename K, typename M, typename H>
+void HashMap<K, M, H>::enable_bloom_filter(size_t bits_per_key) {
+    _bloom_filter = std::make_unique<BlockedBloomFilter>(0, bits_per_key);
+    rebuild_bloom_filter();
+}
+
+template<typename K, typename M, typename H>
+void HashMap<K, M, H>::disable_bloom_filter() {
+    _bloom_filter.reset();
+}
+
+template<typename K, typename M, typename H>
+bool HashMap<K, M, H>::bloom_filter_enabled() const {
+    return _bloom_filter != nullptr;
+}
+
 template<typename K, typename M, typename H>
 HashMap<K, M, H>::~HashMap() {
+    if constexpr (kTrivialNodeDestructor) {
+        // the pool unmaps its slabs when it is destroyed, taking every node with it
+        if (_node_pool) {return;}
+    }
     clear();
 }
 
@@ -34,6 +65,13 @@ inline size_t HashMap<K, M, H>::bucket_count() const {
     return _buckets_array.size();
 }
 
+template<typename K, typename M, typename H>
+size_t HashMap<K, M, H>::memory_usage() const {
+    size_t node_bytes = _node_pool ? _node_pool->bytes() : _size * sizeof(Node);
+    size_t filter_bytes = _bloom_filter ? _bloom_filter->memory_usage() : 0;
+    return sizeof(*this) + _buckets_array.capacity() * sizeof(Node*) + node_bytes + filter_bytes;
+}
+
 template<typename K, typename M, typename H>
 bool HashMap<K, M, H>::contains(const K& key) const {
     auto [pre_node, cur_node] = find_node(key);
@@ -63,38 +101,67 @@ const M& HashMap<K, M, H>::at(const K& key) const {
 
 template<typename K, typename M, typename H>
 void HashMap<K, M, H>::clear() {
-    for (auto& bucket : _buckets_array) {
-        // bucket is the head of linkedlist, traver linkedlist and delete each node
-        while (bucket != nullptr) {
-            auto tmp_bkt = bucket->next;
-            delete bucket;
-            bucket = tmp_bkt;
-        }
+    bool nodes_need_delete = true;
+    if constexpr (kTrivialNodeDestructor) {nodes_need_delete = !_node_pool;}
+    if (nodes_need_delete) {
+        chain_delete_all(_buckets_array, [this](Node* node) {delete_node(node);});
+    } else {
+        std::fill(_buckets_array.begin(), _buckets_array.end(), nullptr);
     }
+    // every node is gone: the slabs stay mapped for the next inserts, so a map that is
+    // cleared and refilled does not unmap and map them again each time
+    if (_node_pool) {_node_pool->reset();}
+    if (_bloom_filter) {_bloom_filter->clear();}
     _size = 0; 
 }
 
 template<typename K, typename M, typename H>
 std::pair<typename HashMap<K, M, H>::iterator, bool> HashMap<K, M, H>::insert(const value_type& kv_pair) {
+    return insert(kv_pair, _hash_function(kv_pair.first));
+}
+
+template<typename K, typename M, typename H>
+std::pair<typename HashMap<K, M, H>::iterator, bool> HashMap<K, M, H>::insert(const value_type& kv_pair, size_t hash) {
+    assert(hash == static_cast<size_t>(_hash_function(kv_pair.first)) && "HashMap::insert: precomputed hash does not match the key");
     /*
     1. Find the bucket index using the hash function
     2. if find node with the key, return {iterator to the newnode, false}
-    3. if not found, create a new node and insert it to the tail of the linked list in the bucket (pre_node is the last node in the linked list), which is pre_node ->next = new_node
+    3. if not found, create a new node and insert it after pre_node: the tail of the linked list in the bucket, or its place in hash order if the chains are sorted
     4. Return {iterator to the new node, true}
     */
-    auto [pre_node, cur_node] = find_node(kv_pair.first); 
-    if (cur_node != nullptr) return {make_iterator(cur_node), false};
-    size_t bucket_index = _hash_function(kv_pair.first) % _buckets_array.size();
-    Node* new_node = new Node(kv_pair, nullptr);
-
-    if (pre_node != nullptr) {pre_node->next = new_node;}
-    else {_buckets_array[bucket_index] = new_node;}
+    auto [pre_node, cur_node] = find_node(kv_pair.first, hash); 
+    if (cur_node != nullptr) return {make_iterator(cur_node, hash), false};
+    size_t bucket_index = hash % _buckets_array.size();
+    if (_sorted_chains && pre_node == nullptr && _bloom_filter) {
+        // the Bloom filter skipped the walk, which is still needed to find the place in order
+        pre_node = chain_find_hashed(_buckets_array[bucket_index], kv_pair.first, hash, PairFirstKey(), true).first;
+    }
+    Node* new_node = this->new_node(kv_pair, hash);
+
+    if (pre_node != nullptr) {
+        new_node->next = pre_node->next;
+        pre_node->next = new_node;
+    } else {
+        // no tail when the Bloom filter ruled the key out, so link at the head
+        new_node->next = _buckets_array[bucket_index];
+        _buckets_array[bucket_index] = new_node;
+    }
     _size++;
-    return {make_iterator(new_node), true};
+    if (_bloom_filter) {
+        _bloom_filter->add(hash);
+        maintain_bloom_filter();
+    }
+    return {make_iterator(new_node, hash), true};
 }
 
 template<typename K, typename M, typename H>
 bool HashMap<K, M, H>::erase(const K& key) {
+    return erase(key, _hash_function(key));
+}
+
+template<typename K, typename M, typename H>
+bool HashMap<K, M, H>::erase(const K& key, size_t hash) {
+    assert(hash == static_cast<size_t>(_hash_function(key)) && "HashMap::erase: precomputed hash does not match the key");
     /*
     1. get bucket index based on key's hash val 
     2. find the node with the key
@@ -102,12 +169,12 @@ bool HashMap<K, M, H>::erase(const K& key) {
     4. if the node is found, remove the node from the linked list
     */
 
-   size_t bucket_index = _hash_function(key) % _buckets_array.size();
-   auto [pre_node, cur_node] = find_node(key);
+   auto [pre_node, cur_node] = find_node(key, hash);
    if (cur_node == nullptr) {return false;}
+   size_t bucket_index = hash % _buckets_array.size();
 
    Node* next_node = cur_node->next; 
-   delete cur_node;
+   delete_node(cur_node);
    // if the node is the head of the linked list
    if (pre_node == nullptr) {
         _buckets_array[bucket_index] = next_node;
@@ -115,6 +182,10 @@ bool HashMap<K, M, H>::erase(const K& key) {
         pre_node->next = next_node;
    }
    _size--;
+   if (_bloom_filter) {
+        _bloom_filter->mark_stale();
+        maintain_bloom_filter();
+   }
    return true;
 
 }
@@ -138,32 +209,79 @@ void HashMap<K, M, H>::rehash(size_t new_buckets) {
     */
     if (new_buckets == 0) 
     {throw std::out_of_range("HashMap<K, M, H>::rehash: new_buckets cannot be 0");}
-    // shallow copy the old bucket array (copy the pointers stored in old array)
-    bucket_array_type tmp_bkt_array = _buckets_array;
-    _buckets_array.clear();
-    _buckets_array.resize(new_buckets, nullptr);
-
-    // traverse the old bucket array and redistribute the nodes
-    for (auto& old_bucket_head : tmp_bkt_array) {
-        while (old_bucket_head  != nullptr) {
-            /*
-            1. store the next node
-            2. get the new bucket index
-            3. insert the current node to the new bucket as new head 
-            */
-           Node* curr_node = old_bucket_head;
-           old_bucket_head = old_bucket_head->next;
-           // extract key-val from curr 
-           const auto& [key, mapped] = curr_node->value;
-           size_t new_bucket_index = _hash_function(key) % new_buckets;
-
-           // insert the node to the new bucket as the head 
-           curr_node->next = _buckets_array[new_bucket_index];
-           _buckets_array[new_bucket_index] = curr_node;
+    // relink every node into its new bucket by its stored hash, no node is copied
+    chain_redistribute(_buckets_array, new_buckets, [this](const value_type& kv_pair) {
+        return _hash_function(kv_pair.first);
+    });
+    chain_sort_by_hash(_buckets_array);
+    _sorted_chains = true;
+    if (_bloom_filter) {rebuild_bloom_filter();}
+}
+
+template<typename K, typename M, typename H>
+void HashMap<K, M, H>::optimize_for_reads() {
+    chain_sort_by_hash(_buckets_array);
+    _sorted_chains = true;
+    if (_size == 0) {return;}
+
+    // copy the nodes in bucket order into a slab sized for the map, up to a huge page;
+    // slabs for later inserts double from there
+    PagePolicy policy = _node_pool ? _node_pool->policy() : page_policy();
+    policy.pooled_nodes = true;
+    auto pool = std::make_unique<SlabPool<Node>>(policy, std::min(kHugePageBytes, _size * sizeof(Node)));
+    bucket_array_type copies(_buckets_array.size(), nullptr, _buckets_array.get_allocator());
+    try {
+        for (size_t index = 0; index < _buckets_array.size(); index++) {
+            Node** link = &copies[index];
+            for (Node* node = _buckets_array[index]; node != nullptr; node = node->next) {
+                void* memory = pool->allocate();
+                try {
+                    *link = new (memory) Node(node->value, node->hash, nullptr);
+                } catch (...) {
+                    pool->deallocate(memory);
+                    throw;
+                }
+                link = &(*link)->next;
+            }
+        }
+    } catch (...) {
+        // the map is untouched; only the copies made so far need destroying
+        if constexpr (!kTrivialNodeDestructor) {
+            chain_delete_all(copies, [](Node* node) {node->~Node();});
         }
+        throw;
+    }
+
+    // free the old nodes the way they were allocated, then adopt the copies
+    bool nodes_need_delete = true;
+    if constexpr (kTrivialNodeDestructor) {nodes_need_delete = !_node_pool;}
+    if (nodes_need_delete) {
+        chain_delete_all(_buckets_array, [this](Node* node) {delete_node(node);});
     }
+    _buckets_array.swap(copies);
+    _node_pool = std::move(pool);
+}
+
+template<typename K, typename M, typename H>
+bool HashMap<K, M, H>::chains_sorted() const {
+    return _sorted_chains;
+}
+
+template<typename K, typename M, typename H>
+void HashMap<K, M, H>::reserve(size_t n) {
+    size_t needed = buckets_for(n);
+    if (needed > _buckets_array.size()) {rehash(needed);}
+}
 
+template<typename K, typename M, typename H>
+void HashMap<K, M, H>::shrink_to_fit() {
+    size_t needed = std::max(buckets_for(_size), size_t(kDefaultBuckets));
+    if (needed < _buckets_array.size()) {rehash(needed);}
+}
 
+template<typename K, typename M, typename H>
+inline float HashMap<K, M, H>::max_load_factor() const {
+    return kMaxLoadFactor;
 }
 
 template<typename K, typename M, typename H>
@@ -192,8 +310,7 @@ typename HashMap<K, M, H>::const_iterator HashMap<K, M, H>::end() const {
 
 template<typename K, typename M, typename H>
 typename HashMap<K, M, H>::iterator HashMap<K, M, H>::find(const K& key) {
-    auto [prev_node, curr_node] = find_node(key);
-    return make_iterator(curr_node);
+    return find(key, _hash_function(key));
 }
 
 template<typename K, typename M, typename H>
@@ -201,6 +318,23 @@ typename HashMap<K, M, H>::const_iterator HashMap<K, M, H>::find(const K& key) c
     return const_cast<HashMap<K, M, H> *>(this)->find(key);
 }
 
+template<typename K, typename M, typename H>
+size_t HashMap<K, M, H>::hash_of(const K& key) const {
+    return _hash_function(key);
+}
+
+template<typename K, typename M, typename H>
+typename HashMap<K, M, H>::iterator HashMap<K, M, H>::find(const K& key, size_t hash) {
+    assert(hash == static_cast<size_t>(_hash_function(key)) && "HashMap::find: precomputed hash does not match the key");
+    auto [prev_node, curr_node] = find_node(key, hash);
+    return make_iterator(curr_node, hash);
+}
+
+template<typename K, typename M, typename H>
+typename HashMap<K, M, H>::const_iterator HashMap<K, M, H>::find(const K& key, size_t hash) const {
+    return const_cast<HashMap<K, M, H> *>(this)->find(key, hash);
+}
+
 
 template<typename K, typename M, typename H>
 void HashMap<K, M, H>::debug() {
@@ -224,10 +358,35 @@ void HashMap<K, M, H>::debug() {
 
 template<typename K, typename M, typename H>
 template<typename InputIter>
-HashMap<K, M, H>::HashMap(InputIter begin, InputIter end, size_t bucket_count, const H& hash):HashMap(bucket_count, hash) //  delegating constructor 
+HashMap<K, M, H>::HashMap(InputIter begin, InputIter end, size_t bucket_count, const H& hash):
+    HashMap(std::max(bucket_count, buckets_for(begin, end)), hash) //  delegating constructor 
 {
-    for (InputIter it = begin; it != end; it++) {
-        insert(*it);
+    insert(begin, end);
+}
+
+template<typename K, typename M, typename H>
+template<typename InputIter>
+void HashMap<K, M, H>::insert(InputIter first, InputIter last) {
+    using category = typename std::iterator_traits<InputIter>::iterator_category;
+    if constexpr (HasBatchHash<H, K>::value && std::is_base_of_v<std::forward_iterator_tag, category>) {
+        // one pass gathers and hashes a batch of keys, a second inserts its pairs
+        K keys[kBatchSize];
+        size_t hashes[kBatchSize];
+        while (first != last) {
+            InputIter batch = first;
+            size_t count = 0;
+            for (; count < kBatchSize && first != last; ++first) {
+                keys[count++] = (*first).first;
+            }
+            hash_batch(_hash_function, keys, count, hashes);
+            for (size_t i = 0; i < count; i++, ++batch) {
+                insert(*batch, hashes[i]);
+            }
+        }
+    } else {
+        for (; first != last; ++first) {
+            insert(*first);
+        }
     }
 }
 
@@ -247,8 +406,16 @@ template<typename K, typename M, typename H>
 HashMap<K, M, H>::HashMap(const HashMap<K, M, H>& map): 
     _size(0),
     _hash_function(map._hash_function),
-    _buckets_array(map._buckets_array.size(), nullptr)
+    _buckets_array(map._buckets_array.size(), nullptr, map._buckets_array.get_allocator()),
+    _sorted_chains(map._sorted_chains)
 {   
+    if constexpr (kMemcpyNodes) {
+        if (map._node_pool) {
+            copy_slabs(map);
+            return;
+        }
+    }
+    if (map._bloom_filter) {enable_bloom_filter(map._bloom_filter->bits_per_key());}
     for (const auto& kv_pair : map) {
         insert(kv_pair);
     }
@@ -262,7 +429,10 @@ template<typename K, typename M, typename H>
 HashMap<K, M, H>::HashMap(HashMap<K, M, H>&& map):
     _size(std::move(map._size)),
     _hash_function(std::move(map._hash_function)),
-    _buckets_array(std::move(map._buckets_array)) 
+    _buckets_array(std::move(map._buckets_array)),
+    _node_pool(std::move(map._node_pool)),
+    _bloom_filter(std::move(map._bloom_filter)),
+    _sorted_chains(map._sorted_chains)
 {
     map._buckets_array.resize(_buckets_array.size(), nullptr);
     map._size = 0;
@@ -275,8 +445,18 @@ HashMap<K, M, H>::HashMap(HashMap<K, M, H>&& map):
 template<typename K, typename M, typename H>
 HashMap<K, M, H>& HashMap<K, M, H>::operator=(const HashMap<K, M, H>& map) {
     if (this == &map) {return *this;}
+    if constexpr (kMemcpyNodes) {
+        // duplicate the slabs as the copy constructor does, instead of inserting one by one
+        if (map._node_pool) {
+            *this = HashMap<K, M, H>(map);
+            return *this;
+        }
+    }
     this->clear();
     this->_hash_function = map._hash_function;
+    this->_sorted_chains = map._sorted_chains;
+    if (map._bloom_filter) {enable_bloom_filter(map._bloom_filter->bits_per_key());}
+    else {disable_bloom_filter();}
     for (const auto& kv_pair : map) {
         this->insert(kv_pair);
     }
@@ -293,6 +473,9 @@ HashMap<K, M, H>& HashMap<K, M, H>::operator=(HashMap<K, M, H>&& map) {
     this->_size = std::move(map._size);
     this->_hash_function = map._hash_function;
     this->_buckets_array = std::move(map._buckets_array);
+    this->_node_pool = std::move(map._node_pool);
+    this->_bloom_filter = std::move(map._bloom_filter);
+    this->_sorted_chains = map._sorted_chains;
 
     //reset the map
     map._size = 0;
@@ -310,15 +493,18 @@ HashMap<K, M, H>& HashMap<K, M, H>::operator=(HashMap<K, M, H>&& map) {
 
 template<typename K, typename M, typename H>
 size_t HashMap<K, M, H>::first_not_empty_bucket() const {
-    for (size_t i = 0; i < _buckets_array.size(); i++) {
-        if (_buckets_array[i] != nullptr) {return i;}
-    }
-    return _buckets_array.size() - 1;
+    return chain_first_not_empty(_buckets_array);
 }
 
 
 template<typename K, typename M, typename H> 
 typename HashMap<K, M, H>::node_pair HashMap<K, M, H>::find_node(const K& key) const 
+{
+    return find_node(key, _hash_function(key));
+}
+
+template<typename K, typename M, typename H> 
+typename HashMap<K, M, H>::node_pair HashMap<K, M, H>::find_node(const K& key, size_t hash) const 
 {
     /*
     1. Find the bucket index using the hash function
@@ -327,17 +513,10 @@ typename HashMap<K, M, H>::node_pair HashMap<K, M, H>::find_node(const K& key) c
     4. If the key is not found, return {last node in correspoding bucket, nullptr}
     */
 
-   size_t bucket_index = _hash_function(key) % _buckets_array.size();
-   Node* prev = nullptr;
-   Node* curr = _buckets_array[bucket_index];
-   // traverse the linked list in the bucket
-   while (curr != nullptr) {
-    const auto& cur_key = curr->value.first;
-    if (cur_key == key) {return {prev, curr};}
-    prev = curr;
-    curr = curr->next;
-   }
-    return {prev, curr};
+   // a negative from the filter is exact: the key is missing and its chain is never walked
+   if (_bloom_filter && !_bloom_filter->may_contain(hash)) {return {nullptr, nullptr};}
+   size_t bucket_index = hash % _buckets_array.size();
+   return chain_find_hashed(_buckets_array[bucket_index], key, hash, PairFirstKey(), _sorted_chains);
 }
 
 template<typename K, typename M, typename H>
@@ -348,24 +527,28 @@ typename HashMap<K, M, H>::iterator HashMap<K, M, H>::make_iterator(Node* curr)
     */
    size_t index = bucket_count();
    if (curr != nullptr) {
-    index = _hash_function(curr->value.first) % _buckets_array.size();
+    index = curr->hash % _buckets_array.size();
    }
    return iterator(&_buckets_array, curr, index);
 } 
 
 template<typename K, typename M, typename H>
-std::ostream& operator<<(std::ostream& output_stream, const HashMap<K, M, H>& map) {
-    if (map.empty()) {return output_stream << "{}";}
-    std::stringstream formatted_stream;
+typename HashMap<K, M, H>::iterator HashMap<K, M, H>::make_iterator(Node* curr, size_t hash) {
+   if (curr == nullptr) {return end();}
+   return iterator(&_buckets_array, curr, hash % _buckets_array.size());
+}
 
+template<typename K, typename M, typename H>
+std::ostream& operator<<(std::ostream& output_stream, const HashMap<K, M, H>& map) {
+    // streamed element by element: no copy of the whole output is built in memory
+    output_stream << "{";
+    bool first = true;
     for (const auto& kv_pair : map) {
-        formatted_stream << kv_pair.first << ":" << kv_pair.second << ", ";
+        if (!first) {output_stream << ", ";}
+        first = false;
+        output_stream << kv_pair.first << ":" << kv_pair.second;
     }
-
-    std::string map_string = formatted_stream.str();
-    if (map_string.size() != 0) {map_string.erase(map_string.size() - 2, 2);}// remove the last ", "
-    output_stream << "{" << map_string << "}";
-    return output_stream;
+    return output_stream << "}";
 }
 
 
@@ -382,4 +565,235 @@ bool operator==(const HashMap<K, M, H>& lhs, const HashMap<K, M, H>& rhs) {
 template<typename K, typename M, typename H>
 bool operator!=(const HashMap<K, M, H>& lhs, const HashMap<K, M, H>& rhs) {
     return !(lhs == rhs);
-}
\ No newline at end of file
+}
+
+template<typename K, typename M, typename H>
+typename HashMap<K, M, H>::Node* HashMap<K, M, H>::new_node(const value_type& value, size_t hash) {
+    if (!_node_pool && page_policy().enabled()) {
+        _node_pool = std::make_unique<SlabPool<Node>>(page_policy());
+    }
+    if (!_node_pool) {return new Node(value, hash, nullptr);}
+
+    void* memory = _node_pool->allocate();
+    try {
+        return new (memory) Node(value, hash, nullptr);
+    } catch (...) {
+        _node_pool->deallocate(memory);
+        throw;
+    }
+}
+
+template<typename K, typename M, typename H>
+void HashMap<K, M, H>::delete_node(Node* node) {
+    if (!_node_pool) {
+        delete node;
+        return;
+    }
+    node->~Node();
+    _node_pool->deallocate(node);
+}
+
+template<typename K, typename M, typename H>
+void HashMap<K, M, H>::rebuild_bloom_filter() {
+    _bloom_filter->reset(std::max(_size, _buckets_array.size()));
+    for (Node* head : _buckets_array) {
+        for (Node* node = head; node != nullptr; node = node->next) {_bloom_filter->add(node->hash);}
+    }
+}
+
+template<typename K, typename M, typename H>
+void HashMap<K, M, H>::maintain_bloom_filter() {
+    size_t threshold = (_size + _buckets_array.size()) / 2;
+    // past its capacity the false-positive rate climbs; past half stale it mostly says "maybe"
+    if (_bloom_filter->keys() > _bloom_filter->capacity() + threshold || _bloom_filter->stale() > threshold) {
+        rebuild_bloom_filter();
+    }
+}
+
+template<typename K, typename M, typename H>
+size_t HashMap<K, M, H>::buckets_for(size_t n) {
+    return static_cast<size_t>(std::ceil(n / kMaxLoadFactor));
+}
+
+template<typename K, typename M, typename H>
+template<typename InputIter>
+size_t HashMap<K, M, H>::buckets_for(InputIter begin, InputIter end) {
+    using category = typename std::iterator_traits<InputIter>::iterator_category;
+    if constexpr (std::is_base_of_v<std::forward_iterator_tag, category>) {
+        return buckets_for(static_cast<size_t>(std::distance(begin, end)));
+    } else {
+        return 0;
+    }
+}
+
+template<typename K, typename M, typename H>
+void HashMap<K, M, H>::find_many(const std::vector<K>& keys, std::vector<iterator>& out) {
+    find_many_into(keys, out);
+}
+
+template<typename K, typename M, typename H>
+void HashMap<K, M, H>::find_many(const std::vector<K>& keys, std::vector<const_iterator>& out) const {
+    find_many_into(keys, out);
+}
+
+template<typename K, typename M, typename H>
+void HashMap<K, M, H>::lookup_interleaved(const std::vector<K>& keys, std::vector<iterator>& out, size_t group_size) {
+    lookup_interleaved_into(keys, out, group_size);
+}
+
+template<typename K, typename M, typename H>
+void HashMap<K, M, H>::lookup_interleaved(const std::vector<K>& keys, std::vector<const_iterator>& out,
+                                          size_t group_size) const {
+    lookup_interleaved_into(keys, out, group_size);
+}
+
+template<typename K, typename M, typename H>
+template<typename Iter>
+void HashMap<K, M, H>::find_many_into(const std::vector<K>& keys, std::vector<Iter>& out) const {
+    auto* self = const_cast<HashMap<K, M, H> *>(this);
+    out.assign(keys.size(), self->end());
+
+    size_t hashes[kBatchSize];
+    for (size_t first = 0; first < keys.size(); first += kBatchSize) {
+        size_t count = std::min(kBatchSize, keys.size() - first);
+        hash_batch(_hash_function, &keys[first], count, hashes);
+        for (size_t i = 0; i < count; i++) {
+            __builtin_prefetch(&_buckets_array[hashes[i] % _buckets_array.size()]);
+        }
+        for (size_t i = 0; i < count; i++) {
+            Node* head = _buckets_array[hashes[i] % _buckets_array.size()];
+            if (head != nullptr) {__builtin_prefetch(head);}
+        }
+        for (size_t i = 0; i < count; i++) {
+            auto [prev_node, curr_node] = find_node(keys[first + i], hashes[i]);
+            out[first + i] = self->make_iterator(curr_node, hashes[i]);
+        }
+    }
+}
+
+template<typename K, typename M, typename H>
+template<typename Iter>
+void HashMap<K, M, H>::lookup_interleaved_into(const std::vector<K>& keys, std::vector<Iter>& out,
+                                               size_t group_size) const {
+    if (group_size == 0) {
+        throw std::out_of_range("HashMap<K, M, H>::lookup_interleaved: group_size cannot be 0");
+    }
+    auto* self = const_cast<HashMap<K, M, H> *>(this);
+    out.assign(keys.size(), self->end());
+
+    /*
+    * One in-flight lookup. In the bucket stage its bucket slot has been prefetched,
+    * in the chain stage node has been prefetched and is the next node to compare.
+    */
+    struct Lookup {
+        enum class Stage { Bucket, Chain, Done };
+        Stage stage = Stage::Done;
+        size_t key_index = 0;
+        size_t hash = 0;
+        Node* node = nullptr;
+    };
+    std::vector<Lookup> group(std::min(group_size, keys.size()));
+    size_t next_key = 0;
+    // keys are hashed kBatchSize at a time, hashes[i % kBatchSize] holds key i's hash
+    size_t hashes[kBatchSize];
+    size_t hashed = 0;
+
+    // starts the next key in lookup, skipping keys the Bloom filter rules out (out is end())
+    auto start = [&](Lookup& lookup) {
+        lookup.stage = Lookup::Stage::Done;
+        while (next_key < keys.size()) {
+            if (next_key == hashed) {
+                size_t count = std::min(kBatchSize, keys.size() - hashed);
+                hash_batch(_hash_function, &keys[hashed], count, hashes);
+                hashed += count;
+            }
+            size_t hash = hashes[next_key % kBatchSize];
+            size_t key_index = next_key++;
+            if (_bloom_filter && !_bloom_filter->may_contain(hash)) {continue;}
+            lookup = {Lookup::Stage::Bucket, key_index, hash, nullptr};
+            __builtin_prefetch(&_buckets_array[hash % _buckets_array.size()]);
+            return;
+        }
+    };
+
+    size_t in_flight = 0;
+    for (auto& lookup : group) {
+        start(lookup);
+        if (lookup.stage != Lookup::Stage::Done) {in_flight++;}
+    }
+    while (in_flight > 0) {
+        for (auto& lookup : group) {
+            if (lookup.stage == Lookup::Stage::Done) {continue;}
+            if (lookup.stage == Lookup::Stage::Bucket) {
+                lookup.node = _buckets_array[lookup.hash % _buckets_array.size()];
+                lookup.stage = Lookup::Stage::Chain;
+            } else if (lookup.node->hash == lookup.hash && lookup.node->value.first == keys[lookup.key_index]) {
+                out[lookup.key_index] = self->make_iterator(lookup.node, lookup.hash);
+                lookup.node = nullptr;
+            } else if (_sorted_chains && lookup.node->hash > lookup.hash) {
+                // like chain_find_hashed: past its place in a sorted chain, the key is missing
+                lookup.node = nullptr;
+            } else {
+                lookup.node = lookup.node->next;
+            }
+            if (lookup.node != nullptr) {
+                __builtin_prefetch(lookup.node);
+                continue;
+            }
+            // found or end of chain: the slot moves on to the next key
+            start(lookup);
+            if (lookup.stage == Lookup::Stage::Done) {in_flight--;}
+        }
+    }
+}
+
+template<typename K, typename M, typename H>
+template<typename Compare>
+SortedView<typename HashMap<K, M, H>::value_type> HashMap<K, M, H>::sorted_view(Compare comp, size_t threads) const {
+    threads = sort_thread_count(_size, threads);
+    std::vector<const value_type*> elements;
+    if constexpr (kRadixSortable<K> && (std::is_same_v<Compare, std::less<K>> || std::is_same_v<Compare, std::less<>>)) {
+        // the keys are copied next to the pointers, so the passes do not chase pointers
+        using Entry = RadixEntry<std::make_unsigned_t<K>, const value_type*>;
+        std::vector<Entry> entries;
+        gather_chains(_buckets_array, _size, threads,
+                      [](const Node* node) {return Entry{radix_key(node->value.first), &node->value};}, entries);
+        parallel_radix_sort(entries, threads);
+        elements.reserve(entries.size());
+        for (const Entry& entry : entries) {elements.push_back(entry.element);}
+    } else {
+        gather_chains(_buckets_array, _size, threads, [](const Node* node) {return &node->value;}, elements);
+        parallel_merge_sort(elements, [&comp](const value_type* lhs, const value_type* rhs) {
+            return comp(lhs->first, rhs->first);
+        }, threads);
+    }
+    return SortedView<value_type>(std::move(elements));
+}
+
+template<typename K, typename M, typename H>
+template<typename Compare>
+std::vector<std::pair<K, M>> HashMap<K, M, H>::to_sorted_vector(Compare comp, size_t threads) const {
+    threads = sort_thread_count(_size, threads);
+    auto view = sorted_view(comp, threads);
+    std::vector<std::pair<K, M>> out(view.size());
+    run_parallel(threads, [&](size_t i) {
+        for (size_t index = i * view.size() / threads; index < (i + 1) * view.size() / threads; index++) {
+            out[index] = view[index];
+        }
+    });
+    return out;
+}
+
+template<typename K, typename M, typename H>
+void HashMap<K, M, H>::copy_slabs(const HashMap<K, M, H>& map) {
+    _node_pool = std::make_unique<SlabPool<Node>>(map._node_pool->policy());
+    auto relocate = _node_pool->copy_from(*map._node_pool);
+    for (size_t index = 0; index < _buckets_array.size(); index++) {
+        _buckets_array[index] = relocate(map._buckets_array[index]);
+        for (Node* node = _buckets_array[index]; node != nullptr; node = node->next) {
+            node->next = relocate(node->next);
+        }
+    }
+    _size = map._size;
+    if (map._bloom_filter) {_bloom_filter = std::make_unique<BlockedBloomFilter>(*map._bloom_filter);}
+}
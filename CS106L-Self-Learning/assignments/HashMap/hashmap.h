@@ -2,19 +2,33 @@
 #ifndef HASHMAP_H
 #define HASHMAP_H
 
+#include <algorithm>
+#include <cassert>
+#include <cmath>
 #include <iostream>
 #include <iomanip>
+#include <iterator>
+#include <memory>
 #include <sstream>
+#include <type_traits>
 #include <vector>
 
+#include "batch_hash.h"
+#include "bloom_filter.h"
+#include "hash_chain.h"
+#include "hashers.h"
 #include "hashmap_iterator.h"
+#include "page_allocator.h"
+#include "sorted_view.h"
 
 /*
 * Template class for a HashMap
 *
 * K = key type
 * M = mapped type
-* H = hash function type used to hash a key; if not provided, defaults to std::hash<K>
+* H = hash function type used to hash a key; if not provided, defaults to DefaultHash<K>
+*     (hashers.h), which mixes every key bit into the bucket index. std::hash is the
+*     identity for integers in libstdc++, so strided keys would pile into a few buckets.
 *
 * Notes: When dealing with the Stanford libraries, we often call M the value
 * (and maps store key/value pairs).
@@ -36,7 +50,7 @@
 *           The const and reference are not required, but key cannot be modified in function.
 *      - K and M must be regular (copyable, default constructible, and equality comparable).
 */
-template<typename K, typename M, typename H = std::hash<K>>
+template<typename K, typename M, typename H = DefaultHash<K>>
 class HashMap {
 public:
     /*
@@ -115,12 +129,65 @@ public:
     */
     explicit HashMap(size_t bucket_count, const H& hash = H());
 
+    /*
+    * Constructor with bucket_count, hash function and page placement policy.
+    *
+    * With an enabled policy, the bucket array is mapped with huge pages and/or NUMA placement
+    * (see PagePolicy), and nodes are carved out of 2 MiB slabs mapped the same way instead of
+    * being allocated one by one. For maps of several GB this cuts the TLB misses of find,
+    * which otherwise touches a different 4 KiB page for the bucket and for every node.
+    * The policy is kept by copies and moves of the map.
+    *
+    * Usage:
+    *      PagePolicy policy;
+    *      policy.huge_pages = PagePolicy::HugePages::Transparent;
+    *      HashMap<int, int> map(1 << 24, DefaultHash<int>(), policy);
+    *
+    * Complexity: O(B), B = number of buckets
+    *
+    * Notes: slabs are only given back to the system by the destructor (or by assigning
+    * another map); erased nodes are reused by later inserts, and clear() keeps the slabs
+    * for the inserts that follow it.
+    */
+    HashMap(size_t bucket_count, const H& hash, const PagePolicy& policy);
+
+    /*
+    * Returns the page placement policy of the map (disabled unless given to the constructor).
+    */
+    PagePolicy page_policy() const;
+
+    /*
+    * Turns on a blocked Bloom filter (see bloom_filter.h) in front of the bucket array.
+    * find, contains, at and erase check the filter first, and a key it rules out is
+    * reported missing without touching the bucket array or any node. That pays off when
+    * most lookups miss; when most of them hit, the filter is only extra work.
+    *
+    * The filter is kept up to date by insert and rebuilt from the elements by rehash,
+    * after enough inserts to outgrow it and after enough erases to leave it mostly stale.
+    * Copies keep the filter; a moved-from map loses it.
+    *
+    * Usage:
+    *      map.enable_bloom_filter();
+    *      if (!map.contains(key)) { ... }   // usually decided by the filter alone
+    *
+    * Exceptions: std::out_of_range if bits_per_key = 0.
+    *
+    * Complexity: O(N + B), N = number of elements, B = number of buckets
+    *
+    * Notes: with the filter on, insert links a key the filter rules out at the head of
+    * its bucket instead of the tail, so the order of a bucket may differ.
+    */
+    void enable_bloom_filter(size_t bits_per_key = BlockedBloomFilter::kDefaultBitsPerKey);
+    void disable_bloom_filter();
+    bool bloom_filter_enabled() const;
+
     /*
     * Destructor.
     *
     * Usage: (implicitly called when HashMap goes out of scope)
     *
-    * Complexity: O(N), N = number of elements
+    * Complexity: O(N), N = number of elements;
+    *             O(S), S = number of slabs, with pooled nodes and trivially destructible K and M
     */
     ~HashMap();
 
@@ -129,6 +196,21 @@ public:
     inline float load_factor() const;
     inline size_t bucket_count() const;
 
+    /*
+    * Returns the number of bytes held by the HashMap: the object itself, the bucket array
+    * and the nodes. Nodes allocated one by one count sizeof(node) per element; nodes in a
+    * slab pool (a page policy, or optimize_for_reads) count every mapped slab in full,
+    * including the free and not yet used slots in it.
+    *
+    * Complexity: O(1)
+    *
+    * Notes: a node allocated on its own also costs the allocator's bookkeeping (8-16 bytes
+    * per node with glibc), which is not counted here; slabs have none.
+    * CompactHashMap avoids both that overhead and the 64-bit next pointers.
+    * An enabled Bloom filter is counted as well.
+    */
+    size_t memory_usage() const;
+
     /*
     * Returns whether or not the HashMap contains the given key.
     *
@@ -184,6 +266,11 @@ public:
     * with those elements, but the HashMap should still be in a valid state and is
     * ready to be inserted again, as if it were a newly constructed HashMap with no elements.
     * The number of buckets should stay the same.
+    *
+    * When the nodes come from a slab pool (see PagePolicy) and K and M are trivially
+    * destructible, no node needs its destructor: the chains are not walked, the bucket array
+    * is zeroed and the slab pool is reset at once, in O(B). The slabs stay mapped and are
+    * reused by the next inserts.
     */
     void clear();
 
@@ -207,6 +294,22 @@ public:
     * Complexity: O(1) amortized average case
     */
     std::pair<iterator, bool> insert(const value_type& val);
+    std::pair<iterator, bool> insert(const value_type& val, size_t precomputed_hash);
+
+    /*
+    * Inserts every K/M pair of [first, last), with the same rule as insert for keys that
+    * already exist (including keys repeated within the range: the first one wins).
+    *
+    * Usage:
+    *      map.insert(rows.begin(), rows.end());
+    *
+    * Complexity: O(N) average case, N = std::distance(first, last)
+    *
+    * Notes: when H has a hash_batch (see batch_hash.h) and the range can be traversed twice,
+    * the keys are hashed kBatchSize at a time with it before their pairs are inserted.
+    */
+    template<typename InputIter>
+    void insert(InputIter first, InputIter last);
     
     /*
     * Erases a K/M pair (if one exists) corresponding to given key from the HashMap.
@@ -224,6 +327,7 @@ public:
     * other than iterators to the erased K/M element.
     */
     bool erase(const K& key);
+    bool erase(const K& key, size_t precomputed_hash);
 
     /*
     * Erases the K/M pair that pos points to.
@@ -266,9 +370,73 @@ public:
     * Previously, this function was part of the assignment. However, it's a fairly challenging
     * linked list problem, and students had a difficult time finding an elegant solution.
     * Instead, we will ask short answer questions on this function instead.
+    *
+    * Nodes keep the hash of their key, so rehash relinks them without calling the hash
+    * function. It also leaves every chain sorted by hash, like optimize_for_reads but
+    * without moving the nodes.
     */
     void rehash(size_t new_bucket);
 
+    /*
+    * Prepares a bulk-loaded map for a read-heavy phase:
+    *      - every chain is sorted by the hash stored in its nodes, so a lookup for a missing
+    *        key stops at the first larger hash instead of walking the whole chain;
+    *      - the nodes are copied into fresh slabs in bucket order, each chain contiguous,
+    *        so walking the chains (and iterating the map) reads memory sequentially.
+    * The chains stay sorted afterwards: insert links new nodes at their place in the order.
+    *
+    * Usage:
+    *      HashMap<std::string, Row> index(rows.begin(), rows.end());
+    *      index.optimize_for_reads();
+    *
+    * Complexity: O(N log L + B), L = length of the longest chain
+    *
+    * Notes: invalidates every iterator, pointer and reference to the elements. The node
+    * slabs keep the map's page policy; a map without one gets plain pooled slabs. The first
+    * slab holds the current elements, and the slabs mapped for later inserts grow
+    * geometrically, so a small map that keeps growing maps O(log N) slabs.
+    */
+    void optimize_for_reads();
+
+    /*
+    * True once optimize_for_reads or rehash has sorted the chains.
+    */
+    bool chains_sorted() const;
+
+    /*
+    * Makes room for n elements: if n elements would push the load factor above
+    * max_load_factor(), rehashes to the smallest bucket count that keeps it there.
+    * Never reduces the number of buckets.
+    *
+    * Usage:
+    *      map.reserve(rows.size());
+    *      for (const auto& row : rows) map.insert(row);
+    *
+    * Complexity: O(N + B) if it rehashes, O(1) otherwise
+    *
+    * Notes: since the map never rehashes on its own, a bulk load into a map that was not
+    * reserved ends up with long chains instead of a regrown table.
+    */
+    void reserve(size_t n);
+
+    /*
+    * Rehashes down to the smallest bucket count that holds the current elements at
+    * max_load_factor(), but no fewer than a default constructed map has. The old bucket
+    * array is freed. Never increases the number of buckets.
+    *
+    * Usage:
+    *      for (const auto& key : expired) map.erase(key);
+    *      map.shrink_to_fit();
+    *
+    * Complexity: O(N + B) if it rehashes, O(1) otherwise
+    */
+    void shrink_to_fit();
+
+    /*
+    * The load factor reserve, shrink_to_fit and the range constructors size the map for.
+    */
+    inline float max_load_factor() const;
+
     /*
     * Returns an iterator to the first element.
     * This overload is used when the HashMap is non-const.
@@ -315,6 +483,92 @@ public:
 
     const_iterator find(const K& key) const;
 
+    /*
+    * Returns the hash of key under this map's hash function.
+    *
+    * The overloads of find, insert and erase taking a precomputed_hash skip hashing the key,
+    * which is most of the cost of a lookup with long string keys. A key looked up in several
+    * maps with the same hash function only needs to be hashed once.
+    * In debug builds (NDEBUG not defined), each of them asserts that precomputed_hash is
+    * hash_of(key); in release builds a wrong hash makes the result unspecified.
+    *
+    * Usage:
+    *      size_t hash = routes.hash_of(key);
+    *      auto route = routes.find(key, hash);
+    *      auto quota = quotas.find(key, hash);
+    *
+    * Complexity: cost of one call to the hash function
+    */
+    size_t hash_of(const K& key) const;
+
+    iterator find(const K& key, size_t precomputed_hash);
+    const_iterator find(const K& key, size_t precomputed_hash) const;
+
+    /*
+    * Batched lookups: sets out[i] = find(keys[i]) for every key; out is resized to keys.size().
+    *
+    * find_many works in batches of kBatchSize keys: the whole batch is hashed (with
+    * H::hash_batch when H has one, see batch_hash.h) and its bucket
+    * slots prefetched, then the chain heads are prefetched, then each chain is walked.
+    * That overlaps the first two cache misses of every key, but a long chain still stalls
+    * the rest of its batch.
+    *
+    * lookup_interleaved keeps group_size lookups in flight as small state machines
+    * (asynchronous memory access chaining). Each step of a lookup reads only memory that
+    * was prefetched on its previous step, prefetches the next bucket slot or node, and
+    * moves on to the next lookup of the group. A finished lookup is replaced by the next
+    * key right away, so chains of any length overlap with each other.
+    *
+    * Usage:
+    *      std::vector<HashMap<int, int>::iterator> found;
+    *      map.lookup_interleaved(keys, found);
+    *      for (size_t i = 0; i < keys.size(); ++i) if (found[i] != map.end()) ...
+    *
+    * Exceptions: std::out_of_range if group_size = 0.
+    *
+    * Complexity: O(K) average case, K = number of keys
+    *
+    * Notes: both only pay off when the map is much larger than the caches; for a map that
+    * fits in cache, a loop of find is at least as fast. Both check the Bloom filter first
+    * when it is enabled. Like find, they compare a key only with nodes of the same hash,
+    * and stop a lookup at the first larger hash once the chains are sorted.
+    */
+    void find_many(const std::vector<K>& keys, std::vector<iterator>& out);
+    void find_many(const std::vector<K>& keys, std::vector<const_iterator>& out) const;
+    void lookup_interleaved(const std::vector<K>& keys, std::vector<iterator>& out,
+                            size_t group_size = kDefaultGroupSize);
+    void lookup_interleaved(const std::vector<K>& keys, std::vector<const_iterator>& out,
+                            size_t group_size = kDefaultGroupSize) const;
+
+    /*
+    * Sorted exports: the elements ordered by key with comp.
+    *
+    * sorted_view returns a random access view of pointers to the elements, copying none
+    * of them; to_sorted_vector copies each element once, in order. Both gather the
+    * elements with threads threads (0 = one per core, fewer for small maps), each
+    * walking a range of buckets into an array allocated once. An integral key with the
+    * default std::less is then sorted by a parallel radix sort, anything else by a
+    * parallel merge sort. See sorted_view.h.
+    *
+    * Usage:
+    *      for (const auto& [id, order] : orders.sorted_view()) report << id << order;
+    *      auto by_name = users.sorted_view([](const auto& a, const auto& b) { return a.name < b.name; });
+    *      std::vector<std::pair<int, double>> snapshot = prices.to_sorted_vector();
+    *
+    * Complexity: O(N + B) to gather, plus O(N) for the radix sort of a key of up to 8 bytes
+    * or O(N log N) comparisons, divided among the threads
+    *
+    * Notes: comp is called from several threads at once, and must be safe for that. Keys
+    * that compare equivalent come out in an unspecified order. The view stays valid
+    * through inserts, rehash and reserve, which relink nodes without moving them. It is
+    * invalidated by optimize_for_reads, which copies every node into new slabs, and by
+    * erase, clear, assigning to the map and destroying it.
+    */
+    template<typename Compare = std::less<K>>
+    SortedView<value_type> sorted_view(Compare comp = Compare(), size_t threads = 0) const;
+    template<typename Compare = std::less<K>>
+    std::vector<std::pair<K, M>> to_sorted_vector(Compare comp = Compare(), size_t threads = 0) const;
+
     /*
     * Function that will print to std::cout the contents of the hash table as
     * linked lists, and also displays the size, number of buckets, and load factor.
@@ -350,6 +604,10 @@ public:
     *      HashMap<char, int> map{vec.begin(), vec.end()};
     *
     * Complexity: O(N), where N = std::distance(first, last);
+    *
+    * Notes: for forward iterators, the map gets enough buckets for std::distance(first, last)
+    * elements at max_load_factor() if bucket_count is smaller. An input range cannot be
+    * measured without consuming it, so it keeps bucket_count.
     */
     template<typename InputIter>
     HashMap(InputIter begin, InputIter end, size_t bucket_count = kDefaultBuckets, const H& hash = H());
@@ -365,6 +623,8 @@ public:
     *
     * Complexity: O(N), where N = init.size();
     *
+    * Notes: the map gets enough buckets for init.size() elements, as with the range constructor.
+    *
     * Notes: you may want to do some research on initializer_lists. The most important detail you need
     * to know is that they are very limited, and have three functions: init.begin(), init.end(), and init.size().
     * There are no other ways to access the elements in an initializer_list.
@@ -392,9 +652,19 @@ public:
 
 
     // TODO: declare headers for copy constructor/assignment, move constructor/assignment
+    /*
+    * The copy constructor inserts the elements of map one by one, except when map's nodes
+    * come from a slab pool and K and M are trivially copyable: then the slabs are copied
+    * with memcpy and the next pointers are relocated into the copies, so no element is
+    * hashed and nothing is allocated per element.
+    */
     HashMap(const HashMap<K, M, H>& map);
     HashMap(HashMap<K, M, H>&& map);
 
+    /*
+    * Copy assignment takes the slab fast path of the copy constructor too, and then has
+    * map's bucket count; otherwise it keeps its own buckets and inserts map's elements.
+    */
     HashMap<K, M, H>& operator=(const HashMap<K, M, H>& map);
     HashMap<K, M, H>& operator=(HashMap<K, M, H>&& map);
 
@@ -402,6 +672,7 @@ private:
     /*
     * node structure represented a node in a linked list.
     * Each node consists of a value_type (K/M pair) and a next pointer.
+    * The node type is shared with HashSet and HashMultiMap, see hash_chain.h.
     *
     * This is implemented in the private section as clients should not be dealing
     * with anything related to the node struct.
@@ -411,20 +682,11 @@ private:
     *      n->value = {3, 4};
     *      n->next = nullptr;
     */
-    struct Node
-    {
-        value_type value;
-        Node* next;
-       /*
-        * Default constructor, so even if you forget to set next to nullptr it'll be fine.
-        *
-        */
-        Node() : value(value_type()), next(nullptr) {};
-        Node(const value_type& value, Node* next):value(value), next(next) {};
-    };
+    using Node = HashedNode<value_type>;
 
     using node_pair = std::pair<Node *, Node *>;
     node_pair find_node(const K& key) const;
+    node_pair find_node(const K& key, size_t hash) const;
     size_t first_not_empty_bucket() const;
 
     /*
@@ -433,13 +695,65 @@ private:
     * Hint: on the assignment, you should NOT need to call this function.
     */
     iterator make_iterator(Node* curr);
+    // same, when the hash of curr's key is already known
+    iterator make_iterator(Node* curr, size_t hash);
+
+    /*
+    * Allocate and free nodes: from the slab pool if the map has an enabled page policy,
+    * with new and delete otherwise.
+    */
+    Node* new_node(const value_type& value, size_t hash);
+    void delete_node(Node* node);
+
+    /*
+    * Refills the Bloom filter from the elements, sized for max(N, B) keys.
+    * maintain_bloom_filter rebuilds it once it holds (N + B) / 2 keys more than it was sized
+    * for, or (N + B) / 2 of its keys have been erased, so the O(N + B) rebuilds amortize
+    * to O(1) per update.
+    */
+    void rebuild_bloom_filter();
+    void maintain_bloom_filter();
+
+    /*
+    * Copy constructor fast path: duplicates map's slab pool and relocates the bucket
+    * heads and next pointers into it. Requires kMemcpyNodes and a pool in map.
+    */
+    void copy_slabs(const HashMap<K, M, H>& map);
+
+    /*
+    * Number of buckets n elements need at max_load_factor(); for the range constructor,
+    * that number for std::distance(begin, end) elements, or 0 for a single-pass range.
+    */
+    static size_t buckets_for(size_t n);
+
+    /*
+    * Shared by the iterator and const_iterator overloads of find_many and lookup_interleaved.
+    */
+    template<typename Iter>
+    void find_many_into(const std::vector<K>& keys, std::vector<Iter>& out) const;
+    template<typename Iter>
+    void lookup_interleaved_into(const std::vector<K>& keys, std::vector<Iter>& out, size_t group_size) const;
+    template<typename InputIter>
+    static size_t buckets_for(InputIter begin, InputIter end);
 
     /* Private member variables */
     size_t _size;
     H _hash_function;
-    std::vector<Node *> _buckets_array;
+    std::vector<Node *, PageAllocator<Node *>> _buckets_array;
+    // only allocated with an enabled page policy, which the bucket array allocator holds
+    std::unique_ptr<SlabPool<Node>> _node_pool;
+    // only allocated by enable_bloom_filter
+    std::unique_ptr<BlockedBloomFilter> _bloom_filter;
+    // set by optimize_for_reads and rehash: every chain is ordered by node hash
+    bool _sorted_chains = false;
 
     static const size_t kDefaultBuckets = 10;
+    static constexpr float kMaxLoadFactor = 1.0f;
+    // nodes of such maps can be copied with memcpy and freed without running destructors
+    static constexpr bool kMemcpyNodes = std::is_trivially_copyable_v<K> && std::is_trivially_copyable_v<M>;
+    static constexpr bool kTrivialNodeDestructor = std::is_trivially_destructible_v<value_type>;
+    static constexpr size_t kBatchSize = 16;
+    static constexpr size_t kDefaultGroupSize = 16;
     using bucket_array_type = decltype(_buckets_array);
 };
 
@@ -4,6 +4,7 @@
 
 #include <iterator>     // for std::forward_iterator_tag
 #include <functional>   // for std::conditional_t
+#include <type_traits>  // for std::enable_if_t
 
 // forward declaration for the HashMap class
 template <typename K, typename M, typename H> class HashMap;
@@ -15,7 +16,9 @@ template <typename K, typename M, typename H> class HashMap;
 * IsConst = whether this is a const_iterator class.
 *
 * Concept requirements:
-* - Map must be a valid class HashMap<K, M, H>
+* - Map must be a valid class HashMap<K, M, H>, or any other container built on the
+*   chains of hash_chain.h (HashSet, HashMultiMap) that exposes the value_type, Node and
+*   bucket_array_type aliases and befriends this class.
 */
 template <typename Map, bool IsConst = true>
 class HashMapIterator {
@@ -26,7 +29,7 @@ public:
     * that prevents the client from modifying the elements via a const_iterator. The meta-function
     * std::conditional_t changes the value_type (at compile-time) to a const one if IsConst is true.
     */
-    using value_type = std::conditional_t<IsConst, typename Map::value_type, typename Map::value_type>;
+    using value_type = std::conditional_t<IsConst, const typename Map::value_type, typename Map::value_type>;
 
     /*
     * Public aliases for this iterator class. Important so STL functions like std::iterator_traits
@@ -60,7 +63,10 @@ public:
     *
     * Note: conversion in the opposite direction (const to non-const) is not safe
     * because that gives the client write access the map itself is const.
+    * The operator only exists on non-const iterators, a const_iterator already is one
+    * (HashSet uses const_iterator for both of its iterator aliases).
     */
+    template <bool IsConst_ = IsConst, typename = std::enable_if_t<!IsConst_>>
     operator HashMapIterator<Map, true>() const {
         return HashMapIterator<Map, true>(_buckets_array, _node, _bucket_idx);
     }
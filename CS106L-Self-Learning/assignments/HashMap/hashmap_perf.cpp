@@ -2,11 +2,39 @@
 #include <random>
 #include <string>
 #include <chrono>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <fstream>
+#include <iomanip>
 #include <iostream>
+#include <sstream>
 #include <algorithm>
+#include <numeric>
 #include <unordered_map>
 
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
 #include "hashmap.h"
+#include "concurrent_cache.h"
+#include "hash_aggregator.h"
+#include "hash_join.h"
+#include "compact_hashmap.h"
+#include "durable_hashmap.h"
+#include "persistent_hashmap.h"
+#include "hashmap_text.h"
+#include "ttl_hashmap.h"
+#include "hashers.h"
+#include "static_hashmap.h"
+#include "instrumented_hashmap.h"
+#include "mvcc_hashmap.h"
+#include "disk_hashmap.h"
+#include "extendible_hashmap.h"
 #include "gtest/gtest.h"
 #include "test_settings.h"
 
@@ -48,12 +76,180 @@ std::string print_with_commas(long long int n) {
     return ans;
 }
 
+/*
+* Hardware performance counters of the calling thread between start() and stop(), read with
+* perf_event_open: cycles, instructions, L1d load misses, last level cache misses, dTLB load
+* misses and branch misses, user space only.
+*
+* Every counter is opened on its own, so a kernel or container that refuses some of them
+* (perf_event_paranoid, no PMU in a VM) only loses those columns, which print n/a; on
+* non-Linux systems they all do. When the PMU has fewer registers than events it multiplexes
+* them, and each count is scaled by the time the event was enabled over the time it ran.
+*
+* Usage:
+*      PerfCounters counters;
+*      counters.start();
+*      ... N operations ...
+*      counters.stop();
+*      std::cout << counters.per_op(N) << '\n';
+*/
+class PerfCounters {
+public:
+    enum Event { Cycles, Instructions, L1dMisses, LlcMisses, DtlbMisses, BranchMisses, kEventCount };
+
+    PerfCounters() {
+        for (int event = 0; event < kEventCount; event++) {
+            _fds[event] = open_event(static_cast<Event>(event));
+            _values[event] = -1;
+        }
+    }
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    ~PerfCounters() {
+#if defined(__linux__)
+        for (int fd : _fds) if (fd >= 0) close(fd);
+#endif
+    }
+
+    bool available(Event event) const { return _fds[event] >= 0; }
+
+    bool any_available() const {
+        return std::any_of(std::begin(_fds), std::end(_fds), [](int fd) { return fd >= 0; });
+    }
+
+    void start() {
+#if defined(__linux__)
+        for (int fd : _fds) {
+            if (fd < 0) continue;
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+#endif
+    }
+
+    void stop() {
+#if defined(__linux__)
+        for (int event = 0; event < kEventCount; event++) {
+            _values[event] = -1;
+            if (_fds[event] < 0) continue;
+            ioctl(_fds[event], PERF_EVENT_IOC_DISABLE, 0);
+            // {value, time enabled, time running}, see PERF_FORMAT_TOTAL_TIME_*
+            unsigned long long data[3];
+            if (read(_fds[event], data, sizeof(data)) != sizeof(data) || data[2] == 0) continue;
+            _values[event] = static_cast<long long>(data[0] * (double(data[1]) / data[2]));
+        }
+#endif
+    }
+
+    /*
+    * Count of event between the last start() and stop(), or -1 if it is not available.
+    */
+    long long value(Event event) const { return _values[event]; }
+
+    std::string count(Event event) const {
+        return _values[event] < 0 ? "n/a" : print_with_commas(_values[event]);
+    }
+
+    /*
+    * All counters divided by operations, formatted as columns for the benchmark tables.
+    */
+    std::string per_op(size_t operations) const {
+        static const char* names[kEventCount] = {
+            "cycles", "instructions", "L1d misses", "LLC misses", "dTLB misses", "branch misses"
+        };
+        std::ostringstream line;
+        line << std::fixed << std::setprecision(2);
+        for (int event = 0; event < kEventCount; event++) {
+            line << " | " << names[event] << "/op: " << std::setw(8);
+            if (_values[event] < 0) {
+                line << "n/a";
+            } else {
+                line << double(_values[event]) / std::max<size_t>(operations, 1);
+            }
+        }
+        return line.str();
+    }
+
+private:
+    static int open_event(Event event) {
+#if defined(__linux__)
+        perf_event_attr attr{};
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        auto cache_miss = [](unsigned long long cache) {
+            return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        };
+        switch (event) {
+        case Cycles:       attr.config = PERF_COUNT_HW_CPU_CYCLES; break;
+        case Instructions: attr.config = PERF_COUNT_HW_INSTRUCTIONS; break;
+        case BranchMisses: attr.config = PERF_COUNT_HW_BRANCH_MISSES; break;
+        case LlcMisses:    attr.config = PERF_COUNT_HW_CACHE_MISSES; break;
+        case L1dMisses:
+            attr.type = PERF_TYPE_HW_CACHE;
+            attr.config = cache_miss(PERF_COUNT_HW_CACHE_L1D);
+            break;
+        case DtlbMisses:
+            attr.type = PERF_TYPE_HW_CACHE;
+            attr.config = cache_miss(PERF_COUNT_HW_CACHE_DTLB);
+            break;
+        default: return -1;
+        }
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+#else
+        (void) event;
+        return -1;
+#endif
+    }
+
+    int _fds[kEventCount];
+    long long _values[kEventCount];
+};
+
+/*
+* Wraps a timed benchmark region: with RUN_PERF_COUNTERS set, the region is also counted
+* and print() adds a line of per-operation counters under the timing line. Without any
+* usable counter, print() prints nothing; main says so once.
+*/
+class BenchmarkCounters {
+public:
+    void start() {
+#if RUN_PERF_COUNTERS
+        _counters.start();
+#endif
+    }
+
+    void stop() {
+#if RUN_PERF_COUNTERS
+        _counters.stop();
+#endif
+    }
+
+    void print(const std::string& label, size_t operations) const {
+#if RUN_PERF_COUNTERS
+        if (!_counters.any_available()) return;
+        std::cout << std::setw(24) << label << _counters.per_op(operations) << '\n';
+#else
+        (void) label;
+        (void) operations;
+#endif
+    }
+
+private:
+#if RUN_PERF_COUNTERS
+    PerfCounters _counters;
+#endif
+};
+
 #if RUN_TEST_PERF
 void benchmark_insert_erase() {
     std::cout << "Task: insert then erase N elements, measured in ns." << '\n';
-    auto good_hash_function = [](const int& key) {
-       return (key * 43037 + 52081) % 79229;
-    };
+    DefaultHash<int> good_hash_function;
 
     std::vector<size_t> my_map_timing;
     std::vector<int> sizes{10, 100, 1000, 10000, 100000, 1000000};
@@ -65,7 +261,9 @@ void benchmark_insert_erase() {
         auto rng = std::default_random_engine {};
         std::shuffle(million.begin(), million.end(), rng);
         size_t my_map_result, std_map_result;
+        BenchmarkCounters my_counters, std_counters;
         {
+            my_counters.start();
             auto my_start = clock_type::now();
 
             HashMap<int, int, decltype(good_hash_function)> my_map(size, good_hash_function);
@@ -78,12 +276,14 @@ void benchmark_insert_erase() {
             }
 
             auto my_end = clock_type::now();
+            my_counters.stop();
             auto end = std::chrono::duration_cast<ns>(my_end - my_start);
 
             my_map_result = end.count();
         }
 
         {
+            std_counters.start();
             auto std_start = clock_type::now();
 
             std::unordered_map<int, int, decltype(good_hash_function)> std_map(size, good_hash_function);
@@ -96,6 +296,7 @@ void benchmark_insert_erase() {
             }
 
             auto std_end = clock_type::now();
+            std_counters.stop();
             auto end = std::chrono::duration_cast<ns>(std_end - std_start);
 
             std_map_result = end.count();
@@ -104,6 +305,8 @@ void benchmark_insert_erase() {
         std::cout << "size "  << std::setw(10) << size;
         std::cout << " | HashMap: " <<  std::setw(13) << print_with_commas(my_map_result);
         std::cout << " | std:unordered_map: "  << std::setw(13) << print_with_commas(std_map_result) << '\n';
+        my_counters.print("HashMap", 2 * size);
+        std_counters.print("std::unordered_map", 2 * size);
         my_map_timing.push_back(my_map_result);
     }
     EXPECT_TRUE(10*my_map_timing[0] < my_map_timing[3]); // Ensure runtime of N = 10 is much faster than N = 10000
@@ -111,9 +314,7 @@ void benchmark_insert_erase() {
 
 void benchmark_find() {
     std::cout << "Task: find N elements (random hit/miss), measured in ns." << '\n';
-    auto good_hash_function = [](const int& key) {
-       return (key * 43037 + 52081) % 79229;
-    };
+    DefaultHash<int> good_hash_function;
 
     std::vector<size_t> my_map_timing;
     std::vector<int> sizes{10, 100, 1000, 10000, 100000, 1000000};
@@ -128,6 +329,7 @@ void benchmark_find() {
         std::shuffle(million.begin(), million.end(), rng);
         std::shuffle(lookup.begin(), lookup.end(), rng);
         size_t my_map_result, std_map_result;
+        BenchmarkCounters my_counters, std_counters;
         {
 
             HashMap<int, int, decltype(good_hash_function)> my_map(size, good_hash_function);
@@ -135,6 +337,7 @@ void benchmark_find() {
                 int element = million[i];
                 my_map.insert({element, element});
             }
+            my_counters.start();
             auto my_start = clock_type::now();
             int count = 0;
             for (size_t i = 0; i < lookup.size(); i += 2) {
@@ -144,6 +347,7 @@ void benchmark_find() {
             }
 
             auto my_end = clock_type::now();
+            my_counters.stop();
             auto end = std::chrono::duration_cast<ns>(my_end - my_start);
 
             my_map_result = end.count();
@@ -155,6 +359,7 @@ void benchmark_find() {
                 int element = million[i];
                 std_map.insert({element, element});
             }
+            std_counters.start();
             auto std_start = clock_type::now();
             int count = 0;
             for (size_t i = 0; i < lookup.size(); i += 2) {
@@ -164,6 +369,7 @@ void benchmark_find() {
             }
 
             auto std_end = clock_type::now();
+            std_counters.stop();
             auto end = std::chrono::duration_cast<ns>(std_end - std_start);
 
             std_map_result = end.count();
@@ -172,6 +378,8 @@ void benchmark_find() {
         std::cout << "size "  << std::setw(10) << size;
         std::cout << " | HashMap: " <<  std::setw(13) << print_with_commas(my_map_result);
         std::cout << " | std:unordered_map: "  << std::setw(13) << print_with_commas(std_map_result) << '\n';
+        my_counters.print("HashMap", size);
+        std_counters.print("std::unordered_map", size);
         my_map_timing.push_back(my_map_result);
     }
     EXPECT_TRUE(10*my_map_timing[0] < my_map_timing[3]); // Ensure runtime of N = 10 is much faster than N = 10000
@@ -179,9 +387,7 @@ void benchmark_find() {
 
 void benchmark_iterate() {
     std::cout << "Task: iterate over all N elements, measured in ns." << '\n';
-    auto good_hash_function = [](const int& key) {
-       return (key * 43037 + 52081) % 79229;
-    };
+    DefaultHash<int> good_hash_function;
 
     std::vector<size_t> my_map_timing;
     std::vector<size_t> std_map_timing;
@@ -194,18 +400,21 @@ void benchmark_iterate() {
         auto rng = std::default_random_engine {};
         std::shuffle(million.begin(), million.end(), rng);
         size_t my_map_result, std_map_result;
+        BenchmarkCounters my_counters, std_counters;
         {
             HashMap<int, int, decltype(good_hash_function)> my_map(size, good_hash_function);
             for (int element : million) {
                 my_map.insert({element, element});
             }
 
+            my_counters.start();
             auto my_start = clock_type::now();
             size_t count = 0;
             for (const auto& [key, value] : my_map) {
                 count += key;
             }
             auto my_end = clock_type::now();
+            my_counters.stop();
             auto end = std::chrono::duration_cast<ns>(my_end - my_start);
 
             my_map_result = end.count();
@@ -217,12 +426,14 @@ void benchmark_iterate() {
                 std_map.insert({element, element});
             }
 
+            std_counters.start();
             auto std_start = clock_type::now();
             size_t count = 0;
             for (const auto& [key, value] : std_map) {
                 count += key;
             }
             auto std_end = clock_type::now();
+            std_counters.stop();
             auto end = std::chrono::duration_cast<ns>(std_end - std_start);
 
             std_map_result = end.count();
@@ -231,18 +442,964 @@ void benchmark_iterate() {
         std::cout << "size "  << std::setw(10) << size;
         std::cout << " | HashMap: " <<  std::setw(13) << print_with_commas(my_map_result);
         std::cout << " | std:unordered_map: "  << std::setw(13) << print_with_commas(std_map_result) << '\n';
+        my_counters.print("HashMap", size);
+        std_counters.print("std::unordered_map", size);
         my_map_timing.push_back(my_map_result);
     }
     EXPECT_TRUE(10*my_map_timing[0] < my_map_timing[3]); // Ensure runtime of N = 10 is much faster than N = 10000
 }
+
+void benchmark_concurrent_cache() {
+    std::cout << "Task: get-or-put from T threads on a ConcurrentCache, measured in ops/us." << '\n';
+    // keys are drawn uniformly from capacity / hit_ratio distinct keys, so the steady
+    // state hit ratio of the cache is roughly hit_ratio
+    const size_t capacity = 1 << 16;
+    const size_t ops_per_thread = 200000;
+    std::vector<double> hit_ratios{0.5, 0.9, 0.99};
+    std::vector<size_t> shard_counts{1, 64};
+    size_t max_threads = std::max(2u, std::thread::hardware_concurrency());
+
+    for (double hit_ratio : hit_ratios) {
+        size_t key_space = static_cast<size_t>(capacity / hit_ratio);
+        for (size_t shards : shard_counts) {
+            for (size_t threads = 1; threads <= max_threads; threads *= 2) {
+                ConcurrentCache<int, int> cache(capacity, shards);
+                for (size_t i = 0; i < capacity; i++) cache.put(i, i);
+
+                auto start = clock_type::now();
+                std::vector<std::thread> workers;
+                for (size_t t = 0; t < threads; t++) {
+                    workers.emplace_back([&cache, key_space, ops_per_thread, t]() {
+                        std::default_random_engine rng(t + 1);
+                        std::uniform_int_distribution<int> dist(0, key_space - 1);
+                        for (size_t i = 0; i < ops_per_thread; i++) {
+                            int key = dist(rng);
+                            if (!cache.get(key)) cache.put(key, key);
+                        }
+                    });
+                }
+                for (auto& worker : workers) worker.join();
+                auto end = std::chrono::duration_cast<ns>(clock_type::now() - start);
+
+                auto stats = cache.stats();
+                double observed = double(stats.hits) / (stats.hits + stats.misses);
+                double ops_per_us = 1000.0 * threads * ops_per_thread / end.count();
+                std::cout << "hit ratio " << std::setw(5) << hit_ratio
+                          << " | shards " << std::setw(3) << shards
+                          << " | threads " << std::setw(3) << threads
+                          << " | ops/us: " << std::setw(8) << std::fixed << std::setprecision(2) << ops_per_us
+                          << " | observed hit ratio: " << observed
+                          << " | evictions: " << std::setw(10) << print_with_commas(stats.evictions) << '\n';
+                std::cout.unsetf(std::ios::fixed);
+            }
+        }
+    }
+}
+
+void benchmark_aggregate() {
+    std::cout << "Task: sum N rows grouped by key, measured in ns." << '\n';
+    const size_t rows_count = 2000000;
+    std::vector<size_t> cardinalities{16, 1000, 1000000};
+    size_t max_threads = std::max(2u, std::thread::hardware_concurrency());
+
+    for (size_t cardinality : cardinalities) {
+        std::vector<std::pair<int, long>> rows;
+        auto rng = std::default_random_engine {};
+        std::uniform_int_distribution<int> dist(0, cardinality - 1);
+        for (size_t i = 0; i < rows_count; i++) rows.push_back({dist(rng), 1});
+
+        size_t serial_result;
+        {
+            auto start = clock_type::now();
+            HashMap<int, long> map(cardinality);
+            for (const auto& [key, value] : rows) map[key] += value;
+            serial_result = std::chrono::duration_cast<ns>(clock_type::now() - start).count();
+        }
+        std::cout << "groups " << std::setw(8) << cardinality
+                  << " | HashMap::operator[]   | " << std::setw(13) << print_with_commas(serial_result) << '\n';
+
+        for (size_t threads = 1; threads <= max_threads; threads *= 2) {
+            auto start = clock_type::now();
+            HashAggregator<int, long> agg(threads);
+            agg.consume(rows.begin(), rows.end());
+            agg.finish();
+            size_t result = std::chrono::duration_cast<ns>(clock_type::now() - start).count();
+            EXPECT_TRUE(agg.size() <= cardinality);
+            std::cout << "groups " << std::setw(8) << cardinality
+                      << " | HashAggregator T=" << std::setw(3) << threads
+                      << " | " << std::setw(13) << print_with_commas(result) << '\n';
+        }
+    }
+}
+
+void benchmark_hash_join() {
+    std::cout << "Task: inner join N probe rows against N build rows (half match), measured in ns." << '\n';
+    std::vector<size_t> sizes{10000, 100000, 1000000};
+    for (size_t size : sizes) {
+        std::vector<std::pair<int, int>> build;
+        std::vector<int> probe;
+        for (size_t i = 0; i < size; i++) {
+            build.push_back({int(2 * i), int(i)});
+            probe.push_back(int(i));
+        }
+        auto rng = std::default_random_engine {};
+        std::shuffle(build.begin(), build.end(), rng);
+        std::shuffle(probe.begin(), probe.end(), rng);
+
+        size_t find_result, join_result;
+        long find_sum = 0, join_sum = 0;
+        {
+            HashMap<int, int> map(build.begin(), build.end(), size);
+            auto start = clock_type::now();
+            for (int key : probe) {
+                auto found = map.find(key);
+                if (found != map.end()) find_sum += found->second;
+            }
+            find_result = std::chrono::duration_cast<ns>(clock_type::now() - start).count();
+        }
+        {
+            auto key_of = [](const std::pair<int, int>& row) { return row.first; };
+            HashJoinTable<int, std::pair<int, int>> table(build.begin(), build.end(), key_of);
+            auto start = clock_type::now();
+            table.probe<JoinMode::Inner>(probe.begin(), probe.end(), [](const int& key) { return key; },
+                [&join_sum](const int&, const std::pair<int, int>& row) { join_sum += row.second; });
+            join_result = std::chrono::duration_cast<ns>(clock_type::now() - start).count();
+        }
+        EXPECT_EQ(find_sum, join_sum);
+        std::cout << "size "  << std::setw(10) << size;
+        std::cout << " | HashMap::find per row: " << std::setw(13) << print_with_commas(find_result);
+        std::cout << " | HashJoinTable::probe: " << std::setw(13) << print_with_commas(join_result) << '\n';
+    }
+}
+
+void benchmark_compact() {
+    std::cout << "Task: memory and find time of N uint32_t pairs, HashMap vs CompactHashMap." << '\n';
+    std::vector<size_t> sizes{1000, 100000, 1000000};
+
+    for (size_t size : sizes) {
+        std::vector<uint32_t> keys(size);
+        for (size_t i = 0; i < size; i++) keys[i] = static_cast<uint32_t>(i);
+        std::shuffle(keys.begin(), keys.end(), std::default_random_engine {});
+
+        HashMap<uint32_t, uint32_t> map(size);
+        CompactHashMap<uint32_t, uint32_t> compact(size);
+        for (uint32_t key : keys) {
+            map.insert({key, key});
+            compact.insert({key, key});
+        }
+
+        uint64_t sum = 0;
+        auto start = clock_type::now();
+        for (uint32_t key : keys) sum += map.find(key)->second;
+        size_t map_result = std::chrono::duration_cast<ns>(clock_type::now() - start).count();
+
+        start = clock_type::now();
+        for (uint32_t key : keys) sum -= compact.find(key)->second;
+        size_t compact_result = std::chrono::duration_cast<ns>(clock_type::now() - start).count();
+        EXPECT_EQ(sum, 0);
+
+        std::cout << "size " << std::setw(8) << size
+                  << " | HashMap bytes: " << std::setw(12) << print_with_commas(map.memory_usage())
+                  << " | CompactHashMap bytes: " << std::setw(12) << print_with_commas(compact.memory_usage())
+                  << " | find HashMap: " << std::setw(12) << print_with_commas(map_result)
+                  << " | find CompactHashMap: " << std::setw(12) << print_with_commas(compact_result) << '\n';
+    }
+}
+
+void benchmark_page_policy() {
+    std::cout << "Task: N random finds in a map of N ints, default pages vs huge pages, measured in ns." << '\n';
+    std::vector<size_t> sizes{100000, 4000000};
+    PagePolicy huge;
+    huge.huge_pages = PagePolicy::HugePages::Transparent;
+
+    for (size_t size : sizes) {
+        std::vector<int> keys(size);
+        for (size_t i = 0; i < size; i++) keys[i] = static_cast<int>(i);
+        std::shuffle(keys.begin(), keys.end(), std::default_random_engine {});
+
+        for (bool use_huge : {false, true}) {
+            HashMap<int, int> map = use_huge ? HashMap<int, int>(size, DefaultHash<int>(), huge) : HashMap<int, int>(size);
+            for (int key : keys) map.insert({key, key});
+            std::shuffle(keys.begin(), keys.end(), std::default_random_engine {});
+
+            PerfCounters counters;
+            long long sum = 0;
+            counters.start();
+            auto start = clock_type::now();
+            for (int key : keys) sum += map.find(key)->second;
+            size_t result = std::chrono::duration_cast<ns>(clock_type::now() - start).count();
+            counters.stop();
+            EXPECT_EQ(sum, (long long) size * (size - 1) / 2);
+
+            std::cout << "size " << std::setw(8) << size
+                      << " | " << (use_huge ? "huge pages  " : "4 KiB pages ")
+                      << " | find: " << std::setw(13) << print_with_commas(result)
+                      << " | dTLB load misses: " << std::setw(12) << counters.count(PerfCounters::DtlbMisses) << '\n';
+        }
+    }
+}
+
+void benchmark_durable() {
+    std::cout << "Task: N durable writes with group commit every S records, measured in ns." << '\n';
+    const size_t writes = 5000;
+    std::vector<size_t> sync_every{1, 16, 256, 0};
+
+    for (size_t every : sync_every) {
+        char pattern[] = "/tmp/durable_perf_XXXXXX";
+        std::string directory = mkdtemp(pattern);
+        DurableOptions options;
+        options.sync_every = every;
+
+        size_t result;
+        size_t syncs;
+        {
+            DurableHashMap<int, long> map(directory, options, writes);
+            auto start = clock_type::now();
+            for (size_t i = 0; i < writes; i++) map.insert_or_assign(static_cast<int>(i), static_cast<long>(i));
+            map.sync();
+            result = std::chrono::duration_cast<ns>(clock_type::now() - start).count();
+            syncs = map.sync_count();
+        }
+        std::remove((directory + "/wal.log").c_str());
+        rmdir(directory.c_str());
+
+        std::cout << "sync every " << std::setw(4) << (every == 0 ? "end" : std::to_string(every))
+                  << " | fsyncs: " << std::setw(6) << syncs
+                  << " | total: " << std::setw(15) << print_with_commas(result)
+                  << " | writes/s: " << std::setw(12) << print_with_commas(writes * 1000000000ull / std::max<size_t>(result, 1)) << '\n';
+    }
+}
+
+void benchmark_persistent() {
+    std::cout << "Task: N finds and one snapshot of a map of N ints, HashMap vs PersistentHashMap, measured in ns." << '\n';
+    std::vector<size_t> sizes{10000, 1000000};
+
+    for (size_t size : sizes) {
+        std::vector<int> keys(size);
+        for (size_t i = 0; i < size; i++) keys[i] = static_cast<int>(i);
+        std::shuffle(keys.begin(), keys.end(), std::default_random_engine {});
+
+        HashMap<int, int> map(size);
+        PersistentHashMap<int, int> persistent;
+        for (int key : keys) {
+            map.insert({key, key});
+            persistent.insert({key, key});
+        }
+
+        long long sum = 0;
+        auto start = clock_type::now();
+        for (int key : keys) sum += map.find(key)->second;
+        size_t map_find = std::chrono::duration_cast<ns>(clock_type::now() - start).count();
+
+        start = clock_type::now();
+        for (int key : keys) sum -= persistent.find(key)->second;
+        size_t persistent_find = std::chrono::duration_cast<ns>(clock_type::now() - start).count();
+        EXPECT_EQ(sum, 0);
+
+        start = clock_type::now();
+        HashMap<int, int> copy(map);
+        size_t map_copy = std::chrono::duration_cast<ns>(clock_type::now() - start).count();
+
+        start = clock_type::now();
+        auto snapshot = persistent.snapshot();
+        size_t persistent_snapshot = std::chrono::duration_cast<ns>(clock_type::now() - start).count();
+        EXPECT_EQ(copy.size(), snapshot.size());
+
+        std::cout << "size " << std::setw(8) << size
+                  << " | find HashMap: " << std::setw(12) << print_with_commas(map_find)
+                  << " | find PersistentHashMap: " << std::setw(12) << print_with_commas(persistent_find)
+                  << " | HashMap copy: " << std::setw(12) << print_with_commas(map_copy)
+                  << " | snapshot: " << std::setw(8) << print_with_commas(persistent_snapshot) << '\n';
+    }
+}
+void benchmark_bloom_filter() {
+    std::cout << "Task: N lookups in a map of N ints, 95% of them misses, without and with a Bloom filter, measured in ns." << '\n';
+    std::vector<size_t> sizes{10000, 1000000};
+
+    for (size_t size : sizes) {
+        std::vector<int> keys(size);
+        for (size_t i = 0; i < size; i++) keys[i] = static_cast<int>(i);
+        std::shuffle(keys.begin(), keys.end(), std::default_random_engine {});
+        // one probe in 20 hits, the others are keys that were never inserted
+        std::vector<int> probes(size);
+        for (size_t i = 0; i < size; i++) probes[i] = i % 20 == 0 ? keys[i] : static_cast<int>(size + i);
+
+        HashMap<int, int> map(size);
+        for (int key : keys) map.insert({key, key});
+
+        size_t results[2];
+        for (bool use_filter : {false, true}) {
+            if (use_filter) map.enable_bloom_filter();
+            size_t hits = 0;
+            auto start = clock_type::now();
+            for (int probe : probes) hits += map.find(probe) != map.end();
+            results[use_filter] = std::chrono::duration_cast<ns>(clock_type::now() - start).count();
+            EXPECT_EQ(hits, (size + 19) / 20);
+        }
+
+        BlockedBloomFilter filter(size);
+        for (int key : keys) filter.add(std::hash<int>()(key));
+        size_t false_positives = 0;
+        for (size_t i = 0; i < size; i++) false_positives += filter.may_contain(std::hash<int>()(static_cast<int>(size + i)));
+
+        std::cout << "size " << std::setw(8) << size
+                  << " | no filter: " << std::setw(13) << print_with_commas(results[0])
+                  << " | filter: " << std::setw(13) << print_with_commas(results[1])
+                  << " | speedup: " << std::fixed << std::setprecision(2) << std::setw(5) << double(results[0]) / std::max<size_t>(results[1], 1)
+                  << " | false positives: " << std::setprecision(3) << std::setw(6) << 100.0 * false_positives / size << "%"
+                  << " | filter bytes: " << std::setw(11) << print_with_commas(filter.memory_usage()) << '\n';
+        std::cout.unsetf(std::ios_base::floatfield);
+    }
+}
+
+void benchmark_interleaved() {
+    // about 40 bytes per element: the node, its malloc header and its bucket slot
+    long llc_bytes = sysconf(_SC_LEVEL3_CACHE_SIZE);
+    size_t large = std::max<size_t>(1000000, llc_bytes > 0 ? 10 * size_t(llc_bytes) / 40 : 0);
+    std::cout << "Task: 1,000,000 finds (half misses), find vs find_many vs lookup_interleaved, measured in ns."
+              << " Last level cache: " << print_with_commas(std::max(llc_bytes, 0L)) << " bytes." << '\n';
+    std::vector<size_t> sizes{100000, large};
+
+    for (size_t size : sizes) {
+        HashMap<int, int> map(size);
+        for (size_t i = 0; i < size; i++) map.insert({static_cast<int>(i), static_cast<int>(i)});
+        std::vector<int> probes(1000000);
+        std::mt19937 rng(37);
+        for (int& probe : probes) probe = static_cast<int>(rng() % (2 * size));
+
+        long long sum = 0;
+        auto start = clock_type::now();
+        for (int probe : probes) {
+            auto found = map.find(probe);
+            if (found != map.end()) sum += found->second;
+        }
+        size_t find_result = std::chrono::duration_cast<ns>(clock_type::now() - start).count();
+
+        std::vector<HashMap<int, int>::iterator> found;
+        start = clock_type::now();
+        map.find_many(probes, found);
+        for (const auto& iter : found) if (iter != map.end()) sum -= iter->second;
+        size_t batch_result = std::chrono::duration_cast<ns>(clock_type::now() - start).count();
+        EXPECT_EQ(sum, 0);
+
+        start = clock_type::now();
+        map.lookup_interleaved(probes, found);
+        for (const auto& iter : found) if (iter != map.end()) sum += iter->second;
+        size_t interleaved_result = std::chrono::duration_cast<ns>(clock_type::now() - start).count();
+
+        std::cout << "size " << std::setw(10) << print_with_commas(size)
+                  << " | find: " << std::setw(13) << print_with_commas(find_result)
+                  << " | find_many: " << std::setw(13) << print_with_commas(batch_result)
+                  << " | lookup_interleaved: " << std::setw(13) << print_with_commas(interleaved_result) << '\n';
+    }
+}
+
+void benchmark_trivial_nodes() {
+    std::cout << "Task: build, copy and destroy a map of N int pairs, malloc'ed vs pooled nodes, measured in ns." << '\n';
+    std::vector<size_t> sizes{10000, 1000000};
+    PagePolicy pooled;
+    pooled.pooled_nodes = true;
+
+    for (size_t size : sizes) {
+        for (bool use_pool : {false, true}) {
+            auto start = clock_type::now();
+            auto* map = use_pool ? new HashMap<int, int>(size, DefaultHash<int>(), pooled) : new HashMap<int, int>(size);
+            for (size_t i = 0; i < size; i++) map->insert({static_cast<int>(i), static_cast<int>(i)});
+            size_t build = std::chrono::duration_cast<ns>(clock_type::now() - start).count();
+
+            start = clock_type::now();
+            auto* copy = new HashMap<int, int>(*map);
+            size_t copy_result = std::chrono::duration_cast<ns>(clock_type::now() - start).count();
+            EXPECT_EQ(copy->size(), size);
+
+            start = clock_type::now();
+            delete map;
+            delete copy;
+            size_t destroy = std::chrono::duration_cast<ns>(clock_type::now() - start).count() / 2;
+
+            std::cout << "size " << std::setw(8) << size
+                      << " | " << (use_pool ? "pooled " : "malloc ")
+                      << " | build: " << std::setw(13) << print_with_commas(build)
+                      << " | copy: " << std::setw(13) << print_with_commas(copy_result)
+                      << " | destroy: " << std::setw(13) << print_with_commas(destroy) << '\n';
+        }
+    }
+}
+
+void benchmark_text() {
+    std::cout << "Task: dump and load a map of N int/double pairs as text, measured in ns." << '\n';
+    std::vector<size_t> sizes{100000, 1000000};
+
+    for (size_t size : sizes) {
+        HashMap<int, double> map(size);
+        for (size_t i = 0; i < size; i++) map.insert({static_cast<int>(i), i / 7.0});
+        char path[] = "/tmp/hashmap_text_perf_XXXXXX";
+        int fd = mkstemp(path);
+
+        auto start = clock_type::now();
+        {
+            std::ofstream out(path);
+            out << map;
+        }
+        size_t print_result = std::chrono::duration_cast<ns>(clock_type::now() - start).count();
+
+        start = clock_type::now();
+        write_text(map, fd);
+        size_t write_result = std::chrono::duration_cast<ns>(clock_type::now() - start).count();
+        close(fd);
+
+        HashMap<int, double> from_stream;
+        start = clock_type::now();
+        {
+            std::ifstream in(path);
+            read_text(from_stream, in);
+        }
+        size_t stream_result = std::chrono::duration_cast<ns>(clock_type::now() - start).count();
+
+        HashMap<int, double> from_file;
+        start = clock_type::now();
+        read_text(from_file, path);
+        size_t mapped_result = std::chrono::duration_cast<ns>(clock_type::now() - start).count();
+        EXPECT_TRUE(from_file == map);
+        EXPECT_EQ(from_stream.size(), size);
+        std::remove(path);
+
+        std::cout << "size " << std::setw(8) << size
+                  << " | operator<<: " << std::setw(13) << print_with_commas(print_result)
+                  << " | write_text: " << std::setw(13) << print_with_commas(write_result)
+                  << " | read_text(istream): " << std::setw(13) << print_with_commas(stream_result)
+                  << " | read_text(path): " << std::setw(13) << print_with_commas(mapped_result) << '\n';
+    }
+}
+
+void benchmark_ttl() {
+    std::cout << "Task: expire N entries with TTLs up to 60 s, sweeping once per simulated second, measured in ns." << '\n';
+    std::vector<size_t> sizes{100000, 1000000};
+    using steady = std::chrono::steady_clock;
+
+    for (size_t size : sizes) {
+        std::mt19937 rng(41);
+        std::vector<std::chrono::milliseconds> ttls(size);
+        for (auto& ttl : ttls) ttl = std::chrono::milliseconds(1 + rng() % 60000);
+
+        // baseline: every sweep scans the whole map for expired entries
+        auto origin = steady::now();
+        HashMap<int, steady::time_point> scanned(size);
+        for (size_t i = 0; i < size; i++) scanned.insert({static_cast<int>(i), origin + ttls[i]});
+        auto start = clock_type::now();
+        size_t scan_reaped = 0;
+        for (int second = 1; second <= 61; second++) {
+            auto now = origin + std::chrono::seconds(second);
+            for (auto it = scanned.begin(); it != scanned.end(); ) {
+                if (it->second <= now) {
+                    it = scanned.erase(it);
+                    scan_reaped++;
+                } else {
+                    ++it;
+                }
+            }
+        }
+        size_t scan_result = std::chrono::duration_cast<ns>(clock_type::now() - start).count();
+
+        TtlHashMap<int, int> wheel(std::chrono::milliseconds(1), size);
+        for (size_t i = 0; i < size; i++) wheel.insert_with_ttl(static_cast<int>(i), 0, ttls[i]);
+        origin = steady::now();
+        start = clock_type::now();
+        size_t wheel_reaped = 0;
+        for (int second = 1; second <= 61; second++) {
+            wheel_reaped += wheel.advance(origin + std::chrono::seconds(second));
+        }
+        size_t wheel_result = std::chrono::duration_cast<ns>(clock_type::now() - start).count();
+        EXPECT_EQ(scan_reaped, size);
+        EXPECT_EQ(wheel_reaped, size);
+
+        std::cout << "size " << std::setw(8) << size
+                  << " | full scan: " << std::setw(15) << print_with_commas(scan_result)
+                  << " | timing wheel: " << std::setw(15) << print_with_commas(wheel_result) << '\n';
+    }
+}
+
+void benchmark_batch_hash() {
+    std::cout << "Task: hash N uint64_t keys and bulk load them into a map, measured in ns (kernel: "
+              << hash_kernel_name(detected_hash_kernel()) << ")." << '\n';
+    std::vector<size_t> sizes{100000, 1000000};
+
+    for (size_t size : sizes) {
+        std::mt19937_64 rng(42);
+        std::vector<uint64_t> keys(size);
+        std::vector<std::pair<uint64_t, int>> rows(size);
+        for (size_t i = 0; i < size; i++) {
+            keys[i] = rng();
+            rows[i] = {keys[i], static_cast<int>(i)};
+        }
+        std::vector<size_t> hashes(size);
+
+        auto start = clock_type::now();
+        MixHash<uint64_t>::hash_batch(keys.data(), size, hashes.data(), HashKernel::Scalar);
+        size_t scalar_result = std::chrono::duration_cast<ns>(clock_type::now() - start).count();
+
+        start = clock_type::now();
+        MixHash<uint64_t>::hash_batch(keys.data(), size, hashes.data());
+        size_t batch_result = std::chrono::duration_cast<ns>(clock_type::now() - start).count();
+
+        start = clock_type::now();
+        Crc32cHash<uint64_t>::hash_batch(keys.data(), size, hashes.data());
+        size_t crc_result = std::chrono::duration_cast<ns>(clock_type::now() - start).count();
+
+        start = clock_type::now();
+        HashMap<uint64_t, int, MixHash<uint64_t>> one_by_one(size);
+        for (const auto& row : rows) one_by_one.insert(row);
+        size_t single_load_result = std::chrono::duration_cast<ns>(clock_type::now() - start).count();
+
+        start = clock_type::now();
+        HashMap<uint64_t, int, MixHash<uint64_t>> batched(rows.begin(), rows.end(), size);
+        size_t batch_load_result = std::chrono::duration_cast<ns>(clock_type::now() - start).count();
+        EXPECT_EQ(batched.size(), one_by_one.size());
+
+        std::cout << "size " << std::setw(8) << size
+                  << " | MixHash scalar: " << std::setw(12) << print_with_commas(scalar_result)
+                  << " | MixHash batch: " << std::setw(12) << print_with_commas(batch_result)
+                  << " | CRC32C batch: " << std::setw(12) << print_with_commas(crc_result)
+                  << " | load one by one: " << std::setw(14) << print_with_commas(single_load_result)
+                  << " | load batched: " << std::setw(14) << print_with_commas(batch_load_result) << '\n';
+    }
+}
+
+void benchmark_read_optimized() {
+    std::cout << "Task: N hits and N misses at load factor 4, before and after optimize_for_reads, measured in ns." << '\n';
+    std::vector<size_t> sizes{100000, 1000000};
+
+    for (size_t size : sizes) {
+        std::mt19937_64 rng(44);
+        std::vector<uint64_t> keys(size), misses(size);
+        for (auto& key : keys) key = rng();
+        for (auto& key : misses) key = rng();
+        HashMap<uint64_t, uint64_t, DefaultHash<uint64_t>> map(size / 4);
+        // interleave with throwaway allocations so the nodes do not start out contiguous
+        std::vector<std::unique_ptr<char[]>> clutter;
+        for (uint64_t key : keys) {
+            map.insert({key, key});
+            clutter.emplace_back(new char[24]);
+        }
+        clutter.clear();
+
+        auto probe = [&](const std::vector<uint64_t>& probes) {
+            size_t found = 0;
+            auto start = clock_type::now();
+            for (uint64_t key : probes) found += map.contains(key);
+            size_t elapsed = std::chrono::duration_cast<ns>(clock_type::now() - start).count();
+            EXPECT_EQ(found, &probes == &keys ? size : 0);
+            return elapsed;
+        };
+        size_t hits_before = probe(keys), misses_before = probe(misses);
+        auto start = clock_type::now();
+        map.optimize_for_reads();
+        size_t optimize_result = std::chrono::duration_cast<ns>(clock_type::now() - start).count();
+        size_t hits_after = probe(keys), misses_after = probe(misses);
+
+        std::cout << "size " << std::setw(8) << size
+                  << " | hits: " << std::setw(13) << print_with_commas(hits_before)
+                  << " -> " << std::setw(13) << print_with_commas(hits_after)
+                  << " | misses: " << std::setw(13) << print_with_commas(misses_before)
+                  << " -> " << std::setw(13) << print_with_commas(misses_after)
+                  << " | optimize_for_reads: " << std::setw(13) << print_with_commas(optimize_result) << '\n';
+    }
+}
+
+constexpr auto kHeaderIds = make_static_hash_map<std::string_view, int>({
+    {"accept", 0}, {"accept-encoding", 1}, {"accept-language", 2}, {"authorization", 3},
+    {"cache-control", 4}, {"connection", 5}, {"content-length", 6}, {"content-type", 7},
+    {"cookie", 8}, {"date", 9}, {"etag", 10}, {"host", 11},
+    {"if-none-match", 12}, {"location", 13}, {"referer", 14}, {"user-agent", 15}
+});
+
+void benchmark_static_table() {
+    std::cout << "Task: build a 16-entry header table and look up N header names, measured in ns." << '\n';
+    std::vector<size_t> sizes{100000, 1000000};
+
+    for (size_t size : sizes) {
+        std::vector<std::string> names;
+        std::mt19937 rng(45);
+        for (size_t i = 0; i < size; i++) {
+            // one name in four is not in the table
+            names.push_back(rng() % 4 == 0 ? "x-request-id" : std::string(kHeaderIds.begin()[rng() % 16].first));
+        }
+
+        auto start = clock_type::now();
+        HashMap<std::string_view, int> dynamic(kHeaderIds.begin(), kHeaderIds.end(), 32);
+        size_t build_result = std::chrono::duration_cast<ns>(clock_type::now() - start).count();
+
+        size_t dynamic_sum = 0, static_sum = 0;
+        start = clock_type::now();
+        for (const auto& name : names) {
+            auto found = dynamic.find(name);
+            dynamic_sum += found == dynamic.end() ? 100 : found->second;
+        }
+        size_t dynamic_result = std::chrono::duration_cast<ns>(clock_type::now() - start).count();
+
+        start = clock_type::now();
+        for (const auto& name : names) {
+            auto found = kHeaderIds.find(name);
+            static_sum += found == kHeaderIds.end() ? 100 : found->second;
+        }
+        size_t static_result = std::chrono::duration_cast<ns>(clock_type::now() - start).count();
+        EXPECT_EQ(dynamic_sum, static_sum);
+
+        std::cout << "size " << std::setw(8) << size
+                  << " | HashMap build: " << std::setw(9) << print_with_commas(build_result)
+                  << " | HashMap lookups: " << std::setw(13) << print_with_commas(dynamic_result)
+                  << " | StaticHashMap build: 0 (compile time)"
+                  << " | StaticHashMap lookups: " << std::setw(13) << print_with_commas(static_result) << '\n';
+    }
+}
+
+/*
+* Runs writers threads of ops_per_writer writes each, plus scanners threads that scan the
+* whole map back to back until the writers are done. Returns the write ops/us, the
+* latency of every write and the number of scans completed.
+*/
+struct IngestionResult {
+    double ops_per_us;
+    LatencyHistogram write_latency;
+    size_t scans;
+};
+
+template<typename Write, typename Scan>
+IngestionResult run_ingestion(size_t writers, size_t ops_per_writer, size_t scanners,
+                              size_t key_space, Write write, Scan scan) {
+    std::atomic<bool> writing{true};
+    std::atomic<size_t> scans{0};
+    std::vector<std::thread> scan_threads;
+    for (size_t t = 0; t < scanners; t++) {
+        scan_threads.emplace_back([&]() {
+            while (writing.load()) {
+                scan();
+                scans++;
+            }
+        });
+    }
+    std::vector<LatencyHistogram> latencies(writers);
+    auto start = clock_type::now();
+    std::vector<std::thread> write_threads;
+    for (size_t t = 0; t < writers; t++) {
+        write_threads.emplace_back([&, t]() {
+            std::default_random_engine rng(t + 1);
+            std::uniform_int_distribution<int> dist(0, key_space - 1);
+            for (size_t i = 0; i < ops_per_writer; i++) {
+                auto write_start = clock_type::now();
+                write(dist(rng), static_cast<int>(i));
+                latencies[t].record(std::chrono::duration_cast<ns>(clock_type::now() - write_start).count());
+            }
+        });
+    }
+    for (auto& thread : write_threads) thread.join();
+    auto end = std::chrono::duration_cast<ns>(clock_type::now() - start);
+    writing = false;
+    for (auto& thread : scan_threads) thread.join();
+
+    IngestionResult result{1000.0 * writers * ops_per_writer / end.count(), LatencyHistogram(), scans.load()};
+    for (const auto& latency : latencies) result.write_latency.merge(latency);
+    return result;
+}
+
+void benchmark_mvcc() {
+    std::cout << "Task: ingestion from 2 writer threads while S threads scan the whole map, "
+              << "measured in write ops/us and write latency (ns)." << '\n';
+    const size_t key_space = 100000;
+    const size_t writers = 2;
+    const size_t ops_per_writer = 300000;
+
+    auto print = [](const std::string& label, const IngestionResult& result) {
+        std::cout << " | " << label << std::fixed << std::setprecision(2) << std::setw(6) << result.ops_per_us
+                  << std::defaultfloat << " ops/us, p99 " << std::setw(7) << print_with_commas(result.write_latency.percentile(99))
+                  << " max " << std::setw(11) << print_with_commas(result.write_latency.max())
+                  << " (" << std::setw(3) << result.scans << " scans)";
+    };
+
+    for (size_t scanners : {0, 1, 2}) {
+        // a HashMap behind a lock that a scan holds throughout (a reader/writer lock would
+        // let back-to-back scans starve the writers completely)
+        HashMap<int, int, DefaultHash<int>> locked_map(key_space);
+        std::mutex lock;
+        auto locked = run_ingestion(writers, ops_per_writer, scanners, key_space,
+            [&](int key, int value) {
+                std::lock_guard<std::mutex> guard(lock);
+                locked_map[key] = value;
+            },
+            [&]() {
+                std::lock_guard<std::mutex> guard(lock);
+                long long sum = 0;
+                for (const auto& [key, value] : locked_map) sum += value;
+                EXPECT_GE(sum, 0);
+            });
+
+        MvccHashMap<int, int, DefaultHash<int>> mvcc_map(key_space);
+        mvcc_map.start_background_gc(std::chrono::milliseconds(5));
+        auto mvcc = run_ingestion(writers, ops_per_writer, scanners, key_space,
+            [&](int key, int value) { mvcc_map.insert_or_assign(key, value); },
+            [&]() {
+                auto snapshot = mvcc_map.snapshot();
+                long long sum = 0;
+                snapshot.for_each([&sum](int, int value) { sum += value; });
+                EXPECT_GE(sum, 0);
+            });
+        mvcc_map.stop_background_gc();
+
+        std::cout << "scanners " << scanners;
+        print("HashMap + mutex: ", locked);
+        print("MvccHashMap: ", mvcc);
+        std::cout << '\n';
+    }
+}
+
+void benchmark_disk() {
+    std::cout << "Task: DiskHashMap with a page cache of 1/4 of the file: insert N, then look up 100,000 keys "
+              << "one by one and in batches of 10,000, measured in ns." << '\n';
+    std::vector<size_t> sizes{250000, 1000000};
+    const size_t lookups = 100000;
+    const size_t batch = 10000;
+
+    for (size_t size : sizes) {
+        char path[] = "/tmp/disk_hashmap_perf_XXXXXX";
+        int fd = mkstemp(path);
+        close(fd);
+        std::remove(path);
+
+        // 4 KB pages hold 255 uint64 pairs; buckets sized for 80% full primary pages
+        DiskOptions options;
+        options.bucket_count = size / 200 + 1;
+        options.cache_pages = std::max<size_t>(2, options.bucket_count / 4);
+        std::mt19937_64 rng(48);
+        std::vector<uint64_t> keys(size);
+        for (auto& key : keys) key = rng();
+
+        DiskHashMap<uint64_t, uint64_t, DefaultHash<uint64_t>> map(path, options);
+        auto start = clock_type::now();
+        for (uint64_t key : keys) map.insert({key, key});
+        map.flush();
+        size_t insert_result = std::chrono::duration_cast<ns>(clock_type::now() - start).count();
+
+        // half hits, half misses
+        std::vector<uint64_t> probes;
+        for (size_t i = 0; i < lookups; i++) probes.push_back(i % 2 == 0 ? keys[rng() % size] : rng());
+
+        map.reset_stats();
+        size_t single_hits = 0;
+        start = clock_type::now();
+        for (uint64_t key : probes) single_hits += map.find(key).has_value();
+        size_t single_result = std::chrono::duration_cast<ns>(clock_type::now() - start).count();
+        size_t single_reads = map.stats().page_reads;
+
+        map.reset_stats();
+        size_t batch_hits = 0;
+        std::vector<uint64_t> group;
+        std::vector<std::optional<uint64_t>> found;
+        start = clock_type::now();
+        for (size_t first = 0; first < probes.size(); first += batch) {
+            group.assign(probes.begin() + first, probes.begin() + std::min(first + batch, probes.size()));
+            map.find_many(group, found);
+            for (const auto& value : found) batch_hits += value.has_value();
+        }
+        size_t batch_result = std::chrono::duration_cast<ns>(clock_type::now() - start).count();
+        size_t batch_reads = map.stats().page_reads;
+        EXPECT_EQ(single_hits, batch_hits);
+
+        std::cout << "size " << std::setw(8) << size << " (" << map.page_count() * 4 / 1024 << " MB file, "
+                  << options.cache_pages * 4 / 1024 << " MB cache)"
+                  << " | insert: " << std::setw(13) << print_with_commas(insert_result)
+                  << " | find: " << std::setw(11) << print_with_commas(single_result)
+                  << " (" << std::setw(6) << single_reads << " page reads)"
+                  << " | find_many: " << std::setw(11) << print_with_commas(batch_result)
+                  << " (" << std::setw(6) << batch_reads << " page reads)" << '\n';
+        std::remove(path);
+    }
+}
+
+void benchmark_extendible() {
+    std::cout << "Task: grow from empty to N elements, timing every insert (including any table growth), "
+              << "then look up every key, measured in ns." << '\n';
+    std::cout << "(HashMap doubles when full; ExtendibleHashMap splits one segment at a time)" << '\n';
+    std::vector<size_t> sizes{100000, 1000000};
+
+    for (size_t size : sizes) {
+        std::vector<uint64_t> keys(size);
+        std::mt19937_64 rng(49);
+        for (auto& key : keys) key = rng();
+
+        auto report = [&](const char* name, const LatencyHistogram& inserts, size_t insert_result,
+                          size_t find_result) {
+            std::cout << "size " << std::setw(8) << size << " | " << std::setw(17) << name
+                      << " | insert: " << std::setw(12) << print_with_commas(insert_result)
+                      << " | p99.9 " << std::setw(7) << print_with_commas(inserts.percentile(99.9))
+                      << " | max " << std::setw(11) << print_with_commas(inserts.max())
+                      << " | find: " << std::setw(11) << print_with_commas(find_result) << '\n';
+        };
+
+        {
+            HashMap<uint64_t, uint64_t, DefaultHash<uint64_t>> map(16);
+            LatencyHistogram inserts;
+            auto start = clock_type::now();
+            for (uint64_t key : keys) {
+                auto op_start = clock_type::now();
+                map.insert({key, key});
+                if (map.size() >= map.bucket_count()) {
+                    map.rehash(2 * map.bucket_count());
+                }
+                inserts.record(std::chrono::duration_cast<ns>(clock_type::now() - op_start).count());
+            }
+            size_t insert_result = std::chrono::duration_cast<ns>(clock_type::now() - start).count();
+            size_t found = 0;
+            start = clock_type::now();
+            for (uint64_t key : keys) found += map.contains(key);
+            size_t find_result = std::chrono::duration_cast<ns>(clock_type::now() - start).count();
+            EXPECT_EQ(found, size);
+            report("HashMap", inserts, insert_result, find_result);
+        }
+        {
+            ExtendibleHashMap<uint64_t, uint64_t, DefaultHash<uint64_t>> map;
+            LatencyHistogram inserts;
+            auto start = clock_type::now();
+            for (uint64_t key : keys) {
+                auto op_start = clock_type::now();
+                map.insert({key, key});
+                inserts.record(std::chrono::duration_cast<ns>(clock_type::now() - op_start).count());
+            }
+            size_t insert_result = std::chrono::duration_cast<ns>(clock_type::now() - start).count();
+            size_t found = 0;
+            start = clock_type::now();
+            for (uint64_t key : keys) found += map.contains(key);
+            size_t find_result = std::chrono::duration_cast<ns>(clock_type::now() - start).count();
+            EXPECT_EQ(found, size);
+            report("ExtendibleHashMap", inserts, insert_result, find_result);
+        }
+    }
+}
+
+void benchmark_sorted_export() {
+    std::cout << "Task: export a HashMap of N elements in key order, measured in ns." << '\n';
+    std::cout << "(baseline: copy into a std::vector and std::sort; sorted_view copies no elements)" << '\n';
+    std::vector<size_t> sizes{100000, 1000000};
+
+    for (size_t size : sizes) {
+        std::mt19937_64 rng(50);
+        HashMap<uint64_t, uint64_t, DefaultHash<uint64_t>> numbers(size);
+        HashMap<std::string, uint64_t, DefaultHash<std::string>> words(size);
+        while (numbers.size() < size) {
+            uint64_t key = rng();
+            numbers.insert({key, key});
+            words.insert({std::to_string(key), key});
+        }
+
+        auto start = clock_type::now();
+        std::vector<std::pair<uint64_t, uint64_t>> copied(numbers.begin(), numbers.end());
+        std::sort(copied.begin(), copied.end());
+        size_t copy_result = std::chrono::duration_cast<ns>(clock_type::now() - start).count();
+
+        start = clock_type::now();
+        auto view = numbers.sorted_view();
+        size_t view_result = std::chrono::duration_cast<ns>(clock_type::now() - start).count();
+
+        start = clock_type::now();
+        auto exported = numbers.to_sorted_vector();
+        size_t vector_result = std::chrono::duration_cast<ns>(clock_type::now() - start).count();
+        EXPECT_TRUE(exported == copied);
+        EXPECT_EQ(view.front().first, copied.front().first);
+
+        start = clock_type::now();
+        std::vector<std::pair<std::string, uint64_t>> copied_words(words.begin(), words.end());
+        std::sort(copied_words.begin(), copied_words.end());
+        size_t copy_words_result = std::chrono::duration_cast<ns>(clock_type::now() - start).count();
+
+        start = clock_type::now();
+        auto word_view = words.sorted_view();
+        size_t view_words_result = std::chrono::duration_cast<ns>(clock_type::now() - start).count();
+        EXPECT_EQ(word_view.back().first, copied_words.back().first);
+
+        std::cout << "size " << std::setw(8) << size
+                  << " | uint64 keys: copy + std::sort " << std::setw(12) << print_with_commas(copy_result)
+                  << " | sorted_view (radix) " << std::setw(12) << print_with_commas(view_result)
+                  << " | to_sorted_vector " << std::setw(12) << print_with_commas(vector_result)
+                  << " | string keys: copy + std::sort " << std::setw(13) << print_with_commas(copy_words_result)
+                  << " | sorted_view (merge) " << std::setw(13) << print_with_commas(view_words_result) << '\n';
+    }
+}
+
+#if RUN_PERF_LATENCY
+void benchmark_latency() {
+    std::cout << "Task: per-operation latency percentiles of a growing HashMap, measured in ns." << '\n';
+    std::cout << "(the table starts with 16 buckets and doubles whenever it is full, like std::unordered_map)" << '\n';
+    std::vector<size_t> sizes{1000, 10000, 100000, 1000000};
+
+    for (size_t size : sizes) {
+        std::vector<int> keys(size);
+        std::iota(keys.begin(), keys.end(), 0);
+        std::shuffle(keys.begin(), keys.end(), std::default_random_engine(46));
+
+        InstrumentedHashMap<int, int, DefaultHash<int>> map(16);
+        for (int key : keys) {
+            map.insert({key, key});
+            if (map.size() >= map.bucket_count()) {
+                map.rehash(2 * map.bucket_count());
+            }
+        }
+        // one miss for every hit
+        for (int key : keys) {
+            map.find(key);
+            map.find(key + static_cast<int>(size));
+        }
+        for (int key : keys) {
+            map.erase(key);
+        }
+
+        for (HashMapOp op : {HashMapOp::Insert, HashMapOp::Find, HashMapOp::Erase, HashMapOp::Rehash}) {
+            const LatencyHistogram& histogram = map.latencies().histogram(op);
+            std::cout << "size " << std::setw(8) << size << " | " << std::setw(6) << hashmap_op_name(op)
+                      << " | count " << std::setw(8) << histogram.count()
+                      << " | p50 " << std::setw(11) << print_with_commas(histogram.percentile(50))
+                      << " | p90 " << std::setw(11) << print_with_commas(histogram.percentile(90))
+                      << " | p99 " << std::setw(11) << print_with_commas(histogram.percentile(99))
+                      << " | p99.9 " << std::setw(11) << print_with_commas(histogram.percentile(99.9))
+                      << " | max " << std::setw(13) << print_with_commas(histogram.max()) << '\n';
+        }
+    }
+}
+#endif
+
 #endif
 
 int main() {
     std::cout << "Performance Test: " << std::endl;
+#if RUN_PERF_COUNTERS
+    if (!PerfCounters().any_available()) {
+        std::cout << "Hardware counters: not available (perf_event_open refused), timings only." << std::endl;
+    }
+#endif
 #if RUN_TEST_PERF
     benchmark_find();
     benchmark_insert_erase();
     benchmark_iterate();
+    benchmark_concurrent_cache();
+    benchmark_aggregate();
+    benchmark_hash_join();
+    benchmark_compact();
+    benchmark_page_policy();
+    benchmark_durable();
+    benchmark_persistent();
+    benchmark_bloom_filter();
+    benchmark_interleaved();
+    benchmark_trivial_nodes();
+    benchmark_text();
+    benchmark_ttl();
+    benchmark_batch_hash();
+    benchmark_read_optimized();
+    benchmark_static_table();
+    benchmark_mvcc();
+    benchmark_disk();
+    benchmark_extendible();
+    benchmark_sorted_export();
+#if RUN_PERF_LATENCY
+    benchmark_latency();
+#endif
 #endif
     return 0;
 }
\ No newline at end of file
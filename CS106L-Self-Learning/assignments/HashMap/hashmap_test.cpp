@@ -1,9 +1,33 @@
 #include <vector>
+#include <thread>
 #include <unordered_map>
+#include <random>
+#include <map>
+#include <numeric>
+#include <set>
+#include <sstream>
+#include <sys/resource.h>
 
 #include "test_settings.h"
 #include "gtest/gtest.h"
 #include "hashmap.h"
+#include "concurrent_cache.h"
+#include "hashset.h"
+#include "hash_multimap.h"
+#include "hash_aggregator.h"
+#include "hash_join.h"
+#include "compact_hashmap.h"
+#include "durable_hashmap.h"
+#include "persistent_hashmap.h"
+#include "hashmap_text.h"
+#include "ttl_hashmap.h"
+#include "hashers.h"
+#include "hash_quality.h"
+#include "static_hashmap.h"
+#include "instrumented_hashmap.h"
+#include "mvcc_hashmap.h"
+#include "disk_hashmap.h"
+#include "extendible_hashmap.h"
 
 // ----------------------------------------------------------------------------------------------
 /* Type Alias and Common Test Utilities */
@@ -545,7 +569,9 @@ TEST(HashMapTest, TEST_1N_ITER_FORWARD_OPERATORS) {
     // It's not like I have anything else to do, right?
 
 
-    HashMap<int, int> map;            // can your iterator traverse normal use case?
+    // the checks below expect keys 1, 2, 3 in that order, which std::hash<int> (the
+    // identity) gives with the default buckets; DefaultHash<int> would scatter them
+    HashMap<int, int, std::hash<int>> map;  // can your iterator traverse normal use case?
     for (const auto& pair : questions) {
         map.insert(pair);
     }
@@ -563,7 +589,7 @@ TEST(HashMapTest, TEST_1N_ITER_FORWARD_OPERATORS) {
     ASSERT_TRUE(iter->second == -2);      // behavior of -> operator as an r-value
 
     // verify correct prefix/postfix behavior (this was very tedious)
-    HashMap<int, int>::iterator iter0 = iter; // just to prove why type aliases are helpful
+    HashMap<int, int, std::hash<int>>::iterator iter0 = iter; // just to prove why type aliases are helpful
     auto iter1 = ++iter;                      // though auto usually works as well
     auto iter2 = ++iter;
     auto iter3 = ++iter;
@@ -1787,3 +1813,2295 @@ TEST(HashMapTest, TEST_4H_MOVE_ASSIGN_TIME) {
     ASSERT_TRUE(3*big_time.count() > huge_time.count());
 }
 #endif
+
+// ----------------------------------------------------------------------------------------------
+/* Extension 6 Test Cases: ConcurrentCache */
+
+#if RUN_TEST_6A
+TEST(ConcurrentCacheTest, TEST_6A_BASIC) {
+    ConcurrentCache<std::string, int> cache(64, 4);
+    ASSERT_EQ(cache.shard_count(), 4);
+    ASSERT_EQ(cache.capacity(), 64);
+    ASSERT_FALSE(cache.get("A").has_value());
+
+    cache.put("A", 3);
+    cache.put("B", 2);
+    cache.put("A", 5);
+    ASSERT_EQ(cache.size(), 2);
+    ASSERT_EQ(cache.get("A"), 5);
+    ASSERT_EQ(cache.get("B"), 2);
+    ASSERT_TRUE(cache.contains("B"));
+
+    ASSERT_TRUE(cache.erase("B"));
+    ASSERT_FALSE(cache.erase("B"));
+    ASSERT_FALSE(cache.contains("B"));
+
+    auto stats = cache.stats();
+    ASSERT_EQ(stats.hits, 2);
+    ASSERT_EQ(stats.misses, 1);
+    ASSERT_EQ(stats.evictions, 0);
+
+    cache.clear();
+    ASSERT_EQ(cache.size(), 0);
+    ASSERT_FALSE(cache.get("A").has_value());
+}
+#endif
+
+#if RUN_TEST_6B
+TEST(ConcurrentCacheTest, TEST_6B_CLOCK_EVICTION) {
+    // a single shard makes the clock order predictable
+    ConcurrentCache<int, int> cache(4, 1);
+    for (int i = 0; i < 4; ++i) cache.put(i, i);
+
+    // referenced entries get a second chance, so 1 is the first unreferenced victim
+    ASSERT_TRUE(cache.get(0).has_value());
+    ASSERT_TRUE(cache.get(2).has_value());
+    ASSERT_TRUE(cache.get(3).has_value());
+    cache.put(4, 4);
+    ASSERT_EQ(cache.size(), 4);
+    ASSERT_FALSE(cache.contains(1));
+    ASSERT_TRUE(cache.contains(0));
+    ASSERT_TRUE(cache.contains(4));
+    ASSERT_EQ(cache.shard_stats(0).evictions, 1);
+
+    // capacity is never exceeded
+    for (int i = 5; i < 100; ++i) cache.put(i, i);
+    ASSERT_EQ(cache.size(), 4);
+    ASSERT_EQ(cache.stats().evictions, 96);
+
+    try {
+        cache.shard_stats(1);
+        ASSERT_TRUE(false);
+    } catch (const std::out_of_range& e) {
+    }
+}
+#endif
+
+#if RUN_TEST_6C
+TEST(ConcurrentCacheTest, TEST_6C_MULTITHREADED) {
+    const int kThreads = 8;
+    const int kOps = 20000;
+    ConcurrentCache<int, int> cache(512, 8);
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; ++t) {
+        threads.emplace_back([&cache, t]() {
+            for (int i = 0; i < kOps; ++i) {
+                int key = (i * 7 + t) % 1024;
+                auto hit = cache.get(key);
+                if (hit.has_value()) {
+                    ASSERT_EQ(*hit, key * 2);
+                } else {
+                    cache.put(key, key * 2);
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) thread.join();
+
+    auto stats = cache.stats();
+    ASSERT_EQ(stats.hits + stats.misses, size_t(kThreads * kOps));
+    ASSERT_LE(cache.size(), cache.capacity());
+}
+#endif
+
+// ----------------------------------------------------------------------------------------------
+/* Extension 7 Test Cases: HashSet and HashMultiMap */
+
+#if RUN_TEST_7A
+TEST(HashSetTest, TEST_7A_BASIC) {
+    std::set<std::string> answer;
+    HashSet<std::string> set;
+    ASSERT_EQ(set.bucket_count(), 10);
+
+    for (const auto& [key, mapped] : vec) {
+        bool inserted = answer.insert(key).second;
+        auto [iter, set_inserted] = set.insert(key);
+        ASSERT_EQ(inserted, set_inserted);
+        ASSERT_EQ(*iter, key);
+    }
+    ASSERT_EQ(set.size(), answer.size());
+    for (const auto& key : answer) ASSERT_TRUE(set.contains(key));
+    ASSERT_EQ(set.count("Not found"), 0);
+    ASSERT_TRUE(set.find("Not found") == set.end());
+
+    set.rehash(3);
+    std::set<std::string> iterated(set.begin(), set.end());
+    ASSERT_TRUE(iterated == answer);
+
+    ASSERT_TRUE(set.erase("A"));
+    ASSERT_FALSE(set.erase("A"));
+    auto next = set.erase(set.find("B"));
+    ASSERT_TRUE(next == set.end() || *next != "B");
+    ASSERT_EQ(set.size(), answer.size() - 2);
+
+    set.clear();
+    ASSERT_TRUE(set.empty());
+    ASSERT_TRUE(set.begin() == set.end());
+
+    // a set node only stores the key
+    ASSERT_LT(sizeof(HashNode<long long>), sizeof(HashNode<std::pair<const long long, bool>>));
+}
+#endif
+
+#if RUN_TEST_7B
+TEST(HashSetTest, TEST_7B_COPY_MOVE) {
+    HashSet<int> set{1, 2, 3, 2, 1};
+    ASSERT_EQ(set.size(), 3);
+
+    HashSet<int> copy = set;
+    ASSERT_TRUE(copy == set);
+    copy.insert(4);
+    ASSERT_TRUE(copy != set);
+
+    HashSet<int> moved = std::move(copy);
+    ASSERT_EQ(moved.size(), 4);
+    ASSERT_TRUE(copy.empty());
+    copy.insert(7);
+    ASSERT_TRUE(copy.contains(7));
+
+    set = moved;
+    ASSERT_TRUE(set == moved);
+    std::stringstream stream;
+    stream << HashSet<int>{5};
+    ASSERT_EQ(stream.str(), "{5}");
+}
+#endif
+
+#if RUN_TEST_7C
+TEST(HashMultiMapTest, TEST_7C_EQUAL_RANGE) {
+    std::unordered_multimap<std::string, int> answer {vec.begin(), vec.end()};
+    HashMultiMap<std::string, int> map {vec.begin(), vec.end()};
+    ASSERT_EQ(map.size(), answer.size());
+
+    for (const auto& key : keys) {
+        ASSERT_EQ(map.count(key), answer.count(key));
+        auto [first, last] = map.equal_range(key);
+        std::multiset<int> values, expected;
+        for (auto iter = first; iter != last; ++iter) {
+            ASSERT_EQ(iter->first, key);
+            values.insert(iter->second);
+        }
+        auto [answer_first, answer_last] = answer.equal_range(key);
+        for (auto iter = answer_first; iter != answer_last; ++iter) expected.insert(iter->second);
+        ASSERT_TRUE(values == expected);
+    }
+
+    // equal keys stay adjacent through a rehash
+    for (size_t buckets : {1, 7, 100}) {
+        map.rehash(buckets);
+        auto [first, last] = map.equal_range("A");
+        ASSERT_EQ(std::distance(first, last), 3);
+    }
+
+    // insert keeps the relative order of equal keys
+    HashMultiMap<int, int> ordered(1);
+    for (int i = 0; i < 5; ++i) ordered.insert({i % 2, i});
+    auto [first, last] = ordered.equal_range(0);
+    std::vector<int> values;
+    for (auto iter = first; iter != last; ++iter) values.push_back(iter->second);
+    ASSERT_EQ(values, std::vector<int>({0, 2, 4}));
+}
+#endif
+
+#if RUN_TEST_7D
+TEST(HashMultiMapTest, TEST_7D_ERASE) {
+    HashMultiMap<std::string, int> map {vec.begin(), vec.end(), 3};
+    ASSERT_EQ(map.erase("A"), 3);
+    ASSERT_EQ(map.erase("A"), 0);
+    ASSERT_FALSE(map.contains("A"));
+    ASSERT_EQ(map.size(), vec.size() - 3);
+
+    // erase by iterator removes exactly one of several equal keys
+    auto [first, last] = map.equal_range("B");
+    ASSERT_EQ(std::distance(first, last), 2);
+    auto next = map.erase(++first);
+    ASSERT_EQ(map.count("B"), 1);
+    ASSERT_TRUE(next == map.end() || next->first != "B");
+
+    size_t remaining = 0;
+    for (__attribute__((unused)) const auto& kv_pair : map) remaining++;
+    ASSERT_EQ(remaining, map.size());
+
+    const auto& cmap = map;
+    ASSERT_TRUE(cmap.find("C") != cmap.end());
+    map.clear();
+    ASSERT_TRUE(map.begin() == map.end());
+}
+#endif
+
+// ----------------------------------------------------------------------------------------------
+/* Extension 8 Test Cases: HashAggregator */
+
+#if RUN_TEST_8A
+TEST(HashAggregatorTest, TEST_8A_SUM) {
+    std::unordered_map<std::string, int> answer;
+    for (const auto& [key, value] : vec) answer[key] += value;
+
+    for (size_t threads : {1, 4}) {
+        // tiny batches so every worker gets some rows
+        HashAggregator<std::string, int> agg(threads, 2);
+        agg.consume(vec.begin(), vec.end());
+        agg.consume(vec.begin(), vec.end());
+        agg.finish();
+
+        ASSERT_EQ(agg.thread_count(), threads);
+        ASSERT_EQ(agg.size(), answer.size());
+        for (const auto& [key, value] : answer) {
+            ASSERT_EQ(agg.at(key), 2 * value);
+        }
+        ASSERT_FALSE(agg.contains("Not found"));
+
+        auto map = agg.to_hashmap();
+        ASSERT_EQ(map.size(), answer.size());
+        ASSERT_EQ(map.at("A"), 2 * answer["A"]);
+    }
+}
+#endif
+
+#if RUN_TEST_8B
+TEST(HashAggregatorTest, TEST_8B_CUSTOM_COMBINE) {
+    auto max_combine = [](const int& lhs, const int& rhs) { return std::max(lhs, rhs); };
+    std::vector<std::pair<int, int>> rows;
+    for (int i = 0; i < 100000; ++i) rows.push_back({i % 1000, i});
+
+    HashAggregator<int, int, std::hash<int>, decltype(max_combine)> agg(4, 512, std::hash<int>(), max_combine);
+    agg.consume(rows.begin(), rows.end());
+    agg.finish();
+
+    ASSERT_EQ(agg.size(), 1000);
+    size_t groups = 0;
+    agg.for_each([&groups](const int& key, const int& value) {
+        ASSERT_EQ(value, 99000 + key);
+        groups++;
+    });
+    ASSERT_EQ(groups, 1000);
+
+    // every key lives in exactly one partition
+    size_t partitioned = 0;
+    for (size_t p = 0; p < agg.partition_count(); ++p) partitioned += agg.partition(p).size();
+    ASSERT_EQ(partitioned, 1000);
+}
+#endif
+
+// ----------------------------------------------------------------------------------------------
+/* Extension 9 Test Cases: HashJoinTable and grace_hash_join */
+
+#if RUN_TEST_9A
+TEST(HashJoinTest, TEST_9A_JOIN_MODES) {
+    // build side: (key, payload) with duplicate keys; probe side: keys
+    std::vector<std::pair<int, int>> build {{1, 10}, {2, 20}, {1, 11}, {3, 30}};
+    std::vector<int> probe {1, 4, 3, 1, 5};
+    auto build_key = [](const std::pair<int, int>& row) { return row.first; };
+    auto probe_key = [](const int& row) { return row; };
+
+    HashJoinTable<int, std::pair<int, int>> table(build.begin(), build.end(), build_key);
+    ASSERT_EQ(table.size(), 4);
+
+    std::multiset<std::pair<int, int>> inner;
+    table.probe<JoinMode::Inner>(probe.begin(), probe.end(), probe_key,
+        [&inner](const int& probe_row, const std::pair<int, int>& build_row) {
+            inner.insert({probe_row, build_row.second});
+        }, 2);
+    std::multiset<std::pair<int, int>> expected_inner {{1, 10}, {1, 11}, {3, 30}, {1, 10}, {1, 11}};
+    ASSERT_TRUE(inner == expected_inner);
+
+    std::vector<int> semi, anti;
+    table.probe<JoinMode::LeftSemi>(probe.begin(), probe.end(), probe_key, join_output(std::back_inserter(semi)));
+    table.probe<JoinMode::LeftAnti>(probe.begin(), probe.end(), probe_key, join_output(std::back_inserter(anti)));
+    ASSERT_EQ(semi, std::vector<int>({1, 3, 1}));
+    ASSERT_EQ(anti, std::vector<int>({4, 5}));
+
+    std::vector<std::pair<int, std::pair<int, int>>> joined;
+    table.probe<JoinMode::Inner>(probe.begin(), probe.begin() + 1, probe_key, join_output(std::back_inserter(joined)));
+    ASSERT_EQ(joined.size(), 2);
+
+    // an input range cannot be counted up front: the buckets grow with the rows instead
+    std::stringstream stream;
+    for (int i = 0; i < 20000; ++i) stream << i << ' ';
+    HashJoinTable<int, int> streamed(std::istream_iterator<int>(stream), std::istream_iterator<int>(), probe_key);
+    ASSERT_EQ(streamed.size(), 20000);
+    ASSERT_GE(streamed.bucket_count(), streamed.size() / 2);
+    std::vector<int> keys {-1, 0, 9999, 19999, 20000};
+    std::vector<int> found;
+    streamed.probe<JoinMode::LeftSemi>(keys.begin(), keys.end(), probe_key, join_output(std::back_inserter(found)));
+    ASSERT_EQ(found, std::vector<int>({0, 9999, 19999}));
+}
+#endif
+
+#if RUN_TEST_9B
+TEST(HashJoinTest, TEST_9B_GRACE_SPILL) {
+    struct Row { int key; int payload; };
+    std::vector<Row> build, probe;
+    for (int i = 0; i < 5000; ++i) build.push_back({i % 2500, i});
+    for (int i = 0; i < 8000; ++i) probe.push_back({i, -i});
+    auto key_of = [](const Row& row) { return row.key; };
+
+    for (JoinMode mode : {JoinMode::Inner, JoinMode::LeftSemi, JoinMode::LeftAnti}) {
+        size_t unlimited = 0, spilled = 0;
+        auto run = [&](size_t budget, size_t& count) {
+            if (mode == JoinMode::Inner) {
+                grace_hash_join<JoinMode::Inner, int>(build.begin(), build.end(), key_of,
+                    probe.begin(), probe.end(), key_of,
+                    [&count](const Row& p, const Row& b) { count += (p.key == b.key); }, budget);
+            } else if (mode == JoinMode::LeftSemi) {
+                grace_hash_join<JoinMode::LeftSemi, int>(build.begin(), build.end(), key_of,
+                    probe.begin(), probe.end(), key_of, [&count](const Row&) { count++; }, budget);
+            } else {
+                grace_hash_join<JoinMode::LeftAnti, int>(build.begin(), build.end(), key_of,
+                    probe.begin(), probe.end(), key_of, [&count](const Row&) { count++; }, budget);
+            }
+        };
+        run(size_t(1) << 30, unlimited);
+        run(4096, spilled);   // forces many partitions
+        ASSERT_EQ(unlimited, spilled);
+        ASSERT_EQ(unlimited, mode == JoinMode::Inner ? 5000u : mode == JoinMode::LeftSemi ? 2500u : 5500u);
+    }
+
+    // rows that cannot be spilled are rejected instead of silently exceeding the budget
+    std::vector<std::pair<std::string, int>> strings {{"A", 1}};
+    auto string_key = [](const std::pair<std::string, int>& row) { return row.first; };
+    ASSERT_THROW((grace_hash_join<JoinMode::Inner, std::string>(strings.begin(), strings.end(), string_key,
+        strings.begin(), strings.end(), string_key, [](const auto&, const auto&) {}, 1)), std::length_error);
+}
+#endif
+
+#if RUN_TEST_9C
+TEST(HashJoinTest, TEST_9C_GRACE_RECURSION_AND_SKEW) {
+    struct Row { int key; int payload; };
+    auto key_of = [](const Row& row) { return row.key; };
+    auto joins = [&](const std::vector<Row>& build, const std::vector<Row>& probe, size_t budget) {
+        std::vector<size_t> counts(3, 0);
+        grace_hash_join<JoinMode::Inner, int>(build.begin(), build.end(), key_of, probe.begin(), probe.end(), key_of,
+            [&](const Row& p, const Row& b) { counts[0] += (p.key == b.key); }, budget);
+        grace_hash_join<JoinMode::LeftSemi, int>(build.begin(), build.end(), key_of, probe.begin(), probe.end(),
+            key_of, [&](const Row&) { counts[1]++; }, budget);
+        grace_hash_join<JoinMode::LeftAnti, int>(build.begin(), build.end(), key_of, probe.begin(), probe.end(),
+            key_of, [&](const Row&) { counts[2]++; }, budget);
+        return counts;
+    };
+
+    // needs thousands of partitions at this budget: the fan-out is capped, and the
+    // partitions that are still too large are split again on the next hash bits
+    std::vector<Row> build, probe;
+    for (int i = 0; i < 40000; ++i) build.push_back({i, i});
+    for (int i = 0; i < 60000; i += 3) probe.push_back({i, -i});
+    auto counts = joins(build, probe, 1024);
+    ASSERT_EQ(counts, joins(build, probe, size_t(1) << 30));
+    ASSERT_EQ(counts, std::vector<size_t>({13334, 13334, 6666}));
+
+    // one key with far more rows than the budget holds: it cannot be partitioned, and is
+    // joined in chunks of the build side
+    std::vector<Row> skewed;
+    for (int i = 0; i < 3000; ++i) skewed.push_back({7, i});
+    for (int i = 0; i < 100; ++i) skewed.push_back({i, i});
+    std::vector<Row> probe_skewed;
+    for (int i = 0; i < 200; ++i) probe_skewed.push_back({i % 10 == 0 ? 7 : i, i});
+    counts = joins(skewed, probe_skewed, 1024);
+    ASSERT_EQ(counts, joins(skewed, probe_skewed, size_t(1) << 30));
+    // 21 probe rows of key 7 (i = 7 and every tenth) match its 3001 build rows, and the
+    // other 89 keys below 100 match one row each
+    ASSERT_EQ(counts, std::vector<size_t>({21 * 3001 + 89, 110, 90}));
+
+    ASSERT_THROW((grace_hash_join<JoinMode::Inner, int>(build.begin(), build.end(), key_of,
+        probe.begin(), probe.end(), key_of, [](const Row&, const Row&) {}, 0)), std::out_of_range);
+}
+#endif
+
+#if RUN_TEST_9D
+TEST(HashJoinTest, TEST_9D_NESTED_PARTITIONS_UNDER_FILE_LIMIT) {
+    struct Row { int key; int payload; };
+    auto key_of = [](const Row& row) { return row.key; };
+    auto joins = [&](const std::vector<Row>& build, const std::vector<Row>& probe, size_t budget) {
+        std::vector<size_t> counts(3, 0);
+        grace_hash_join<JoinMode::Inner, int>(build.begin(), build.end(), key_of, probe.begin(), probe.end(), key_of,
+            [&](const Row& p, const Row& b) { counts[0] += (p.key == b.key); }, budget);
+        grace_hash_join<JoinMode::LeftSemi, int>(build.begin(), build.end(), key_of, probe.begin(), probe.end(),
+            key_of, [&](const Row&) { counts[1]++; }, budget);
+        grace_hash_join<JoinMode::LeftAnti, int>(build.begin(), build.end(), key_of, probe.begin(), probe.end(),
+            key_of, [&](const Row&) { counts[2]++; }, budget);
+        return counts;
+    };
+
+    // the top pass uses the full fan-out, and its first partition holds 6000 more keys, so
+    // it is partitioned again, and so are its own partitions, while all the others are open
+    std::vector<Row> build, probe;
+    for (int i = 0; i < 40000; ++i) build.push_back({i, i});
+    for (int key = 40000, crowded = 0; crowded < 6000; ++key) {
+        if ((mix64(std::hash<int>()(key)) >> 56) != 0) continue;
+        build.push_back({key, key});
+        crowded++;
+    }
+    for (size_t i = 0; i < build.size(); i += 3) probe.push_back({build[i].key, 0});
+    for (int i = 0; i < 1000; ++i) probe.push_back({-1 - i, 0});
+
+    // restores the descriptor limit when the test ends, also on a failed assertion
+    struct FileLimit {
+        rlimit saved;
+        explicit FileLimit(rlim_t limit) {
+            getrlimit(RLIMIT_NOFILE, &saved);
+            rlimit lowered = saved;
+            lowered.rlim_cur = std::min(saved.rlim_cur, limit);
+            setrlimit(RLIMIT_NOFILE, &lowered);
+        }
+        ~FileLimit() { setrlimit(RLIMIT_NOFILE, &saved); }
+    };
+    std::vector<size_t> counts;
+    {
+        FileLimit limit(kMaxOpenSpillFiles + 64);
+        counts = joins(build, probe, 1024);
+    }
+    ASSERT_EQ(counts, joins(build, probe, size_t(1) << 30));
+    size_t matches = (build.size() + 2) / 3;
+    ASSERT_EQ(counts, std::vector<size_t>({matches, matches, 1000}));
+}
+#endif
+
+// ----------------------------------------------------------------------------------------------
+/* Extension 10 Test Cases: CompactHashMap */
+
+#if RUN_TEST_10A
+TEST(CompactHashMapTest, TEST_10A_BASIC) {
+    CompactHashMap<std::string, int> map;
+    std::unordered_map<std::string, int> answer;
+    for (const auto& kv_pair : vec) {
+        ASSERT_EQ(map.insert(kv_pair).second, answer.insert(kv_pair).second);
+        CHECK_MAP_EQUAL(map, answer);
+    }
+    map["Z"] = 26;
+    answer["Z"] = 26;
+    map.at("A")++;
+    answer.at("A")++;
+    CHECK_MAP_EQUAL(map, answer);
+    ASSERT_THROW(map.at("Not found"), std::out_of_range);
+
+    // randomized inserts and erases, which keep moving the last pool slot into holes
+    std::mt19937 rng(7);
+    CompactHashMap<int, int> ints(7);
+    std::unordered_map<int, int> int_answer;
+    for (int i = 0; i < 20000; ++i) {
+        int key = rng() % 500;
+        if (rng() % 3 == 0) {
+            ASSERT_EQ(ints.erase(key), int_answer.erase(key) == 1);
+        } else {
+            ints.insert({key, i});
+            int_answer.insert({key, i});
+        }
+    }
+    CHECK_MAP_EQUAL(ints, int_answer);
+    size_t visited = 0;
+    for (const auto& [key, mapped] : ints) {
+        ASSERT_EQ(int_answer.at(key), mapped);
+        visited++;
+    }
+    ASSERT_EQ(visited, int_answer.size());
+}
+#endif
+
+#if RUN_TEST_10B
+TEST(CompactHashMapTest, TEST_10B_MEMORY_USAGE) {
+    const size_t n = 100000;
+    HashMap<uint32_t, uint32_t> map(n);
+    CompactHashMap<uint32_t, uint32_t> compact(n);
+    ASSERT_EQ(compact.memory_usage(), sizeof(compact) + n * sizeof(uint32_t));
+
+    for (uint32_t i = 0; i < n; ++i) {
+        map.insert({i, i});
+        compact.insert({i, i});
+    }
+    // 12 bytes per node (8 payload + 4 link) plus pool slack, 4 bytes per bucket
+    ASSERT_EQ(compact.memory_usage(), sizeof(compact) + compact.capacity() * 12 + n * sizeof(uint32_t));
+    ASSERT_LE(compact.capacity(), 2 * n);
+    // HashMap nodes: 8 payload + 8 stored hash + 8 link
+    ASSERT_EQ(map.memory_usage(), sizeof(map) + n * sizeof(void*) + n * 24);
+    ASSERT_LT(compact.memory_usage(), map.memory_usage());
+}
+#endif
+
+#if RUN_TEST_10C
+TEST(CompactHashMapTest, TEST_10C_COPY_MOVE_REHASH) {
+    CompactHashMap<int, std::string> map{{1, "one"}, {2, "two"}, {3, "three"}, {4, "four"}};
+    std::unordered_map<int, std::string> answer{{1, "one"}, {2, "two"}, {3, "three"}, {4, "four"}};
+
+    CompactHashMap<int, std::string> copy = map;
+    CHECK_MAP_EQUAL(copy, answer);
+    copy.erase(1);
+    ASSERT_TRUE(map.contains(1));
+
+    for (size_t buckets : {1, 2, 64}) {
+        map.rehash(buckets);
+        ASSERT_EQ(map.bucket_count(), buckets);
+        CHECK_MAP_EQUAL(map, answer);
+    }
+    ASSERT_THROW(map.rehash(0), std::out_of_range);
+
+    CompactHashMap<int, std::string> moved = std::move(map);
+    CHECK_MAP_EQUAL(moved, answer);
+    ASSERT_TRUE(map.empty());
+    ASSERT_EQ(map.bucket_count(), 0);
+    map.insert({5, "five"});
+    ASSERT_EQ(map.at(5), "five");
+    map = moved;
+    CHECK_MAP_EQUAL(map, answer);
+
+    // erasing while iterating visits every element exactly once
+    std::set<int> erased;
+    for (auto it = map.begin(); it != map.end();) {
+        erased.insert(it->first);
+        it = map.erase(it);
+    }
+    ASSERT_EQ(erased, std::set<int>({1, 2, 3, 4}));
+    ASSERT_TRUE(map.empty());
+
+    std::stringstream stream;
+    stream << CompactHashMap<int, int>{{1, 2}};
+    ASSERT_EQ(stream.str(), "{1:2}");
+}
+#endif
+
+// ----------------------------------------------------------------------------------------------
+/* Extension 11 Test Cases: PagePolicy, PageAllocator and SlabPool */
+
+#if RUN_TEST_11A
+TEST(HashMapTest, TEST_11A_PAGE_POLICY_MAP) {
+    PagePolicy policy;
+    policy.huge_pages = PagePolicy::HugePages::Transparent;
+    policy.numa = PagePolicy::Numa::Interleave;
+    policy.numa_nodes = 1;
+
+    HashMap<int, std::string> map(20000, DefaultHash<int>(), policy);
+    std::unordered_map<int, std::string> answer;
+    ASSERT_TRUE(map.page_policy() == policy);
+    ASSERT_FALSE((HashMap<int, int>().page_policy().enabled()));
+
+    for (int i = 0; i < 50000; ++i) {
+        map.insert({i, std::to_string(i)});
+        answer.insert({i, std::to_string(i)});
+    }
+    for (int i = 0; i < 50000; i += 3) {
+        map.erase(i);
+        answer.erase(i);
+    }
+    // erased nodes are reused by the slab pool
+    for (int i = 50000; i < 55000; ++i) {
+        map.insert({i, std::to_string(i)});
+        answer.insert({i, std::to_string(i)});
+    }
+    CHECK_MAP_EQUAL(map, answer);
+    ASSERT_EQ((map.memory_usage() - sizeof(map) - map.bucket_count() * sizeof(void*)) % kHugePageBytes, 0);
+
+    map.rehash(777);
+    CHECK_MAP_EQUAL(map, answer);
+
+    HashMap<int, std::string> copy = map;
+    ASSERT_TRUE(copy.page_policy() == policy);
+    CHECK_MAP_EQUAL(copy, answer);
+
+    HashMap<int, std::string> moved = std::move(map);
+    ASSERT_TRUE(moved.page_policy() == policy);
+    CHECK_MAP_EQUAL(moved, answer);
+    map.insert({-1, "-1"});
+    ASSERT_EQ(map.at(-1), "-1");
+
+    // clear keeps the slabs mapped for the next inserts
+    size_t before_clear = moved.memory_usage();
+    moved.clear();
+    ASSERT_EQ(moved.memory_usage(), before_clear);
+    moved.insert({1, "1"});
+    ASSERT_EQ(moved.at(1), "1");
+}
+#endif
+
+#if RUN_TEST_11B
+TEST(HashMapTest, TEST_11B_PAGE_ALLOCATOR) {
+    PagePolicy policy;
+    policy.huge_pages = PagePolicy::HugePages::Explicit;   // falls back if no huge pages are reserved
+
+    // large arrays are mapped on page boundaries, small ones come from operator new
+    std::vector<long, PageAllocator<long>> large(1 << 20, 7, PageAllocator<long>(policy));
+    ASSERT_EQ(reinterpret_cast<uintptr_t>(large.data()) % 4096, 0);
+    ASSERT_EQ(std::count(large.begin(), large.end(), 7), 1 << 20);
+    std::vector<long, PageAllocator<long>> small(4, 1, PageAllocator<long>(policy));
+    ASSERT_EQ(small[3], 1);
+    ASSERT_TRUE(large.get_allocator() == small.get_allocator());
+    ASSERT_TRUE(large.get_allocator() != PageAllocator<long>());
+
+    struct Node { long value[3]; };
+    SlabPool<Node> pool(policy);
+    std::set<void*> slots;
+    for (int i = 0; i < 1000; ++i) slots.insert(pool.allocate());
+    ASSERT_EQ(slots.size(), 1000);
+    ASSERT_EQ(pool.bytes(), kHugePageBytes);
+    void* freed = *slots.begin();
+    pool.deallocate(freed);
+    ASSERT_EQ(pool.allocate(), freed);
+    pool.release_all();
+    ASSERT_EQ(pool.bytes(), 0);
+}
+#endif
+
+// ----------------------------------------------------------------------------------------------
+/* Extension 12 Test Cases: DurableHashMap */
+
+#if RUN_TEST_12A || RUN_TEST_12B
+// a fresh directory under /tmp for one test, removed again at the end of the test
+struct TempDirectory {
+    std::string path;
+    TempDirectory() {
+        char pattern[] = "/tmp/durable_hashmap_XXXXXX";
+        path = mkdtemp(pattern);
+    }
+    ~TempDirectory() {
+        for (const char* name : {"wal.log", "snapshot.bin", "snapshot.tmp"}) {
+            std::remove((path + "/" + name).c_str());
+        }
+        rmdir(path.c_str());
+    }
+};
+#endif
+
+#if RUN_TEST_12A
+TEST(DurableHashMapTest, TEST_12A_RECOVERY) {
+    TempDirectory dir;
+    std::unordered_map<std::string, int> answer;
+    size_t records = 0;
+    {
+        DurableHashMap<std::string, int> map(dir.path);
+        ASSERT_TRUE(map.empty());
+        for (const auto& kv_pair : vec) {
+            records += map.insert(kv_pair);
+            answer.insert(kv_pair);
+        }
+        map.insert_or_assign("A", 100);
+        answer["A"] = 100;
+        records += map.erase("B") + 1;
+        answer.erase("B");
+    }
+    {
+        // the log alone
+        DurableHashMap<std::string, int> map(dir.path);
+        CHECK_MAP_EQUAL(map.map(), answer);
+        ASSERT_EQ(map.log_records(), records);
+
+        // snapshot plus log tail
+        map.checkpoint();
+        ASSERT_EQ(map.log_records(), 0);
+        map.insert_or_assign("C", -3);
+        answer["C"] = -3;
+
+        // updates that leave the map as it is write no record
+        map.insert_or_assign("C", -3);
+        ASSERT_FALSE(map.insert({"C", 4}));
+        ASSERT_FALSE(map.erase("Missing"));
+        ASSERT_EQ(map.log_records(), 1);
+    }
+    {
+        DurableHashMap<std::string, int> map(dir.path);
+        CHECK_MAP_EQUAL(map.map(), answer);
+        ASSERT_EQ(map.log_records(), 1);
+        map.insert_or_assign("Torn", 1);
+    }
+
+    // a crash in the middle of the last write leaves a torn record behind
+    std::string log = dir.path + "/wal.log";
+    struct stat info;
+    ASSERT_EQ(stat(log.c_str(), &info), 0);
+    ASSERT_EQ(truncate(log.c_str(), info.st_size - 3), 0);
+    {
+        DurableHashMap<std::string, int> map(dir.path);
+        CHECK_MAP_EQUAL(map.map(), answer);
+        ASSERT_FALSE(map.contains("Torn"));
+        // the torn tail is cut off, so new records are readable again
+        map.clear();
+        map.insert({"After", 1});
+    }
+    {
+        DurableHashMap<std::string, int> map(dir.path);
+        ASSERT_EQ(map.size(), 1);
+        ASSERT_EQ(map.at("After"), 1);
+        size_t records = map.log_records();
+        map.clear();
+        map.clear();
+        ASSERT_EQ(map.log_records(), records + 1);
+    }
+}
+#endif
+
+#if RUN_TEST_12B
+TEST(DurableHashMapTest, TEST_12B_GROUP_COMMIT) {
+    TempDirectory dir;
+    DurableOptions options;
+    options.sync_every = 8;
+    options.checkpoint_every = 100;
+    {
+        DurableHashMap<int, double> map(dir.path, options);
+        for (int i = 0; i < 20; ++i) map.insert({i, i / 2.0});
+        ASSERT_EQ(map.sync_count(), 2);
+        map.sync();
+        ASSERT_EQ(map.sync_count(), 3);
+        map.sync();
+        ASSERT_EQ(map.sync_count(), 3);
+
+        // unchanged updates are not logged
+        ASSERT_FALSE(map.insert({0, 5.0}));
+        ASSERT_FALSE(map.erase(1000));
+        ASSERT_EQ(map.log_records(), 20);
+
+        for (int i = 20; i < 250; ++i) map.insert({i, i / 2.0});
+        ASSERT_EQ(map.log_records(), 50);
+    }
+    DurableHashMap<int, double> map(dir.path, options);
+    ASSERT_EQ(map.size(), 250);
+    for (int i = 0; i < 250; ++i) ASSERT_EQ(map.at(i), i / 2.0);
+}
+#endif
+
+// ----------------------------------------------------------------------------------------------
+/* Extension 13 Test Cases: PersistentHashMap */
+
+#if RUN_TEST_13A
+TEST(PersistentHashMapTest, TEST_13A_BASIC) {
+    PersistentHashMap<std::string, int> map;
+    std::unordered_map<std::string, int> answer;
+    for (const auto& kv_pair : vec) {
+        ASSERT_EQ(map.insert(kv_pair), answer.insert(kv_pair).second);
+    }
+    CHECK_MAP_EQUAL(map, answer);
+    ASSERT_THROW(map.at("Not found"), std::out_of_range);
+    ASSERT_TRUE(map.find("Not found") == map.end());
+
+    // randomized updates, compared with std::unordered_map, including a full iteration
+    std::mt19937 rng(33);
+    PersistentHashMap<int, int> ints;
+    std::unordered_map<int, int> int_answer;
+    for (int i = 0; i < 50000; ++i) {
+        int key = rng() % 5000;
+        switch (rng() % 3) {
+        case 0:
+            ASSERT_EQ(ints.erase(key), int_answer.erase(key) == 1);
+            break;
+        case 1:
+            ints.insert_or_assign(key, i);
+            int_answer[key] = i;
+            break;
+        default:
+            ASSERT_EQ(ints.insert({key, i}), int_answer.insert({key, i}).second);
+        }
+    }
+    CHECK_MAP_EQUAL(ints, int_answer);
+    std::set<int> visited;
+    for (const auto& [key, mapped] : ints) {
+        ASSERT_EQ(int_answer.at(key), mapped);
+        visited.insert(key);
+    }
+    ASSERT_EQ(visited.size(), int_answer.size());
+
+    // an iterator from find continues the walk: every element is reached exactly once
+    // counting from begin() up to it plus from it to end()
+    auto middle = ints.find(int_answer.begin()->first);
+    ASSERT_EQ(middle->first, int_answer.begin()->first);
+    size_t before = std::distance(ints.begin(), middle);
+    size_t after = std::distance(middle, ints.end());
+    ASSERT_EQ(before + after, ints.size());
+
+    ints.clear();
+    ASSERT_TRUE(ints.empty());
+    ASSERT_TRUE(ints.begin() == ints.end());
+}
+#endif
+
+#if RUN_TEST_13B
+TEST(PersistentHashMapTest, TEST_13B_SNAPSHOTS_AND_COLLISIONS) {
+    PersistentHashMap<int, std::string> map{{1, "one"}, {2, "two"}};
+    auto first = map.snapshot();
+    map.insert_or_assign(1, "uno");
+    map.erase(2);
+    map.insert({3, "three"});
+    auto second = map.snapshot();
+    map.clear();
+
+    ASSERT_EQ(first.size(), 2);
+    ASSERT_EQ(first.at(1), "one");
+    ASSERT_EQ(first.at(2), "two");
+    ASSERT_FALSE(first.contains(3));
+    ASSERT_EQ(second.size(), 2);
+    ASSERT_EQ(second.at(1), "uno");
+    ASSERT_FALSE(second.contains(2));
+    ASSERT_TRUE(map.empty());
+
+    // every key hashes to the same value: all of them end up in one collision node
+    auto collide = [](int key) { return size_t(key % 2); };
+    PersistentHashMap<int, int, decltype(collide)> collisions(collide);
+    for (int i = 0; i < 100; ++i) collisions.insert({i, i});
+    auto before_erase = collisions;
+    for (int i = 0; i < 100; i += 2) ASSERT_TRUE(collisions.erase(i));
+    ASSERT_EQ(collisions.size(), 50);
+    ASSERT_EQ(before_erase.size(), 100);
+    for (int i = 0; i < 100; ++i) {
+        ASSERT_EQ(collisions.contains(i), i % 2 == 1);
+        ASSERT_EQ(before_erase.at(i), i);
+    }
+    ASSERT_EQ(std::distance(collisions.begin(), collisions.end()), 50);
+}
+#endif
+
+// ----------------------------------------------------------------------------------------------
+/* Extension 14 Test Cases: Bloom filter front end */
+
+#if RUN_TEST_14A
+TEST(BloomFilterTest, TEST_14A_NO_FALSE_NEGATIVES) {
+    BlockedBloomFilter filter(10000);
+    for (size_t i = 0; i < 10000; ++i) filter.add(std::hash<size_t>()(i));
+    for (size_t i = 0; i < 10000; ++i) ASSERT_TRUE(filter.may_contain(std::hash<size_t>()(i)));
+
+    size_t false_positives = 0;
+    for (size_t i = 10000; i < 110000; ++i) {
+        if (filter.may_contain(std::hash<size_t>()(i))) false_positives++;
+    }
+    // about 0.5% expected at 12 bits per key
+    ASSERT_LT(false_positives, 3000u);
+
+    filter.clear();
+    ASSERT_EQ(filter.keys(), 0);
+    ASSERT_FALSE(filter.may_contain(std::hash<size_t>()(1)));
+    ASSERT_THROW(BlockedBloomFilter(10, 0), std::out_of_range);
+}
+#endif
+
+#if RUN_TEST_14B
+TEST(BloomFilterTest, TEST_14B_HASHMAP_WITH_FILTER) {
+    HashMap<std::string, int> map;
+    map.enable_bloom_filter();
+    ASSERT_TRUE(map.bloom_filter_enabled());
+    std::unordered_map<std::string, int> answer;
+    for (const auto& kv_pair : vec) {
+        ASSERT_EQ(map.insert(kv_pair).second, answer.insert(kv_pair).second);
+    }
+    CHECK_MAP_EQUAL(map, answer);
+    ASSERT_FALSE(map.contains("Not found"));
+    ASSERT_THROW(map.at("Not found"), std::out_of_range);
+
+    // enough inserts and erases to rebuild the filter several times, plus a rehash
+    std::mt19937 rng(34);
+    HashMap<int, int> ints(16);
+    ints.enable_bloom_filter(8);
+    std::unordered_map<int, int> int_answer;
+    for (int i = 0; i < 40000; ++i) {
+        int key = rng() % 4000;
+        if (rng() % 2) {
+            ASSERT_EQ(ints.erase(key), int_answer.erase(key) == 1);
+        } else {
+            ASSERT_EQ(ints.insert({key, i}).second, int_answer.insert({key, i}).second);
+        }
+        if (i == 20000) ints.rehash(1000);
+    }
+    CHECK_MAP_EQUAL(ints, int_answer);
+    for (int key = 0; key < 4000; ++key) {
+        ASSERT_EQ(ints.find(key) == ints.end(), int_answer.count(key) == 0);
+    }
+
+    // copies keep the filter, moves take it along
+    HashMap<int, int> copy = ints;
+    ASSERT_TRUE(copy.bloom_filter_enabled());
+    CHECK_MAP_EQUAL(copy, int_answer);
+    HashMap<int, int> moved = std::move(copy);
+    ASSERT_TRUE(moved.bloom_filter_enabled());
+    ASSERT_FALSE(copy.bloom_filter_enabled());
+    CHECK_MAP_EQUAL(moved, int_answer);
+
+    moved.clear();
+    ASSERT_FALSE(moved.contains(int_answer.begin()->first));
+    moved.insert({1, 1});
+    ASSERT_TRUE(moved.contains(1));
+    moved.disable_bloom_filter();
+    ASSERT_FALSE(moved.bloom_filter_enabled());
+    ASSERT_TRUE(moved.contains(1));
+}
+#endif
+
+#if RUN_TEST_14C
+TEST(BloomFilterTest, TEST_14C_SCALAR_AND_AVX2_AGREE) {
+    // on a CPU without AVX2 both calls run the scalar loop and the test is trivially true
+    std::cout << "Bloom filter kernel: " << hash_kernel_name(detected_hash_kernel()) << '\n';
+    std::mt19937_64 rng(34);
+    for (size_t bits_per_key : {1, 4, 12}) {
+        BlockedBloomFilter filter(5000, bits_per_key);
+        std::vector<size_t> added;
+        for (int i = 0; i < 5000; ++i) {
+            added.push_back(rng());
+            filter.add(added.back());
+        }
+        for (size_t hash : added) {
+            ASSERT_TRUE(filter.may_contain(hash, HashKernel::Scalar));
+            ASSERT_TRUE(filter.may_contain(hash, HashKernel::Avx2));
+        }
+        // absent hashes, with answers of both kinds at one bit per key
+        size_t positives = 0;
+        for (int i = 0; i < 20000; ++i) {
+            size_t hash = rng();
+            bool scalar = filter.may_contain(hash, HashKernel::Scalar);
+            ASSERT_EQ(scalar, filter.may_contain(hash, HashKernel::Avx2)) << hash;
+            ASSERT_EQ(scalar, filter.may_contain(hash));
+            positives += scalar;
+        }
+        ASSERT_LT(positives, 20000u);
+        if (bits_per_key == 1) {
+            ASSERT_GT(positives, 0u);
+        }
+    }
+}
+#endif
+
+// ----------------------------------------------------------------------------------------------
+/* Extension 15 Test Cases: reserve and shrink_to_fit */
+
+#if RUN_TEST_15A
+TEST(HashMapTest, TEST_15A_RESERVE_SHRINK) {
+    HashMap<int, int> map;
+    ASSERT_EQ(map.max_load_factor(), 1.0f);
+    map.reserve(5);
+    ASSERT_EQ(map.bucket_count(), 10);
+    map.reserve(1000);
+    ASSERT_EQ(map.bucket_count(), 1000);
+    std::unordered_map<int, int> answer;
+    for (int i = 0; i < 1000; ++i) {
+        map.insert({i, i});
+        answer.insert({i, i});
+    }
+    ASSERT_LE(map.load_factor(), map.max_load_factor());
+
+    for (int i = 0; i < 900; ++i) {
+        map.erase(i);
+        answer.erase(i);
+    }
+    map.shrink_to_fit();
+    ASSERT_EQ(map.bucket_count(), 100);
+    CHECK_MAP_EQUAL(map, answer);
+    map.clear();
+    map.shrink_to_fit();
+    ASSERT_EQ(map.bucket_count(), 10);
+    map.shrink_to_fit();
+    ASSERT_EQ(map.bucket_count(), 10);
+
+    // forward ranges and initializer lists are measured
+    std::vector<std::pair<int, int>> pairs;
+    for (int i = 0; i < 500; ++i) pairs.push_back({i, i});
+    HashMap<int, int> from_vector(pairs.begin(), pairs.end());
+    ASSERT_EQ(from_vector.bucket_count(), 500);
+    HashMap<int, int> explicit_buckets(pairs.begin(), pairs.end(), 2000);
+    ASSERT_EQ(explicit_buckets.bucket_count(), 2000);
+    HashMap<int, int> from_list{{1, 1}, {2, 2}, {3, 3}};
+    ASSERT_EQ(from_list.bucket_count(), 10);
+    HashMap<std::string, int> from_strings(vec.begin(), vec.end(), 1);
+    ASSERT_EQ(from_strings.bucket_count(), vec.size());
+}
+#endif
+
+// ----------------------------------------------------------------------------------------------
+/* Extension 16 Test Cases: precomputed-hash lookups */
+
+#if RUN_TEST_16A
+TEST(HashMapTest, TEST_16A_PRECOMPUTED_HASH) {
+    HashMap<std::string, int> routes;
+    HashMap<std::string, int> quotas(3);
+    std::unordered_map<std::string, int> answer;
+    for (const auto& kv_pair : vec) {
+        size_t hash = routes.hash_of(kv_pair.first);
+        ASSERT_EQ(hash, DefaultHash<std::string>()(kv_pair.first));
+        auto [iter, inserted] = routes.insert(kv_pair, hash);
+        ASSERT_EQ(inserted, answer.insert(kv_pair).second);
+        ASSERT_EQ(iter->first, kv_pair.first);
+        quotas.insert(kv_pair, hash);
+    }
+    CHECK_MAP_EQUAL(routes, answer);
+    CHECK_MAP_EQUAL(quotas, answer);
+
+    // one hash per key serves both maps, and iterators from find keep working
+    for (const auto& [key, mapped] : answer) {
+        size_t hash = routes.hash_of(key);
+        auto route = routes.find(key, hash);
+        const auto& const_quotas = quotas;
+        auto quota = const_quotas.find(key, hash);
+        ASSERT_EQ(route->second, mapped);
+        ASSERT_EQ(quota->second, mapped);
+        ASSERT_EQ(std::distance(route, routes.end()), std::distance(routes.find(key), routes.end()));
+    }
+    ASSERT_TRUE(routes.find("Not found", routes.hash_of("Not found")) == routes.end());
+
+    for (const auto& [key, mapped] : vec) {
+        size_t hash = routes.hash_of(key);
+        ASSERT_EQ(routes.erase(key, hash), answer.erase(key) == 1);
+        quotas.erase(key, hash);
+    }
+    ASSERT_TRUE(routes.empty());
+    ASSERT_TRUE(quotas.empty());
+
+#ifndef NDEBUG
+    ASSERT_DEATH(routes.find("key", routes.hash_of("key") + 1), "precomputed hash");
+#endif
+}
+#endif
+
+// ----------------------------------------------------------------------------------------------
+/* Extension 17 Test Cases: find_many and lookup_interleaved */
+
+#if RUN_TEST_17A
+TEST(HashMapTest, TEST_17A_BATCHED_LOOKUPS) {
+    // few buckets, so the chains are long and of very different lengths
+    HashMap<int, int> map(7);
+    std::vector<int> keys;
+    for (int i = 0; i < 300; ++i) {
+        if (i % 3 != 0) map.insert({i, i * 2});
+        keys.push_back(i);
+        keys.push_back(1000 + i);
+    }
+    std::vector<HashMap<int, int>::iterator> batched;
+    std::vector<HashMap<int, int>::iterator> interleaved;
+    map.find_many(keys, batched);
+    ASSERT_EQ(batched.size(), keys.size());
+    for (size_t group_size : {1, 2, 5, 16, 1000}) {
+        map.lookup_interleaved(keys, interleaved, group_size);
+        ASSERT_EQ(interleaved.size(), keys.size());
+        for (size_t i = 0; i < keys.size(); ++i) {
+            ASSERT_TRUE(interleaved[i] == map.find(keys[i]));
+            ASSERT_TRUE(batched[i] == map.find(keys[i]));
+        }
+    }
+    interleaved[2]->second = -1;
+    ASSERT_EQ(map.at(1), -1);
+    ASSERT_THROW(map.lookup_interleaved(keys, interleaved, 0), std::out_of_range);
+
+    // const overloads, Bloom filter, and no keys at all
+    map.enable_bloom_filter();
+    const auto& cmap = map;
+    std::vector<HashMap<int, int>::const_iterator> const_found;
+    cmap.lookup_interleaved(keys, const_found, 4);
+    for (size_t i = 0; i < keys.size(); ++i) ASSERT_TRUE(const_found[i] == cmap.find(keys[i]));
+    cmap.find_many(keys, const_found);
+    for (size_t i = 0; i < keys.size(); ++i) ASSERT_TRUE(const_found[i] == cmap.find(keys[i]));
+    cmap.lookup_interleaved({}, const_found);
+    ASSERT_TRUE(const_found.empty());
+
+    HashMap<std::string, int> moved_from;
+    HashMap<std::string, int> other = std::move(moved_from);
+    std::vector<HashMap<std::string, int>::iterator> none;
+    moved_from.lookup_interleaved({"a", "b"}, none);
+    ASSERT_EQ(none.size(), 2);
+    ASSERT_TRUE(none[0] == moved_from.end());
+}
+#endif
+
+// ----------------------------------------------------------------------------------------------
+/* Extension 18 Test Cases: slab copy and release for trivially copyable elements */
+
+#if RUN_TEST_18A
+TEST(HashMapTest, TEST_18A_POOLED_TRIVIAL_NODES) {
+    PagePolicy pooled;
+    pooled.pooled_nodes = true;
+    ASSERT_TRUE(pooled.enabled());
+
+    HashMap<int, double> map(101, DefaultHash<int>(), pooled);
+    std::unordered_map<int, double> answer;
+    // more than one slab, and a free list left behind by the erases
+    for (int i = 0; i < 200000; ++i) {
+        map.insert({i, i * 0.5});
+        answer.insert({i, i * 0.5});
+    }
+    for (int i = 0; i < 200000; i += 3) {
+        map.erase(i);
+        answer.erase(i);
+    }
+    map.enable_bloom_filter();
+
+    HashMap<int, double> copy(map);
+    ASSERT_TRUE(copy.page_policy() == pooled);
+    ASSERT_TRUE(copy.bloom_filter_enabled());
+    ASSERT_EQ(copy.memory_usage(), map.memory_usage());
+    CHECK_MAP_EQUAL(copy, answer);
+
+    // the copy reuses its own free slots and slabs, never the original's
+    for (int i = 0; i < 200000; i += 3) copy.insert({i, -1.0});
+    for (int i = 200000; i < 300000; ++i) copy.insert({i, -1.0});
+    for (int i = 1; i < 200000; i += 3) copy.at(i) = -2.0;
+    CHECK_MAP_EQUAL(map, answer);
+    ASSERT_EQ(copy.size(), 300000);
+    ASSERT_EQ(copy.at(0), -1.0);
+    ASSERT_EQ(copy.at(1), -2.0);
+
+    map.clear();
+    ASSERT_TRUE(map.empty());
+    ASSERT_TRUE(map.begin() == map.end());
+    ASSERT_EQ(map.bucket_count(), 101);
+    map.insert({7, 7.0});
+    ASSERT_EQ(map.at(7), 7.0);
+    ASSERT_FALSE(map.contains(8));
+
+    // elements that are not trivially copyable take the per-element path
+    HashMap<std::string, int> strings(10, DefaultHash<std::string>(), pooled);
+    for (const auto& kv_pair : vec) strings.insert(kv_pair);
+    HashMap<std::string, int> string_copy(strings);
+    ASSERT_TRUE(string_copy == strings);
+    string_copy.clear();
+    ASSERT_FALSE(strings.empty());
+}
+#endif
+
+#if RUN_TEST_18B
+TEST(HashMapTest, TEST_18B_CLEAR_KEEPS_SLABS_AND_COPY_ASSIGN) {
+    PagePolicy pooled;
+    pooled.pooled_nodes = true;
+    HashMap<int, int> map(1 << 17, DefaultHash<int>(), pooled);
+
+    // a map cleared and refilled per batch maps its slabs once
+    size_t filled = 0;
+    for (int batch = 0; batch < 5; ++batch) {
+        for (int i = 0; i < 200000; ++i) map.insert({i, batch});
+        if (batch == 0) filled = map.memory_usage();
+        ASSERT_EQ(map.memory_usage(), filled);
+        ASSERT_EQ(map.at(199999), batch);
+        map.clear();
+        ASSERT_EQ(map.memory_usage(), filled);
+    }
+
+    // after a clear, only the slabs in use are copied, and the copy continues from them
+    for (int i = 0; i < 10; ++i) map.insert({i, i});
+    HashMap<int, int> copy(map);
+    ASSERT_LT(copy.memory_usage(), filled);
+    for (int i = 10; i < 200000; ++i) {
+        copy.insert({i, i});
+        map.insert({i, -i});
+    }
+    ASSERT_EQ(map.memory_usage(), filled);
+    ASSERT_EQ(copy.at(5), 5);
+    ASSERT_EQ(copy.at(199999), 199999);
+    ASSERT_EQ(map.at(199999), -199999);
+
+    // copy assignment takes the same slab path and gets map's buckets
+    HashMap<int, int> assigned(7);
+    assigned.insert({-1, -1});
+    assigned = map;
+    ASSERT_EQ(assigned.bucket_count(), map.bucket_count());
+    ASSERT_TRUE(assigned.page_policy() == pooled);
+    ASSERT_EQ(assigned.memory_usage(), map.memory_usage());
+    ASSERT_TRUE(assigned == map);
+    ASSERT_FALSE(assigned.contains(-1));
+    assigned.at(3) = 0;
+    ASSERT_EQ(map.at(3), 3);
+}
+#endif
+
+// ----------------------------------------------------------------------------------------------
+/* Extension 20 Test Cases: write_text and read_text */
+
+#if RUN_TEST_20A
+TEST(HashMapTextTest, TEST_20A_ROUND_TRIP) {
+    // strings through streams
+    HashMap<std::string, int> strings(vec.begin(), vec.end());
+    std::stringstream stream;
+    write_text(strings, stream);
+    HashMap<std::string, int> strings_back;
+    ASSERT_EQ(read_text(strings_back, stream), strings.size());
+    ASSERT_TRUE(strings_back == strings);
+
+    // numbers through a file, parsed with any number of threads
+    HashMap<long long, double> numbers;
+    std::mt19937_64 rng(40);
+    for (int i = 0; i < 20000; ++i) {
+        numbers.insert({static_cast<long long>(rng()) - (1LL << 62), std::ldexp(double(rng() % 1000003), -int(rng() % 40))});
+    }
+    numbers.insert({0, -0.1});
+    char path[] = "/tmp/hashmap_text_XXXXXX";
+    int fd = mkstemp(path);
+    ASSERT_GE(fd, 0);
+    write_text(numbers, fd);
+    close(fd);
+    for (size_t threads : {1, 3, 8, 100000}) {
+        HashMap<long long, double> back;
+        ASSERT_EQ(read_text(back, path, threads), numbers.size());
+        ASSERT_TRUE(back == numbers);
+    }
+
+    // keys already in the map are kept, duplicate lines keep the first value
+    std::stringstream duplicates("1\t10\n\n2\t20\n1\t30");
+    HashMap<int, int> map{{2, 0}};
+    ASSERT_EQ(read_text(map, duplicates), 1);
+    ASSERT_EQ(map.at(1), 10);
+    ASSERT_EQ(map.at(2), 0);
+
+    // malformed input throws and leaves the map alone
+    for (const char* bad : {"1\t2\nnot a number\t3\n", "1 2\n", "1\t2x\n"}) {
+        std::stringstream input(bad);
+        HashMap<int, int> untouched;
+        ASSERT_THROW(read_text(untouched, input), std::runtime_error);
+        ASSERT_TRUE(untouched.empty());
+    }
+    fd = open(path, O_WRONLY | O_TRUNC);
+    ASSERT_EQ(write(fd, "7\t8\n9\n", 6), 6);
+    close(fd);
+    HashMap<int, int> from_bad_file;
+    ASSERT_THROW(read_text(from_bad_file, path, 2), std::runtime_error);
+    ASSERT_TRUE(from_bad_file.empty());
+    std::remove(path);
+    ASSERT_THROW(read_text(from_bad_file, path), std::runtime_error);
+
+    HashMap<std::string, int> tabs{{"a\tb", 1}};
+    std::stringstream ignored;
+    ASSERT_THROW(write_text(tabs, ignored), std::invalid_argument);
+
+    // operator<< streams the same text as before
+    std::stringstream printed;
+    printed << HashMap<int, int>{{1, 2}};
+    ASSERT_EQ(printed.str(), "{1:2}");
+}
+#endif
+
+// ----------------------------------------------------------------------------------------------
+/* Extension 21 Test Cases: TtlHashMap */
+
+// a clock the tests move by hand
+struct ManualClock {
+    using duration = std::chrono::milliseconds;
+    using rep = duration::rep;
+    using period = duration::period;
+    using time_point = std::chrono::time_point<ManualClock>;
+    static constexpr bool is_steady = true;
+    static time_point current;
+    static time_point now() { return current; }
+};
+ManualClock::time_point ManualClock::current;
+
+#if RUN_TEST_21A
+TEST(TtlHashMapTest, TEST_21A_LAZY_EXPIRY_AND_TOUCH) {
+    using std::chrono::milliseconds;
+    ManualClock::current = ManualClock::time_point();
+    TtlHashMap<std::string, int, std::hash<std::string>, ManualClock> map;
+    ASSERT_THROW((TtlHashMap<int, int, std::hash<int>, ManualClock>(milliseconds(0))), std::out_of_range);
+
+    ASSERT_TRUE(map.insert_with_ttl("A", 1, milliseconds(10)));
+    ASSERT_TRUE(map.insert_with_ttl("B", 2, milliseconds(20)));
+    ASSERT_FALSE(map.insert_with_ttl("A", 3, milliseconds(100)));
+    ASSERT_EQ(map.at("A"), 1);
+    ASSERT_EQ(map.expiry("B"), ManualClock::time_point(milliseconds(20)));
+
+    // expired entries vanish on lookup even without advance
+    ManualClock::current += milliseconds(10);
+    ASSERT_FALSE(map.contains("A"));
+    ASSERT_THROW(map.at("A"), std::out_of_range);
+    ASSERT_EQ(map.size(), 1);
+
+    // touch pushes the expiry out, and an expired key can be inserted again
+    ASSERT_TRUE(map.touch("B", milliseconds(50)));
+    ASSERT_FALSE(map.touch("A", milliseconds(50)));
+    ASSERT_TRUE(map.insert_with_ttl("A", 4, milliseconds(5)));
+    ManualClock::current += milliseconds(20);
+    ASSERT_EQ(map.at("B"), 2);
+    ASSERT_FALSE(map.contains("A"));
+    ASSERT_TRUE(map.erase("B"));
+    ASSERT_FALSE(map.erase("B"));
+    ASSERT_TRUE(map.empty());
+
+    ASSERT_TRUE(map.insert_with_ttl("C", 5, milliseconds(0)));
+    ASSERT_FALSE(map.contains("C"));
+    ASSERT_TRUE(map.insert_with_ttl("D", 6, milliseconds(1)));
+    map.clear();
+    ASSERT_TRUE(map.empty());
+    ASSERT_EQ(map.advance(ManualClock::current + milliseconds(10)), 0);
+}
+#endif
+
+#if RUN_TEST_21B
+TEST(TtlHashMapTest, TEST_21B_ADVANCE_MATCHES_EXPIRY) {
+    using std::chrono::milliseconds;
+    ManualClock::current = ManualClock::time_point();
+    TtlHashMap<int, int, std::hash<int>, ManualClock> map;
+    std::map<int, ManualClock::time_point> expiries;
+    std::mt19937 rng(41);
+    // ttls across every level of the wheels, and beyond them
+    const long long ttls[] = {0, 1, 255, 256, 300, 65535, 65536, 70000, 1LL << 24, 1LL << 33};
+    for (int key = 0; key < 3000; ++key) {
+        long long ttl = key < 10 ? ttls[key] : static_cast<long long>(rng() % (1u << (rng() % 26)));
+        ASSERT_TRUE(map.insert_with_ttl(key, key, milliseconds(ttl)));
+        expiries[key] = ManualClock::current + milliseconds(ttl);
+        // a few keys are touched or erased along the way
+        if (key % 7 == 0 && expiries.count(key - 1)) {
+            milliseconds ttl(rng() % 100000);
+            if (map.touch(key - 1, ttl)) {
+                expiries[key - 1] = ManualClock::current + ttl;
+            } else {
+                ASSERT_LE(expiries[key - 1], ManualClock::current);
+                expiries.erase(key - 1);
+            }
+        }
+        if (key % 11 == 0) {
+            map.erase(key / 2);
+            expiries.erase(key / 2);
+        }
+        ManualClock::current += milliseconds(rng() % 5);
+    }
+
+    // advance in uneven steps, some with a batch limit: exactly the entries that are due
+    // get reaped, and the live ones are all still there
+    auto step = milliseconds(1);
+    while (!expiries.empty()) {
+        ManualClock::current += step;
+        size_t due = 0;
+        for (auto it = expiries.begin(); it != expiries.end(); ) {
+            if (it->second <= ManualClock::current) {
+                it = expiries.erase(it);
+                due++;
+            } else {
+                ++it;
+            }
+        }
+        size_t reaped = 0;
+        if (step.count() % 3 == 0) {
+            reaped = map.advance(ManualClock::current, 5);
+            ASSERT_LE(reaped, 5);
+        }
+        reaped += map.advance(ManualClock::current);
+        ASSERT_EQ(reaped, due);
+        ASSERT_EQ(map.size(), expiries.size());
+        for (const auto& [key, expiry] : expiries) ASSERT_EQ(map.at(key), key);
+        step = std::min(step * 3 + milliseconds(rng() % 7), milliseconds(1LL << 32));
+    }
+    ASSERT_TRUE(map.empty());
+}
+#endif
+
+#if RUN_TEST_21C
+TEST(TtlHashMapTest, TEST_21C_INDEX_GROWS_WITH_INSERTS) {
+    using std::chrono::milliseconds;
+    ManualClock::current = ManualClock::time_point();
+    TtlHashMap<int, int, std::hash<int>, ManualClock> map;
+    size_t start_buckets = map.bucket_count();
+    float max_load = HashMap<int, int>().max_load_factor();
+    size_t rehashes = 0;
+    for (int key = 0; key < 20000; ++key) {
+        size_t buckets = map.bucket_count();
+        ASSERT_TRUE(map.insert_with_ttl(key, key, milliseconds(1000 + key)));
+        if (map.bucket_count() != buckets) rehashes++;
+        ASSERT_LE(map.size(), map.bucket_count() * max_load);
+    }
+    ASSERT_GT(map.bucket_count(), start_buckets);
+    // doubling: a logarithmic number of rehashes, not one every few inserts
+    ASSERT_LE(rehashes, 16);
+    for (int key = 0; key < 20000; key += 997) ASSERT_EQ(map.at(key), key);
+    ASSERT_EQ(map.advance(ManualClock::current + milliseconds(30000)), 20000);
+}
+#endif
+
+// ----------------------------------------------------------------------------------------------
+/* Extension 22 Test Cases: batch hashing */
+
+#if RUN_TEST_22A
+TEST(BatchHashTest, TEST_22A_KERNELS_AGREE) {
+    std::mt19937_64 rng(42);
+    std::vector<uint64_t> wide(1003);
+    std::vector<int32_t> narrow(1003);
+    std::vector<std::array<unsigned char, 13>> bytes(1003);
+    for (size_t i = 0; i < wide.size(); ++i) {
+        wide[i] = rng();
+        narrow[i] = static_cast<int32_t>(rng());
+        for (auto& byte : bytes[i]) byte = static_cast<unsigned char>(rng());
+    }
+    // every kernel, whether or not this CPU has it, matches operator() on odd-sized batches
+    std::vector<size_t> out(wide.size());
+    for (HashKernel kernel : {HashKernel::Scalar, HashKernel::Sse42, HashKernel::Avx2}) {
+        for (size_t count : {size_t(0), size_t(1), size_t(7), wide.size()}) {
+            MixHash<uint64_t>::hash_batch(wide.data(), count, out.data(), kernel);
+            for (size_t i = 0; i < count; ++i) ASSERT_EQ(out[i], MixHash<uint64_t>()(wide[i]));
+            MixHash<int32_t>::hash_batch(narrow.data(), count, out.data(), kernel);
+            for (size_t i = 0; i < count; ++i) ASSERT_EQ(out[i], MixHash<int32_t>()(narrow[i]));
+            Crc32cHash<uint32_t>::hash_batch(reinterpret_cast<const uint32_t*>(narrow.data()), count, out.data(), kernel);
+            for (size_t i = 0; i < count; ++i) ASSERT_EQ(out[i], Crc32cHash<uint32_t>()(narrow[i]));
+            FixedBytesHash<13>::hash_batch(bytes.data(), count, out.data(), kernel);
+            for (size_t i = 0; i < count; ++i) ASSERT_EQ(out[i], FixedBytesHash<13>()(bytes[i]));
+        }
+    }
+    // the standard CRC32C check value, on every kernel
+    std::array<unsigned char, 9> check{'1', '2', '3', '4', '5', '6', '7', '8', '9'};
+    for (HashKernel kernel : {HashKernel::Scalar, HashKernel::Sse42}) {
+        size_t hash;
+        FixedBytesHash<9>::hash_batch(&check, 1, &hash, kernel);
+        ASSERT_EQ(hash, 0xe3069283U);
+    }
+    ASSERT_NE(MixHash<uint64_t>()(1), MixHash<uint64_t>()(2));
+    ASSERT_TRUE((HasBatchHash<MixHash<uint64_t>, uint64_t>::value));
+    ASSERT_FALSE((HasBatchHash<std::hash<uint64_t>, uint64_t>::value));
+
+    // maps hashing in batches hold and find the same elements as maps hashing one key at a time
+    std::vector<std::pair<uint64_t, int>> rows;
+    for (size_t i = 0; i < 5000; ++i) rows.push_back({rng() % 4000, static_cast<int>(i)});
+    HashMap<uint64_t, int> expected(rows.begin(), rows.end());
+    HashMap<uint64_t, int, MixHash<uint64_t>> built(rows.begin(), rows.end());
+    HashMap<uint64_t, int, MixHash<uint64_t>> inserted;
+    inserted.insert(rows.begin(), rows.begin() + 10);
+    inserted.insert(rows.begin(), rows.end());
+    ASSERT_EQ(built.size(), expected.size());
+    ASSERT_EQ(inserted.size(), expected.size());
+    for (const auto& [key, mapped] : expected) {
+        ASSERT_EQ(built.at(key), mapped);
+        ASSERT_EQ(inserted.at(key), mapped);
+    }
+    std::vector<uint64_t> probes;
+    for (size_t i = 0; i < 1000; ++i) probes.push_back(rng() % 8000);
+    std::vector<HashMap<uint64_t, int, MixHash<uint64_t>>::iterator> many, interleaved;
+    built.find_many(probes, many);
+    built.lookup_interleaved(probes, interleaved, 5);
+    for (size_t i = 0; i < probes.size(); ++i) {
+        ASSERT_TRUE(many[i] == built.find(probes[i]));
+        ASSERT_TRUE(interleaved[i] == built.find(probes[i]));
+    }
+}
+#endif
+
+// ----------------------------------------------------------------------------------------------
+/* Extension 23 Test Cases: hashers and hash quality analysis */
+
+#if RUN_TEST_23A
+TEST(HashersTest, TEST_23A_MIXING_AND_COMBINING) {
+    // the same string hashes alike whatever its type, and every length up to two blocks differs
+    std::string text = "the quick brown fox jumps over the lazy dog";
+    ASSERT_EQ(StringHash()(text), StringHash()(std::string_view(text)));
+    ASSERT_EQ(StringHash()(text), StringHash()(text.c_str()));
+    ASSERT_EQ(DefaultHash<std::string>()(text), StringHash()(text));
+    std::set<size_t> prefixes;
+    for (size_t length = 0; length <= text.size(); ++length) prefixes.insert(StringHash()(text.substr(0, length)));
+    ASSERT_EQ(prefixes.size(), text.size() + 1);
+    ASSERT_NE(StringHash()(std::string("a\0", 2)), StringHash()(std::string("a")));
+
+    ASSERT_EQ(DefaultHash<double>()(0.0), DefaultHash<double>()(-0.0));
+    ASSERT_NE(DefaultHash<double>()(1.0), DefaultHash<double>()(2.0));
+    ASSERT_EQ(DefaultHash<float>()(1.5f), DefaultHash<double>()(1.5));
+    ASSERT_NE(DefaultHash<int>()(1), DefaultHash<int>()(2));
+
+    // pairs, tuples and structs are order sensitive
+    using Pair = std::pair<int, std::string>;
+    ASSERT_EQ(DefaultHash<Pair>()({1, "a"}), DefaultHash<Pair>()({1, "a"}));
+    ASSERT_NE(DefaultHash<Pair>()({1, "a"}), DefaultHash<Pair>()({1, "b"}));
+    ASSERT_NE((DefaultHash<std::pair<int, int>>()({1, 2})), (DefaultHash<std::pair<int, int>>()({2, 1})));
+    ASSERT_NE((DefaultHash<std::tuple<int, int, int>>()({1, 2, 3})), (DefaultHash<std::tuple<int, int, int>>()({3, 2, 1})));
+    ASSERT_EQ((DefaultHash<std::tuple<int, int, int>>()({1, 2, 3})), hash_fields(1, 2, 3));
+    ASSERT_NE(hash_fields(1, 2), hash_fields(1, 2, 0));
+
+    // DefaultHash is HashMap's default H, so pair keys need no hasher of their own
+    HashMap<std::pair<int, int>, int> grid;
+    for (int x = 0; x < 30; ++x) {
+        for (int y = 0; y < 30; ++y) grid.insert({{x, y}, x * 30 + y});
+    }
+    ASSERT_EQ(grid.size(), 900);
+    ASSERT_EQ(grid.at({7, 11}), 221);
+}
+#endif
+
+#if RUN_TEST_23B
+TEST(HashersTest, TEST_23B_QUALITY_REPORT) {
+    // keys strided by the bucket count all land in bucket 0 with the identity hash
+    std::vector<long long> strided;
+    for (long long i = 0; i < 4096; ++i) strided.push_back(i * 1024);
+    strided.push_back(0);
+    auto identity = analyze_hash_quality(strided, std::hash<long long>(), 1024);
+    ASSERT_EQ(identity.keys, 4096);
+    ASSERT_EQ(identity.distinct_hashes, 4096);
+    ASSERT_EQ(identity.longest_chain, 4096);
+    ASSERT_EQ(identity.chain_lengths[0], 1023);
+    ASSERT_GT(identity.chi_square_z, 1000);
+    // flipping input bit i flips exactly output bit i
+    ASSERT_NEAR(identity.avalanche, 1.0 / 64, 1e-9);
+    ASSERT_DOUBLE_EQ(identity.worst_avalanche_bias, 0.5);
+
+    auto mixed = analyze_hash_quality(strided, DefaultHash<long long>(), 1024);
+    ASSERT_LT(std::abs(mixed.chi_square_z), 4);
+    ASSERT_LT(mixed.longest_chain, 16);
+    ASSERT_NEAR(mixed.mean_probe_length, mixed.expected_probe_length, 0.3);
+    ASSERT_NEAR(mixed.avalanche, 0.5, 0.01);
+    ASSERT_LT(mixed.worst_avalanche_bias, 0.15);
+    double buckets = 0;
+    for (double expected : mixed.expected_chain_lengths) buckets += expected;
+    ASSERT_NEAR(buckets, 1024, 1e-6);
+
+    std::vector<std::string> words;
+    for (int i = 0; i < 3000; ++i) words.push_back("user-" + std::to_string(i));
+    auto strings = analyze_hash_quality(words, DefaultHash<std::string>(), 3000);
+    ASSERT_LT(std::abs(strings.chi_square_z), 4);
+    ASSERT_NEAR(strings.avalanche, 0.5, 0.02);
+
+    std::stringstream printed;
+    printed << mixed;
+    ASSERT_NE(printed.str().find("chi-square"), std::string::npos);
+    ASSERT_THROW(analyze_hash_quality(std::vector<int>{}, std::hash<int>(), 10), std::out_of_range);
+    ASSERT_THROW(analyze_hash_quality(std::vector<int>{1}, std::hash<int>(), 0), std::out_of_range);
+}
+#endif
+
+// ----------------------------------------------------------------------------------------------
+/* Extension 24 Test Cases: sorted chains and optimize_for_reads */
+
+#if RUN_TEST_24A
+TEST(HashMapReadOptimizedTest, TEST_24A_SORTED_CHAINS) {
+    // with one bucket, iteration order is the chain order, and std::hash<int> is the identity
+    // (so keys here are non-negative: a negative key hashes above every positive one)
+    using IdentityMap = HashMap<int, int, std::hash<int>>;
+    auto keys_in_order = [](const auto& map) {
+        std::vector<int> keys;
+        for (const auto& [key, mapped] : map) keys.push_back(key);
+        return keys;
+    };
+    std::vector<int> shuffled(100);
+    std::iota(shuffled.begin(), shuffled.end(), 0);
+    std::shuffle(shuffled.begin(), shuffled.end(), std::mt19937(44));
+
+    IdentityMap map(1);
+    for (int key : shuffled) map.insert({key, -key});
+    ASSERT_FALSE(map.chains_sorted());
+    map.optimize_for_reads();
+    ASSERT_TRUE(map.chains_sorted());
+    std::vector<int> expected(shuffled);
+    std::sort(expected.begin(), expected.end());
+    ASSERT_EQ(keys_in_order(map), expected);
+
+    // inserts keep the order, erases and lookups still work
+    for (int key : {150, 250, 42, 77}) {
+        map.insert({key, -key});
+        expected.push_back(key);
+    }
+    std::sort(expected.begin(), expected.end());
+    expected.erase(std::unique(expected.begin(), expected.end()), expected.end());
+    ASSERT_EQ(keys_in_order(map), expected);
+    ASSERT_TRUE(map.erase(0));
+    ASSERT_TRUE(map.erase(250));
+    ASSERT_FALSE(map.erase(1000));
+    expected.erase(std::find(expected.begin(), expected.end(), 0));
+    expected.pop_back();
+    ASSERT_EQ(keys_in_order(map), expected);
+    ASSERT_FALSE(map.contains(-6));
+    ASSERT_FALSE(map.contains(60000));
+    ASSERT_EQ(map.at(150), -150);
+
+    // rehash sorts too, copies keep the order, and the Bloom filter path inserts in order
+    IdentityMap rehashed(1);
+    for (int key : shuffled) rehashed.insert({key, key});
+    rehashed.rehash(1);
+    ASSERT_TRUE(rehashed.chains_sorted());
+    rehashed.enable_bloom_filter();
+    rehashed.insert({1000, 0});
+    rehashed.insert({500, 0});
+    IdentityMap copy(rehashed);
+    ASSERT_TRUE(copy.chains_sorted());
+    std::vector<int> sorted_keys(shuffled);
+    sorted_keys.push_back(1000);
+    sorted_keys.push_back(500);
+    std::sort(sorted_keys.begin(), sorted_keys.end());
+    ASSERT_EQ(keys_in_order(rehashed), sorted_keys);
+    ASSERT_EQ(keys_in_order(copy), sorted_keys);
+
+    HashMap<int, int> empty;
+    empty.optimize_for_reads();
+    ASSERT_TRUE(empty.empty());
+    empty.insert({1, 1});
+    ASSERT_EQ(empty.at(1), 1);
+}
+#endif
+
+#if RUN_TEST_24B
+TEST(HashMapReadOptimizedTest, TEST_24B_CONTIGUOUS_LAYOUT) {
+    // nodes are laid out in iteration order, one after the other
+    HashMap<int, int> map(1000);
+    std::mt19937 rng(44);
+    for (int i = 0; i < 3000; ++i) map.insert({static_cast<int>(rng() % 100000), i});
+    std::unordered_map<int, int> answer(map.begin(), map.end());
+    map.optimize_for_reads();
+    CHECK_MAP_EQUAL(map, answer);
+    std::vector<const char*> addresses;
+    for (const auto& kv_pair : map) addresses.push_back(reinterpret_cast<const char*>(&kv_pair));
+    ptrdiff_t stride = addresses[1] - addresses[0];
+    ASSERT_GT(stride, 0);
+    for (size_t i = 1; i < addresses.size(); ++i) ASSERT_EQ(addresses[i] - addresses[i - 1], stride);
+
+    // maps with a page policy and with non-trivial elements, before and after more writes
+    PagePolicy pooled;
+    pooled.pooled_nodes = true;
+    HashMap<std::string, int> strings(7, DefaultHash<std::string>(), pooled);
+    std::unordered_map<std::string, int> string_answer;
+    for (const auto& kv_pair : vec) {
+        strings.insert(kv_pair);
+        string_answer.insert(kv_pair);
+    }
+    strings.optimize_for_reads();
+    CHECK_MAP_EQUAL(strings, string_answer);
+    strings.insert({"Zeta", 26});
+    string_answer.insert({"Zeta", 26});
+    strings.erase("Zeta");
+    string_answer.erase("Zeta");
+    strings.optimize_for_reads();
+    CHECK_MAP_EQUAL(strings, string_answer);
+    HashMap<std::string, int> moved(std::move(strings));
+    ASSERT_TRUE(moved.chains_sorted());
+    CHECK_MAP_EQUAL(moved, string_answer);
+}
+#endif
+
+#if RUN_TEST_24D
+// a key that counts how often it is compared
+struct CountedKey {
+    static size_t comparisons;
+    int value = 0;
+    friend bool operator==(const CountedKey& lhs, const CountedKey& rhs) {
+        comparisons++;
+        return lhs.value == rhs.value;
+    }
+};
+size_t CountedKey::comparisons = 0;
+
+struct CountedKeyHash {
+    size_t operator()(const CountedKey& key) const { return DefaultHash<int>()(key.value); }
+};
+
+TEST(HashMapReadOptimizedTest, TEST_24D_INTERLEAVED_LOOKUPS_USE_NODE_HASHES) {
+    // one long chain: every lookup would walk it comparing keys without the node hashes
+    HashMap<CountedKey, int, CountedKeyHash> map(1);
+    std::vector<CountedKey> keys;
+    for (int i = 0; i < 400; ++i) {
+        if (i % 2 == 0) map.insert({CountedKey{i}, i});
+        keys.push_back(CountedKey{i});
+    }
+    std::vector<HashMap<CountedKey, int, CountedKeyHash>::const_iterator> found;
+    const auto& const_map = map;
+
+    // hits compare the key once and misses never, also once sorted chains end misses early
+    for (bool optimized : {false, true}) {
+        if (optimized) map.optimize_for_reads();
+        CountedKey::comparisons = 0;
+        const_map.lookup_interleaved(keys, found, 8);
+        ASSERT_EQ(CountedKey::comparisons, 200);
+        for (size_t i = 0; i < keys.size(); ++i) {
+            ASSERT_EQ(found[i] == const_map.end(), i % 2 == 1);
+            if (i % 2 == 0) {
+                ASSERT_EQ(found[i]->second, static_cast<int>(i));
+            }
+        }
+    }
+}
+#endif
+
+#if RUN_TEST_24C
+TEST(HashMapReadOptimizedTest, TEST_24C_SLABS_GROW_GEOMETRICALLY) {
+    // a pool that starts with one small page doubles its slabs up to a huge page
+    struct Node { long value[3]; };
+    PagePolicy pooled;
+    pooled.pooled_nodes = true;
+    SlabPool<Node> pool(pooled, 4096);
+    const size_t count = 200000;
+    for (size_t i = 0; i < count; ++i) pool.allocate();
+    ASSERT_LE(pool.slab_count(), 12);
+    ASSERT_LE(pool.bytes(), 2 * count * sizeof(Node) + kHugePageBytes);
+    size_t slabs = pool.slab_count();
+    pool.reset();
+    for (size_t i = 0; i < count; ++i) pool.allocate();
+    ASSERT_EQ(pool.slab_count(), slabs);
+
+    // a small map optimized for reads and then grown, then copied slab by slab
+    HashMap<int, int> map;
+    std::unordered_map<int, int> answer;
+    for (int i = 0; i < 20; ++i) {
+        map.insert({i, i});
+        answer.insert({i, i});
+    }
+    map.optimize_for_reads();
+    size_t optimized = map.memory_usage();
+    map.reserve(count);
+    for (int i = 20; i < static_cast<int>(count); ++i) {
+        map.insert({i, -i});
+        answer.insert({i, -i});
+    }
+    CHECK_MAP_EQUAL(map, answer);
+    ASSERT_LE(map.memory_usage() - optimized, map.bucket_count() * sizeof(void*) + 2 * count * 32 + kHugePageBytes);
+    HashMap<int, int> copy(map);
+    CHECK_MAP_EQUAL(copy, answer);
+    copy.insert({-1, 1});
+    ASSERT_EQ(copy.at(-1), 1);
+    ASSERT_FALSE(map.contains(-1));
+}
+#endif
+
+// ----------------------------------------------------------------------------------------------
+/* Extension 25 Test Cases: StaticHashMap */
+
+enum class Opcode { Load, Store, Add, Jump };
+
+constexpr auto kOpcodes = make_static_hash_map<std::string_view, Opcode>({
+    {"load", Opcode::Load}, {"store", Opcode::Store}, {"add", Opcode::Add}, {"jump", Opcode::Jump}
+});
+
+template<size_t... I>
+constexpr auto make_squares(std::index_sequence<I...>) {
+    return std::array<std::pair<int, int>, sizeof...(I)>{{std::pair<int, int>(int(I), int(I * I))...}};
+}
+
+constexpr StaticHashMap<int, int, 200> kSquares(make_squares(std::make_index_sequence<200>()));
+
+// everything below is decided by the compiler
+static_assert(kOpcodes.at("add") == Opcode::Add);
+static_assert(kOpcodes.contains("jump") && !kOpcodes.contains("mul"));
+static_assert(kOpcodes.size() == 4 && kOpcodes.bucket_count() == 8);
+static_assert(kSquares.at(199) == 199 * 199 && kSquares.count(200) == 0);
+static_assert(kSquares.bucket_count() == 512);
+
+#if RUN_TEST_25A
+TEST(StaticHashMapTest, TEST_25A_LOOKUPS) {
+    // the same lookups at run time, with keys the compiler cannot see
+    std::vector<std::string> names{"load", "store", "add", "jump", "mul", ""};
+    for (size_t i = 0; i < names.size(); ++i) {
+        auto found = kOpcodes.find(names[i]);
+        if (i < 4) {
+            ASSERT_NE(found, kOpcodes.end());
+            ASSERT_EQ(found->second, static_cast<Opcode>(i));
+        } else {
+            ASSERT_EQ(found, kOpcodes.end());
+            ASSERT_THROW(kOpcodes.at(names[i]), std::out_of_range);
+        }
+    }
+    // iteration gives the elements in the order they were listed
+    std::vector<std::string_view> order;
+    for (const auto& [name, opcode] : kOpcodes) order.push_back(name);
+    ASSERT_EQ(order, (std::vector<std::string_view>{"load", "store", "add", "jump"}));
+
+    HashMap<int, int> squares;
+    for (const auto& kv_pair : kSquares) squares.insert(kv_pair);
+    ASSERT_EQ(squares.size(), 200);
+    for (int key = -10; key < 300; ++key) {
+        ASSERT_EQ(kSquares.contains(key), squares.contains(key));
+        if (squares.contains(key)) {
+            ASSERT_EQ(kSquares.at(key), squares.at(key));
+        }
+    }
+
+    // a table built at run time behaves the same, and rejects duplicate keys
+    std::pair<int, std::string_view> numbers[] = {{1, "one"}, {2, "two"}, {3, "three"}};
+    auto runtime = make_static_hash_map(numbers);
+    ASSERT_EQ(runtime.at(2), "two");
+    std::pair<int, int> duplicates[] = {{1, 1}, {2, 2}, {1, 3}};
+    ASSERT_THROW((StaticHashMap<int, int, 3>(duplicates)), std::invalid_argument);
+
+    // any constexpr hash works, even a degenerate one that puts everything in one slot
+    struct ZeroHash {
+        constexpr size_t operator()(int) const { return 0; }
+    };
+    constexpr auto colliding = make_static_hash_map({std::pair<int, int>{1, 10}, {2, 20}, {3, 30}}, ZeroHash());
+    static_assert(colliding.at(3) == 30 && !colliding.contains(4));
+}
+#endif
+
+// ----------------------------------------------------------------------------------------------
+/* Extension 26 Test Cases: latency histograms and InstrumentedHashMap */
+
+#if RUN_TEST_26A
+TEST(LatencyHistogramTest, TEST_26A_PERCENTILES_MERGE_AND_EXPORT) {
+    LatencyHistogram empty;
+    ASSERT_EQ(empty.count(), 0u);
+    ASSERT_EQ(empty.percentile(99), 0u);
+    ASSERT_EQ(empty.min(), 0u);
+    ASSERT_THROW(empty.percentile(100.5), std::out_of_range);
+
+    // small values are counted exactly
+    LatencyHistogram small;
+    for (uint64_t value = 1; value <= 60; value++) small.record(value);
+    ASSERT_EQ(small.percentile(50), 30u);
+    ASSERT_EQ(small.percentile(90), 54u);
+    ASSERT_EQ(small.min(), 1u);
+    ASSERT_EQ(small.max(), 60u);
+
+    // larger ones within 1 / kSubBuckets, never below the true percentile nor above max
+    LatencyHistogram histogram;
+    for (uint64_t value = 0; value < 100000; value++) histogram.record(value);
+    ASSERT_EQ(histogram.count(), 100000u);
+    ASSERT_DOUBLE_EQ(histogram.mean(), 49999.5);
+    for (double p : {50.0, 90.0, 99.0, 99.9}) {
+        double exact = p / 100 * 100000 - 1;
+        ASSERT_GE(histogram.percentile(p), exact);
+        ASSERT_LE(histogram.percentile(p), exact * (1 + 1.0 / LatencyHistogram::kSubBuckets));
+    }
+    ASSERT_EQ(histogram.percentile(100), 99999u);
+    ASSERT_EQ(histogram.percentile(0), 0u);
+
+    // one slow outlier shows up at the tail only
+    LatencyHistogram outliers;
+    for (int i = 0; i < 999; i++) outliers.record(50);
+    outliers.record(uint64_t(1) << 40);
+    ASSERT_EQ(outliers.percentile(99.9), 50u);
+    ASSERT_EQ(outliers.percentile(100), uint64_t(1) << 40);
+
+    histogram.merge(outliers);
+    ASSERT_EQ(histogram.count(), 101000u);
+    ASSERT_EQ(histogram.max(), uint64_t(1) << 40);
+    ASSERT_EQ(histogram.min(), 0u);
+    uint64_t bucket_total = 0;
+    histogram.for_each_bucket([&](uint64_t lowest, uint64_t highest, uint64_t count) {
+        ASSERT_LE(lowest, highest);
+        bucket_total += count;
+    });
+    ASSERT_EQ(bucket_total, histogram.count());
+
+    std::ostringstream text, json;
+    small.write_text(text);
+    small.write_json(json);
+    ASSERT_EQ(text.str(), "count 60 mean 30 min 1 p50 30 p90 54 p99 60 p99.9 60 max 60");
+    ASSERT_EQ(json.str().rfind("{\"count\": 60, \"mean\": 30, \"min\": 1, \"p50\": 30, \"p90\": 54, "
+                               "\"p99\": 60, \"p99.9\": 60, \"max\": 60, \"buckets\": [[1, 1], [2, 1]", 0), 0u);
+
+    small.reset();
+    ASSERT_EQ(small.count(), 0u);
+    ASSERT_EQ(small.max(), 0u);
+}
+#endif
+
+#if RUN_TEST_26B
+TEST(InstrumentedHashMapTest, TEST_26B_RECORDS_EACH_OPERATION) {
+    InstrumentedHashMap<std::string, int> map(4);
+    std::map<std::string, int> answer;
+    for (const auto& kv : vec) {
+        map.insert(kv);
+        answer.insert(kv);
+        if (map.size() > map.bucket_count()) {
+            map.rehash(2 * map.bucket_count());
+        }
+    }
+    const auto& latencies = map.latencies();
+    ASSERT_EQ(latencies.histogram(HashMapOp::Insert).count(), vec.size());
+    ASSERT_EQ(latencies.histogram(HashMapOp::Rehash).count(), 1u);
+
+    for (const auto& key : keys) map.find(key);
+    ASSERT_EQ(latencies.histogram(HashMapOp::Find).count(), keys.size());
+    CHECK_MAP_EQUAL(map, answer);
+
+    // a reserve that does not grow the table is not a rehash
+    map.reserve(1);
+    ASSERT_EQ(latencies.histogram(HashMapOp::Rehash).count(), 1u);
+    map.reserve(100);
+    ASSERT_EQ(latencies.histogram(HashMapOp::Rehash).count(), 2u);
+    ASSERT_GE(map.bucket_count(), 100u);
+
+    ASSERT_TRUE(map.erase("A"));
+    ASSERT_FALSE(map.erase("A"));
+    ASSERT_EQ(latencies.histogram(HashMapOp::Erase).count(), 2u);
+    map["Z"] = 26;
+    ASSERT_EQ(latencies.histogram(HashMapOp::Insert).count(), vec.size() + 1);
+    ASSERT_EQ(map.map().at("Z"), 26);
+
+    std::ostringstream json;
+    map.latencies().write_json(json);
+    for (const char* op : {"insert", "find", "erase", "rehash"}) {
+        ASSERT_NE(json.str().find(std::string("\"") + op + "\": {\"count\": "), std::string::npos) << op;
+    }
+    map.latencies().reset();
+    ASSERT_EQ(latencies.histogram(HashMapOp::Insert).count(), 0u);
+
+    // without recording the wrapper is a plain HashMap, in size and behavior
+    static_assert(sizeof(InstrumentedHashMap<std::string, int, std::hash<std::string>, NoLatencyRecording>)
+                  == sizeof(HashMap<std::string, int>));
+    InstrumentedHashMap<std::string, int, std::hash<std::string>, NoLatencyRecording> plain(4);
+    for (const auto& kv : vec) plain.insert(kv);
+    CHECK_MAP_EQUAL(plain, answer);
+}
+#endif
+
+// ----------------------------------------------------------------------------------------------
+/* Extension 27 Test Cases: MvccHashMap */
+
+#if RUN_TEST_27A
+TEST(MvccHashMapTest, TEST_27A_SNAPSHOT_ISOLATION_AND_GC) {
+    ASSERT_THROW((MvccHashMap<int, int>(0)), std::out_of_range);
+    MvccHashMap<std::string, int> map(8);
+    std::map<std::string, int> answer;
+    for (const auto& [key, mapped] : vec) {
+        ASSERT_EQ(map.insert({key, mapped}), answer.insert({key, mapped}).second);
+    }
+    ASSERT_EQ(map.size(), answer.size());
+    ASSERT_EQ(map.version(), answer.size());
+
+    {
+        auto before = map.snapshot();
+        ASSERT_FALSE(map.insert_or_assign("A", 100));
+        ASSERT_TRUE(map.insert_or_assign("New", 1));
+        ASSERT_TRUE(map.erase("B"));
+        ASSERT_FALSE(map.erase("B"));
+        ASSERT_FALSE(map.erase("Not found"));
+        ASSERT_EQ(map.size(), answer.size());
+
+        // the old snapshot still reads the map as it was
+        ASSERT_EQ(before.size(), answer.size());
+        for (const auto& [key, mapped] : answer) {
+            ASSERT_NE(before.find(key), nullptr) << key;
+            ASSERT_EQ(*before.find(key), mapped);
+        }
+        ASSERT_FALSE(before.contains("New"));
+
+        // the latest state has the new writes
+        {
+            auto after = map.snapshot();
+            ASSERT_GT(after.version(), before.version());
+            ASSERT_EQ(*after.find("A"), 100);
+            ASSERT_FALSE(after.contains("B"));
+            std::map<std::string, int> scanned;
+            after.for_each([&](const std::string& key, int mapped) { scanned[key] = mapped; });
+            ASSERT_EQ(scanned.size(), map.size());
+            ASSERT_EQ(scanned["A"], 100);
+        }
+        ASSERT_EQ(map.get("New"), std::optional<int>(1));
+        ASSERT_EQ(map.get("B"), std::nullopt);
+
+        // while before is alive, the overwritten "A" and the erased "B" stay reachable
+        ASSERT_EQ(map.collect_garbage(), 0u);
+        ASSERT_EQ(*before.find("A"), 3);
+        ASSERT_EQ(*before.find("B"), 2);
+    }
+    ASSERT_EQ(map.version_count(), answer.size() + 3);
+
+    // then the old "A" and "B" versions go; "B" is unlinked, but its node and tombstone are
+    // only freed once the snapshots taken before the unlink are released
+    {
+        auto pinning = map.snapshot();
+        ASSERT_EQ(map.collect_garbage(), 2u);
+        ASSERT_FALSE(pinning.contains("B"));
+        ASSERT_EQ(map.collect_garbage(), 0u);
+    }
+    ASSERT_EQ(map.collect_garbage(), 1u);
+    ASSERT_EQ(map.version_count(), map.size());
+    ASSERT_TRUE(map.insert({"B", 7}));
+    ASSERT_EQ(map.get("B"), std::optional<int>(7));
+}
+#endif
+
+#if RUN_TEST_27B
+TEST(MvccHashMapTest, TEST_27B_CONSISTENT_SCANS_UNDER_CONCURRENT_WRITES) {
+    constexpr int kKeys = 1000;
+    constexpr int kRounds = 200;
+    MvccHashMap<int, int> map(kKeys);
+    for (int key = 0; key < kKeys; key++) map.insert({key, 0});
+    map.start_background_gc(std::chrono::milliseconds(1));
+
+    // each writer sets all its keys to round, in key order, round after round
+    std::vector<std::thread> writers;
+    for (int writer = 0; writer < 2; writer++) {
+        writers.emplace_back([&map, writer] {
+            for (int round = 1; round <= kRounds; round++) {
+                for (int key = writer; key < kKeys; key += 2) map.insert_or_assign(key, round);
+            }
+        });
+    }
+    // and a third one keeps inserting and erasing other keys, so nodes get unlinked
+    writers.emplace_back([&map] {
+        for (int round = 0; round < kRounds; round++) {
+            for (int key = kKeys; key < kKeys + 50; key++) map.insert({key, round});
+            for (int key = kKeys; key < kKeys + 50; key++) map.erase(key);
+        }
+    });
+
+    // so a consistent snapshot sees, for each writer, round r on a prefix of its keys and r - 1
+    // on the rest; a torn read would break that, and reading twice must give the same result
+    size_t scans = 0;
+    bool done = false;
+    while (!done) {
+        done = map.get(kKeys - 1) == std::optional<int>(kRounds) && map.get(kKeys - 2) == std::optional<int>(kRounds);
+        auto snapshot = map.snapshot();
+        std::vector<int> values(kKeys, -1);
+        snapshot.for_each([&](int key, int value) {
+            if (key < kKeys) values[key] = value;
+        });
+        for (int writer = 0; writer < 2; writer++) {
+            int first = values[writer];
+            bool dropped = false;
+            for (int key = writer; key < kKeys; key += 2) {
+                ASSERT_TRUE(values[key] == first || (values[key] == first - 1 && first > 0)) << key;
+                if (values[key] != first) dropped = true;
+                if (dropped) {
+                    ASSERT_EQ(values[key], first - 1) << key;
+                }
+                ASSERT_EQ(*snapshot.find(key), values[key]);
+            }
+        }
+        scans++;
+    }
+    for (auto& writer : writers) writer.join();
+    map.stop_background_gc();
+
+    ASSERT_GT(scans, 0u);
+    ASSERT_EQ(map.size(), size_t(kKeys));
+    // the first pass unlinks the erased keys, the second frees them
+    map.collect_garbage();
+    map.collect_garbage();
+    ASSERT_EQ(map.version_count(), size_t(kKeys));
+}
+#endif
+
+// ----------------------------------------------------------------------------------------------
+/* Extension 28 Test Cases: DiskHashMap */
+
+#if RUN_TEST_28A
+TEST(DiskHashMapTest, TEST_28A_OVERFLOW_EVICTION_AND_REOPEN) {
+    char path[] = "/tmp/disk_hashmap_XXXXXX";
+    int fd = mkstemp(path);
+    ASSERT_GE(fd, 0);
+    close(fd);
+    std::remove(path);
+
+    // 128-byte pages of 14 records, 8 buckets and 2 cache pages: long overflow chains,
+    // and almost every page access goes to the file
+    DiskOptions options;
+    options.page_size = 128;
+    options.bucket_count = 8;
+    options.cache_pages = 2;
+    ASSERT_THROW((DiskHashMap<int, int>(path, DiskOptions{128, 8, 1})), std::out_of_range);
+
+    std::unordered_map<int, int> answer;
+    std::mt19937 rng(48);
+    {
+        DiskHashMap<int, int> map(path, options);
+        ASSERT_EQ(map.records_per_page(), 14u);
+        for (int i = 0; i < 2000; i++) {
+            int key = static_cast<int>(rng() % 1500);
+            if (rng() % 4 == 0) {
+                ASSERT_EQ(map.erase(key), answer.erase(key) == 1);
+            } else if (rng() % 2 == 0) {
+                ASSERT_EQ(map.insert({key, i}), answer.insert({key, i}).second);
+            } else {
+                map.insert_or_assign(key, i);
+                answer[key] = i;
+            }
+        }
+        ASSERT_EQ(map.size(), answer.size());
+        ASSERT_GT(map.stats().page_reads, 1000u);
+        for (int key = 0; key < 1500; key++) {
+            auto found = map.find(key);
+            ASSERT_EQ(found.has_value(), answer.count(key) == 1) << key;
+            if (found) {
+                ASSERT_EQ(*found, answer[key]);
+            }
+        }
+        ASSERT_THROW(map.at(-1), std::out_of_range);
+
+        // batched lookups give the same answers, with fewer page reads than one by one
+        std::vector<int> keys;
+        for (int i = 0; i < 3000; i++) keys.push_back(static_cast<int>(rng() % 1600));
+        std::vector<std::optional<int>> found;
+        map.reset_stats();
+        map.find_many(keys, found);
+        size_t batched_reads = map.stats().page_reads;
+        map.reset_stats();
+        for (size_t i = 0; i < keys.size(); i++) {
+            ASSERT_EQ(found[i], map.find(keys[i])) << keys[i];
+        }
+        ASSERT_LT(batched_reads, map.stats().page_reads);
+    }
+
+    // everything is back after reopening, whatever the options now say
+    {
+        DiskHashMap<int, int> map(path, DiskOptions{4096, 1, 4});
+        ASSERT_EQ(map.bucket_count(), 8u);
+        ASSERT_EQ(map.size(), answer.size());
+        std::unordered_map<int, int> scanned;
+        map.for_each([&](int key, int mapped) { ASSERT_TRUE(scanned.insert({key, mapped}).second); });
+        ASSERT_TRUE(scanned == answer);
+
+        // emptied overflow pages are reused before the file grows
+        for (const auto& [key, mapped] : answer) map.erase(key);
+        ASSERT_TRUE(map.empty());
+        size_t pages = map.page_count();
+        for (const auto& [key, mapped] : answer) map.insert({key, -mapped});
+        ASSERT_EQ(map.page_count(), pages);
+        ASSERT_EQ(map.at(answer.begin()->first), -answer.begin()->second);
+    }
+    ASSERT_THROW((DiskHashMap<int, long long>(path)), std::runtime_error);
+    std::remove(path);
+}
+#endif
+
+// ----------------------------------------------------------------------------------------------
+/* Extension 29 Test Cases: ExtendibleHashMap */
+
+#if RUN_TEST_29A
+TEST(ExtendibleHashMapTest, TEST_29A_SPLITS_ONE_SEGMENT_AT_A_TIME) {
+    using Map = ExtendibleHashMap<int, int>;
+    Map map;
+    std::unordered_map<int, int> answer;
+    size_t max_relinked = 0;
+    for (int i = 0; i < 20000; i++) {
+        size_t relinked = map.relinked_nodes();
+        auto [iter, added] = map.insert({i, -i});
+        ASSERT_TRUE(added);
+        ASSERT_EQ(*iter, (std::pair<const int, int>(i, -i)));
+        answer.insert({i, -i});
+        // an insert relinks at most the nodes of the one segment it splits
+        max_relinked = std::max(max_relinked, map.relinked_nodes() - relinked);
+        ASSERT_LE(map.relinked_nodes() - relinked, Map::kSegmentBuckets + 1);
+    }
+    ASSERT_GT(max_relinked, 0u);
+    ASSERT_GT(map.segment_count(), 20000 / Map::kSegmentBuckets);
+    ASSERT_GE(size_t(1) << map.global_depth(), map.segment_count());
+    ASSERT_EQ(map.bucket_count(), map.segment_count() * Map::kSegmentBuckets);
+    ASSERT_LE(map.load_factor(), 1.0f);
+    // growing to N elements relinks each node about once, not once per doubling
+    ASSERT_LT(map.relinked_nodes(), 2u * 20000);
+
+    std::mt19937 rng(49);
+    for (int i = 0; i < 20000; i++) {
+        int key = static_cast<int>(rng() % 30000);
+        if (rng() % 2 == 0) {
+            ASSERT_EQ(map.erase(key), answer.erase(key) == 1);
+        } else {
+            map[key] = i;
+            answer[key] = i;
+        }
+    }
+    ASSERT_EQ(map.size(), answer.size());
+    CHECK_MAP_EQUAL(map, answer);
+    ASSERT_THROW(map.at(-1), std::out_of_range);
+    ASSERT_TRUE(map.find(-1) == map.end());
+
+    std::unordered_map<int, int> scanned;
+    const auto& cmap = map;
+    for (const auto& [key, mapped] : cmap) {
+        ASSERT_TRUE(scanned.insert({key, mapped}).second);
+    }
+    ASSERT_TRUE(scanned == answer);
+
+    // erasing through iterators visits and removes everything exactly once
+    size_t erased = 0;
+    for (auto iter = map.begin(); iter != map.end();) {
+        if (iter->first % 3 == 0) {
+            answer.erase(iter->first);
+            iter = map.erase(iter);
+            erased++;
+        } else {
+            ++iter;
+        }
+    }
+    ASSERT_GT(erased, 0u);
+    ASSERT_EQ(map.size(), answer.size());
+    CHECK_MAP_EQUAL(map, answer);
+}
+#endif
+
+#if RUN_TEST_29B
+TEST(ExtendibleHashMapTest, TEST_29B_COPY_MOVE_AND_EQUAL_HASHES) {
+    ExtendibleHashMap<std::string, int> small{vec.begin(), vec.end()};
+    std::unordered_map<std::string, int> answer{vec.begin(), vec.end()};
+    CHECK_MAP_EQUAL(small, answer);
+
+    ExtendibleHashMap<int, int> map;
+    for (int i = 0; i < 5000; i++) map.insert({i, i});
+    ExtendibleHashMap<int, int> copy = map;
+    ASSERT_EQ(copy.segment_count(), map.segment_count());
+    ASSERT_EQ(copy.global_depth(), map.global_depth());
+    ASSERT_EQ(copy.relinked_nodes(), 0u);
+    copy[0] = 7;
+    ASSERT_EQ(map.at(0), 0);
+    for (int i = 1; i < 5000; i++) ASSERT_EQ(copy.at(i), i);
+
+    ExtendibleHashMap<int, int> moved = std::move(copy);
+    ASSERT_EQ(moved.size(), 5000u);
+    ASSERT_TRUE(copy.empty());
+    ASSERT_EQ(copy.segment_count(), 1u);
+    copy.insert({1, 1});
+    ASSERT_EQ(copy.at(1), 1);
+    copy = moved;
+    ASSERT_EQ(copy.at(0), 7);
+    moved.clear();
+    ASSERT_TRUE(moved.empty());
+    ASSERT_EQ(moved.global_depth(), 0u);
+    ASSERT_TRUE(moved.begin() == moved.end());
+
+    // with a hash that cannot tell keys apart, splitting would only grow the directory
+    auto constant = [](int) { return size_t(42); };
+    ExtendibleHashMap<int, int, decltype(constant)> collide(constant);
+    for (int i = 0; i < 1000; i++) collide.insert({i, i});
+    ASSERT_EQ(collide.segment_count(), 1u);
+    ASSERT_EQ(collide.global_depth(), 0u);
+    for (int i = 0; i < 1000; i++) ASSERT_EQ(collide.at(i), i);
+}
+#endif
+
+// ----------------------------------------------------------------------------------------------
+/* Extension 30 Test Cases: sorted exports */
+
+#if RUN_TEST_30A
+TEST(SortedViewTest, TEST_30A_INTEGRAL_KEYS_RADIX_SORTED) {
+    HashMap<int, int> map(1 << 16);
+    std::map<int, int> answer;
+    std::mt19937 rng(50);
+    for (int i = 0; i < 50000; i++) {
+        // negative keys, and keys spread over all four bytes
+        int key = static_cast<int>(rng());
+        map.insert({key, i});
+        answer.insert({key, i});
+    }
+    std::vector<std::pair<int, int>> expected(answer.begin(), answer.end());
+
+    for (size_t threads : {1, 2, 3, 8}) {
+        auto view = map.sorted_view(std::less<int>(), threads);
+        ASSERT_EQ(view.size(), expected.size());
+        for (size_t i = 0; i < expected.size(); i++) {
+            ASSERT_EQ(view[i].first, expected[i].first) << threads;
+            ASSERT_EQ(view[i].second, expected[i].second) << threads;
+        }
+        ASSERT_TRUE(map.to_sorted_vector(std::less<int>(), threads) == expected);
+    }
+    ASSERT_TRUE(map.to_sorted_vector() == expected);
+
+    // the view points at the elements in the map
+    auto view = map.sorted_view();
+    ASSERT_EQ(&view.front(), &*map.find(expected.front().first));
+    map.at(expected.back().first) = -1;
+    ASSERT_EQ(view.back().second, -1);
+
+    // unsigned and single-byte keys, and an empty map
+    HashMap<uint8_t, int> bytes;
+    for (int i = 255; i >= 0; i -= 3) bytes.insert({static_cast<uint8_t>(i), i});
+    auto sorted_bytes = bytes.to_sorted_vector(std::less<uint8_t>(), 4);
+    ASSERT_EQ(sorted_bytes.size(), bytes.size());
+    ASSERT_TRUE(std::is_sorted(sorted_bytes.begin(), sorted_bytes.end()));
+    HashMap<long long, int> empty;
+    ASSERT_TRUE(empty.sorted_view().empty());
+    ASSERT_TRUE(empty.to_sorted_vector(std::less<long long>(), 4).empty());
+}
+#endif
+
+#if RUN_TEST_30B
+TEST(SortedViewTest, TEST_30B_COMPARATOR_MERGE_SORTED) {
+    HashMap<std::string, int> map{vec.begin(), vec.end()};
+    std::map<std::string, int> answer{vec.begin(), vec.end()};
+    std::vector<std::pair<std::string, int>> expected(answer.begin(), answer.end());
+    ASSERT_TRUE(map.to_sorted_vector() == expected);
+
+    HashMap<std::string, int> large(1 << 15);
+    std::vector<std::string> words;
+    for (int i = 0; i < 20000; i++) {
+        words.push_back(std::to_string(i * 7919 % 20000));
+        large.insert({words.back(), i});
+    }
+    std::sort(words.begin(), words.end(), std::greater<std::string>());
+    for (size_t threads : {1, 2, 5}) {
+        auto view = large.sorted_view(std::greater<std::string>(), threads);
+        ASSERT_EQ(view.size(), words.size());
+        ASSERT_TRUE(std::equal(view.begin(), view.end(), words.begin(),
+                               [](const auto& element, const std::string& word) { return element.first == word; }));
+    }
+
+    // random access: binary search and iterator arithmetic over the view
+    auto view = large.sorted_view();
+    auto found = std::lower_bound(view.begin(), view.end(), std::string("1234"),
+                                  [](const auto& element, const std::string& key) { return element.first < key; });
+    ASSERT_TRUE(found != view.end());
+    ASSERT_EQ(found->first, "1234");
+    ASSERT_EQ(found - view.begin() + (view.end() - found), static_cast<std::ptrdiff_t>(view.size()));
+    ASSERT_EQ((view.begin() + 3)->first, view[3].first);
+    ASSERT_TRUE(view.begin() < view.end());
+
+    // an exception from comp reaches the caller
+    auto throwing = [](const std::string& lhs, const std::string& rhs) {
+        if (lhs == "42" || rhs == "42") throw std::invalid_argument("42");
+        return lhs < rhs;
+    };
+    ASSERT_THROW(large.sorted_view(throwing, 4), std::invalid_argument);
+}
+#endif
@@ -0,0 +1,273 @@
+#ifndef HASHMAP_TEXT_H
+#define HASHMAP_TEXT_H
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <exception>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "hashmap.h"
+
+/*
+* Text encoding of keys and mapped values for write_text and read_text.
+* Integers and floating point numbers go through std::to_chars / std::from_chars (shortest
+* round-trip form, no locale, no allocation) and std::string is written as is;
+* specialize TextCodec for any other K or M.
+*
+* max_size returns an upper bound on the characters write needs for value. write formats
+* value at out and returns the end of what it wrote. read parses [first, last), which
+* must hold exactly one value, and returns false if it does not.
+*/
+template<typename T, typename Enable = void>
+struct TextCodec {
+    static_assert(std::is_arithmetic_v<T> && !std::is_same_v<T, bool>,
+                  "TextCodec: specialize TextCodec for this type");
+
+    // enough for any integer and for the shortest round-trip form of any long double
+    static constexpr size_t kMaxChars = 64;
+
+    static size_t max_size(const T&) { return kMaxChars; }
+
+    static char* write(char* out, const T& value) {
+        return std::to_chars(out, out + kMaxChars, value).ptr;
+    }
+
+    static bool read(const char* first, const char* last, T& value) {
+        auto [end, error] = std::from_chars(first, last, value);
+        return error == std::errc() && end == last;
+    }
+};
+
+/*
+* Strings are written verbatim, so they cannot hold the tab and newline that delimit entries.
+*
+* Exceptions: std::invalid_argument from write if value contains '\t' or '\n'.
+*/
+template<>
+struct TextCodec<std::string> {
+    static size_t max_size(const std::string& value) { return value.size(); }
+
+    static char* write(char* out, const std::string& value) {
+        if (value.find_first_of("\t\n") != std::string::npos) {
+            throw std::invalid_argument("TextCodec<std::string>: tab or newline in \"" + value + "\"");
+        }
+        return std::copy(value.begin(), value.end(), out);
+    }
+
+    static bool read(const char* first, const char* last, std::string& value) {
+        value.assign(first, last);
+        return true;
+    }
+};
+
+constexpr size_t kTextBufferBytes = size_t(1) << 20;
+constexpr size_t kMinTextChunkBytes = size_t(1) << 16;
+
+/*
+* Writes every element of map as one line "key\tmapped\n", in iteration order.
+*
+* Entries are formatted with TextCodec into a fixed buffer of kTextBufferBytes that is
+* handed to the file descriptor or stream in whole-buffer writes, so memory stays constant
+* whatever the size of the map and no iostream formatting is involved.
+*
+* Usage:
+*      write_text(map, std::cout);
+*      int fd = open("dump.tsv", O_WRONLY | O_CREAT | O_TRUNC, 0644);
+*      write_text(map, fd);
+*
+* Exceptions: std::runtime_error if writing fails, std::invalid_argument if a string
+* contains a tab or a newline.
+*
+* Complexity: O(N), N = number of elements
+*
+* Notes: write_text_with is the common part; flush receives each full buffer.
+*/
+template<typename K, typename M, typename H, typename Flush>
+void write_text_with(const HashMap<K, M, H>& map, Flush flush) {
+    std::vector<char> buffer(kTextBufferBytes);
+    size_t used = 0;
+    for (const auto& [key, mapped] : map) {
+        size_t needed = TextCodec<K>::max_size(key) + TextCodec<M>::max_size(mapped) + 2;
+        if (used + needed > buffer.size()) {
+            flush(buffer.data(), used);
+            used = 0;
+            // an entry longer than the whole buffer gets a buffer of its own size
+            if (needed > buffer.size()) buffer.resize(needed);
+        }
+        char* out = buffer.data() + used;
+        out = TextCodec<K>::write(out, key);
+        *out++ = '\t';
+        out = TextCodec<M>::write(out, mapped);
+        *out++ = '\n';
+        used = out - buffer.data();
+    }
+    flush(buffer.data(), used);
+}
+
+template<typename K, typename M, typename H>
+void write_text(const HashMap<K, M, H>& map, int fd) {
+    write_text_with(map, [fd](const char* data, size_t size) {
+        while (size > 0) {
+            ssize_t written = ::write(fd, data, size);
+            if (written < 0 && errno == EINTR) continue;
+            if (written < 0) throw std::runtime_error(std::string("write_text: ") + std::strerror(errno));
+            data += written;
+            size -= written;
+        }
+    });
+}
+
+template<typename K, typename M, typename H>
+void write_text(const HashMap<K, M, H>& map, std::ostream& out) {
+    write_text_with(map, [&out](const char* data, size_t size) {
+        if (!out.write(data, size)) throw std::runtime_error("write_text: stream write failed");
+    });
+}
+
+/*
+* Parses the lines "key\tmapped\n" of [first, last) into entries, appending to out.
+* Empty lines are skipped; the last line may lack its newline. offset is the position of
+* first in the whole input, used in error messages.
+*
+* Exceptions: std::runtime_error on a line without a tab or with a value TextCodec rejects.
+*/
+template<typename K, typename M>
+void parse_text(const char* first, const char* last, size_t offset, std::vector<std::pair<K, M>>& out) {
+    const char* line = first;
+    while (line < last) {
+        const char* end = static_cast<const char*>(std::memchr(line, '\n', last - line));
+        if (end == nullptr) end = last;
+        if (end != line) {
+            const char* tab = static_cast<const char*>(std::memchr(line, '\t', end - line));
+            std::pair<K, M> entry;
+            if (tab == nullptr || !TextCodec<K>::read(line, tab, entry.first) ||
+                !TextCodec<M>::read(tab + 1, end, entry.second)) {
+                throw std::runtime_error("read_text: malformed line at byte " + std::to_string(offset + (line - first)));
+            }
+            out.push_back(std::move(entry));
+        }
+        line = end + 1;
+    }
+}
+
+/*
+* Inserts the parsed chunks into map in order, after reserving room for all of them.
+* Returns the number of elements added.
+*/
+template<typename K, typename M, typename H>
+size_t insert_parsed(HashMap<K, M, H>& map, const std::vector<std::vector<std::pair<K, M>>>& chunks) {
+    size_t total = 0;
+    for (const auto& chunk : chunks) total += chunk.size();
+    size_t before = map.size();
+    map.reserve(before + total);
+    for (const auto& chunk : chunks) {
+        map.insert(chunk.begin(), chunk.end());
+    }
+    return map.size() - before;
+}
+
+/*
+* Reads lines written by write_text and inserts them into map. As with insert, a key that
+* is already in the map keeps its mapped value, and so does the first of duplicate keys.
+* Returns the number of elements added.
+*
+* The path overload maps the file into memory, cuts it at line boundaries into one chunk
+* per thread and parses the chunks in parallel with std::from_chars; the elements are then
+* inserted in file order after a single reserve. The stream overload reads line by line.
+*
+* Usage:
+*      HashMap<int, double> map;
+*      size_t added = read_text(map, "dump.tsv");
+*
+* Exceptions: std::runtime_error if the file cannot be read or a line is malformed;
+* map is left unchanged in that case.
+*
+* Complexity: O(F / T + N), F = file size, T = threads, N = number of lines
+*/
+template<typename K, typename M, typename H>
+size_t read_text(HashMap<K, M, H>& map, const std::string& path,
+                 size_t threads = std::max(1u, std::thread::hardware_concurrency())) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) throw std::runtime_error("read_text: cannot open " + path + ": " + std::strerror(errno));
+    struct stat status;
+    if (fstat(fd, &status) != 0) {
+        close(fd);
+        throw std::runtime_error("read_text: cannot stat " + path + ": " + std::strerror(errno));
+    }
+    size_t size = static_cast<size_t>(status.st_size);
+    if (size == 0) {
+        close(fd);
+        return 0;
+    }
+    void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // the mapping keeps the file alive on its own
+    close(fd);
+    if (mapping == MAP_FAILED) throw std::runtime_error("read_text: cannot map " + path + ": " + std::strerror(errno));
+    madvise(mapping, size, MADV_SEQUENTIAL);
+    const char* data = static_cast<const char*>(mapping);
+
+    // chunk i starts after the first newline at or past i * size / threads;
+    // below kMinTextChunkBytes a chunk is not worth a thread
+    threads = std::max<size_t>(1, std::min(threads, size / kMinTextChunkBytes + 1));
+    std::vector<size_t> bounds{0};
+    for (size_t i = 1; i < threads; i++) {
+        size_t start = std::max(bounds.back(), i * size / threads);
+        const char* newline = static_cast<const char*>(std::memchr(data + start, '\n', size - start));
+        bounds.push_back(newline == nullptr ? size : newline - data + 1);
+    }
+    bounds.push_back(size);
+
+    std::vector<std::vector<std::pair<K, M>>> chunks(threads);
+    std::vector<std::exception_ptr> errors(threads);
+    auto parse_chunk = [&](size_t i) {
+        try {
+            parse_text(data + bounds[i], data + bounds[i + 1], bounds[i], chunks[i]);
+        } catch (...) {
+            errors[i] = std::current_exception();
+        }
+    };
+    // the calling thread parses chunk 0, and any chunk it could not start a thread for
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < threads; i++) {
+        try {
+            workers.emplace_back(parse_chunk, i);
+        } catch (const std::system_error&) {
+            parse_chunk(i);
+        }
+    }
+    parse_chunk(0);
+    for (auto& worker : workers) worker.join();
+    munmap(mapping, size);
+    for (const auto& error : errors) {
+        if (error) std::rethrow_exception(error);
+    }
+    return insert_parsed(map, chunks);
+}
+
+template<typename K, typename M, typename H>
+size_t read_text(HashMap<K, M, H>& map, std::istream& in) {
+    std::vector<std::vector<std::pair<K, M>>> chunks(1);
+    std::string line;
+    size_t offset = 0;
+    while (std::getline(in, line)) {
+        parse_text(line.data(), line.data() + line.size(), offset, chunks[0]);
+        offset += line.size() + 1;
+    }
+    return insert_parsed(map, chunks);
+}
+
+#endif
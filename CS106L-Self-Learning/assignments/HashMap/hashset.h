@@ -0,0 +1,338 @@
+#ifndef HASHSET_H
+#define HASHSET_H
+
+#include <iostream>
+#include <initializer_list>
+#include <stdexcept>
+#include <vector>
+
+#include "hash_chain.h"
+#include "hashmap_iterator.h"
+
+/*
+* Template class for a HashSet
+*
+* K = key type
+* H = hash function type used to hash a key; if not provided, defaults to std::hash<K>
+*
+* HashSet is built on the same chains and iterator as HashMap, but its nodes store only the
+* key, so a HashSet<K> node is {K, next} instead of the {std::pair<const K, bool>, next} of
+* the HashMap<K, bool> that used to emulate a set. Like std::unordered_set, both iterator
+* aliases are const iterators: modifying a key in place would break the hash invariant.
+*
+* Usage:
+*      HashSet<std::string> set{"Avery", "Anna"};
+*      if (set.contains("Avery")) {...}
+*
+* Concept requirements:
+*      - H is function type that with function prototype size_t hash(const K& key).
+*      - K must be regular (copyable, default constructible, and equality comparable).
+*/
+template<typename K, typename H = std::hash<K>>
+class HashSet {
+public:
+    using key_type = K;
+    using value_type = K;
+    using iterator = HashMapIterator<HashSet, true>;
+    using const_iterator = HashMapIterator<HashSet, true>;
+
+    friend class HashMapIterator<HashSet, true>;
+
+    /*
+    * Constructors, with the same meaning as the ones of HashMap.
+    *
+    * Usage:
+    *      HashSet<int> set;
+    *      HashSet<int> set(100, my_hash);
+    *      HashSet<char> set{vec.begin(), vec.end()};
+    *      HashSet<char> set{'a', 'b', 'c'};
+    */
+    HashSet();
+    explicit HashSet(size_t bucket_count, const H& hash = H());
+    template<typename InputIter>
+    HashSet(InputIter begin, InputIter end, size_t bucket_count = kDefaultBuckets, const H& hash = H());
+    HashSet(std::initializer_list<K> init, size_t bucket_count = kDefaultBuckets, const H& hash = H());
+
+    HashSet(const HashSet& set);
+    HashSet(HashSet&& set);
+    HashSet& operator=(const HashSet& set);
+    HashSet& operator=(HashSet&& set);
+    ~HashSet();
+
+    inline size_t size() const;
+    inline bool empty() const;
+    inline float load_factor() const;
+    inline size_t bucket_count() const;
+
+    /*
+    * Returns whether the set contains key, and how many times (0 or 1).
+    *
+    * Complexity: O(1) amortized average case, O(N) worst case, N = number of elements
+    */
+    bool contains(const K& key) const;
+    size_t count(const K& key) const;
+
+    /*
+    * Inserts key, if not already present.
+    * Return value: {iterator to the element with that key, whether it was inserted}.
+    *
+    * Usage:
+    *      auto [iter, inserted] = set.insert(3);
+    *
+    * Complexity: O(1) amortized average case
+    */
+    std::pair<iterator, bool> insert(const K& key);
+
+    /*
+    * Erases key (returns whether it was present), or the element pos points to
+    * (returns the iterator following pos).
+    *
+    * Complexity: O(1) amortized average case, O(N) worst case, N = number of elements
+    */
+    bool erase(const K& key);
+    iterator erase(const_iterator pos);
+
+    /*
+    * Removes all elements, keeping the number of buckets.
+    */
+    void clear();
+
+    /*
+    * Relinks all elements into new_buckets buckets.
+    *
+    * Exceptions: std::out_of_range if new_buckets = 0.
+    */
+    void rehash(size_t new_buckets);
+
+    iterator find(const K& key) const;
+    iterator begin() const;
+    iterator end() const;
+
+private:
+    using Node = HashNode<value_type>;
+    using node_pair = std::pair<Node*, Node*>;
+
+    node_pair find_node(const K& key) const;
+    iterator make_iterator(Node* curr) const;
+
+    /* Private member variables */
+    size_t _size;
+    H _hash_function;
+    // mutable since const iterators keep a pointer to it; the set itself never changes it
+    // from a const member function
+    mutable std::vector<Node*> _buckets_array;
+
+    static const size_t kDefaultBuckets = 10;
+    using bucket_array_type = decltype(_buckets_array);
+};
+
+template<typename K, typename H>
+HashSet<K, H>::HashSet() : HashSet(kDefaultBuckets) {}
+
+template<typename K, typename H>
+HashSet<K, H>::HashSet(size_t bucket_count, const H& hash) :
+    _size(0),
+    _hash_function(hash),
+    _buckets_array(bucket_count, nullptr) {}
+
+template<typename K, typename H>
+template<typename InputIter>
+HashSet<K, H>::HashSet(InputIter begin, InputIter end, size_t bucket_count, const H& hash) :
+    HashSet(bucket_count, hash)
+{
+    for (InputIter it = begin; it != end; it++) {
+        insert(*it);
+    }
+}
+
+template<typename K, typename H>
+HashSet<K, H>::HashSet(std::initializer_list<K> init, size_t bucket_count, const H& hash) :
+    HashSet(init.begin(), init.end(), bucket_count, hash) {}
+
+template<typename K, typename H>
+HashSet<K, H>::HashSet(const HashSet& set) :
+    HashSet(set._buckets_array.size(), set._hash_function)
+{
+    for (const auto& key : set) {
+        insert(key);
+    }
+}
+
+template<typename K, typename H>
+HashSet<K, H>::HashSet(HashSet&& set) :
+    _size(set._size),
+    _hash_function(std::move(set._hash_function)),
+    _buckets_array(std::move(set._buckets_array))
+{
+    set._buckets_array.resize(_buckets_array.size(), nullptr);
+    set._size = 0;
+}
+
+template<typename K, typename H>
+HashSet<K, H>& HashSet<K, H>::operator=(const HashSet& set) {
+    if (this == &set) return *this;
+    clear();
+    _hash_function = set._hash_function;
+    for (const auto& key : set) {
+        insert(key);
+    }
+    return *this;
+}
+
+template<typename K, typename H>
+HashSet<K, H>& HashSet<K, H>::operator=(HashSet&& set) {
+    if (this == &set) return *this;
+    clear();
+    _size = set._size;
+    _hash_function = std::move(set._hash_function);
+    _buckets_array = std::move(set._buckets_array);
+    set._size = 0;
+    set._buckets_array.resize(_buckets_array.size(), nullptr);
+    return *this;
+}
+
+template<typename K, typename H>
+HashSet<K, H>::~HashSet() {
+    clear();
+}
+
+template<typename K, typename H>
+inline size_t HashSet<K, H>::size() const {
+    return _size;
+}
+
+template<typename K, typename H>
+inline bool HashSet<K, H>::empty() const {
+    return _size == 0;
+}
+
+template<typename K, typename H>
+inline float HashSet<K, H>::load_factor() const {
+    return ((float) _size) / _buckets_array.size();
+}
+
+template<typename K, typename H>
+inline size_t HashSet<K, H>::bucket_count() const {
+    return _buckets_array.size();
+}
+
+template<typename K, typename H>
+bool HashSet<K, H>::contains(const K& key) const {
+    return find_node(key).second != nullptr;
+}
+
+template<typename K, typename H>
+size_t HashSet<K, H>::count(const K& key) const {
+    return contains(key) ? 1 : 0;
+}
+
+template<typename K, typename H>
+std::pair<typename HashSet<K, H>::iterator, bool> HashSet<K, H>::insert(const K& key) {
+    auto [prev, curr] = find_node(key);
+    if (curr != nullptr) return {make_iterator(curr), false};
+
+    Node* new_node = new Node(key, nullptr);
+    if (prev != nullptr) {
+        prev->next = new_node;
+    } else {
+        _buckets_array[_hash_function(key) % _buckets_array.size()] = new_node;
+    }
+    _size++;
+    return {make_iterator(new_node), true};
+}
+
+template<typename K, typename H>
+bool HashSet<K, H>::erase(const K& key) {
+    size_t index = _hash_function(key) % _buckets_array.size();
+    auto [prev, curr] = chain_find(_buckets_array[index], key, IdentityKey());
+    if (curr == nullptr) return false;
+
+    if (prev == nullptr) {
+        _buckets_array[index] = curr->next;
+    } else {
+        prev->next = curr->next;
+    }
+    delete curr;
+    _size--;
+    return true;
+}
+
+template<typename K, typename H>
+typename HashSet<K, H>::iterator HashSet<K, H>::erase(const_iterator pos) {
+    iterator next = pos;
+    ++next;
+    if (pos._node != nullptr) erase(pos._node->value);
+    return next;
+}
+
+template<typename K, typename H>
+void HashSet<K, H>::clear() {
+    chain_delete_all(_buckets_array);
+    _size = 0;
+}
+
+template<typename K, typename H>
+void HashSet<K, H>::rehash(size_t new_buckets) {
+    if (new_buckets == 0) {
+        throw std::out_of_range("HashSet<K, H>::rehash: new_buckets cannot be 0");
+    }
+    chain_redistribute(_buckets_array, new_buckets, _hash_function);
+}
+
+template<typename K, typename H>
+typename HashSet<K, H>::iterator HashSet<K, H>::find(const K& key) const {
+    return make_iterator(find_node(key).second);
+}
+
+template<typename K, typename H>
+typename HashSet<K, H>::iterator HashSet<K, H>::begin() const {
+    return make_iterator(_buckets_array[chain_first_not_empty(_buckets_array)]);
+}
+
+template<typename K, typename H>
+typename HashSet<K, H>::iterator HashSet<K, H>::end() const {
+    return make_iterator(nullptr);
+}
+
+template<typename K, typename H>
+typename HashSet<K, H>::node_pair HashSet<K, H>::find_node(const K& key) const {
+    size_t index = _hash_function(key) % _buckets_array.size();
+    return chain_find(_buckets_array[index], key, IdentityKey());
+}
+
+template<typename K, typename H>
+typename HashSet<K, H>::iterator HashSet<K, H>::make_iterator(Node* curr) const {
+    size_t index = _buckets_array.size();
+    if (curr != nullptr) {
+        index = _hash_function(curr->value) % _buckets_array.size();
+    }
+    return iterator(&_buckets_array, curr, index);
+}
+
+template<typename K, typename H>
+std::ostream& operator<<(std::ostream& output_stream, const HashSet<K, H>& set) {
+    output_stream << "{";
+    bool first = true;
+    for (const auto& key : set) {
+        if (!first) output_stream << ", ";
+        output_stream << key;
+        first = false;
+    }
+    return output_stream << "}";
+}
+
+template<typename K, typename H>
+bool operator==(const HashSet<K, H>& lhs, const HashSet<K, H>& rhs) {
+    if (lhs.size() != rhs.size()) return false;
+    for (const auto& key : lhs) {
+        if (!rhs.contains(key)) return false;
+    }
+    return true;
+}
+
+template<typename K, typename H>
+bool operator!=(const HashSet<K, H>& lhs, const HashSet<K, H>& rhs) {
+    return !(lhs == rhs);
+}
+
+#endif
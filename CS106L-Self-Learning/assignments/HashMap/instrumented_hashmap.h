@@ -0,0 +1,220 @@
+#ifndef INSTRUMENTED_HASHMAP_H
+#define INSTRUMENTED_HASHMAP_H
+
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <functional>
+#include <ostream>
+#include <utility>
+
+#include "hashmap.h"
+#include "latency_histogram.h"
+
+/*
+* Operations of a HashMap whose latency an InstrumentedHashMap records.
+*/
+enum class HashMapOp { Insert, Find, Erase, Rehash };
+
+constexpr size_t kHashMapOpCount = 4;
+
+inline const char* hashmap_op_name(HashMapOp op) {
+    switch (op) {
+        case HashMapOp::Insert: return "insert";
+        case HashMapOp::Find: return "find";
+        case HashMapOp::Erase: return "erase";
+        case HashMapOp::Rehash: return "rehash";
+    }
+    return "unknown";
+}
+
+/*
+* Instrumentation policies of InstrumentedHashMap. A policy has a start(op) that returns a
+* timer object, which records the operation when it goes out of scope.
+*
+* NoLatencyRecording is empty and its timer does nothing, so with it an InstrumentedHashMap
+* compiles to plain HashMap calls and is exactly as large as a HashMap.
+*/
+struct NoLatencyRecording {
+    struct Timer {};
+    Timer start(HashMapOp) const { return Timer(); }
+};
+
+/*
+* LatencyRecording times every operation with std::chrono::steady_clock (about 20 ns per
+* operation on Linux, where now() does not enter the kernel) into one LatencyHistogram per
+* operation, in nanoseconds.
+*/
+class LatencyRecording {
+public:
+    class Timer {
+    public:
+        explicit Timer(LatencyHistogram& histogram) :
+            _histogram(histogram), _start(std::chrono::steady_clock::now()) {}
+        Timer(const Timer&) = delete;
+        Timer& operator=(const Timer&) = delete;
+        ~Timer() {
+            auto elapsed = std::chrono::steady_clock::now() - _start;
+            _histogram.record(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+        }
+
+    private:
+        LatencyHistogram& _histogram;
+        std::chrono::steady_clock::time_point _start;
+    };
+
+    Timer start(HashMapOp op) const { return Timer(_histograms[static_cast<size_t>(op)]); }
+
+    const LatencyHistogram& histogram(HashMapOp op) const { return _histograms[static_cast<size_t>(op)]; }
+
+    void reset() {
+        for (auto& histogram : _histograms) histogram.reset();
+    }
+
+    /*
+    * One line per operation, or a JSON object keyed by operation name.
+    *
+    * Usage:
+    *      map.latencies().write_json(std::cout);   // {"insert": {"count": ..., "p99": ...}, ...}
+    */
+    void write_text(std::ostream& out) const {
+        for (size_t op = 0; op < kHashMapOpCount; op++) {
+            out << hashmap_op_name(static_cast<HashMapOp>(op)) << ": ";
+            _histograms[op].write_text(out);
+            out << '\n';
+        }
+    }
+
+    void write_json(std::ostream& out) const {
+        out << '{';
+        for (size_t op = 0; op < kHashMapOpCount; op++) {
+            out << (op == 0 ? "" : ", ") << '"' << hashmap_op_name(static_cast<HashMapOp>(op)) << "\": ";
+            _histograms[op].write_json(out);
+        }
+        out << '}';
+    }
+
+private:
+    // const lookups are recorded too
+    mutable std::array<LatencyHistogram, kHashMapOpCount> _histograms;
+};
+
+/*
+* Template class for a HashMap that records the latency of its insert, find, erase and
+* rehash calls
+*
+* K = key type, M = mapped type, H = hash function type (as for HashMap)
+* Policy = NoLatencyRecording or LatencyRecording (the default)
+*
+* Averages hide the rehash that doubles a large table and the lookup that walks a long
+* chain; per-operation histograms show them as p99.9 and max. The policy is a template
+* parameter so that production builds can keep the same type name and pay nothing:
+*
+*      #ifdef HASHMAP_LATENCY
+*      using Policy = LatencyRecording;
+*      #else
+*      using Policy = NoLatencyRecording;
+*      #endif
+*      InstrumentedHashMap<int, Order, DefaultHash<int>, Policy> orders;
+*
+* Usage:
+*      InstrumentedHashMap<int, int> map(1024);
+*      map.insert({1, 2});
+*      map.find(1);
+*      map.latencies().write_text(std::cout);
+*
+* Notes: insert, find, contains, at, erase and operator[] forward to the HashMap with
+* the same names, timed as HashMapOp::Insert (operator[] too), Find or Erase; rehash, and
+* reserve when it does grow the table, are timed as HashMapOp::Rehash. map() gives read
+* access to the whole HashMap API, untimed.
+*/
+template<typename K, typename M, typename H = DefaultHash<K>, typename Policy = LatencyRecording>
+class InstrumentedHashMap : private Policy {
+public:
+    using map_type = HashMap<K, M, H>;
+    using value_type = typename map_type::value_type;
+    using iterator = typename map_type::iterator;
+    using const_iterator = typename map_type::const_iterator;
+
+    InstrumentedHashMap() = default;
+    explicit InstrumentedHashMap(size_t bucket_count, const H& hash = H()) : _map(bucket_count, hash) {}
+
+    std::pair<iterator, bool> insert(const value_type& value) {
+        [[maybe_unused]] auto timer = Policy::start(HashMapOp::Insert);
+        return _map.insert(value);
+    }
+
+    M& operator[](const K& key) {
+        [[maybe_unused]] auto timer = Policy::start(HashMapOp::Insert);
+        return _map[key];
+    }
+
+    iterator find(const K& key) {
+        [[maybe_unused]] auto timer = Policy::start(HashMapOp::Find);
+        return _map.find(key);
+    }
+
+    const_iterator find(const K& key) const {
+        [[maybe_unused]] auto timer = Policy::start(HashMapOp::Find);
+        return _map.find(key);
+    }
+
+    bool contains(const K& key) const {
+        [[maybe_unused]] auto timer = Policy::start(HashMapOp::Find);
+        return _map.contains(key);
+    }
+
+    M& at(const K& key) {
+        [[maybe_unused]] auto timer = Policy::start(HashMapOp::Find);
+        return _map.at(key);
+    }
+
+    const M& at(const K& key) const {
+        [[maybe_unused]] auto timer = Policy::start(HashMapOp::Find);
+        return _map.at(key);
+    }
+
+    bool erase(const K& key) {
+        [[maybe_unused]] auto timer = Policy::start(HashMapOp::Erase);
+        return _map.erase(key);
+    }
+
+    void rehash(size_t new_bucket_count) {
+        [[maybe_unused]] auto timer = Policy::start(HashMapOp::Rehash);
+        _map.rehash(new_bucket_count);
+    }
+
+    void reserve(size_t n) {
+        // a reserve that finds the table large enough does no work and is not recorded
+        if (std::ceil(n / _map.max_load_factor()) <= _map.bucket_count()) return;
+        [[maybe_unused]] auto timer = Policy::start(HashMapOp::Rehash);
+        _map.reserve(n);
+    }
+
+    void clear() { _map.clear(); }
+
+    size_t size() const { return _map.size(); }
+    bool empty() const { return _map.empty(); }
+    size_t bucket_count() const { return _map.bucket_count(); }
+    float load_factor() const { return _map.load_factor(); }
+    float max_load_factor() const { return _map.max_load_factor(); }
+
+    iterator begin() { return _map.begin(); }
+    iterator end() { return _map.end(); }
+    const_iterator begin() const { return _map.begin(); }
+    const_iterator end() const { return _map.end(); }
+
+    const map_type& map() const { return _map; }
+
+    /*
+    * The recording policy, with its histograms when it is LatencyRecording.
+    */
+    Policy& latencies() { return *this; }
+    const Policy& latencies() const { return *this; }
+
+private:
+    map_type _map;
+};
+
+#endif
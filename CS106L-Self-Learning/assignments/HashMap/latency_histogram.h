@@ -0,0 +1,150 @@
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <ostream>
+#include <stdexcept>
+
+/*
+* Log-linear latency histogram in the style of HdrHistogram.
+*
+* Values (nanoseconds, or any unsigned count) below 2 * kSubBuckets are counted exactly.
+* Above that, every power of two [2^m, 2^(m+1)) is split into kSubBuckets equal buckets,
+* so a value is reported with a relative error of at most 1 / kSubBuckets (about 3%)
+* whatever its magnitude, from nanoseconds to hours, in a fixed array of counters.
+* record is a few shifts and an increment: no allocation, no branch on the magnitude.
+*
+* Usage:
+*      LatencyHistogram histogram;
+*      histogram.record(elapsed_ns);
+*      std::cout << histogram.percentile(99.9) << " ns at p99.9\n";
+*
+* Exceptions: percentile throws std::out_of_range if p is not in [0, 100].
+*/
+class LatencyHistogram {
+public:
+    static constexpr size_t kSubBucketBits = 5;
+    static constexpr size_t kSubBuckets = size_t(1) << kSubBucketBits;
+
+    void record(uint64_t value) {
+        _counts[index_of(value)]++;
+        _count++;
+        _sum += value;
+        _min = std::min(_min, value);
+        _max = std::max(_max, value);
+    }
+
+    /*
+    * Smallest recorded value v such that at least p percent of the values are <= v,
+    * rounded up to the top of its bucket (but never above max()). 0 when empty.
+    */
+    uint64_t percentile(double p) const {
+        if (!(p >= 0 && p <= 100)) {
+            throw std::out_of_range("LatencyHistogram::percentile: p must be in [0, 100]");
+        }
+        if (_count == 0) return 0;
+        // the epsilon keeps 99.9% of 1000 values at rank 999, not 1000 after rounding
+        double exact_rank = p / 100 * _count;
+        uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(exact_rank - 1e-9 * exact_rank)));
+        uint64_t seen = 0;
+        for (size_t index = 0; index < kBuckets; index++) {
+            seen += _counts[index];
+            if (seen >= rank) return std::min(highest_in(index), _max);
+        }
+        return _max;
+    }
+
+    void merge(const LatencyHistogram& other) {
+        for (size_t index = 0; index < kBuckets; index++) _counts[index] += other._counts[index];
+        _count += other._count;
+        _sum += other._sum;
+        _min = std::min(_min, other._min);
+        _max = std::max(_max, other._max);
+    }
+
+    void reset() {
+        *this = LatencyHistogram();
+    }
+
+    uint64_t count() const { return _count; }
+    uint64_t min() const { return _count == 0 ? 0 : _min; }
+    uint64_t max() const { return _max; }
+    double mean() const { return _count == 0 ? 0 : double(_sum) / _count; }
+
+    /*
+    * Calls f(lowest, highest, count) for every non-empty bucket, in increasing order.
+    */
+    template<typename F>
+    void for_each_bucket(F f) const {
+        for (size_t index = 0; index < kBuckets; index++) {
+            if (_counts[index] != 0) f(lowest_in(index), highest_in(index), _counts[index]);
+        }
+    }
+
+    /*
+    * One line of count, mean, min, p50, p90, p99, p99.9 and max, or the same fields as a
+    * JSON object, which also lists the non-empty buckets as [highest value, count] pairs.
+    */
+    void write_text(std::ostream& out) const {
+        out << "count " << count() << " mean " << static_cast<uint64_t>(mean()) << " min " << min();
+        for (const auto& [name, p] : kPercentiles) out << ' ' << name << ' ' << percentile(p);
+        out << " max " << max();
+    }
+
+    void write_json(std::ostream& out) const {
+        out << "{\"count\": " << count() << ", \"mean\": " << static_cast<uint64_t>(mean())
+            << ", \"min\": " << min();
+        for (const auto& [name, p] : kPercentiles) out << ", \"" << name << "\": " << percentile(p);
+        out << ", \"max\": " << max() << ", \"buckets\": [";
+        bool first = true;
+        for_each_bucket([&](uint64_t, uint64_t highest, uint64_t count) {
+            out << (first ? "" : ", ") << '[' << highest << ", " << count << ']';
+            first = false;
+        });
+        out << "]}";
+    }
+
+private:
+    // exact values [0, 2 * kSubBuckets), then kSubBuckets per power of two up to 2^64
+    static constexpr size_t kBuckets = 2 * kSubBuckets + (64 - kSubBucketBits - 1) * kSubBuckets;
+
+    struct NamedPercentile {
+        const char* name;
+        double p;
+    };
+    static constexpr NamedPercentile kPercentiles[] = {
+        {"p50", 50}, {"p90", 90}, {"p99", 99}, {"p99.9", 99.9}
+    };
+
+    static size_t index_of(uint64_t value) {
+        if (value < 2 * kSubBuckets) return static_cast<size_t>(value);
+        size_t magnitude = 63 - __builtin_clzll(value);
+        size_t shift = magnitude - kSubBucketBits;
+        return 2 * kSubBuckets + (shift - 1) * kSubBuckets + static_cast<size_t>((value >> shift) - kSubBuckets);
+    }
+
+    static uint64_t lowest_in(size_t index) {
+        if (index < 2 * kSubBuckets) return index;
+        size_t shift = (index - 2 * kSubBuckets) / kSubBuckets + 1;
+        uint64_t top = (index - 2 * kSubBuckets) % kSubBuckets + kSubBuckets;
+        return top << shift;
+    }
+
+    static uint64_t highest_in(size_t index) {
+        if (index < 2 * kSubBuckets) return index;
+        size_t shift = (index - 2 * kSubBuckets) / kSubBuckets + 1;
+        return lowest_in(index) + ((uint64_t(1) << shift) - 1);
+    }
+
+    std::array<uint64_t, kBuckets> _counts{};
+    uint64_t _count = 0;
+    uint64_t _sum = 0;
+    uint64_t _min = std::numeric_limits<uint64_t>::max();
+    uint64_t _max = 0;
+};
+
+#endif
@@ -0,0 +1,466 @@
+#ifndef MVCC_HASHMAP_H
+#define MVCC_HASHMAP_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/*
+* Template class for a multi-version concurrent hash map: readers scan consistent snapshots
+* while writers keep updating, and neither blocks the other
+*
+* K = key type
+* M = mapped type
+* H = hash function type used to hash a key; if not provided, defaults to std::hash<K>
+*
+* Every key has a node in a separately chained bucket array, and every node a list of
+* versions, newest first. A write never changes a version: insert_or_assign and erase
+* (which writes a tombstone) push a new version stamped with the next value of a global
+* version clock. A Snapshot pins the clock value at the time it is taken and sees, for each
+* key, the newest version no newer than that, so a long scan reads one consistent state of
+* the map however many writes commit meanwhile.
+*
+* Readers take no lock: chains and version lists are atomic pointers published with
+* release stores. Writers lock one of kStripes mutexes, each guarding a range of buckets, so
+* writers only wait for writers of the same stripe, plus a global commit mutex held for
+* three stores to stamp and publish the version in clock order.
+*
+* collect_garbage frees the versions that no snapshot can see any more (those behind the
+* newest version at or below the oldest pinned clock value) and unlinks the nodes of erased
+* keys. Unlinked nodes are freed once every snapshot taken before the unlink has been
+* released, since such a snapshot may still be walking through them. start_background_gc
+* runs it on a thread at a fixed interval.
+*
+* Usage:
+*      MvccHashMap<int, Order> orders(1 << 20);
+*      orders.start_background_gc(std::chrono::milliseconds(10));
+*      orders.insert_or_assign(7, order);           // ingestion threads
+*      {
+*          auto snapshot = orders.snapshot();       // analytics thread
+*          snapshot.for_each([](int id, const Order& order) { ... });
+*      }
+*
+* Exceptions: the constructor throws std::out_of_range if bucket_count is 0.
+*
+* Notes: the bucket array does not grow, so bucket_count should be close to the number of
+* keys expected. A Snapshot must be released before the map is destroyed, and pointers
+* returned by Snapshot::find are valid while the snapshot is alive.
+*
+* Concept requirements:
+*      - K must be copyable and equality comparable, M copy or move constructible.
+*      - H must be safe to call concurrently from several threads.
+*/
+template<typename K, typename M, typename H = std::hash<K>>
+class MvccHashMap {
+    struct Version;
+    struct Node;
+
+public:
+    using value_type = std::pair<const K, M>;
+
+    static constexpr size_t kStripes = 64;
+
+    /*
+    * A consistent, read-only view of the map as of the moment it was taken.
+    * Move-only; releasing it (destruction) lets collect_garbage reclaim what it pinned.
+    */
+    class Snapshot {
+    public:
+        Snapshot(Snapshot&& other) noexcept : _map(other._map), _id(other._id), _version(other._version) {
+            other._map = nullptr;
+        }
+        Snapshot(const Snapshot&) = delete;
+        Snapshot& operator=(const Snapshot&) = delete;
+        Snapshot& operator=(Snapshot&&) = delete;
+        ~Snapshot() {
+            if (_map != nullptr) _map->release(_id);
+        }
+
+        /*
+        * Returns a pointer to the value of key in this snapshot, or nullptr if key was absent.
+        *
+        * Complexity: O(L + V) average case, L = chain length, V = versions newer than the snapshot
+        */
+        const M* find(const K& key) const {
+            const Node* node = _map->find_node(key);
+            return node == nullptr ? nullptr : visible_value(node);
+        }
+
+        bool contains(const K& key) const { return find(key) != nullptr; }
+
+        /*
+        * Calls f(key, value) for every key present in this snapshot, in bucket order.
+        *
+        * Complexity: O(N + B)
+        */
+        template<typename F>
+        void for_each(F f) const {
+            for (size_t bucket = 0; bucket < _map->_bucket_count; bucket++) {
+                for (const Node* node = _map->_buckets[bucket].load(std::memory_order_acquire); node != nullptr;
+                     node = node->next.load(std::memory_order_acquire)) {
+                    if (const M* value = visible_value(node)) f(node->key, *value);
+                }
+            }
+        }
+
+        /*
+        * Number of keys in this snapshot.
+        *
+        * Complexity: O(N + B)
+        */
+        size_t size() const {
+            size_t count = 0;
+            for_each([&count](const K&, const M&) { count++; });
+            return count;
+        }
+
+        // the clock value the snapshot was taken at: it sees every write stamped at or below it
+        uint64_t version() const { return _version; }
+
+    private:
+        friend class MvccHashMap;
+
+        Snapshot(const MvccHashMap* map, uint64_t id, uint64_t version) : _map(map), _id(id), _version(version) {}
+
+        const M* visible_value(const Node* node) const {
+            const Version* version = node->newest.load(std::memory_order_acquire);
+            while (version != nullptr && version->version > _version) {
+                version = version->older.load(std::memory_order_acquire);
+            }
+            return version == nullptr || !version->value ? nullptr : &*version->value;
+        }
+
+        const MvccHashMap* _map;
+        uint64_t _id;
+        uint64_t _version;
+    };
+
+    /*
+    * Constructor with bucket count and hash function.
+    *
+    * Complexity: O(B)
+    */
+    explicit MvccHashMap(size_t bucket_count = kDefaultBuckets, const H& hash = H()) :
+        _bucket_count(bucket_count), _buckets_per_stripe((bucket_count + kStripes - 1) / kStripes),
+        _hash_function(hash) {
+        if (bucket_count == 0) {
+            throw std::out_of_range("MvccHashMap: bucket_count must be positive");
+        }
+        _buckets = std::make_unique<std::atomic<Node*>[]>(bucket_count);
+        for (size_t bucket = 0; bucket < bucket_count; bucket++) _buckets[bucket].store(nullptr);
+    }
+
+    MvccHashMap(const MvccHashMap&) = delete;
+    MvccHashMap& operator=(const MvccHashMap&) = delete;
+
+    ~MvccHashMap() {
+        stop_background_gc();
+        for (size_t bucket = 0; bucket < _bucket_count; bucket++) {
+            Node* node = _buckets[bucket].load();
+            while (node != nullptr) {
+                Node* next = node->next.load();
+                delete_node(node);
+                node = next;
+            }
+        }
+        for (auto& retired : _retired) delete_node(retired.second);
+    }
+
+    /*
+    * Pins the current state of the map. Never blocks on writers.
+    *
+    * Complexity: O(log S), S = number of live snapshots
+    */
+    Snapshot snapshot() const {
+        std::lock_guard<std::mutex> lock(_snapshot_mutex);
+        uint64_t id = _next_snapshot_id++;
+        uint64_t version = _clock.load(std::memory_order_acquire);
+        _snapshots.emplace(id, version);
+        return Snapshot(this, id, version);
+    }
+
+    /*
+    * Adds key -> value if key is absent (in the latest state); returns whether it was added.
+    *
+    * Complexity: O(L) average case, L = chain length
+    */
+    bool insert(const value_type& value) {
+        return write(value.first, value.second, WriteMode::InsertOnly);
+    }
+
+    /*
+    * Writes a new version of key holding value; returns true if key was absent.
+    *
+    * Complexity: O(L) average case, L = chain length
+    */
+    bool insert_or_assign(const K& key, M value) {
+        return write(key, std::move(value), WriteMode::Assign);
+    }
+
+    /*
+    * Writes a tombstone for key; returns false (and writes nothing) if key was absent.
+    * Snapshots taken before the erase still see key.
+    *
+    * Complexity: O(L) average case, L = chain length
+    */
+    bool erase(const K& key) {
+        return write(key, std::nullopt, WriteMode::Erase);
+    }
+
+    /*
+    * Copy of the latest value of key, or std::nullopt, read through a short-lived snapshot.
+    *
+    * Complexity: O(L) average case, L = chain length
+    */
+    std::optional<M> get(const K& key) const {
+        auto snapshot = this->snapshot();
+        const M* value = snapshot.find(key);
+        return value == nullptr ? std::nullopt : std::optional<M>(*value);
+    }
+
+    bool contains(const K& key) const { return get(key).has_value(); }
+
+    // number of keys in the latest state
+    size_t size() const { return _size.load(std::memory_order_relaxed); }
+    bool empty() const { return size() == 0; }
+    size_t bucket_count() const { return _bucket_count; }
+
+    // versions currently allocated, tombstones included: what collect_garbage keeps down
+    size_t version_count() const { return _versions.load(std::memory_order_relaxed); }
+
+    // value of the version clock, i.e. the number of writes committed so far
+    uint64_t version() const { return _clock.load(std::memory_order_acquire); }
+
+    /*
+    * Frees every version hidden from all live snapshots, unlinks erased keys, and frees
+    * the nodes unlinked by earlier calls that no snapshot can reach any more.
+    * Returns the number of versions freed. Writers of a stripe wait while it is swept.
+    *
+    * Complexity: O(N + B)
+    */
+    size_t collect_garbage() {
+        std::lock_guard<std::mutex> gc_lock(_gc_mutex);
+        uint64_t oldest_version, oldest_id;
+        {
+            std::lock_guard<std::mutex> lock(_snapshot_mutex);
+            // ids and pinned versions increase together, so the oldest snapshot has both
+            oldest_version = _snapshots.empty() ? _clock.load(std::memory_order_acquire) : _snapshots.begin()->second;
+            oldest_id = _snapshots.empty() ? _next_snapshot_id : _snapshots.begin()->first;
+        }
+
+        size_t freed = 0;
+        auto still_reachable = std::partition(_retired.begin(), _retired.end(),
+            [oldest_id](const auto& retired) { return retired.first > oldest_id; });
+        for (auto retired = still_reachable; retired != _retired.end(); ++retired) {
+            freed += delete_node(retired->second);
+        }
+        _retired.erase(still_reachable, _retired.end());
+
+        // nothing was written and no snapshot released since the last sweep: nothing to sweep
+        uint64_t clock = _clock.load(std::memory_order_acquire);
+        if (clock == _swept_clock && oldest_version == _swept_oldest_version) return freed;
+        _swept_clock = clock;
+        _swept_oldest_version = oldest_version;
+
+        size_t swept = 0;
+        std::vector<Node*> unlinked;
+        for (size_t stripe = 0; stripe < kStripes; stripe++) {
+            // a stripe is a range of buckets, swept under one lock
+            std::lock_guard<std::mutex> lock(_stripes[stripe]);
+            size_t end = std::min(_bucket_count, (stripe + 1) * _buckets_per_stripe);
+            for (size_t bucket = stripe * _buckets_per_stripe; bucket < end; bucket++) {
+                std::atomic<Node*>* link = &_buckets[bucket];
+                Node* node = link->load(std::memory_order_relaxed);
+                while (node != nullptr) {
+                    Node* next = node->next.load(std::memory_order_relaxed);
+                    Version* newest = node->newest.load(std::memory_order_relaxed);
+                    // every snapshot sees this version or a newer one, never anything older
+                    Version* floor = newest;
+                    while (floor != nullptr && floor->version > oldest_version) {
+                        floor = floor->older.load(std::memory_order_relaxed);
+                    }
+                    if (floor != nullptr) {
+                        Version* older = floor->older.exchange(nullptr, std::memory_order_relaxed);
+                        while (older != nullptr) {
+                            Version* next_older = older->older.load(std::memory_order_relaxed);
+                            delete older;
+                            swept++;
+                            older = next_older;
+                        }
+                    }
+                    if (floor != nullptr && floor == newest && !floor->value) {
+                        // erased for every snapshot: readers already inside may still pass through
+                        link->store(next, std::memory_order_release);
+                        unlinked.push_back(node);
+                    } else {
+                        link = &node->next;
+                    }
+                    node = next;
+                }
+            }
+        }
+        _versions.fetch_sub(swept, std::memory_order_relaxed);
+
+        if (!unlinked.empty()) {
+            uint64_t stamp;
+            {
+                // snapshots from this id on were taken after the unlink and cannot reach the nodes
+                std::lock_guard<std::mutex> lock(_snapshot_mutex);
+                stamp = _next_snapshot_id;
+            }
+            for (Node* node : unlinked) _retired.emplace_back(stamp, node);
+        }
+        return freed + swept;
+    }
+
+    /*
+    * Runs collect_garbage every interval on a background thread until stop_background_gc
+    * or destruction. Calling it again changes nothing while the thread runs.
+    */
+    void start_background_gc(std::chrono::milliseconds interval) {
+        std::lock_guard<std::mutex> lock(_gc_thread_mutex);
+        if (_gc_thread.joinable()) return;
+        _gc_stop = false;
+        _gc_thread = std::thread([this, interval] {
+            std::unique_lock<std::mutex> lock(_gc_thread_mutex);
+            while (!_gc_wakeup.wait_for(lock, interval, [this] { return _gc_stop; })) {
+                lock.unlock();
+                collect_garbage();
+                lock.lock();
+            }
+        });
+    }
+
+    void stop_background_gc() {
+        std::thread thread;
+        {
+            std::lock_guard<std::mutex> lock(_gc_thread_mutex);
+            _gc_stop = true;
+            thread = std::move(_gc_thread);
+        }
+        _gc_wakeup.notify_all();
+        if (thread.joinable()) thread.join();
+    }
+
+private:
+    static constexpr size_t kDefaultBuckets = 1024;
+
+    enum class WriteMode { InsertOnly, Assign, Erase };
+
+    struct Version {
+        std::optional<M> value;     // std::nullopt for a tombstone
+        uint64_t version;
+        std::atomic<Version*> older;
+
+        Version(std::optional<M> value, Version* older) : value(std::move(value)), version(0), older(older) {}
+    };
+
+    struct Node {
+        K key;
+        std::atomic<Version*> newest;
+        std::atomic<Node*> next;
+
+        Node(const K& key, Node* next) : key(key), newest(nullptr), next(next) {}
+    };
+
+    const Node* find_node(const K& key) const {
+        const Node* node = _buckets[_hash_function(key) % _bucket_count].load(std::memory_order_acquire);
+        while (node != nullptr && !(node->key == key)) node = node->next.load(std::memory_order_acquire);
+        return node;
+    }
+
+    bool write(const K& key, std::optional<M> value, WriteMode mode) {
+        size_t bucket = _hash_function(key) % _bucket_count;
+        std::lock_guard<std::mutex> lock(_stripes[bucket / _buckets_per_stripe]);
+        Node* head = _buckets[bucket].load(std::memory_order_relaxed);
+        Node* node = head;
+        while (node != nullptr && !(node->key == key)) node = node->next.load(std::memory_order_relaxed);
+
+        // writers of this key hold the stripe lock, so the newest version is the latest state
+        Version* latest = node == nullptr ? nullptr : node->newest.load(std::memory_order_relaxed);
+        bool present = latest != nullptr && latest->value.has_value();
+        if ((mode == WriteMode::InsertOnly && present) || (mode == WriteMode::Erase && !present)) return false;
+
+        if (node == nullptr) {
+            // a node without versions reads as absent until the version below is committed
+            node = new Node(key, head);
+            _buckets[bucket].store(node, std::memory_order_release);
+        }
+        auto version = new Version(std::move(value), latest);
+        _versions.fetch_add(1, std::memory_order_relaxed);
+        {
+            // the clock only moves past a version once it is reachable, so a snapshot taken at
+            // clock value v sees every write stamped at or below v
+            std::lock_guard<std::mutex> commit_lock(_commit_mutex);
+            version->version = _clock.load(std::memory_order_relaxed) + 1;
+            node->newest.store(version, std::memory_order_release);
+            _clock.store(version->version, std::memory_order_release);
+        }
+        if (mode == WriteMode::Erase) {
+            _size.fetch_sub(1, std::memory_order_relaxed);
+        } else if (!present) {
+            _size.fetch_add(1, std::memory_order_relaxed);
+        }
+        return mode == WriteMode::Erase || !present;
+    }
+
+    void release(uint64_t id) const {
+        std::lock_guard<std::mutex> lock(_snapshot_mutex);
+        _snapshots.erase(id);
+    }
+
+    // frees node with all its versions, returns the number of versions freed
+    size_t delete_node(Node* node) {
+        size_t freed = 0;
+        Version* version = node->newest.load();
+        while (version != nullptr) {
+            Version* older = version->older.load();
+            delete version;
+            freed++;
+            version = older;
+        }
+        delete node;
+        _versions.fetch_sub(freed, std::memory_order_relaxed);
+        return freed;
+    }
+
+    size_t _bucket_count;
+    size_t _buckets_per_stripe;
+    H _hash_function;
+    std::unique_ptr<std::atomic<Node*>[]> _buckets;
+    std::mutex _stripes[kStripes];
+    std::mutex _commit_mutex;
+    std::atomic<uint64_t> _clock{0};
+    std::atomic<size_t> _size{0};
+    std::atomic<size_t> _versions{0};
+
+    // live snapshots: id -> pinned clock value
+    mutable std::mutex _snapshot_mutex;
+    mutable std::map<uint64_t, uint64_t> _snapshots;
+    mutable uint64_t _next_snapshot_id = 0;
+
+    // nodes unlinked by collect_garbage, with the first snapshot id that cannot reach them
+    std::mutex _gc_mutex;
+    std::vector<std::pair<uint64_t, Node*>> _retired;
+    // clock and oldest pinned version at the start of the last sweep
+    uint64_t _swept_clock = 0;
+    uint64_t _swept_oldest_version = 0;
+
+    std::mutex _gc_thread_mutex;
+    std::condition_variable _gc_wakeup;
+    std::thread _gc_thread;
+    bool _gc_stop = false;
+};
+
+#endif
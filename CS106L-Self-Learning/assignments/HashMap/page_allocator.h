@@ -0,0 +1,374 @@
+#ifndef PAGE_ALLOCATOR_H
+#define PAGE_ALLOCATOR_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+/*
+* Page placement policy for the large allocations of a HashMap: the bucket array and the
+* slabs its nodes are carved from.
+*
+* huge_pages:
+*      None        - regular 4 KiB pages
+*      Transparent - madvise(MADV_HUGEPAGE), the kernel backs the range with 2 MiB pages
+*                    when it can (transparent huge pages must be enabled, "madvise" mode)
+*      Explicit    - mmap(MAP_HUGETLB) from the reserved pool (vm.nr_hugepages); falls back
+*                    to Transparent when the pool is empty
+* numa:
+*      Default     - first-touch placement
+*      Interleave  - pages spread round-robin over numa_nodes
+*      Bind        - pages restricted to numa_nodes
+*
+* pooled_nodes:
+*      false       - nodes are carved out of slabs only if huge pages or NUMA placement are on
+*      true        - nodes always come from slabs; with trivially destructible elements
+*                    clear() and the destructor then free them slab by slab, and with
+*                    trivially copyable keys and values a copy duplicates the slabs
+*
+* numa_nodes is a bit mask of NUMA node ids (bit i = node i); with a mask of 0 the
+* numa setting is ignored. NUMA placement uses the mbind system call directly, so there
+* is no dependency on libnuma. All of this is best effort: a failing madvise or mbind
+* leaves the memory usable with default placement.
+*
+* Usage:
+*      PagePolicy policy;
+*      policy.huge_pages = PagePolicy::HugePages::Transparent;
+*      policy.numa = PagePolicy::Numa::Interleave;
+*      policy.numa_nodes = 0b11;
+*      HashMap<int, int> map(1 << 24, std::hash<int>(), policy);
+*/
+struct PagePolicy {
+    enum class HugePages { None, Transparent, Explicit };
+    enum class Numa { Default, Interleave, Bind };
+
+    HugePages huge_pages = HugePages::None;
+    Numa numa = Numa::Default;
+    unsigned long numa_nodes = 0;
+    bool pooled_nodes = false;
+
+    bool enabled() const {
+        return huge_pages != HugePages::None || (numa != Numa::Default && numa_nodes != 0) || pooled_nodes;
+    }
+
+    friend bool operator==(const PagePolicy& lhs, const PagePolicy& rhs) {
+        return lhs.huge_pages == rhs.huge_pages && lhs.numa == rhs.numa && lhs.numa_nodes == rhs.numa_nodes
+            && lhs.pooled_nodes == rhs.pooled_nodes;
+    }
+
+    friend bool operator!=(const PagePolicy& lhs, const PagePolicy& rhs) {
+        return !(lhs == rhs);
+    }
+};
+
+constexpr size_t kHugePageBytes = size_t(1) << 21;
+
+/*
+* Maps and unmaps page-aligned memory following a PagePolicy.
+* Requests are rounded up to whole pages (whole huge pages if huge pages are requested).
+*/
+inline size_t page_mapped_size(size_t bytes, const PagePolicy& policy) {
+    size_t page = policy.huge_pages == PagePolicy::HugePages::None ? 4096 : kHugePageBytes;
+    return (bytes + page - 1) / page * page;
+}
+
+/*
+* Returns page_mapped_size(bytes, policy) bytes of zeroed memory.
+*
+* Exceptions: std::bad_alloc if the memory cannot be mapped.
+*/
+inline void* page_map(size_t bytes, const PagePolicy& policy) {
+    size_t size = page_mapped_size(bytes, policy);
+#if defined(__linux__)
+    void* memory = MAP_FAILED;
+    if (policy.huge_pages == PagePolicy::HugePages::Explicit) {
+        memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    }
+    if (memory == MAP_FAILED) {
+        memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (memory == MAP_FAILED) throw std::bad_alloc();
+        if (policy.huge_pages != PagePolicy::HugePages::None) {
+            madvise(memory, size, MADV_HUGEPAGE);
+        }
+    }
+    if (policy.numa != PagePolicy::Numa::Default && policy.numa_nodes != 0) {
+        // values of MPOL_BIND and MPOL_INTERLEAVE in <linux/mempolicy.h>
+        const int mode = policy.numa == PagePolicy::Numa::Bind ? 2 : 3;
+        unsigned long nodes = policy.numa_nodes;
+        // before any page is touched, so the policy applies to every page of the range
+        syscall(SYS_mbind, memory, size, mode, &nodes, sizeof(nodes) * 8, 0);
+    }
+    return memory;
+#else
+    return ::operator new(size);
+#endif
+}
+
+inline void page_unmap(void* memory, size_t bytes, const PagePolicy& policy) {
+    if (memory == nullptr) return;
+#if defined(__linux__)
+    munmap(memory, page_mapped_size(bytes, policy));
+#else
+    ::operator delete(memory);
+#endif
+}
+
+/*
+* STL allocator that places large arrays with page_map and small ones with operator new.
+* A default constructed PageAllocator (disabled policy) behaves exactly like std::allocator.
+*
+* The policy is part of the allocator state and propagates with the container on copy, move
+* and swap, so a bucket array keeps its placement when it is moved to another HashMap.
+*/
+template<typename T>
+class PageAllocator {
+public:
+    using value_type = T;
+    using propagate_on_container_copy_assignment = std::true_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+    PageAllocator() = default;
+    explicit PageAllocator(const PagePolicy& policy) : _policy(policy) {}
+    template<typename U>
+    PageAllocator(const PageAllocator<U>& other) : _policy(other.policy()) {}
+
+    T* allocate(size_t count) {
+        size_t bytes = count * sizeof(T);
+        if (use_pages(bytes)) return static_cast<T*>(page_map(bytes, _policy));
+        return static_cast<T*>(::operator new(bytes));
+    }
+
+    void deallocate(T* memory, size_t count) {
+        size_t bytes = count * sizeof(T);
+        if (use_pages(bytes)) {
+            page_unmap(memory, bytes, _policy);
+        } else {
+            ::operator delete(memory);
+        }
+    }
+
+    const PagePolicy& policy() const { return _policy; }
+
+    friend bool operator==(const PageAllocator& lhs, const PageAllocator& rhs) {
+        return lhs._policy == rhs._policy;
+    }
+
+    friend bool operator!=(const PageAllocator& lhs, const PageAllocator& rhs) {
+        return !(lhs == rhs);
+    }
+
+private:
+    // below this, a dedicated mapping wastes more than it saves in TLB reach
+    static constexpr size_t kMinPageBytes = size_t(1) << 16;
+
+    bool use_pages(size_t bytes) const {
+        return _policy.enabled() && bytes >= kMinPageBytes;
+    }
+
+    PagePolicy _policy;
+};
+
+/*
+* Fixed-size object pool that carves nodes out of large slabs mapped with page_map.
+* Freed nodes go to an intrusive free list and are reused before the slab is bumped.
+* The pool hands out raw storage; constructing and destroying the node is up to the caller.
+*
+* The first slab is slab_bytes long and each one after it twice the previous, up to
+* kHugePageBytes (or slab_bytes, if larger): a pool sized for a small map starts small
+* without mapping one small slab after another once the map grows.
+*
+* Usage:
+*      SlabPool<Node> pool(policy);
+*      Node* node = new (pool.allocate()) Node(value, nullptr);
+*      node->~Node();
+*      pool.deallocate(node);
+*/
+template<typename Node>
+class SlabPool {
+public:
+    explicit SlabPool(const PagePolicy& policy, size_t slab_bytes = kHugePageBytes) :
+        _policy(policy),
+        _next_slab_bytes(page_mapped_size(std::max(slab_bytes, kSlotSize), policy)),
+        _max_slab_bytes(std::max(_next_slab_bytes, kHugePageBytes)) {}
+
+    SlabPool(const SlabPool&) = delete;
+    SlabPool& operator=(const SlabPool&) = delete;
+
+    ~SlabPool() {
+        release_all();
+    }
+
+    void* allocate() {
+        if (_free_list != nullptr) {
+            FreeSlot* slot = _free_list;
+            _free_list = slot->next;
+            return slot;
+        }
+        if (static_cast<size_t>(_bump_end - _bump) < kSlotSize) {
+            // after a reset, the slabs already mapped are bumped again before a new one
+            if (_bump == nullptr || _current + 1 == _slabs.size()) {
+                map_slab();
+                _current = _slabs.size() - 1;
+            } else {
+                _current++;
+            }
+            _bump = _slabs[_current].memory;
+            _bump_end = _bump + _slabs[_current].bytes;
+        }
+        void* slot = _bump;
+        _bump += kSlotSize;
+        return slot;
+    }
+
+    void deallocate(void* node) {
+        _free_list = new (node) FreeSlot{_free_list};
+    }
+
+    /*
+    * Frees every node at once but keeps the slabs mapped: allocation starts over at the
+    * first slab, and the slabs are bumped again in order before a new one is mapped.
+    * Every node must already have been destroyed.
+    *
+    * Complexity: O(1)
+    */
+    void reset() {
+        _free_list = nullptr;
+        _current = 0;
+        _bump = _bump_end = nullptr;
+        if (!_slabs.empty()) {
+            _bump = _slabs.front().memory;
+            _bump_end = _bump + _slabs.front().bytes;
+        }
+    }
+
+    /*
+    * Unmaps all slabs at once. The next slab mapped is as large as the last one was, so a
+    * refilled pool does not grow through the small sizes again.
+    * Every node must already have been destroyed.
+    */
+    void release_all() {
+        for (const Slab& slab : _slabs) page_unmap(slab.memory, slab.bytes, _policy);
+        _slabs.clear();
+        _bytes = 0;
+        _free_list = nullptr;
+        _current = 0;
+        _bump = _bump_end = nullptr;
+    }
+
+    size_t bytes() const {
+        return _bytes;
+    }
+
+    size_t slab_count() const {
+        return _slabs.size();
+    }
+
+    /*
+    * Maps a pointer into the slabs of the pool a copy was made from to the same slot of the
+    * copy; nullptr stays nullptr. Returned by copy_from.
+    *
+    * Complexity: O(log S), S = number of slabs
+    */
+    class Relocation {
+    public:
+        template<typename T>
+        T* operator()(T* pointer) const {
+            if (pointer == nullptr) return nullptr;
+            const char* address = reinterpret_cast<const char*>(pointer);
+            // the last slab starting at or before address is the one holding it
+            auto slab = std::upper_bound(_slabs.begin(), _slabs.end(), address,
+                [](const char* target, const auto& entry) { return target < entry.first; }) - 1;
+            return reinterpret_cast<T*>(slab->second + (address - slab->first));
+        }
+
+    private:
+        friend class SlabPool;
+        std::vector<std::pair<const char*, char*>> _slabs;   // {source slab, copy}, by source address
+    };
+
+    /*
+    * Copies every slab of other that is in use byte for byte into this pool, which must be
+    * empty, including its free list and bump position; slabs kept unused by a reset are not
+    * copied. The nodes are not constructed, so this is only valid for nodes that can be copied
+    * with memcpy. Pointers stored inside the nodes still point into other; the caller fixes
+    * them up with the returned Relocation.
+    *
+    * Complexity: O(S log S) plus copying S slabs, S = number of slabs
+    */
+    Relocation copy_from(const SlabPool& other) {
+        Relocation relocation;
+        _next_slab_bytes = other._next_slab_bytes;
+        _max_slab_bytes = other._max_slab_bytes;
+        // slabs past the bumped one are only there for reuse
+        size_t used = other._bump == nullptr ? 0 : other._current + 1;
+        for (size_t index = 0; index < used; index++) {
+            const Slab& source = other._slabs[index];
+            char* slab = static_cast<char*>(page_map(source.bytes, _policy));
+            _slabs.push_back({slab, source.bytes});
+            _bytes += source.bytes;
+            std::memcpy(slab, source.memory, source.bytes);
+            relocation._slabs.push_back({source.memory, slab});
+        }
+        std::sort(relocation._slabs.begin(), relocation._slabs.end());
+
+        // _bump can sit one past the end of its slab
+        if (used > 0) {
+            _current = used - 1;
+            _bump = _slabs[_current].memory + (other._bump - other._slabs[_current].memory);
+            _bump_end = _slabs[_current].memory + _slabs[_current].bytes;
+        }
+        _free_list = relocation(other._free_list);
+        for (FreeSlot* slot = _free_list; slot != nullptr; slot = slot->next) {
+            slot->next = relocation(slot->next);
+        }
+        return relocation;
+    }
+
+    const PagePolicy& policy() const { return _policy; }
+
+private:
+    struct FreeSlot {
+        FreeSlot* next;
+    };
+
+    struct Slab {
+        char* memory;
+        size_t bytes;
+    };
+
+    void map_slab() {
+        _slabs.push_back({static_cast<char*>(page_map(_next_slab_bytes, _policy)), _next_slab_bytes});
+        _bytes += _next_slab_bytes;
+        if (_next_slab_bytes < _max_slab_bytes) {
+            _next_slab_bytes = page_mapped_size(std::min(2 * _next_slab_bytes, _max_slab_bytes), _policy);
+        }
+    }
+
+    static constexpr size_t kSlotAlign = std::max(alignof(Node), alignof(FreeSlot));
+    static constexpr size_t kSlotSize = (std::max(sizeof(Node), sizeof(FreeSlot)) + kSlotAlign - 1) / kSlotAlign * kSlotAlign;
+
+    PagePolicy _policy;
+    size_t _next_slab_bytes;
+    size_t _max_slab_bytes;
+    size_t _bytes = 0;
+    std::vector<Slab> _slabs;
+    // the slab being bumped, valid while _bump is set
+    size_t _current = 0;
+    FreeSlot* _free_list = nullptr;
+    char* _bump = nullptr;
+    char* _bump_end = nullptr;
+};
+
+#endif
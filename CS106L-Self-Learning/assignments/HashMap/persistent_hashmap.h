@@ -0,0 +1,474 @@
+#ifndef PERSISTENT_HASHMAP_H
+#define PERSISTENT_HASHMAP_H
+
+#include <cstdint>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+/*
+* Template class for a persistent (immutable) hash map
+*
+* K = key type
+* M = mapped type
+* H = hash function type used to hash a key; if not provided, defaults to std::hash<K>
+*
+* PersistentHashMap is a hash array mapped trie in the CHAMP layout. Every node covers 5
+* bits of the hash and has two 32-bit bitmaps: datamap marks the slots that hold an element
+* inline, nodemap the slots that hold a sub-node. Both are stored as dense arrays indexed by
+* the popcount of the bitmap below the slot, so a node only pays for the slots it uses.
+* Keys whose 64-bit hashes are all equal end up in a collision node below the last level.
+*
+* Nodes are never modified once built. An update copies the O(log32 N) nodes on the path
+* from the root to the element and shares everything else with the previous version, so
+*      - copying the map, or snapshot(), is O(1): both versions share the same root,
+*      - a snapshot never observes later updates, and can be read from other threads while
+*        the original keeps being updated (the reference counts are atomic).
+*
+* Usage:
+*      PersistentHashMap<std::string, int> map;
+*      map.insert({"Avery", 3});
+*      auto view = map.snapshot();     // O(1), sees {"Avery", 3} forever
+*      map.erase("Avery");
+*      view.at("Avery");               // still 3
+*
+* Notes: elements are stored as std::pair<K, M> and only exposed as const references;
+* iterators are invalidated by updates of the map they came from (not of its snapshots).
+*
+* Concept requirements:
+*      - H is function type that with function prototype size_t hash(const K& key).
+*      - K and M must be copyable, K equality comparable.
+*/
+template<typename K, typename M, typename H = std::hash<K>>
+class PersistentHashMap {
+    struct Node;
+    using node_ptr = std::shared_ptr<const Node>;
+
+public:
+    using value_type = std::pair<const K, M>;
+
+    /*
+    * Forward iterator over the elements: a pre-order walk of the trie that visits the
+    * elements inlined in a node, then its sub-nodes in slot order. It keeps the path from
+    * the root, so an iterator returned by find() continues the walk like any other.
+    */
+    class const_iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = const std::pair<K, M>;
+        using difference_type = std::ptrdiff_t;
+        using pointer = value_type*;
+        using reference = value_type&;
+
+        const_iterator() : _index(0) {}
+
+        reference operator*() const { return node()->entries[_index]; }
+        pointer operator->() const { return &node()->entries[_index]; }
+
+        const_iterator& operator++() {
+            if (++_index >= node()->entries.size()) next_node();
+            return *this;
+        }
+
+        const_iterator operator++(int) {
+            auto copy = *this;
+            ++*this;
+            return copy;
+        }
+
+        friend bool operator==(const const_iterator& lhs, const const_iterator& rhs) {
+            return lhs.node() == rhs.node() && lhs._index == rhs._index;
+        }
+
+        friend bool operator!=(const const_iterator& lhs, const const_iterator& rhs) {
+            return !(lhs == rhs);
+        }
+
+    private:
+        friend class PersistentHashMap;
+
+        explicit const_iterator(const Node* root) : _index(0) {
+            _path.push_back({root, 0});
+            if (root->entries.empty()) next_node();
+        }
+
+        const Node* node() const {
+            return _path.empty() ? nullptr : _path.back().first;
+        }
+
+        // moves to the first element of the next node in pre-order that has elements, or to end()
+        void next_node() {
+            _index = 0;
+            while (!_path.empty()) {
+                auto& [node, next_child] = _path.back();
+                if (next_child == node->children.size()) {
+                    _path.pop_back();
+                    continue;
+                }
+                const Node* child = node->children[next_child++].get();
+                _path.push_back({child, 0});
+                if (!child->entries.empty()) return;
+            }
+        }
+
+        // {node, index of the next sub-node to visit} from the root down to the current node
+        std::vector<std::pair<const Node*, size_t>> _path;
+        size_t _index;
+    };
+
+    using iterator = const_iterator;
+
+    /*
+    * Creates an empty map.
+    */
+    explicit PersistentHashMap(const H& hash = H());
+
+    template<typename InputIter>
+    PersistentHashMap(InputIter begin, InputIter end, const H& hash = H());
+    PersistentHashMap(std::initializer_list<value_type> init, const H& hash = H());
+
+    size_t size() const;
+    bool empty() const;
+
+    /*
+    * Lookups, with the semantics of HashMap.
+    *
+    * Exceptions: at throws std::out_of_range if key is not in the map.
+    *
+    * Complexity: O(log32 N), at most 13 levels for a 64-bit hash
+    */
+    bool contains(const K& key) const;
+    const M& at(const K& key) const;
+    const_iterator find(const K& key) const;
+
+    /*
+    * Updates, with the semantics of HashMap::insert, operator[] assignment and erase.
+    * Each copies the nodes on one root-to-leaf path; unchanged maps copy nothing.
+    *
+    * Complexity: O(log32 N) time and new nodes
+    */
+    bool insert(const value_type& value);
+    void insert_or_assign(const K& key, const M& mapped);
+    bool erase(const K& key);
+    void clear();
+
+    /*
+    * Returns a map sharing all nodes with this one, which later updates of either map
+    * do not affect. Same as copying the map.
+    *
+    * Complexity: O(1)
+    */
+    PersistentHashMap snapshot() const;
+
+    const_iterator begin() const;
+    const_iterator end() const;
+
+private:
+    /*
+    * A trie node. Below the last hash level (shift >= kHashBits) a node is a collision node:
+    * both bitmaps are 0 and entries is an unordered list of elements with equal hashes.
+    */
+    struct Node {
+        uint32_t datamap = 0;
+        uint32_t nodemap = 0;
+        std::vector<std::pair<K, M>> entries;
+        std::vector<node_ptr> children;
+    };
+
+    static constexpr unsigned kBitsPerLevel = 5;
+    static constexpr unsigned kHashBits = 64;
+
+    static unsigned fragment(uint64_t hash, unsigned shift);
+    static unsigned index_below(uint32_t bitmap, uint32_t bit);
+
+    uint64_t hash_of(const K& key) const;
+    const std::pair<K, M>* lookup(const K& key) const;
+
+    node_ptr insert_into(const node_ptr& node, unsigned shift, uint64_t hash,
+                         const K& key, const M& mapped, bool assign, bool& inserted) const;
+    node_ptr merge(std::pair<K, M> first, uint64_t first_hash,
+                   std::pair<K, M> second, uint64_t second_hash, unsigned shift) const;
+    node_ptr erase_from(const node_ptr& node, unsigned shift, uint64_t hash, const K& key, bool& erased) const;
+
+    H _hash_function;
+    node_ptr _root;
+    size_t _size;
+};
+
+template<typename K, typename M, typename H>
+PersistentHashMap<K, M, H>::PersistentHashMap(const H& hash) :
+    _hash_function(hash),
+    _root(std::make_shared<const Node>()),
+    _size(0) {}
+
+template<typename K, typename M, typename H>
+template<typename InputIter>
+PersistentHashMap<K, M, H>::PersistentHashMap(InputIter begin, InputIter end, const H& hash) :
+    PersistentHashMap(hash)
+{
+    for (InputIter it = begin; it != end; ++it) {
+        insert(*it);
+    }
+}
+
+template<typename K, typename M, typename H>
+PersistentHashMap<K, M, H>::PersistentHashMap(std::initializer_list<value_type> init, const H& hash) :
+    PersistentHashMap(init.begin(), init.end(), hash) {}
+
+template<typename K, typename M, typename H>
+size_t PersistentHashMap<K, M, H>::size() const {
+    return _size;
+}
+
+template<typename K, typename M, typename H>
+bool PersistentHashMap<K, M, H>::empty() const {
+    return _size == 0;
+}
+
+template<typename K, typename M, typename H>
+bool PersistentHashMap<K, M, H>::contains(const K& key) const {
+    return lookup(key) != nullptr;
+}
+
+template<typename K, typename M, typename H>
+const M& PersistentHashMap<K, M, H>::at(const K& key) const {
+    const std::pair<K, M>* entry = lookup(key);
+    if (entry == nullptr) {
+        throw std::out_of_range("PersistentHashMap<K, M, H>::at: key not found");
+    }
+    return entry->second;
+}
+
+template<typename K, typename M, typename H>
+typename PersistentHashMap<K, M, H>::const_iterator PersistentHashMap<K, M, H>::find(const K& key) const {
+    // the same walk as lookup, recording the path so the iterator can continue from there
+    uint64_t hash = hash_of(key);
+    const_iterator iter;
+    const Node* node = _root.get();
+    for (unsigned shift = 0; shift < kHashBits; shift += kBitsPerLevel) {
+        uint32_t bit = 1u << fragment(hash, shift);
+        if (node->datamap & bit) {
+            unsigned index = index_below(node->datamap, bit);
+            if (node->entries[index].first != key) return end();
+            iter._path.push_back({node, 0});
+            iter._index = index;
+            return iter;
+        }
+        if (!(node->nodemap & bit)) return end();
+        unsigned index = index_below(node->nodemap, bit);
+        iter._path.push_back({node, index + 1});
+        node = node->children[index].get();
+    }
+    for (size_t i = 0; i < node->entries.size(); i++) {
+        if (node->entries[i].first != key) continue;
+        iter._path.push_back({node, 0});
+        iter._index = i;
+        return iter;
+    }
+    return end();
+}
+
+template<typename K, typename M, typename H>
+bool PersistentHashMap<K, M, H>::insert(const value_type& value) {
+    bool inserted = false;
+    _root = insert_into(_root, 0, hash_of(value.first), value.first, value.second, false, inserted);
+    _size += inserted;
+    return inserted;
+}
+
+template<typename K, typename M, typename H>
+void PersistentHashMap<K, M, H>::insert_or_assign(const K& key, const M& mapped) {
+    bool inserted = false;
+    _root = insert_into(_root, 0, hash_of(key), key, mapped, true, inserted);
+    _size += inserted;
+}
+
+template<typename K, typename M, typename H>
+bool PersistentHashMap<K, M, H>::erase(const K& key) {
+    bool erased = false;
+    _root = erase_from(_root, 0, hash_of(key), key, erased);
+    _size -= erased;
+    return erased;
+}
+
+template<typename K, typename M, typename H>
+void PersistentHashMap<K, M, H>::clear() {
+    _root = std::make_shared<const Node>();
+    _size = 0;
+}
+
+template<typename K, typename M, typename H>
+PersistentHashMap<K, M, H> PersistentHashMap<K, M, H>::snapshot() const {
+    return *this;
+}
+
+template<typename K, typename M, typename H>
+typename PersistentHashMap<K, M, H>::const_iterator PersistentHashMap<K, M, H>::begin() const {
+    return const_iterator(_root.get());
+}
+
+template<typename K, typename M, typename H>
+typename PersistentHashMap<K, M, H>::const_iterator PersistentHashMap<K, M, H>::end() const {
+    return const_iterator();
+}
+
+template<typename K, typename M, typename H>
+unsigned PersistentHashMap<K, M, H>::fragment(uint64_t hash, unsigned shift) {
+    return static_cast<unsigned>(hash >> shift) & ((1u << kBitsPerLevel) - 1);
+}
+
+template<typename K, typename M, typename H>
+unsigned PersistentHashMap<K, M, H>::index_below(uint32_t bitmap, uint32_t bit) {
+    return static_cast<unsigned>(__builtin_popcount(bitmap & (bit - 1)));
+}
+
+template<typename K, typename M, typename H>
+uint64_t PersistentHashMap<K, M, H>::hash_of(const K& key) const {
+    return static_cast<uint64_t>(_hash_function(key));
+}
+
+template<typename K, typename M, typename H>
+const std::pair<K, M>* PersistentHashMap<K, M, H>::lookup(const K& key) const {
+    uint64_t hash = hash_of(key);
+    const Node* node = _root.get();
+    for (unsigned shift = 0; shift < kHashBits; shift += kBitsPerLevel) {
+        uint32_t bit = 1u << fragment(hash, shift);
+        if (node->datamap & bit) {
+            const auto& entry = node->entries[index_below(node->datamap, bit)];
+            return entry.first == key ? &entry : nullptr;
+        }
+        if (!(node->nodemap & bit)) return nullptr;
+        node = node->children[index_below(node->nodemap, bit)].get();
+    }
+    for (const auto& entry : node->entries) {
+        if (entry.first == key) return &entry;
+    }
+    return nullptr;
+}
+
+template<typename K, typename M, typename H>
+typename PersistentHashMap<K, M, H>::node_ptr
+PersistentHashMap<K, M, H>::insert_into(const node_ptr& node, unsigned shift, uint64_t hash,
+                                        const K& key, const M& mapped, bool assign, bool& inserted) const {
+    if (shift >= kHashBits) {
+        for (size_t i = 0; i < node->entries.size(); i++) {
+            if (node->entries[i].first != key) continue;
+            if (!assign) return node;
+            auto copy = std::make_shared<Node>(*node);
+            copy->entries[i].second = mapped;
+            return copy;
+        }
+        auto copy = std::make_shared<Node>(*node);
+        copy->entries.emplace_back(key, mapped);
+        inserted = true;
+        return copy;
+    }
+
+    uint32_t bit = 1u << fragment(hash, shift);
+    if (node->datamap & bit) {
+        unsigned index = index_below(node->datamap, bit);
+        const auto& entry = node->entries[index];
+        if (entry.first == key) {
+            if (!assign) return node;
+            auto copy = std::make_shared<Node>(*node);
+            copy->entries[index].second = mapped;
+            return copy;
+        }
+        // two keys share this slot: push both one level down
+        node_ptr child = merge(entry, hash_of(entry.first), {key, mapped}, hash, shift + kBitsPerLevel);
+        auto copy = std::make_shared<Node>(*node);
+        copy->entries.erase(copy->entries.begin() + index);
+        copy->datamap ^= bit;
+        copy->nodemap |= bit;
+        copy->children.insert(copy->children.begin() + index_below(copy->nodemap, bit), std::move(child));
+        inserted = true;
+        return copy;
+    }
+    if (node->nodemap & bit) {
+        unsigned index = index_below(node->nodemap, bit);
+        node_ptr child = insert_into(node->children[index], shift + kBitsPerLevel, hash, key, mapped, assign, inserted);
+        if (child == node->children[index]) return node;
+        auto copy = std::make_shared<Node>(*node);
+        copy->children[index] = std::move(child);
+        return copy;
+    }
+    auto copy = std::make_shared<Node>(*node);
+    copy->entries.emplace(copy->entries.begin() + index_below(node->datamap, bit), key, mapped);
+    copy->datamap |= bit;
+    inserted = true;
+    return copy;
+}
+
+template<typename K, typename M, typename H>
+typename PersistentHashMap<K, M, H>::node_ptr
+PersistentHashMap<K, M, H>::merge(std::pair<K, M> first, uint64_t first_hash,
+                                  std::pair<K, M> second, uint64_t second_hash, unsigned shift) const {
+    auto node = std::make_shared<Node>();
+    if (shift >= kHashBits) {
+        node->entries.push_back(std::move(first));
+        node->entries.push_back(std::move(second));
+        return node;
+    }
+    unsigned first_fragment = fragment(first_hash, shift);
+    unsigned second_fragment = fragment(second_hash, shift);
+    if (first_fragment == second_fragment) {
+        node->nodemap = 1u << first_fragment;
+        node->children.push_back(merge(std::move(first), first_hash, std::move(second), second_hash,
+                                       shift + kBitsPerLevel));
+        return node;
+    }
+    node->datamap = (1u << first_fragment) | (1u << second_fragment);
+    if (first_fragment > second_fragment) std::swap(first, second);
+    node->entries.push_back(std::move(first));
+    node->entries.push_back(std::move(second));
+    return node;
+}
+
+template<typename K, typename M, typename H>
+typename PersistentHashMap<K, M, H>::node_ptr
+PersistentHashMap<K, M, H>::erase_from(const node_ptr& node, unsigned shift, uint64_t hash,
+                                       const K& key, bool& erased) const {
+    if (shift >= kHashBits) {
+        for (size_t i = 0; i < node->entries.size(); i++) {
+            if (node->entries[i].first != key) continue;
+            auto copy = std::make_shared<Node>(*node);
+            copy->entries.erase(copy->entries.begin() + i);
+            erased = true;
+            return copy;
+        }
+        return node;
+    }
+
+    uint32_t bit = 1u << fragment(hash, shift);
+    if (node->datamap & bit) {
+        unsigned index = index_below(node->datamap, bit);
+        if (node->entries[index].first != key) return node;
+        auto copy = std::make_shared<Node>(*node);
+        copy->entries.erase(copy->entries.begin() + index);
+        copy->datamap ^= bit;
+        erased = true;
+        return copy;
+    }
+    if (!(node->nodemap & bit)) return node;
+
+    unsigned index = index_below(node->nodemap, bit);
+    node_ptr child = erase_from(node->children[index], shift + kBitsPerLevel, hash, key, erased);
+    if (child == node->children[index]) return node;
+
+    auto copy = std::make_shared<Node>(*node);
+    if (child->children.empty() && child->entries.size() == 1) {
+        // canonical form: a sub-node left with a single element is inlined into its parent
+        copy->children.erase(copy->children.begin() + index);
+        copy->nodemap ^= bit;
+        copy->datamap |= bit;
+        copy->entries.insert(copy->entries.begin() + index_below(copy->datamap, bit), child->entries.front());
+    } else {
+        copy->children[index] = std::move(child);
+    }
+    return copy;
+}
+
+#endif
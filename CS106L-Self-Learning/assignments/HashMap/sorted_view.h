@@ -0,0 +1,291 @@
+#ifndef SORTED_VIEW_H
+#define SORTED_VIEW_H
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <iterator>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/*
+* Sorted exports of chained hash tables: HashMap::sorted_view and HashMap::to_sorted_vector
+* are built from the pieces in this file.
+*
+* The elements are gathered as pointers, one contiguous slice of the bucket array per
+* thread, into an array sized up front. The pointers are then sorted, by a parallel LSD
+* radix sort when the key is an integer and the order is std::less, and otherwise by
+* sorting one run per thread with std::sort and merging the runs pairwise in parallel.
+*/
+
+// below this many elements per thread, a thread costs more than it saves
+constexpr size_t kMinSortElementsPerThread = 1 << 14;
+
+/*
+* Template class for a forward-and-back, random access iterator over a SortedView.
+*
+* V = element type of the view; the iterator walks an array of const V*.
+*/
+template<typename V>
+class SortedViewIterator {
+public:
+    using value_type = const V;
+    using iterator_category = std::random_access_iterator_tag;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const V*;
+    using reference = const V&;
+
+    SortedViewIterator() : _slot(nullptr) {}
+    explicit SortedViewIterator(const V* const* slot) : _slot(slot) {}
+
+    reference operator*() const { return **_slot; }
+    pointer operator->() const { return *_slot; }
+    reference operator[](difference_type n) const { return *_slot[n]; }
+
+    SortedViewIterator& operator++() { ++_slot; return *this; }
+    SortedViewIterator operator++(int) { auto copy = *this; ++_slot; return copy; }
+    SortedViewIterator& operator--() { --_slot; return *this; }
+    SortedViewIterator operator--(int) { auto copy = *this; --_slot; return copy; }
+    SortedViewIterator& operator+=(difference_type n) { _slot += n; return *this; }
+    SortedViewIterator& operator-=(difference_type n) { _slot -= n; return *this; }
+
+    friend SortedViewIterator operator+(SortedViewIterator iter, difference_type n) { return iter += n; }
+    friend SortedViewIterator operator+(difference_type n, SortedViewIterator iter) { return iter += n; }
+    friend SortedViewIterator operator-(SortedViewIterator iter, difference_type n) { return iter -= n; }
+    friend difference_type operator-(const SortedViewIterator& lhs, const SortedViewIterator& rhs) {
+        return lhs._slot - rhs._slot;
+    }
+
+    friend bool operator==(const SortedViewIterator& lhs, const SortedViewIterator& rhs) { return lhs._slot == rhs._slot; }
+    friend bool operator!=(const SortedViewIterator& lhs, const SortedViewIterator& rhs) { return lhs._slot != rhs._slot; }
+    friend bool operator<(const SortedViewIterator& lhs, const SortedViewIterator& rhs) { return lhs._slot < rhs._slot; }
+    friend bool operator>(const SortedViewIterator& lhs, const SortedViewIterator& rhs) { return lhs._slot > rhs._slot; }
+    friend bool operator<=(const SortedViewIterator& lhs, const SortedViewIterator& rhs) { return lhs._slot <= rhs._slot; }
+    friend bool operator>=(const SortedViewIterator& lhs, const SortedViewIterator& rhs) { return lhs._slot >= rhs._slot; }
+
+private:
+    const V* const* _slot;
+};
+
+/*
+* Template class for a read-only, random access view of a container's elements in a
+* sorted order. The view holds one pointer per element and no copies of the elements.
+*
+* V = element type, such as HashMap<K, M, H>::value_type
+*
+* Usage:
+*      auto view = map.sorted_view();
+*      for (const auto& [key, mapped] : view) ...
+*      const auto& median = view[view.size() / 2];
+*
+* Notes: the view points into the container. Inserting into the container does not
+* invalidate it (the new element is just not in the view). Anything that destroys or
+* moves elements does: erasing, clearing, assigning or destroying the container, and
+* HashMap::optimize_for_reads.
+*/
+template<typename V>
+class SortedView {
+public:
+    using value_type = V;
+    using iterator = SortedViewIterator<V>;
+    using const_iterator = iterator;
+
+    SortedView() = default;
+    explicit SortedView(std::vector<const V*> elements) : _elements(std::move(elements)) {}
+
+    size_t size() const { return _elements.size(); }
+    bool empty() const { return _elements.empty(); }
+
+    const V& operator[](size_t index) const { return *_elements[index]; }
+    const V& front() const { return *_elements.front(); }
+    const V& back() const { return *_elements.back(); }
+
+    iterator begin() const { return iterator(_elements.data()); }
+    iterator end() const { return iterator(_elements.data() + _elements.size()); }
+
+private:
+    std::vector<const V*> _elements;
+};
+
+/*
+* Threads to use for n elements: threads if set, otherwise one per core, but no more than
+* one per kMinSortElementsPerThread elements.
+*/
+inline size_t sort_thread_count(size_t n, size_t threads) {
+    if (threads != 0) return threads;
+    threads = std::max(1u, std::thread::hardware_concurrency());
+    return std::max<size_t>(1, std::min(threads, n / kMinSortElementsPerThread));
+}
+
+/*
+* Runs task(0), ..., task(count - 1), each on its own thread except task(0), which runs
+* on the calling thread (as does any task a thread could not be started for). The first
+* exception thrown by a task is rethrown once all of them have finished.
+*/
+template<typename Task>
+void run_parallel(size_t count, Task task) {
+    std::vector<std::exception_ptr> errors(count);
+    auto guarded = [&](size_t i) {
+        try {
+            task(i);
+        } catch (...) {
+            errors[i] = std::current_exception();
+        }
+    };
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < count; i++) {
+        try {
+            workers.emplace_back(guarded, i);
+        } catch (const std::system_error&) {
+            guarded(i);
+        }
+    }
+    if (count > 0) guarded(0);
+    for (auto& worker : workers) worker.join();
+    for (const auto& error : errors) {
+        if (error) std::rethrow_exception(error);
+    }
+}
+
+/*
+* Sets out to make(node) for every node of the chains in buckets, size nodes in all, in
+* bucket order. Each of threads threads counts, then fills, one contiguous range of
+* buckets, so out is allocated once and no element is moved after it is written.
+*/
+template<typename BucketArray, typename T, typename Make>
+void gather_chains(const BucketArray& buckets, size_t size, size_t threads, Make make, std::vector<T>& out) {
+    out.resize(size);
+    threads = std::max<size_t>(1, std::min(threads, buckets.size()));
+    std::vector<size_t> offsets(threads + 1, 0);
+    auto range = [&](size_t i) { return std::make_pair(i * buckets.size() / threads, (i + 1) * buckets.size() / threads); };
+    if (threads > 1) {
+        run_parallel(threads, [&](size_t i) {
+            auto [first, last] = range(i);
+            size_t count = 0;
+            for (size_t bucket = first; bucket < last; bucket++) {
+                for (auto node = buckets[bucket]; node != nullptr; node = node->next) count++;
+            }
+            offsets[i + 1] = count;
+        });
+        for (size_t i = 0; i < threads; i++) offsets[i + 1] += offsets[i];
+    }
+    run_parallel(threads, [&](size_t i) {
+        auto [first, last] = range(i);
+        size_t slot = offsets[i];
+        for (size_t bucket = first; bucket < last; bucket++) {
+            for (auto node = buckets[bucket]; node != nullptr; node = node->next) out[slot++] = make(node);
+        }
+    });
+}
+
+/*
+* Sorts elements with std::sort on one run per thread, then merges pairs of runs on
+* parallel threads until one run is left (log2(threads) rounds).
+*
+* Complexity: O(N log N / T + N log T), T = threads
+*/
+template<typename T, typename Compare>
+void parallel_merge_sort(std::vector<T>& elements, Compare comp, size_t threads) {
+    if (threads <= 1) {
+        std::sort(elements.begin(), elements.end(), comp);
+        return;
+    }
+    std::vector<size_t> bounds;
+    for (size_t i = 0; i <= threads; i++) bounds.push_back(i * elements.size() / threads);
+    run_parallel(threads, [&](size_t i) {
+        std::sort(elements.begin() + bounds[i], elements.begin() + bounds[i + 1], comp);
+    });
+
+    std::vector<T> buffer(elements.size());
+    while (bounds.size() > 2) {
+        size_t runs = bounds.size() - 1;
+        std::vector<size_t> merged;
+        for (size_t i = 0; i < runs; i += 2) merged.push_back(bounds[i]);
+        merged.push_back(bounds.back());
+        run_parallel((runs + 1) / 2, [&](size_t pair) {
+            size_t first = bounds[2 * pair];
+            size_t middle = bounds[std::min(2 * pair + 1, runs)];
+            size_t last = bounds[std::min(2 * pair + 2, runs)];
+            std::merge(elements.begin() + first, elements.begin() + middle, elements.begin() + middle,
+                       elements.begin() + last, buffer.begin() + first, comp);
+        });
+        elements.swap(buffer);
+        bounds.swap(merged);
+    }
+}
+
+/*
+* Element of a radix sort: an integer key, with the sign bit flipped for signed types so
+* that unsigned order is key order, and the element it belongs to.
+*/
+template<typename U, typename P>
+struct RadixEntry {
+    U key;
+    P element;
+};
+
+template<typename K>
+constexpr bool kRadixSortable = std::is_integral_v<K> && !std::is_same_v<K, bool>;
+
+template<typename K>
+std::make_unsigned_t<K> radix_key(K key) {
+    using U = std::make_unsigned_t<K>;
+    if constexpr (std::is_signed_v<K>) {
+        return static_cast<U>(static_cast<U>(key) ^ (U(1) << (8 * sizeof(K) - 1)));
+    } else {
+        return key;
+    }
+}
+
+/*
+* Stable LSD radix sort by key, one byte per pass. In every pass each thread counts the
+* digits of its slice, the counts give every (thread, digit) its output range, and each
+* thread scatters its slice. A pass in which every key has the same digit is skipped,
+* so keys that only use their low bytes need only as many passes as they use.
+*
+* Complexity: O(sizeof(U) * (N / T + 256 T)), T = threads
+*/
+template<typename U, typename P>
+void parallel_radix_sort(std::vector<RadixEntry<U, P>>& entries, size_t threads) {
+    constexpr size_t kDigits = 256;
+    threads = std::max<size_t>(1, threads);
+    std::vector<RadixEntry<U, P>> buffer(entries.size());
+    std::vector<std::array<size_t, kDigits>> counts(threads);
+    auto slice = [&](size_t i) { return std::make_pair(i * entries.size() / threads, (i + 1) * entries.size() / threads); };
+
+    for (size_t shift = 0; shift < 8 * sizeof(U); shift += 8) {
+        run_parallel(threads, [&](size_t i) {
+            counts[i].fill(0);
+            auto [first, last] = slice(i);
+            for (size_t j = first; j < last; j++) counts[i][(entries[j].key >> shift) & 0xff]++;
+        });
+
+        size_t total = 0;
+        bool one_digit = false;
+        for (size_t digit = 0; digit < kDigits; digit++) {
+            size_t in_digit = 0;
+            for (size_t i = 0; i < threads; i++) {
+                size_t count = counts[i][digit];
+                counts[i][digit] = total;
+                total += count;
+                in_digit += count;
+            }
+            one_digit = one_digit || in_digit == entries.size();
+        }
+        if (one_digit) continue;
+
+        run_parallel(threads, [&](size_t i) {
+            auto [first, last] = slice(i);
+            for (size_t j = first; j < last; j++) buffer[counts[i][(entries[j].key >> shift) & 0xff]++] = entries[j];
+        });
+        entries.swap(buffer);
+    }
+}
+
+#endif
@@ -0,0 +1,163 @@
+#ifndef STATIC_HASHMAP_H
+#define STATIC_HASHMAP_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+#include "hashers.h"
+
+/*
+* Hash functions that can run at compile time, the default H of StaticHashMap.
+* Integers and enums go through mix64; std::string_view uses 64-bit FNV-1a, one byte at a
+* time, since StringHash reads words with memcpy, which is not constexpr.
+*/
+template<typename K, typename Enable = void>
+struct ConstexprHash;
+
+template<typename K>
+struct ConstexprHash<K, std::enable_if_t<std::is_integral_v<K> || std::is_enum_v<K>>> {
+    constexpr size_t operator()(K key) const {
+        return static_cast<size_t>(mix64(static_cast<uint64_t>(key)));
+    }
+};
+
+template<>
+struct ConstexprHash<std::string_view> {
+    constexpr size_t operator()(std::string_view key) const {
+        uint64_t hash = 0xcbf29ce484222325ULL;
+        for (char c : key) {
+            hash = (hash ^ static_cast<unsigned char>(c)) * 0x100000001b3ULL;
+        }
+        return static_cast<size_t>(mix64(hash));
+    }
+};
+
+/*
+* Template class for a fixed, read-only map whose whole layout is computed by the compiler
+*
+* K = key type, M = mapped type, N = number of elements
+* H = hash function type with a constexpr operator(); defaults to ConstexprHash<K>
+*
+* The elements are kept in the order they were given, and an open-addressing index of
+* kBuckets slots (the power of two at or above 2 * N, so probes stay short) maps hashes to
+* them with linear probing. Both are filled by a constexpr constructor: a constexpr
+* StaticHashMap is constant-initialized, so it needs no startup work and, with trivially
+* destructible K and M, lands in read-only data (.data.rel.ro rather than .rodata when it
+* holds pointers, such as string_view keys, in a position-independent binary). Lookups are
+* constexpr too, so a lookup of a constant key in a constexpr map folds to its result.
+*
+* The lookup API mirrors the const part of HashMap: find, at, contains, count, size,
+* empty, bucket_count and iteration, with iterators being pointers to the elements.
+*
+* Usage:
+*      constexpr auto kHeaders = make_static_hash_map<std::string_view, Header>({
+*          {"content-type", Header::ContentType},
+*          {"content-length", Header::ContentLength},
+*      });
+*      static_assert(kHeaders.at("content-length") == Header::ContentLength);
+*      auto header = kHeaders.find(name);     // at run time
+*      if (header != kHeaders.end()) ...
+*
+* Exceptions: the constructor throws std::invalid_argument on a duplicate key, which in a
+* constexpr context is a compile error; at throws std::out_of_range on a missing key.
+*
+* Concept requirements:
+*      - K and M must be literal types, K equality comparable in constant expressions
+*        (std::string_view rather than std::string).
+*/
+template<typename K, typename M, size_t N, typename H = ConstexprHash<K>>
+class StaticHashMap {
+public:
+    using key_type = K;
+    using mapped_type = M;
+    using value_type = std::pair<const K, M>;
+    using const_iterator = const value_type*;
+    using iterator = const_iterator;
+
+    static constexpr size_t kBuckets = [] {
+        size_t buckets = 1;
+        while (buckets < 2 * N) buckets *= 2;
+        return buckets;
+    }();
+
+    constexpr StaticHashMap(const std::pair<K, M> (&entries)[N], const H& hash = H()) :
+        StaticHashMap(entries, hash, std::make_index_sequence<N>()) {}
+
+    // for tables generated by a constexpr function
+    constexpr StaticHashMap(const std::array<std::pair<K, M>, N>& entries, const H& hash = H()) :
+        StaticHashMap(entries, hash, std::make_index_sequence<N>()) {}
+
+    constexpr const_iterator find(const K& key) const {
+        size_t slot = _hash_function(key) & (kBuckets - 1);
+        // at least half the slots are empty, so every probe sequence ends
+        while (_slots[slot] != 0) {
+            const value_type& entry = _entries[_slots[slot] - 1];
+            if (entry.first == key) return &entry;
+            slot = (slot + 1) & (kBuckets - 1);
+        }
+        return end();
+    }
+
+    constexpr const M& at(const K& key) const {
+        const_iterator entry = find(key);
+        if (entry == end()) throw std::out_of_range("StaticHashMap<K, M, N, H>::at: key not found");
+        return entry->second;
+    }
+
+    constexpr bool contains(const K& key) const { return find(key) != end(); }
+    constexpr size_t count(const K& key) const { return contains(key) ? 1 : 0; }
+
+    constexpr size_t size() const { return N; }
+    constexpr bool empty() const { return N == 0; }
+    constexpr size_t bucket_count() const { return kBuckets; }
+
+    constexpr const_iterator begin() const { return _entries.data(); }
+    constexpr const_iterator end() const { return _entries.data() + N; }
+
+private:
+    template<typename Entries, size_t... I>
+    constexpr StaticHashMap(const Entries& entries, const H& hash, std::index_sequence<I...>) :
+        _hash_function(hash),
+        _entries{{value_type(entries[I].first, entries[I].second)...}},
+        _slots{} {
+        for (size_t index = 0; index < N; index++) {
+            size_t slot = _hash_function(_entries[index].first) & (kBuckets - 1);
+            while (_slots[slot] != 0) {
+                if (_entries[_slots[slot] - 1].first == _entries[index].first) {
+                    throw std::invalid_argument("StaticHashMap: duplicate key");
+                }
+                slot = (slot + 1) & (kBuckets - 1);
+            }
+            _slots[slot] = static_cast<uint32_t>(index + 1);
+        }
+    }
+
+    H _hash_function;
+    std::array<value_type, N> _entries;
+    // 1 + index of the element in each slot, 0 for an empty slot
+    std::array<uint32_t, kBuckets> _slots;
+};
+
+/*
+* Builds a StaticHashMap from a braced list of pairs, deducing the number of elements.
+*
+* Usage:
+*      constexpr auto kOpcodes = make_static_hash_map<uint8_t, Handler>({{0x01, &op_load}, {0x02, &op_store}});
+*      constexpr auto kNames = make_static_hash_map({std::pair{1, "one"}, std::pair{2, "two"}}, MyHash());
+*/
+template<typename K, typename M, size_t N>
+constexpr StaticHashMap<K, M, N> make_static_hash_map(const std::pair<K, M> (&entries)[N]) {
+    return StaticHashMap<K, M, N>(entries);
+}
+
+template<typename K, typename M, size_t N, typename H>
+constexpr StaticHashMap<K, M, N, H> make_static_hash_map(const std::pair<K, M> (&entries)[N], const H& hash) {
+    return StaticHashMap<K, M, N, H>(entries, hash);
+}
+
+#endif
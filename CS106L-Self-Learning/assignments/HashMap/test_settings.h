@@ -67,3 +67,110 @@
 
 // Milestone 5: benchmark (optional)
 #define RUN_TEST_PERF 1
+
+// Hardware counters (cycles, instructions, cache/TLB/branch misses) per operation under the
+// timings of the core benchmarks; prints n/a where perf_event_open is not allowed
+#define RUN_PERF_COUNTERS 1
+
+// Latency percentiles (p50 to max) of insert, find, erase and rehash per table size,
+// recorded by an InstrumentedHashMap
+#define RUN_PERF_LATENCY 1
+
+// Extension 6: sharded concurrent CLOCK cache
+#define RUN_TEST_6A 1
+#define RUN_TEST_6B 1
+#define RUN_TEST_6C 1
+
+// Extension 7: HashSet and HashMultiMap
+#define RUN_TEST_7A 1
+#define RUN_TEST_7B 1
+#define RUN_TEST_7C 1
+#define RUN_TEST_7D 1
+
+// Extension 8: parallel hash aggregation
+#define RUN_TEST_8A 1
+#define RUN_TEST_8B 1
+
+// Extension 9: hash join
+#define RUN_TEST_9A 1
+#define RUN_TEST_9B 1
+#define RUN_TEST_9C 1
+#define RUN_TEST_9D 1
+
+// Extension 10: compact index-based HashMap
+#define RUN_TEST_10A 1
+#define RUN_TEST_10B 1
+#define RUN_TEST_10C 1
+
+// Extension 11: huge-page and NUMA-aware allocation
+#define RUN_TEST_11A 1
+#define RUN_TEST_11B 1
+
+// Extension 12: write-ahead log and crash recovery
+#define RUN_TEST_12A 1
+#define RUN_TEST_12B 1
+
+// Extension 13: persistent hash array mapped trie
+#define RUN_TEST_13A 1
+#define RUN_TEST_13B 1
+
+// Extension 14: Bloom filter front end
+#define RUN_TEST_14A 1
+#define RUN_TEST_14B 1
+#define RUN_TEST_14C 1
+
+// Extension 15: reserve and shrink_to_fit
+#define RUN_TEST_15A 1
+
+// Extension 16: precomputed-hash lookups
+#define RUN_TEST_16A 1
+
+// Extension 17: interleaved batched lookups
+#define RUN_TEST_17A 1
+
+// Extension 18: trivially copyable fast paths
+#define RUN_TEST_18A 1
+#define RUN_TEST_18B 1
+
+// Extension 20: bulk text import and export
+#define RUN_TEST_20A 1
+
+// Extension 21: expiring entries on a timing wheel
+#define RUN_TEST_21A 1
+#define RUN_TEST_21B 1
+#define RUN_TEST_21C 1
+
+// Extension 22: batch hashing kernels
+#define RUN_TEST_22A 1
+
+// Extension 23: hashers and hash quality analysis
+#define RUN_TEST_23A 1
+#define RUN_TEST_23B 1
+
+// Extension 24: sorted chains and read-optimized layout
+#define RUN_TEST_24A 1
+#define RUN_TEST_24B 1
+#define RUN_TEST_24C 1
+#define RUN_TEST_24D 1
+
+// Extension 25: compile-time StaticHashMap
+#define RUN_TEST_25A 1
+
+// Extension 26: latency histograms
+#define RUN_TEST_26A 1
+#define RUN_TEST_26B 1
+
+// Extension 27: multi-version concurrent reads
+#define RUN_TEST_27A 1
+#define RUN_TEST_27B 1
+
+// Extension 28: disk-backed hash table
+#define RUN_TEST_28A 1
+
+// Extension 29: extendible hashing
+#define RUN_TEST_29A 1
+#define RUN_TEST_29B 1
+
+// Extension 30: sorted exports
+#define RUN_TEST_30A 1
+#define RUN_TEST_30B 1
@@ -0,0 +1,418 @@
+#ifndef TTL_HASHMAP_H
+#define TTL_HASHMAP_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <iterator>
+#include <stdexcept>
+#include <vector>
+
+#include "hashmap.h"
+
+/*
+* Template class for a HashMap whose entries expire
+*
+* K = key type
+* M = mapped type
+* H = hash function type used to hash a key; if not provided, defaults to DefaultHash<K>
+* Clock = clock the expiry times are measured on; defaults to std::chrono::steady_clock
+*
+* Every entry carries an expiry time and is linked into a hierarchical timing wheel:
+* kLevels wheels of kSlotsPerLevel slots each, where a slot of level l spans
+* kSlotsPerLevel^l ticks of the given resolution. An entry is filed at the lowest level
+* whose span still reaches its expiry, and moves one level down each time the wheel above
+* turns to its slot, so it is touched at most kLevels times before it is reaped.
+* advance(now) then only visits the slots that became due, never the whole map, so a sweep
+* costs O(expired entries + occupied slots passed) instead of O(N).
+*
+* Expiry is also checked lazily: lookups compare the entry's expiry with Clock::now() and
+* remove an expired entry on the spot, so an entry is never visible after its expiry
+* even if advance has not run since.
+*
+* Usage:
+*      TtlHashMap<SessionId, Session> sessions;
+*      sessions.insert_with_ttl(id, session, std::chrono::minutes(30));
+*      sessions.touch(id, std::chrono::minutes(30));     // on activity
+*      sessions.advance();                                // periodically, reaps due sessions
+*
+* Concept requirements:
+*      - K and M must be default constructible and copyable.
+*      - Clock must meet the C++ Clock requirements (a static now()).
+*/
+template<typename K, typename M, typename H = DefaultHash<K>, typename Clock = std::chrono::steady_clock>
+class TtlHashMap {
+public:
+    using time_point = typename Clock::time_point;
+    using duration = typename Clock::duration;
+
+    /*
+    * Constructor with the wheel resolution, initial bucket count and hash function.
+    * Entries are reaped by the first advance at least one resolution past their expiry.
+    * The wheels cover kSlotsPerLevel^kLevels ticks (about 49 days at 1 ms); entries further
+    * out wait in the last level and are refiled when it turns. bucket_count is only the
+    * starting size of the key index: inserts grow it as the map fills.
+    *
+    * Usage:
+    *      TtlHashMap<int, std::string> map;                               // 1 ms ticks
+    *      TtlHashMap<int, std::string> map(std::chrono::seconds(1), 1 << 16);
+    *
+    * Exceptions: std::out_of_range if resolution is not positive.
+    *
+    * Complexity: O(B), B = number of buckets
+    */
+    explicit TtlHashMap(duration resolution = std::chrono::milliseconds(1),
+                        size_t bucket_count = kDefaultBuckets, const H& hash = H());
+
+    /*
+    * Inserts key with mapped, expiring ttl from now. If key is already in the map and has
+    * not expired, this is a no-op and returns false; an expired entry is replaced.
+    *
+    * Usage:
+    *      map.insert_with_ttl(3, "Avery", std::chrono::seconds(10));
+    *
+    * Complexity: O(1) amortized; an insert that would push the key index past its
+    * max_load_factor() doubles it first, in O(N)
+    */
+    bool insert_with_ttl(const K& key, const M& mapped, duration ttl);
+
+    /*
+    * Moves the expiry of key to ttl from now. Returns false if key is missing or expired.
+    *
+    * Complexity: O(1) average case
+    */
+    bool touch(const K& key, duration ttl);
+
+    /*
+    * Lookups. An expired entry is erased when it is looked up and then reported missing.
+    *
+    * Exceptions: at throws std::out_of_range if key is missing or expired.
+    *
+    * Complexity: O(1) average case
+    */
+    bool contains(const K& key);
+    M& at(const K& key);
+
+    /*
+    * Returns the expiry time of key.
+    *
+    * Exceptions: std::out_of_range if key is missing or expired.
+    */
+    time_point expiry(const K& key);
+
+    /*
+    * Removes key. Returns true if key was in the map (expired or not).
+    */
+    bool erase(const K& key);
+
+    /*
+    * Reaps the entries that expired by now: turns the wheels up to now, cascading entries
+    * down the levels and erasing those whose slot comes due. Stops early after
+    * max_expirations entries; the remaining due entries stay invisible to lookups and are
+    * reaped by the next call. Returns the number of entries reaped.
+    *
+    * Usage:
+    *      size_t reaped = map.advance();                         // everything due
+    *      map.advance(TtlHashMap<int, int>::clock::now(), 1000); // bounded pause
+    *
+    * Complexity: O(E + S), E = entries reaped or cascaded, S = non-empty slots passed
+    */
+    size_t advance(time_point now = Clock::now(), size_t max_expirations = std::numeric_limits<size_t>::max());
+
+    /*
+    * Number of entries, including expired ones that have not been reaped or looked up yet.
+    */
+    size_t size() const;
+    bool empty() const;
+
+    /*
+    * Number of buckets in the key index.
+    */
+    size_t bucket_count() const;
+
+    /*
+    * Removes every entry. The wheels keep their position.
+    */
+    void clear();
+
+    using clock = Clock;
+
+private:
+    static constexpr size_t kDefaultBuckets = 10;
+    static constexpr size_t kLevels = 4;
+    static constexpr size_t kSlotBits = 8;
+    static constexpr size_t kSlotsPerLevel = size_t(1) << kSlotBits;
+    static constexpr size_t kNil = std::numeric_limits<size_t>::max();
+
+    /*
+    * One entry, linked into the doubly linked list of its wheel slot by index, so entries
+    * can be unlinked in O(1) and the pool can be copied and moved as a plain vector.
+    */
+    struct Entry {
+        K key;
+        M mapped;
+        time_point expiry;
+        uint64_t expiry_tick = 0;
+        size_t slot = kNil;
+        size_t prev = kNil;
+        size_t next = kNil;
+    };
+
+    uint64_t tick_of(time_point time, bool round_up) const;
+    // files entry into the slot for its expiry tick, relative to _next_tick
+    void link(size_t entry);
+    void unlink(size_t entry);
+    void remove(size_t entry);
+    // returns the entry for key after lazily expiring it, or kNil
+    size_t find_live(const K& key);
+    // refiles every entry of one slot of a level above 0
+    void cascade(size_t level, size_t index);
+    // first tick at or after tick at which an occupied slot of level comes due
+    uint64_t next_due_tick(size_t level, uint64_t tick) const;
+
+    duration _resolution;
+    time_point _origin;
+    // ticks before _next_tick have been processed
+    uint64_t _next_tick = 0;
+    uint64_t _cascaded_tick = kNil;
+    HashMap<K, size_t, H> _index;
+    std::vector<Entry> _entries;
+    std::vector<size_t> _free_entries;
+    std::vector<size_t> _slots;
+    // one bit per non-empty slot, so empty stretches of the wheels are skipped in one step
+    uint64_t _occupied[kLevels * kSlotsPerLevel / 64] = {};
+};
+
+template<typename K, typename M, typename H, typename Clock>
+TtlHashMap<K, M, H, Clock>::TtlHashMap(duration resolution, size_t bucket_count, const H& hash) :
+    _resolution(resolution),
+    _origin(Clock::now()),
+    _index(bucket_count, hash),
+    _slots(kLevels * kSlotsPerLevel, kNil) {
+    if (resolution <= duration::zero()) {
+        throw std::out_of_range("TtlHashMap: resolution must be positive");
+    }
+}
+
+template<typename K, typename M, typename H, typename Clock>
+bool TtlHashMap<K, M, H, Clock>::insert_with_ttl(const K& key, const M& mapped, duration ttl) {
+    if (find_live(key) != kNil) return false;
+    size_t entry;
+    if (_free_entries.empty()) {
+        entry = _entries.size();
+        _entries.emplace_back();
+    } else {
+        entry = _free_entries.back();
+        _free_entries.pop_back();
+    }
+    Entry& slot_entry = _entries[entry];
+    slot_entry.key = key;
+    slot_entry.mapped = mapped;
+    slot_entry.expiry = Clock::now() + ttl;
+    slot_entry.expiry_tick = tick_of(slot_entry.expiry, true);
+    link(entry);
+    // HashMap never rehashes on its own, so grow the index geometrically here: a map that
+    // outlives many ttls would otherwise end up with chains as long as size() / bucket_count
+    if (_index.size() + 1 > _index.bucket_count() * _index.max_load_factor()) {
+        _index.reserve(2 * (_index.size() + 1));
+    }
+    _index.insert({key, entry});
+    return true;
+}
+
+template<typename K, typename M, typename H, typename Clock>
+bool TtlHashMap<K, M, H, Clock>::touch(const K& key, duration ttl) {
+    size_t entry = find_live(key);
+    if (entry == kNil) return false;
+    unlink(entry);
+    _entries[entry].expiry = Clock::now() + ttl;
+    _entries[entry].expiry_tick = tick_of(_entries[entry].expiry, true);
+    link(entry);
+    return true;
+}
+
+template<typename K, typename M, typename H, typename Clock>
+bool TtlHashMap<K, M, H, Clock>::contains(const K& key) {
+    return find_live(key) != kNil;
+}
+
+template<typename K, typename M, typename H, typename Clock>
+M& TtlHashMap<K, M, H, Clock>::at(const K& key) {
+    size_t entry = find_live(key);
+    if (entry == kNil) throw std::out_of_range("TtlHashMap<K, M, H, Clock>::at: key not found or expired");
+    return _entries[entry].mapped;
+}
+
+template<typename K, typename M, typename H, typename Clock>
+typename TtlHashMap<K, M, H, Clock>::time_point TtlHashMap<K, M, H, Clock>::expiry(const K& key) {
+    size_t entry = find_live(key);
+    if (entry == kNil) throw std::out_of_range("TtlHashMap<K, M, H, Clock>::expiry: key not found or expired");
+    return _entries[entry].expiry;
+}
+
+template<typename K, typename M, typename H, typename Clock>
+bool TtlHashMap<K, M, H, Clock>::erase(const K& key) {
+    auto found = _index.find(key);
+    if (found == _index.end()) return false;
+    remove(found->second);
+    return true;
+}
+
+template<typename K, typename M, typename H, typename Clock>
+size_t TtlHashMap<K, M, H, Clock>::advance(time_point now, size_t max_expirations) {
+    uint64_t target = tick_of(now, false);
+    size_t reaped = 0;
+    while (_next_tick <= target) {
+        if (_index.empty()) {
+            _next_tick = target + 1;
+            break;
+        }
+        // higher levels first: a level 2 slot can refile entries into the level 1 slot due now
+        if (_cascaded_tick != _next_tick) {
+            for (size_t level = kLevels - 1; level > 0; level--) {
+                uint64_t span = uint64_t(1) << (kSlotBits * level);
+                if (_next_tick % span == 0) {
+                    cascade(level, (_next_tick >> (kSlotBits * level)) & (kSlotsPerLevel - 1));
+                }
+            }
+            _cascaded_tick = _next_tick;
+        }
+
+        size_t& head = _slots[_next_tick & (kSlotsPerLevel - 1)];
+        while (head != kNil) {
+            if (reaped == max_expirations) return reaped;
+            remove(head);
+            reaped++;
+        }
+
+        // jump straight to the next tick with a slot to reap or cascade
+        uint64_t next = target + 1;
+        for (size_t level = 0; level < kLevels; level++) {
+            next = std::min(next, next_due_tick(level, _next_tick + 1));
+        }
+        _next_tick = next;
+    }
+    return reaped;
+}
+
+template<typename K, typename M, typename H, typename Clock>
+size_t TtlHashMap<K, M, H, Clock>::size() const {
+    return _index.size();
+}
+
+template<typename K, typename M, typename H, typename Clock>
+bool TtlHashMap<K, M, H, Clock>::empty() const {
+    return _index.empty();
+}
+
+template<typename K, typename M, typename H, typename Clock>
+size_t TtlHashMap<K, M, H, Clock>::bucket_count() const {
+    return _index.bucket_count();
+}
+
+template<typename K, typename M, typename H, typename Clock>
+void TtlHashMap<K, M, H, Clock>::clear() {
+    _index.clear();
+    _entries.clear();
+    _free_entries.clear();
+    std::fill(_slots.begin(), _slots.end(), kNil);
+    std::fill(std::begin(_occupied), std::end(_occupied), 0);
+}
+
+template<typename K, typename M, typename H, typename Clock>
+uint64_t TtlHashMap<K, M, H, Clock>::tick_of(time_point time, bool round_up) const {
+    if (time <= _origin) return 0;
+    auto elapsed = (time - _origin).count();
+    auto resolution = _resolution.count();
+    return static_cast<uint64_t>(round_up ? (elapsed + resolution - 1) / resolution : elapsed / resolution);
+}
+
+template<typename K, typename M, typename H, typename Clock>
+void TtlHashMap<K, M, H, Clock>::link(size_t entry) {
+    Entry& node = _entries[entry];
+    // an entry that is already due goes into the next slot to be processed
+    uint64_t tick = std::max(node.expiry_tick, _next_tick);
+    uint64_t delta = tick - _next_tick;
+    size_t level = 0;
+    while (level + 1 < kLevels && delta >= (uint64_t(1) << (kSlotBits * (level + 1)))) level++;
+    if (level == kLevels - 1 && delta >= (uint64_t(1) << (kSlotBits * kLevels))) {
+        // beyond the last wheel: park in the furthest slot, refiled when it comes round
+        tick = _next_tick + (uint64_t(1) << (kSlotBits * kLevels)) - 1;
+    }
+    size_t index = (tick >> (kSlotBits * level)) & (kSlotsPerLevel - 1);
+    node.slot = level * kSlotsPerLevel + index;
+    node.prev = kNil;
+    node.next = _slots[node.slot];
+    if (node.next != kNil) _entries[node.next].prev = entry;
+    _slots[node.slot] = entry;
+    _occupied[node.slot / 64] |= uint64_t(1) << (node.slot % 64);
+}
+
+template<typename K, typename M, typename H, typename Clock>
+void TtlHashMap<K, M, H, Clock>::unlink(size_t entry) {
+    Entry& node = _entries[entry];
+    if (node.prev != kNil) {
+        _entries[node.prev].next = node.next;
+    } else {
+        _slots[node.slot] = node.next;
+        if (node.next == kNil) _occupied[node.slot / 64] &= ~(uint64_t(1) << (node.slot % 64));
+    }
+    if (node.next != kNil) _entries[node.next].prev = node.prev;
+    node.slot = node.prev = node.next = kNil;
+}
+
+template<typename K, typename M, typename H, typename Clock>
+void TtlHashMap<K, M, H, Clock>::remove(size_t entry) {
+    unlink(entry);
+    _index.erase(_entries[entry].key);
+    // release whatever the key and value own right away
+    _entries[entry].key = K();
+    _entries[entry].mapped = M();
+    _free_entries.push_back(entry);
+}
+
+template<typename K, typename M, typename H, typename Clock>
+size_t TtlHashMap<K, M, H, Clock>::find_live(const K& key) {
+    auto found = _index.find(key);
+    if (found == _index.end()) return kNil;
+    size_t entry = found->second;
+    if (_entries[entry].expiry <= Clock::now()) {
+        remove(entry);
+        return kNil;
+    }
+    return entry;
+}
+
+template<typename K, typename M, typename H, typename Clock>
+void TtlHashMap<K, M, H, Clock>::cascade(size_t level, size_t index) {
+    size_t entry = _slots[level * kSlotsPerLevel + index];
+    _slots[level * kSlotsPerLevel + index] = kNil;
+    _occupied[(level * kSlotsPerLevel + index) / 64] &= ~(uint64_t(1) << (index % 64));
+    while (entry != kNil) {
+        size_t next = _entries[entry].next;
+        link(entry);
+        entry = next;
+    }
+}
+
+template<typename K, typename M, typename H, typename Clock>
+uint64_t TtlHashMap<K, M, H, Clock>::next_due_tick(size_t level, uint64_t tick) const {
+    // slot i of level l comes due on the ticks that are multiples of kSlotsPerLevel^l
+    // with i in the next kSlotBits bits; search from the first such tick, wrapping once
+    size_t shift = kSlotBits * level;
+    uint64_t unit = (tick + (uint64_t(1) << shift) - 1) >> shift;
+    size_t start = unit & (kSlotsPerLevel - 1);
+    const uint64_t* bits = _occupied + level * kSlotsPerLevel / 64;
+    for (size_t offset = 0; offset < kSlotsPerLevel; ) {
+        size_t index = (start + offset) & (kSlotsPerLevel - 1);
+        uint64_t word = bits[index / 64] >> (index % 64);
+        if (word != 0) {
+            return (unit + offset + __builtin_ctzll(word)) << shift;
+        }
+        offset += 64 - index % 64;
+    }
+    return std::numeric_limits<uint64_t>::max();
+}
+
+#endif